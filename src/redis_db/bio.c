@@ -23,6 +23,9 @@
  *
  * (译注：现在不止 close(2) ，连 AOF 文件的 fsync 也是放到后台执行的）
  *
+ * 惰性释放(UNLINK、FLUSHDB ASYNC等)也在后台执行，
+ * 大的值对象以及被清空的整个数据库由 REDIS_BIO_LAZY_FREE 线程释放。
+ *
  * In the future we'll either continue implementing new things we need or
  * we'll switch to libeio. However there are probably long term uses for this
  * file as we may want to put here Redis specific background tasks (for instance
@@ -255,6 +258,15 @@ void *bioProcessBackgroundJobs(void *arg) {
             // 宏定义: 用fdatasync系统调用替换
             aof_fsync((long)job->arg1);
 
+        } else if (type == REDIS_BIO_LAZY_FREE) {
+            // arg1为对象(arg3为其估算的字节数)，arg2和arg3为数据库的两个字典，只有arg3时为基数树索引
+            if (job->arg1)
+                lazyfreeFreeObjectFromBioThread(job->arg1, (size_t)job->arg3);
+            else if (job->arg2 && job->arg3)
+                lazyfreeFreeDatabaseFromBioThread(job->arg2, job->arg3);
+            else if (job->arg3)
+                lazyfreeFreeRaxFromBioThread(job->arg3);
+
         } else {
             printf("Wrong job type in bioProcessBackgroundJobs().\n");
             exit(1);
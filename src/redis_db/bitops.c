@@ -0,0 +1,1179 @@
+//
+// Created by zouyi on 2021/11/15.
+//
+
+#include "redis.h"
+#include <stdint.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define HAVE_X86_POPCOUNT_KERNELS 1
+#endif
+
+/*
+ * 位操作命令: SETBIT，GETBIT，BITCOUNT，BITPOS，BITOP，BITFIELD
+ *
+ * 位图就是普通的字符串，第0位是第一个字节的最高位；
+ * 写操作通过dbUnshareStringValue在原对象上修改，读操作直接访问sds，整数编码的字符串转换到栈上的缓冲区
+ */
+
+/* -----------------------------------------------------------------------------
+ * Helpers and low level bit functions.
+ * -------------------------------------------------------------------------- */
+
+/*
+ * 每个字节中1的个数
+ */
+static const unsigned char bitsinbyte[256] = {
+            0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,
+            1,2,2,3,2,3,3,4,2,3,3,4,3,4,4,5,
+            1,2,2,3,2,3,3,4,2,3,3,4,3,4,4,5,
+            2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,
+            1,2,2,3,2,3,3,4,2,3,3,4,3,4,4,5,
+            2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,
+            2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,
+            3,4,4,5,4,5,5,6,4,5,5,6,5,6,6,7,
+            1,2,2,3,2,3,3,4,2,3,3,4,3,4,4,5,
+            2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,
+            2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,
+            3,4,4,5,4,5,5,6,4,5,5,6,5,6,6,7,
+            2,3,3,4,3,4,4,5,3,4,4,5,4,5,5,6,
+            3,4,4,5,4,5,5,6,4,5,5,6,5,6,6,7,
+            3,4,4,5,4,5,5,6,4,5,5,6,5,6,6,7,
+            4,5,5,6,5,6,6,7,5,6,6,7,6,7,7,8
+};
+
+/*
+ * 一个64位字中1的个数，并行计数(SWAR)
+ */
+static inline size_t popcount64(uint64_t x) {
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (x * 0x0101010101010101ULL) >> 56;
+}
+
+/*
+ * 不依赖特定指令的实现，每次处理32个字节，剩余的字节查表
+ */
+static size_t popcountPortable(const unsigned char* p, long count) {
+    size_t bits = 0;
+    uint64_t w[4];
+
+    while (count >= 32) {
+        memcpy(w, p, sizeof(w));
+        bits += popcount64(w[0]) + popcount64(w[1]) + popcount64(w[2]) + popcount64(w[3]);
+        p += 32;
+        count -= 32;
+    }
+    while (count-- > 0) bits += bitsinbyte[*p++];
+    return bits;
+}
+
+#ifdef HAVE_X86_POPCOUNT_KERNELS
+
+/*
+ * 使用POPCNT指令，每次处理32个字节
+ */
+__attribute__((target("popcnt")))
+static size_t popcountPopcnt(const unsigned char* p, long count) {
+    size_t bits = 0;
+    uint64_t w[4];
+
+    while (count >= 32) {
+        memcpy(w, p, sizeof(w));
+        bits += __builtin_popcountll(w[0]) + __builtin_popcountll(w[1]) +
+                __builtin_popcountll(w[2]) + __builtin_popcountll(w[3]);
+        p += 32;
+        count -= 32;
+    }
+    while (count-- > 0) bits += __builtin_popcount(*p++);
+    return bits;
+}
+
+/*
+ * 使用AVX2的查表法(Mula)，每次处理32个字节:
+ * 每个字节的高低4位分别通过VPSHUFB在16项的表中查出1的个数，按字节累加，
+ * 每个字节的累加值最多8 * 31 = 248，每31次迭代用VPSADBW归并到4个64位计数器中
+ */
+__attribute__((target("avx2")))
+static size_t popcountAvx2(const unsigned char* p, long count) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    __m256i acc = _mm256_setzero_si256();
+    uint64_t lanes[4];
+    int i;
+
+    while (count >= 32) {
+        __m256i local = _mm256_setzero_si256();
+
+        for (i = 0; i < 31 && count >= 32; i++) {
+            __m256i v = _mm256_loadu_si256((const __m256i*) p);
+            __m256i lo = _mm256_and_si256(v, low_mask);
+            __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+
+            local = _mm256_add_epi8(local, _mm256_shuffle_epi8(lookup, lo));
+            local = _mm256_add_epi8(local, _mm256_shuffle_epi8(lookup, hi));
+            p += 32;
+            count -= 32;
+        }
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(local, _mm256_setzero_si256()));
+    }
+    _mm256_storeu_si256((__m256i*) lanes, acc);
+
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + popcountPortable(p, count);
+}
+
+#endif
+
+/*
+ * 短的字符串和长的字符串分别使用的实现，第一次调用时根据CPU支持的指令选择
+ */
+static size_t (*popcountSmall)(const unsigned char* p, long count) = NULL;
+static size_t (*popcountLarge)(const unsigned char* p, long count) = NULL;
+
+// 不短于这个长度时使用AVX2，更短时启动和归并的开销比POPCNT更大
+#define POPCOUNT_AVX2_MIN_BYTES 256
+
+static void popcountSelectKernels(void) {
+    popcountSmall = popcountPortable;
+    popcountLarge = popcountPortable;
+
+#ifdef HAVE_X86_POPCOUNT_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("popcnt"))
+        popcountSmall = popcountLarge = popcountPopcnt;
+    if (__builtin_cpu_supports("avx2"))
+        popcountLarge = popcountAvx2;
+#endif
+}
+
+/*
+ * 计算从s开始的count个字节中1的个数
+ */
+/* Count number of bits set in the binary array pointed by 's' and long
+ * 'count' bytes. The implementation of this function is required to
+ * work with a input string length up to 512 MB. */
+size_t redisPopcount(void* s, long count) {
+    if (popcountSmall == NULL) popcountSelectKernels();
+
+    if (count >= POPCOUNT_AVX2_MIN_BYTES)
+        return popcountLarge(s, count);
+    return popcountSmall(s, count);
+}
+
+/*
+ * 返回从s开始的count个字节中第一个值为bit的位的位置，
+ * 查找1而全部是0时返回-1，查找0而全部是1时返回count * 8，即把字符串右边看作用0填充
+ */
+/* Return the position of the first bit set to one (if 'bit' is 1) or
+ * zero (if 'bit' is 0) in the bitmap starting at 's' and long 'count' bytes.
+ *
+ * The function is guaranteed to return a value >= 0 if 'bit' is 0 since if
+ * no zero bit is found, it returns count*8 assuming the string is zero
+ * padded on the right. However if 'bit' is 1 it is possible that there is
+ * not a single set bit in the bitmap. In this special case -1 is returned. */
+long redisBitpos(void* s, unsigned long count, int bit) {
+    unsigned long* l;
+    unsigned char* c;
+    unsigned long skipval, word = 0, one;
+    long pos = 0; /* Position of bit, to return to the caller. */
+    unsigned long j;
+
+    // 先按字节跳过没有对齐的部分，再按字跳过全0(查找1时)或者全1(查找0时)的字
+    /* Skip initial bits not aligned to sizeof(unsigned long) byte by byte. */
+    skipval = bit ? 0 : UCHAR_MAX;
+    c = (unsigned char*) s;
+    while ((unsigned long) c & (sizeof(*l) - 1) && count) {
+        if (*c != skipval) break;
+        c++;
+        count--;
+        pos += 8;
+    }
+
+    /* Skip bits with full word step. */
+    skipval = bit ? 0 : ULONG_MAX;
+    l = (unsigned long*) c;
+    if (((unsigned long) c & (sizeof(*l) - 1)) == 0) {
+        while (count >= sizeof(*l)) {
+            if (*l != skipval) break;
+            l++;
+            count -= sizeof(*l);
+            pos += sizeof(*l) * 8;
+        }
+    }
+
+    // 把剩下的最多一个字的字节按大端序装入word，不足一个字时右边补0
+    /* Load bytes into "word" considering the first byte as the most significant
+     * (we basically consider it as written in big endian, since we consider the
+     * string as a set of bits from left to right, with the first bit at position
+     * zero.
+     *
+     * Note that the loading is designed to work even when the bytes left
+     * (count) are less than a full word. We pad it with zero on the right. */
+    c = (unsigned char*) l;
+    for (j = 0; j < sizeof(*l); j++) {
+        word <<= 8;
+        if (count) {
+            word |= *c;
+            c++;
+            count--;
+        }
+    }
+
+    /* Special case:
+     * If bits in the string are all zero and we are looking for one,
+     * return -1 to signal that there is not a single "1" in the whole
+     * string. This can't happen when we are looking for "0" as we assume
+     * that the right of the string is zero padded. */
+    if (bit == 1 && word == 0) return -1;
+
+    /* Last word left, scan bit by bit. The first thing we need is to
+     * have a single "1" set in the most significant position in an
+     * unsigned long. We don't know the size of the long so we use a
+     * simple trick. */
+    one = ULONG_MAX; /* All bits set to 1.*/
+    one >>= 1;       /* All bits set to 1 but the MSB. */
+    one = ~one;      /* All bits set to 0 but the MSB. */
+
+    while (one) {
+        if (((one & word) != 0) == bit) return pos;
+        pos++;
+        one >>= 1;
+    }
+
+    /* If we reached this point, there is a bug in the algorithm, since
+     * the case of no match is handled as a special case before. */
+    assert(0);
+    return 0; /* Just to avoid warnings. */
+}
+
+/*
+ * BITFIELD使用的整数读写，offset是位偏移量，bits是整数的位数，高位在前
+ */
+/* The following set.*Bitfield and get.*Bitfield functions implement setting
+ * and getting arbitrary size (up to 64 bits) signed and unsigned integers
+ * at arbitrary positions into a bitmap.
+ *
+ * The representation considers the bitmap as an array of bits, from left to
+ * right, and the integer is stored in the specified position with the most
+ * significant bit first. */
+static void setUnsignedBitfield(unsigned char* p, uint64_t offset, uint64_t bits, uint64_t value) {
+    uint64_t byte, bit, byteval, bitval, j;
+
+    for (j = 0; j < bits; j++) {
+        bitval = (value & ((uint64_t) 1 << (bits - 1 - j))) != 0;
+        byte = offset >> 3;
+        bit = 7 - (offset & 0x7);
+        byteval = p[byte];
+        byteval &= ~(1 << bit);
+        byteval |= bitval << bit;
+        p[byte] = byteval & 0xff;
+        offset++;
+    }
+}
+
+static void setSignedBitfield(unsigned char* p, uint64_t offset, uint64_t bits, int64_t value) {
+    uint64_t uv = value; /* Casting will add UINT64_MAX + 1 if v is negative. */
+    setUnsignedBitfield(p, offset, bits, uv);
+}
+
+static uint64_t getUnsignedBitfield(unsigned char* p, uint64_t offset, uint64_t bits) {
+    uint64_t byte, bit, byteval, bitval, j, value = 0;
+
+    for (j = 0; j < bits; j++) {
+        byte = offset >> 3;
+        bit = 7 - (offset & 0x7);
+        byteval = p[byte];
+        bitval = (byteval >> bit) & 1;
+        value = (value << 1) | bitval;
+        offset++;
+    }
+    return value;
+}
+
+static int64_t getSignedBitfield(unsigned char* p, uint64_t offset, uint64_t bits) {
+    int64_t value;
+    union {
+        uint64_t u;
+        int64_t i;
+    } conv;
+
+    /* Converting from unsigned to signed is undefined when the value does
+     * not fit, however here we assume two's complement and the original value
+     * was obtained from signed -> unsigned conversion, so we'll find the
+     * most significant bit set if the original value was negative.
+     *
+     * Note that two's complement is mandatory for exact-width types
+     * according to the C99 standard. */
+    conv.u = getUnsignedBitfield(p, offset, bits);
+    value = conv.i;
+
+    /* If the top significant bit is 1, propagate it to all the
+     * higher bits for two's complement representation of signed
+     * integers. */
+    if (bits < 64 && (value & ((uint64_t) 1 << (bits - 1))))
+        value |= ((uint64_t) -1) << bits;
+    return value;
+}
+
+/*
+ * BITFIELD的溢出处理方式: 回绕，饱和，失败(不写入并回复空)
+ */
+#define BFOVERFLOW_WRAP 0
+#define BFOVERFLOW_SAT 1
+#define BFOVERFLOW_FAIL 2 /* Used by the BITFIELD command implementation. */
+
+/*
+ * 检查value加上incr之后是否超出bits位整数的范围，上溢返回1，下溢返回-1，没有溢出返回0；
+ * 溢出且limit不为NULL时，WRAP和SAT在limit中返回回绕或者饱和之后的值
+ */
+/* If there is no overflow or underflow, 0 is returned. On overflow
+ * 1 is returned, on underflow -1 is returned.
+ *
+ * When an overflow or underflow is returned, if 'limit' is not NULL,
+ * it is set to the value the operation should result when an overflow
+ * happens, depending on the specified overflow semantics:
+ *
+ * For BFOVERFLOW_SAT if 1 is returned, *limit it is set maximum value that
+ * you can store in that integer. when -1 is returned, *limit is set to the
+ * minimum value that an integer of that size can represent.
+ *
+ * For BFOVERFLOW_WRAP *limit is set by performing the operation in order to
+ * "wrap" around towards zero for unsigned integers, or towards the most
+ * negative number that is possible to represent for signed integers. */
+static int checkUnsignedBitfieldOverflow(uint64_t value, int64_t incr, uint64_t bits, int owtype, uint64_t* limit) {
+    uint64_t max = (bits == 64) ? UINT64_MAX : (((uint64_t) 1 << bits) - 1);
+    int64_t maxincr = max - value;
+    int64_t minincr = -value;
+
+    if (value > max || (incr > 0 && incr > maxincr)) {
+        if (limit) {
+            if (owtype == BFOVERFLOW_WRAP) {
+                goto handle_wrap;
+            } else if (owtype == BFOVERFLOW_SAT) {
+                *limit = max;
+            }
+        }
+        return 1;
+    } else if (incr < 0 && incr < minincr) {
+        if (limit) {
+            if (owtype == BFOVERFLOW_WRAP) {
+                goto handle_wrap;
+            } else if (owtype == BFOVERFLOW_SAT) {
+                *limit = 0;
+            }
+        }
+        return -1;
+    }
+    return 0;
+
+handle_wrap:
+    {
+        uint64_t mask = ((uint64_t) -1) << bits;
+        uint64_t res = value + incr;
+
+        res &= ~mask;
+        *limit = res;
+    }
+    return 1;
+}
+
+static int checkSignedBitfieldOverflow(int64_t value, int64_t incr, uint64_t bits, int owtype, int64_t* limit) {
+    int64_t max = (bits == 64) ? INT64_MAX : (((int64_t) 1 << (bits - 1)) - 1);
+    int64_t min = (-max) - 1;
+
+    /* Note that maxincr and minincr could overflow, but we use the values
+     * only after checking 'value' range, so when we use it no overflow
+     * happens. The 'uint64_t' casts are there just to prevent undefined
+     * behavior on overflow. */
+    int64_t maxincr = (uint64_t) max - (uint64_t) value;
+    int64_t minincr = (uint64_t) min - (uint64_t) value;
+
+    if (value > max || (bits != 64 && incr > maxincr) || (value >= 0 && incr > 0 && incr > maxincr)) {
+        if (limit) {
+            if (owtype == BFOVERFLOW_WRAP) {
+                goto handle_wrap;
+            } else if (owtype == BFOVERFLOW_SAT) {
+                *limit = max;
+            }
+        }
+        return 1;
+    } else if (value < min || (bits != 64 && incr < minincr) || (value < 0 && incr < 0 && incr < minincr)) {
+        if (limit) {
+            if (owtype == BFOVERFLOW_WRAP) {
+                goto handle_wrap;
+            } else if (owtype == BFOVERFLOW_SAT) {
+                *limit = min;
+            }
+        }
+        return -1;
+    }
+    return 0;
+
+handle_wrap:
+    {
+        uint64_t msb = (uint64_t) 1 << (bits - 1);
+        uint64_t a = value, b = incr, c;
+        c = a + b; /* Perform addition as unsigned so that's defined. */
+
+        /* If the sign bit is set, propagate to all the higher order
+         * bits, to cap the negative value. If it's clear, mask to
+         * the positive integer limit. */
+        if (bits < 64) {
+            uint64_t mask = ((uint64_t) -1) << bits;
+            if (c & msb) {
+                c |= mask;
+            } else {
+                c &= ~mask;
+            }
+        }
+        *limit = c;
+    }
+    return 1;
+}
+
+/* -----------------------------------------------------------------------------
+ * Bits related string commands: GETBIT, SETBIT, BITCOUNT, BITOP.
+ * -------------------------------------------------------------------------- */
+
+#define BITOP_AND   0
+#define BITOP_OR    1
+#define BITOP_XOR   2
+#define BITOP_NOT   3
+
+#define BITFIELDOP_GET 0
+#define BITFIELDOP_SET 1
+#define BITFIELDOP_INCRBY 2
+
+/*
+ * 解析位偏移量，偏移量为负数或者超出512MB时回复错误；
+ * hash为真时接受"#N"形式，表示第N个bits位的整数，偏移量为N * bits
+ */
+/* This helper function used by GETBIT / SETBIT parses the bit offset argument
+ * making sure an error is returned if it is negative or if it overflows
+ * Redis 512 MB limit for the string value.
+ *
+ * If the 'hash' argument is true, and 'bits is positive, then the command
+ * will also parse bit offsets prefixed by "#". In such a case the offset
+ * is multiplied by 'bits'. This is useful for the BITFIELD command. */
+static int getBitOffsetFromArgument(redisClient* c, robj* o, size_t* offset, int hash, int bits) {
+    long long loffset;
+    char* err = "bit offset is not an integer or out of range";
+    char* p = o->ptr;
+    size_t plen = sdslen(p);
+    int usehash = 0;
+
+    /* Handle #<offset> form. */
+    if (p[0] == '#' && hash && bits > 0) usehash = 1;
+
+    if (string2ll(p + usehash, plen - usehash, &loffset) == 0 || loffset < 0) {
+        addReplyError(c, err);
+        return REDIS_ERR;
+    }
+
+    /* Adjust the offset by 'bits' for #<offset> form. */
+    if (usehash) {
+        if (loffset > LLONG_MAX / bits) {
+            addReplyError(c, err);
+            return REDIS_ERR;
+        }
+        loffset *= bits;
+    }
+
+    /* Limit offset to 512MB in bytes */
+    if (((unsigned long long) loffset >> 3) >= (512 * 1024 * 1024)) {
+        addReplyError(c, err);
+        return REDIS_ERR;
+    }
+
+    *offset = (size_t) loffset;
+    return REDIS_OK;
+}
+
+/*
+ * 解析BITFIELD的整数类型，i1到i64或者u1到u63
+ */
+/* This helper function for BITFIELD parses a bitfield type in the form
+ * <sign><bits> where sign is 'u' or 'i' for unsigned and signed, and
+ * the bits is a value between 1 and 64. However 64 bits unsigned integers
+ * are reported as an error because of current limitations of Redis protocol
+ * to return unsigned integer values greater than INT64_MAX. */
+static int getBitfieldTypeFromArgument(redisClient* c, robj* o, int* sign, int* bits) {
+    char* p = o->ptr;
+    char* err = "Invalid bitfield type. Use something like i16 u8. Note that u64 is not supported but i64 is.";
+    long long llbits;
+
+    if (p[0] == 'i') {
+        *sign = 1;
+    } else if (p[0] == 'u') {
+        *sign = 0;
+    } else {
+        addReplyError(c, err);
+        return REDIS_ERR;
+    }
+
+    if ((string2ll(p + 1, strlen(p + 1), &llbits)) == 0 ||
+        llbits < 1 ||
+        (*sign == 1 && llbits > 64) ||
+        (*sign == 0 && llbits > 63)) {
+        addReplyError(c, err);
+        return REDIS_ERR;
+    }
+    *bits = llbits;
+    return REDIS_OK;
+}
+
+/*
+ * 写位的命令使用，键不存在时创建，长度不够访问第maxbit位时用0补齐，
+ * 返回可以原地修改的字符串对象，键不是字符串时回复错误并返回NULL
+ */
+/* This is an helper function for commands implementations that need to write
+ * bits to a string object. The command creates or pad with zeroes the string
+ * so that the 'maxbit' bit can be addressed. The object is finally
+ * returned. Otherwise if the key holds a wrong type NULL is returned and
+ * an error is sent to the client. */
+static robj* lookupStringForBitCommand(redisClient* c, size_t maxbit) {
+    size_t byte = maxbit >> 3;
+    robj* o = lookupKeyWrite(c->db, c->argv[1]);
+
+    if (o == NULL) {
+        o = createObject(REDIS_STRING, sdsnewlen(NULL, byte + 1));
+        dbAdd(c->db, c->argv[1], o);
+    } else {
+        if (checkType(c, o, REDIS_STRING)) return NULL;
+        o = dbUnshareStringValue(c->db, c->argv[1], o);
+        o->ptr = sdsgrowzero(o->ptr, byte + 1);
+    }
+    return o;
+}
+
+/*
+ * 取字符串对象的内容和长度，不复制：RAW和EMBSTR编码直接返回sds，整数编码转换到调用者提供的缓冲区llbuf
+ */
+static unsigned char* getObjectReadOnlyString(robj* o, long* len, char* llbuf) {
+    if (o->encoding == REDIS_ENCODING_INT) {
+        *len = ll2string(llbuf, 32, (long) o->ptr);
+        return (unsigned char*) llbuf;
+    }
+    *len = sdslen(o->ptr);
+    return o->ptr;
+}
+
+/*
+ * SETBIT命令
+ *
+ * SETBIT key offset value
+ */
+/* SETBIT key offset bitvalue */
+void setbitCommand(redisClient* c) {
+    robj* o;
+    char* err = "bit is not an integer or out of range";
+    size_t bitoffset;
+    ssize_t byte, bit;
+    int byteval, bitval;
+    long on;
+
+    if (getBitOffsetFromArgument(c, c->argv[2], &bitoffset, 0, 0) != REDIS_OK)
+        return;
+
+    if (getLongFromObjectOrReply(c, c->argv[3], &on, err) != REDIS_OK)
+        return;
+
+    /* Bits can only be set or cleared... */
+    if (on & ~1) {
+        addReplyError(c, err);
+        return;
+    }
+
+    if ((o = lookupStringForBitCommand(c, bitoffset)) == NULL) return;
+
+    /* Get current values */
+    byte = bitoffset >> 3;
+    byteval = ((uint8_t*) o->ptr)[byte];
+    bit = 7 - (bitoffset & 0x7);
+    bitval = byteval & (1 << bit);
+
+    /* Update byte with new bit value and return original value */
+    byteval &= ~(1 << bit);
+    byteval |= ((on & 0x1) << bit);
+    ((uint8_t*) o->ptr)[byte] = byteval;
+    signalModifiedKey(c->db, c->argv[1]);
+    server.dirty++;
+    addReply(c, bitval ? shared.cone : shared.czero);
+}
+
+/*
+ * GETBIT命令
+ *
+ * GETBIT key offset
+ */
+/* GETBIT key offset */
+void getbitCommand(redisClient* c) {
+    robj* o;
+    char llbuf[32];
+    size_t bitoffset;
+    size_t byte, bit;
+    size_t bitval = 0;
+
+    if (getBitOffsetFromArgument(c, c->argv[2], &bitoffset, 0, 0) != REDIS_OK)
+        return;
+
+    if ((o = lookupKeyReadOrReply(c, c->argv[1], shared.czero)) == NULL ||
+        checkType(c, o, REDIS_STRING))
+        return;
+
+    byte = bitoffset >> 3;
+    bit = 7 - (bitoffset & 0x7);
+    if (sdsEncodedObject(o)) {
+        if (byte < sdslen(o->ptr))
+            bitval = ((uint8_t*) o->ptr)[byte] & (1 << bit);
+    } else {
+        if (byte < (size_t) ll2string(llbuf, sizeof(llbuf), (long) o->ptr))
+            bitval = llbuf[byte] & (1 << bit);
+    }
+
+    addReply(c, bitval ? shared.cone : shared.czero);
+}
+
+/*
+ * BITOP命令
+ *
+ * BITOP AND|OR|XOR|NOT destkey srckey [srckey ...]
+ *
+ * 不存在的键看作空字符串，较短的字符串右边看作用0填充，结果保存到destkey，回复结果的长度
+ */
+/* BITOP op_name target_key src_key1 src_key2 src_key3 ... src_keyN */
+void bitopCommand(redisClient* c) {
+    char* opname = c->argv[1]->ptr;
+    robj* o;
+    robj* targetkey = c->argv[2];
+    unsigned long op, j, numkeys;
+    robj** objects;      /* Array of source objects. */
+    unsigned char** src; /* Array of source strings pointers. */
+    unsigned long* len, maxlen = 0; /* Array of length of src strings,
+                                       and max len. */
+    unsigned long minlen = 0;    /* Min len among the input keys. */
+    unsigned char* res = NULL; /* Resulting string. */
+
+    /* Parse the operation name. */
+    if ((opname[0] == 'a' || opname[0] == 'A') && !strcasecmp(opname, "and"))
+        op = BITOP_AND;
+    else if ((opname[0] == 'o' || opname[0] == 'O') && !strcasecmp(opname, "or"))
+        op = BITOP_OR;
+    else if ((opname[0] == 'x' || opname[0] == 'X') && !strcasecmp(opname, "xor"))
+        op = BITOP_XOR;
+    else if ((opname[0] == 'n' || opname[0] == 'N') && !strcasecmp(opname, "not"))
+        op = BITOP_NOT;
+    else {
+        addReply(c, shared.syntaxerr);
+        return;
+    }
+
+    /* Sanity check: NOT accepts only a single key argument. */
+    if (op == BITOP_NOT && c->argc != 4) {
+        addReplyError(c, "BITOP NOT must be called with a single source key.");
+        return;
+    }
+
+    // 源字符串直接使用对象的sds，只有整数编码的对象需要解码
+    /* Lookup keys, and store pointers to the string objects into an array. */
+    numkeys = c->argc - 3;
+    src = zmalloc(sizeof(unsigned char*) * numkeys);
+    len = zmalloc(sizeof(long) * numkeys);
+    objects = zmalloc(sizeof(robj*) * numkeys);
+    for (j = 0; j < numkeys; j++) {
+        o = lookupKeyRead(c->db, c->argv[j + 3]);
+        /* Handle non-existing keys as empty strings. */
+        if (o == NULL) {
+            objects[j] = NULL;
+            src[j] = NULL;
+            len[j] = 0;
+            minlen = 0;
+            continue;
+        }
+        /* Return an error if one of the keys is not a string. */
+        if (checkType(c, o, REDIS_STRING)) {
+            unsigned long i;
+            for (i = 0; i < j; i++) {
+                if (objects[i])
+                    decrRefCount(objects[i]);
+            }
+            zfree(src);
+            zfree(len);
+            zfree(objects);
+            return;
+        }
+        objects[j] = getDecodedObject(o);
+        src[j] = objects[j]->ptr;
+        len[j] = sdslen(objects[j]->ptr);
+        if (len[j] > maxlen) maxlen = len[j];
+        if (j == 0 || len[j] < minlen) minlen = len[j];
+    }
+
+    /* Compute the bit operation, if at least one string is not empty. */
+    if (maxlen) {
+        unsigned char output, byte;
+        unsigned long i;
+        uint64_t acc[4], w[4];
+
+        res = (unsigned char*) sdsnewlen(NULL, maxlen);
+
+        // 所有源字符串都有数据的部分每次处理32个字节(4个64位字)，
+        // sds的地址不一定按8字节对齐，用memcpy读写
+        /* Fast path: as far as we have data for all the input bitmaps we
+         * can take a fast path that performs much better than the
+         * vanilla algorithm. */
+        j = 0;
+        while (minlen - j >= sizeof(acc)) {
+            memcpy(acc, src[0] + j, sizeof(acc));
+            if (op == BITOP_NOT) {
+                acc[0] = ~acc[0];
+                acc[1] = ~acc[1];
+                acc[2] = ~acc[2];
+                acc[3] = ~acc[3];
+            }
+            for (i = 1; i < numkeys; i++) {
+                memcpy(w, src[i] + j, sizeof(w));
+                /* Different branches per different operations for speed (sorry). */
+                if (op == BITOP_AND) {
+                    acc[0] &= w[0];
+                    acc[1] &= w[1];
+                    acc[2] &= w[2];
+                    acc[3] &= w[3];
+                } else if (op == BITOP_OR) {
+                    acc[0] |= w[0];
+                    acc[1] |= w[1];
+                    acc[2] |= w[2];
+                    acc[3] |= w[3];
+                } else if (op == BITOP_XOR) {
+                    acc[0] ^= w[0];
+                    acc[1] ^= w[1];
+                    acc[2] ^= w[2];
+                    acc[3] ^= w[3];
+                }
+            }
+            memcpy(res + j, acc, sizeof(acc));
+            j += sizeof(acc);
+        }
+
+        /* j is set to the next byte to process by the previous loop. */
+        for (; j < maxlen; j++) {
+            output = (len[0] <= j) ? 0 : src[0][j];
+            if (op == BITOP_NOT) output = ~output;
+            for (i = 1; i < numkeys; i++) {
+                byte = (len[i] <= j) ? 0 : src[i][j];
+                switch (op) {
+                    case BITOP_AND:
+                        output &= byte;
+                        break;
+                    case BITOP_OR:
+                        output |= byte;
+                        break;
+                    case BITOP_XOR:
+                        output ^= byte;
+                        break;
+                }
+            }
+            res[j] = output;
+        }
+    }
+    for (j = 0; j < numkeys; j++) {
+        if (objects[j])
+            decrRefCount(objects[j]);
+    }
+    zfree(src);
+    zfree(len);
+    zfree(objects);
+
+    /* Store the computed value into the target key */
+    if (maxlen) {
+        o = createObject(REDIS_STRING, res);
+        setKey(c->db, targetkey, o, 0);
+        decrRefCount(o);
+    } else if (dbDelete(c->db, targetkey)) {
+        signalModifiedKey(c->db, targetkey);
+    }
+    server.dirty++;
+    addReplyLongLong(c, maxlen); /* Return the output string length in bytes. */
+}
+
+/*
+ * BITCOUNT命令
+ *
+ * BITCOUNT key [start end]
+ *
+ * start和end是字节下标，负数从末尾开始计算
+ */
+/* BITCOUNT key [start end] */
+void bitcountCommand(redisClient* c) {
+    robj* o;
+    long start, end, strlen;
+    unsigned char* p;
+    char llbuf[32];
+
+    /* Lookup, check for type, and return 0 for non existing keys. */
+    if ((o = lookupKeyReadOrReply(c, c->argv[1], shared.czero)) == NULL ||
+        checkType(c, o, REDIS_STRING))
+        return;
+    p = getObjectReadOnlyString(o, &strlen, llbuf);
+
+    /* Parse start/end range if any. */
+    if (c->argc == 4) {
+        if (getLongFromObjectOrReply(c, c->argv[2], &start, NULL) != REDIS_OK)
+            return;
+        if (getLongFromObjectOrReply(c, c->argv[3], &end, NULL) != REDIS_OK)
+            return;
+        /* Convert negative indexes */
+        if (start < 0 && end < 0 && start > end) {
+            addReply(c, shared.czero);
+            return;
+        }
+        if (start < 0) start = strlen + start;
+        if (end < 0) end = strlen + end;
+        if (start < 0) start = 0;
+        if (end < 0) end = 0;
+        if (end >= strlen) end = strlen - 1;
+    } else if (c->argc == 2) {
+        /* The whole string. */
+        start = 0;
+        end = strlen - 1;
+    } else {
+        /* Syntax error. */
+        addReply(c, shared.syntaxerr);
+        return;
+    }
+
+    /* Precondition: end >= 0 && end < strlen, so the only condition where
+     * zero can be returned is: start > end. */
+    if (start > end) {
+        addReply(c, shared.czero);
+    } else {
+        long bytes = end - start + 1;
+
+        addReplyLongLong(c, redisPopcount(p + start, bytes));
+    }
+}
+
+/*
+ * BITPOS命令
+ *
+ * BITPOS key bit [start [end]]
+ *
+ * 返回第一个值为bit的位的位置，没有给出end时把字符串右边看作用0填充
+ */
+/* BITPOS key bit [start [end]] */
+void bitposCommand(redisClient* c) {
+    robj* o;
+    long bit, start, end, strlen;
+    unsigned char* p;
+    char llbuf[32];
+    int end_given = 0;
+
+    /* Parse the bit argument to understand what we are looking for, set
+     * or clear bits. */
+    if (getLongFromObjectOrReply(c, c->argv[2], &bit, NULL) != REDIS_OK)
+        return;
+    if (bit != 0 && bit != 1) {
+        addReplyError(c, "The bit argument must be 1 or 0.");
+        return;
+    }
+
+    /* If the key does not exist, from our point of view it is an infinite
+     * array of 0 bits. If the user is looking for the fist clear bit return 0,
+     * If the user is looking for the first set bit, return -1. */
+    if ((o = lookupKeyRead(c->db, c->argv[1])) == NULL) {
+        addReplyLongLong(c, bit ? -1 : 0);
+        return;
+    }
+    if (checkType(c, o, REDIS_STRING)) return;
+    p = getObjectReadOnlyString(o, &strlen, llbuf);
+
+    /* Parse start/end range if any. */
+    if (c->argc == 4 || c->argc == 5) {
+        if (getLongFromObjectOrReply(c, c->argv[3], &start, NULL) != REDIS_OK)
+            return;
+        if (c->argc == 5) {
+            if (getLongFromObjectOrReply(c, c->argv[4], &end, NULL) != REDIS_OK)
+                return;
+            end_given = 1;
+        } else {
+            end = strlen - 1;
+        }
+        /* Convert negative indexes */
+        if (start < 0) start = strlen + start;
+        if (end < 0) end = strlen + end;
+        if (start < 0) start = 0;
+        if (end < 0) end = 0;
+        if (end >= strlen) end = strlen - 1;
+    } else if (c->argc == 3) {
+        /* The whole string. */
+        start = 0;
+        end = strlen - 1;
+    } else {
+        /* Syntax error. */
+        addReply(c, shared.syntaxerr);
+        return;
+    }
+
+    /* For empty ranges (start > end) we return -1 as an empty range does
+     * not contain a 0 nor a 1. */
+    if (start > end) {
+        addReplyLongLong(c, -1);
+    } else {
+        long bytes = end - start + 1;
+        long pos = redisBitpos(p + start, bytes, bit);
+
+        /* If we are looking for clear bits, and the user specified an exact
+         * range with start-end, we can't consider the right of the range as
+         * zero padded (as we do when no explicit end is given).
+         *
+         * So if redisBitpos() returns the first bit outside the range,
+         * we return -1 to the caller, to mean, in the specified range there
+         * is not a single "0" bit. */
+        if (end_given && bit == 0 && pos == bytes * 8) {
+            addReplyLongLong(c, -1);
+            return;
+        }
+        if (pos != -1) pos += start * 8; /* Adjust for the bytes we skipped. */
+        addReplyLongLong(c, pos);
+    }
+}
+
+/*
+ * BITFIELD命令
+ *
+ * BITFIELD key [GET type offset] [SET type offset value] [INCRBY type offset increment] [OVERFLOW WRAP|SAT|FAIL]
+ *
+ * 在位图中读写任意位置、任意位数(有符号最多64位，无符号最多63位)的整数，
+ * 先解析所有子命令，写操作需要的空间一次扩展到位，然后按顺序执行，每个子命令一个回复
+ */
+/* BITFIELD key subcommmand-1 arg ... subcommand-2 arg ... subcommand-N ...
+ *
+ * Supported subcommands:
+ *
+ * GET <type> <offset>
+ * SET <type> <offset> <value>
+ * INCRBY <type> <offset> <increment>
+ * OVERFLOW [WRAP|SAT|FAIL]
+ */
+
+struct bitfieldOp {
+    uint64_t offset;    /* Bitfield offset. */
+    int64_t i64;        /* Increment amount (INCRBY) or SET value */
+    int opcode;         /* Operation id. */
+    int owtype;         /* Overflow type to use. */
+    int bits;           /* Integer bitfield bits width. */
+    int sign;           /* True if signed, otherwise unsigned op. */
+};
+
+void bitfieldCommand(redisClient* c) {
+    robj* o;
+    size_t bitoffset;
+    int j, numops = 0, changes = 0;
+    struct bitfieldOp* ops = NULL; /* Array of ops to execute at end. */
+    int owtype = BFOVERFLOW_WRAP; /* Overflow type. */
+    int readonly = 1;
+    size_t highest_write_offset = 0;
+
+    for (j = 2; j < c->argc; j++) {
+        int remargs = c->argc - j - 1; /* Remaining args other than current. */
+        char* subcmd = c->argv[j]->ptr; /* Current command name. */
+        int opcode; /* Current operation code. */
+        long long i64 = 0;  /* Signed SET value. */
+        int sign = 0; /* Signed or unsigned type? */
+        int bits = 0; /* Bitfield width in bits. */
+
+        if (!strcasecmp(subcmd, "get") && remargs >= 2)
+            opcode = BITFIELDOP_GET;
+        else if (!strcasecmp(subcmd, "set") && remargs >= 3)
+            opcode = BITFIELDOP_SET;
+        else if (!strcasecmp(subcmd, "incrby") && remargs >= 3)
+            opcode = BITFIELDOP_INCRBY;
+        else if (!strcasecmp(subcmd, "overflow") && remargs >= 1) {
+            char* owtypename = c->argv[j + 1]->ptr;
+            j++;
+            if (!strcasecmp(owtypename, "wrap"))
+                owtype = BFOVERFLOW_WRAP;
+            else if (!strcasecmp(owtypename, "sat"))
+                owtype = BFOVERFLOW_SAT;
+            else if (!strcasecmp(owtypename, "fail"))
+                owtype = BFOVERFLOW_FAIL;
+            else {
+                addReplyError(c, "Invalid OVERFLOW type specified");
+                zfree(ops);
+                return;
+            }
+            continue;
+        } else {
+            addReply(c, shared.syntaxerr);
+            zfree(ops);
+            return;
+        }
+
+        /* Get the type and offset arguments, common to all the ops. */
+        if (getBitfieldTypeFromArgument(c, c->argv[j + 1], &sign, &bits) != REDIS_OK) {
+            zfree(ops);
+            return;
+        }
+
+        if (getBitOffsetFromArgument(c, c->argv[j + 2], &bitoffset, 1, bits) != REDIS_OK) {
+            zfree(ops);
+            return;
+        }
+
+        if (opcode != BITFIELDOP_GET) {
+            readonly = 0;
+            if (highest_write_offset < bitoffset + bits - 1)
+                highest_write_offset = bitoffset + bits - 1;
+            /* INCRBY and SET require another argument. */
+            if (getLongLongFromObjectOrReply(c, c->argv[j + 3], &i64, NULL) != REDIS_OK) {
+                zfree(ops);
+                return;
+            }
+        }
+
+        /* Populate the array of operations we'll process. */
+        ops = zrealloc(ops, sizeof(*ops) * (numops + 1));
+        ops[numops].offset = bitoffset;
+        ops[numops].i64 = i64;
+        ops[numops].opcode = opcode;
+        ops[numops].owtype = owtype;
+        ops[numops].bits = bits;
+        ops[numops].sign = sign;
+        numops++;
+
+        j += 3 - (opcode == BITFIELDOP_GET);
+    }
+
+    if (readonly) {
+        /* Lookup for read is ok if key doesn't exit, but errors
+         * if it's not a string. */
+        o = lookupKeyRead(c->db, c->argv[1]);
+        if (o != NULL && checkType(c, o, REDIS_STRING)) {
+            zfree(ops);
+            return;
+        }
+    } else {
+        /* Lookup by making room up to the farest bit reached by
+         * this operation. */
+        if ((o = lookupStringForBitCommand(c, highest_write_offset)) == NULL) {
+            zfree(ops);
+            return;
+        }
+    }
+
+    addReplyMultiBulkLen(c, numops);
+
+    /* Actually process the operations. */
+    for (j = 0; j < numops; j++) {
+        struct bitfieldOp* thisop = ops + j;
+
+        /* Execute the operation. */
+        if (thisop->opcode == BITFIELDOP_SET ||
+            thisop->opcode == BITFIELDOP_INCRBY) {
+            /* SET and INCRBY: We handle both with the same code path
+             * for simplicity. SET return value is the previous value so
+             * we need fetch & store as well. */
+
+            /* We need two different but very similar code paths for signed
+             * and unsigned operations, since the set of functions to get/set
+             * the integers and the used variables types are different. */
+            if (thisop->sign) {
+                int64_t oldval, newval, wrapped, retval;
+                int overflow;
+
+                oldval = getSignedBitfield(o->ptr, thisop->offset, thisop->bits);
+
+                if (thisop->opcode == BITFIELDOP_INCRBY) {
+                    overflow = checkSignedBitfieldOverflow(oldval, thisop->i64, thisop->bits,
+                                                           thisop->owtype, &wrapped);
+                    newval = overflow ? wrapped : oldval + thisop->i64;
+                    retval = newval;
+                } else {
+                    newval = thisop->i64;
+                    overflow = checkSignedBitfieldOverflow(newval, 0, thisop->bits,
+                                                           thisop->owtype, &wrapped);
+                    if (overflow) newval = wrapped;
+                    retval = oldval;
+                }
+
+                /* On overflow of type is "FAIL", don't write and return
+                 * NULL to signal the condition. */
+                if (!(overflow && thisop->owtype == BFOVERFLOW_FAIL)) {
+                    addReplyLongLong(c, retval);
+                    setSignedBitfield(o->ptr, thisop->offset, thisop->bits, newval);
+                } else {
+                    addReply(c, shared.nullbulk);
+                }
+            } else {
+                uint64_t oldval, newval, wrapped, retval;
+                int overflow;
+
+                oldval = getUnsignedBitfield(o->ptr, thisop->offset, thisop->bits);
+
+                if (thisop->opcode == BITFIELDOP_INCRBY) {
+                    newval = oldval + thisop->i64;
+                    overflow = checkUnsignedBitfieldOverflow(oldval, thisop->i64, thisop->bits,
+                                                             thisop->owtype, &wrapped);
+                    if (overflow) newval = wrapped;
+                    retval = newval;
+                } else {
+                    newval = thisop->i64;
+                    overflow = checkUnsignedBitfieldOverflow(newval, 0, thisop->bits,
+                                                             thisop->owtype, &wrapped);
+                    if (overflow) newval = wrapped;
+                    retval = oldval;
+                }
+                /* On overflow of type is "FAIL", don't write and return
+                 * NULL to signal the condition. */
+                if (!(overflow && thisop->owtype == BFOVERFLOW_FAIL)) {
+                    addReplyLongLong(c, retval);
+                    setUnsignedBitfield(o->ptr, thisop->offset, thisop->bits, newval);
+                } else {
+                    addReply(c, shared.nullbulk);
+                }
+            }
+            changes++;
+        } else {
+            /* GET */
+            unsigned char buf[9];
+            long strlen = 0;
+            unsigned char* src = NULL;
+            char llbuf[32];
+            size_t byte = thisop->offset >> 3;
+            int i;
+
+            if (o != NULL)
+                src = getObjectReadOnlyString(o, &strlen, llbuf);
+
+            // 先把最多9个字节复制到局部缓冲区，超出字符串末尾的部分为0
+            /* For GET we use a trick: before executing the operation
+             * copy up to 9 bytes to a local buffer, so that we can easily
+             * execute up to 64 bit operations that are at actual string
+             * object boundaries. */
+            memset(buf, 0, 9);
+            for (i = 0; i < 9; i++) {
+                if (src == NULL || i + byte >= (size_t) strlen) break;
+                buf[i] = src[i + byte];
+            }
+
+            /* Now operate on the copied buffer which is guaranteed
+             * to be zero-padded. */
+            if (thisop->sign) {
+                int64_t val = getSignedBitfield(buf, thisop->offset - (byte * 8), thisop->bits);
+                addReplyLongLong(c, val);
+            } else {
+                uint64_t val = getUnsignedBitfield(buf, thisop->offset - (byte * 8), thisop->bits);
+                addReplyLongLong(c, val);
+            }
+        }
+    }
+
+    if (changes) {
+        signalModifiedKey(c->db, c->argv[1]);
+        server.dirty += changes;
+    }
+    zfree(ops);
+}
@@ -21,4 +21,195 @@ void resetServerSaveParams() {
     zfree(server.saveparams);
     server.saveparams = NULL;
     server.saveparamslen = 0;
-}
\ No newline at end of file
+}
+/*
+ * maxmemory策略名与策略常量的对应表
+ */
+static struct {
+    char* name;
+    int value;
+} maxmemoryPolicyTable[] = {
+        {"volatile-lru", REDIS_MAXMEMORY_VOLATILE_LRU},
+        {"volatile-lfu", REDIS_MAXMEMORY_VOLATILE_LFU},
+        {"volatile-random", REDIS_MAXMEMORY_VOLATILE_RANDOM},
+        {"volatile-ttl", REDIS_MAXMEMORY_VOLATILE_TTL},
+        {"allkeys-lru", REDIS_MAXMEMORY_ALLKEYS_LRU},
+        {"allkeys-lfu", REDIS_MAXMEMORY_ALLKEYS_LFU},
+        {"allkeys-random", REDIS_MAXMEMORY_ALLKEYS_RANDOM},
+        {"noeviction", REDIS_MAXMEMORY_NO_EVICTION},
+        {NULL, 0}
+};
+
+static char* maxmemoryPolicyName(int policy) {
+    int j;
+
+    for (j = 0; maxmemoryPolicyTable[j].name; j++)
+        if (maxmemoryPolicyTable[j].value == policy) return maxmemoryPolicyTable[j].name;
+    return "unknown";
+}
+
+/*
+ * 切换maxmemory策略，
+ * LRU与LFU对lru域的解释不同，切换时从头开始渐进式重置所有对象的lru域，
+ * 避免把时钟当作计数器；重置由databasesCron完成，不在这里遍历键空间
+ */
+static void setMaxmemoryPolicy(int policy) {
+    int wasLFU = REDIS_MAXMEMORY_IS_LFU(server.maxmemory_policy);
+
+    server.maxmemory_policy = policy;
+    if (wasLFU == REDIS_MAXMEMORY_IS_LFU(policy)) return;
+
+    server.lru_reset_db = 0;
+    server.lru_reset_cursor = 0;
+}
+
+/*
+ * CONFIG SET <parameter> <value>
+ */
+static void configSetCommand(redisClient* c) {
+    robj* o;
+    long long ll;
+    int err, j;
+
+    o = c->argv[3];
+
+    if (!strcasecmp(c->argv[2]->ptr, "maxmemory")) {
+        ll = memtoll(o->ptr, &err);
+        if (err || ll < 0) goto badfmt;
+        server.maxmemory = ll;
+        // 新的上限可能低于当前内存占用，立即尝试淘汰
+        if (server.maxmemory) freeMemoryIfNeeded();
+    } else if (!strcasecmp(c->argv[2]->ptr, "maxmemory-policy")) {
+        for (j = 0; maxmemoryPolicyTable[j].name; j++) {
+            if (!strcasecmp(o->ptr, maxmemoryPolicyTable[j].name)) break;
+        }
+        if (maxmemoryPolicyTable[j].name == NULL) goto badfmt;
+        setMaxmemoryPolicy(maxmemoryPolicyTable[j].value);
+    } else if (!strcasecmp(c->argv[2]->ptr, "maxmemory-samples")) {
+        if (getLongLongFromObject(o, &ll) == REDIS_ERR || ll <= 0 || ll > INT_MAX) goto badfmt;
+        server.maxmemory_samples = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr, "maxmemory-eviction-keys")) {
+        if (getLongLongFromObject(o, &ll) == REDIS_ERR || ll <= 0 || ll > INT_MAX) goto badfmt;
+        server.maxmemory_eviction_keys = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr, "maxmemory-eviction-time")) {
+        if (getLongLongFromObject(o, &ll) == REDIS_ERR || ll <= 0) goto badfmt;
+        server.maxmemory_eviction_time = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr, "maxmemory-lowwater")) {
+        if (getLongLongFromObject(o, &ll) == REDIS_ERR || ll <= 0 || ll > 100) goto badfmt;
+        server.maxmemory_lowwater = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr, "lfu-log-factor")) {
+        if (getLongLongFromObject(o, &ll) == REDIS_ERR || ll < 0 || ll > INT_MAX) goto badfmt;
+        server.lfu_log_factor = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr, "hash-max-ziplist-entries")) {
+        if (getLongLongFromObject(o, &ll) == REDIS_ERR || ll < 0) goto badfmt;
+        server.hash_max_ziplist_entries = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr, "hash-max-ziplist-value")) {
+        if (getLongLongFromObject(o, &ll) == REDIS_ERR || ll < 0) goto badfmt;
+        server.hash_max_ziplist_value = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr, "hash-max-packhash-entries")) {
+        // 索引使用32位偏移量，限制键值对数量避免listpack过大
+        if (getLongLongFromObject(o, &ll) == REDIS_ERR || ll < 0 || ll > 1000000) goto badfmt;
+        server.hash_max_packhash_entries = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr, "zset-max-skiplist-entries")) {
+        // 只在有序集合添加元素时检查
+        if (getLongLongFromObject(o, &ll) == REDIS_ERR || ll < 0) goto badfmt;
+        server.zset_max_skiplist_entries = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr, "list-max-ziplist-size")) {
+        // 只影响之后创建的快速列表
+        if (getLongLongFromObject(o, &ll) == REDIS_ERR ||
+            ll < QUICKLIST_FILL_MIN || ll > QUICKLIST_FILL_MAX || ll == 0) goto badfmt;
+        server.list_max_ziplist_size = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr, "list-compress-depth")) {
+        // 只影响之后创建的快速列表
+        if (getLongLongFromObject(o, &ll) == REDIS_ERR || ll < 0 || ll > QUICKLIST_COMPRESS_MAX) goto badfmt;
+        server.list_compress_depth = ll;
+    } else if (!strcasecmp(c->argv[2]->ptr, "lazyfree-lazy-server-del")) {
+        if (!strcasecmp(o->ptr, "yes")) server.lazyfree_lazy_server_del = 1;
+        else if (!strcasecmp(o->ptr, "no")) server.lazyfree_lazy_server_del = 0;
+        else goto badfmt;
+    } else if (!strcasecmp(c->argv[2]->ptr, "lfu-decay-time")) {
+        if (getLongLongFromObject(o, &ll) == REDIS_ERR || ll < 0 || ll > INT_MAX) goto badfmt;
+        server.lfu_decay_time = ll;
+    } else {
+        addReplyErrorFormat(c, "Unsupported CONFIG parameter: %s", (char*) c->argv[2]->ptr);
+        return;
+    }
+    addReply(c, shared.ok);
+    return;
+
+badfmt:
+    addReplyErrorFormat(c, "Invalid argument '%s' for CONFIG SET '%s'",
+                        (char*) o->ptr, (char*) c->argv[2]->ptr);
+}
+
+/*
+ * CONFIG GET <pattern>
+ */
+static void configGetCommand(redisClient* c) {
+    void* replylen = addDeferredMultiBulkLength(c);
+    char* pattern = c->argv[2]->ptr;
+    char buf[128];
+    int matches = 0;
+
+#define config_get_numerical_field(_name, _var) do { \
+    if (stringmatch(pattern, _name, 1)) { \
+        ll2string(buf, sizeof(buf), _var); \
+        addReplyBulkCString(c, _name); \
+        addReplyBulkCString(c, buf); \
+        matches++; \
+    } \
+} while(0)
+
+    config_get_numerical_field("maxmemory", server.maxmemory);
+    config_get_numerical_field("maxmemory-samples", server.maxmemory_samples);
+    config_get_numerical_field("maxmemory-eviction-keys", server.maxmemory_eviction_keys);
+    config_get_numerical_field("maxmemory-eviction-time", server.maxmemory_eviction_time);
+    config_get_numerical_field("maxmemory-lowwater", server.maxmemory_lowwater);
+    config_get_numerical_field("lfu-log-factor", server.lfu_log_factor);
+    config_get_numerical_field("lfu-decay-time", server.lfu_decay_time);
+    config_get_numerical_field("hash-max-ziplist-entries", server.hash_max_ziplist_entries);
+    config_get_numerical_field("hash-max-ziplist-value", server.hash_max_ziplist_value);
+    config_get_numerical_field("hash-max-packhash-entries", server.hash_max_packhash_entries);
+    config_get_numerical_field("zset-max-skiplist-entries", server.zset_max_skiplist_entries);
+    config_get_numerical_field("list-max-ziplist-size", server.list_max_ziplist_size);
+    config_get_numerical_field("list-compress-depth", server.list_compress_depth);
+
+    if (stringmatch(pattern, "lazyfree-lazy-server-del", 1)) {
+        addReplyBulkCString(c, "lazyfree-lazy-server-del");
+        addReplyBulkCString(c, server.lazyfree_lazy_server_del ? "yes" : "no");
+        matches++;
+    }
+
+    if (stringmatch(pattern, "maxmemory-policy", 1)) {
+        addReplyBulkCString(c, "maxmemory-policy");
+        addReplyBulkCString(c, maxmemoryPolicyName(server.maxmemory_policy));
+        matches++;
+    }
+
+#undef config_get_numerical_field
+
+    setDeferredMultiBulkLength(c, replylen, matches * 2);
+}
+
+/*
+ * CONFIG GET|SET|RESETSTAT，仅支持内存淘汰、惰性释放和快速列表相关的参数
+ */
+void configCommand(redisClient* c) {
+    if (!strcasecmp(c->argv[1]->ptr, "resetstat")) {
+        if (c->argc != 2) goto badarity;
+        resetServerStats();
+        addReply(c, shared.ok);
+    } else if (!strcasecmp(c->argv[1]->ptr, "set")) {
+        if (c->argc != 4) goto badarity;
+        configSetCommand(c);
+    } else if (!strcasecmp(c->argv[1]->ptr, "get")) {
+        if (c->argc != 3) goto badarity;
+        configGetCommand(c);
+    } else {
+        addReplyError(c, "CONFIG subcommand must be one of GET, SET, RESETSTAT");
+    }
+    return;
+
+badarity:
+    addReplyErrorFormat(c, "Wrong number of arguments for CONFIG %s", (char*) c->argv[1]->ptr);
+}
@@ -10,10 +10,11 @@
 
 /*
  * 注意: 
- * signalModifiedKey函数与独立功能事务相关，在本代码中删除；
  * notifyKeyspaceEvent函数与独立功能发布/订阅相关，在本代码中删除；
  */
 
+static int removeExpireEntry(redisDb* db, sds key);
+
 /*
  * C-level DB API
  */
@@ -31,13 +32,17 @@ robj* lookupKey(redisDb* db, robj* key) {
 
         robj* val = dictGetVal(de);
 
-        // 每次读取键，都更新它的LRU(最近一次使用)时间，
+        // 每次读取键，都更新它的LRU(最近一次使用)时间，LFU策略下更新访问频率，
         // 只有在不存在子进程时执行，防止破坏copy-on-write机制
         /* Update the access time for the ageing algorithm.
          * Don't do it if we have a saving child, as this will trigger
          * a copy on write madness. */
-        if (server.rdb_child_pid == -1 && server.aof_child_pid == -1)
-            val->lru = getLRUClock();
+        if (server.rdb_child_pid == -1 && server.aof_child_pid == -1) {
+            if (REDIS_MAXMEMORY_IS_LFU(server.maxmemory_policy))
+                updateLFU(val);
+            else
+                val->lru = getLRUClock();
+        }
 
         return val;
     // 键不存在，返回NULL
@@ -114,6 +119,9 @@ void dbAdd(redisDb* db, robj* key, robj* val) {
 
     assert(retval == REDIS_OK);
 
+    // 维护键空间索引
+    if (db->keyindex) raxInsert(db->keyindex, (unsigned char*)copy, sdslen(copy));
+
     // TODO: 集群相关
     /* if (server.cluster_enabled) slotToKeyAdd(key); */
 }
@@ -128,13 +136,21 @@ void dbOverwrite(redisDb* db, robj* key, robj* val) {
 
     assert(de != NULL);
 
-    dictReplace(db->dict, key->ptr, val);
+    // 先设置新值再释放旧值，大的旧值交给bio线程释放
+    if (server.lazyfree_lazy_server_del) {
+        robj* old = dictGetVal(de);
+        dictSetVal(db->dict, de, val);
+        freeObjectAsync(old);
+    } else {
+        dictReplace(db->dict, key->ptr, val);
+    }
 }
 
 /*
- * 高层次的set函数，调用dbAdd或dbOverwrite完成实际的工作
+ * 高层次的set函数，调用dbAdd或dbOverwrite完成实际的工作，
+ * keepttl为1时保留键原有的过期时间
  */
-void setKey(redisDb* db, robj* key, robj* val) {
+void setKey(redisDb* db, robj* key, robj* val, int keepttl) {
 
     // 如果键不存在，调用dbAdd
     if (lookupKeyWrite(db, key) == NULL) {
@@ -148,7 +164,24 @@ void setKey(redisDb* db, robj* key, robj* val) {
     incrRefCount(val);
 
     // 移除键key的过期时间，变为持久键
-    removeExpire(db, key);
+    if (!keepttl) removeExpire(db, key);
+
+    // 通知监视这个键的客户端
+    signalModifiedKey(db, key);
+}
+
+/*
+ * 键key被修改时调用的钩子，将监视这个键的客户端的事务标记为失效
+ */
+void signalModifiedKey(redisDb* db, robj* key) {
+    touchWatchedKey(db, key);
+}
+
+/*
+ * 数据库被清空时调用的钩子，dbid为-1表示清空所有数据库
+ */
+void signalFlushedDb(int dbid) {
+    touchWatchedKeysOnFlush(dbid);
 }
 
 /*
@@ -195,9 +228,11 @@ robj* dbRandomKey(redisDb* db) {
  */
 int dbDelete(redisDb* db, robj* key) {
 
-    if (dictSize(db->expires) > 0) dictDelete(db->expires, key->ptr);
+    if (dictSize(db->expires) > 0) removeExpireEntry(db, key->ptr);
 
     if (dictDelete(db->dict, key->ptr) == DICT_OK) {
+        // 维护键空间索引
+        if (db->keyindex) raxRemove(db->keyindex, key->ptr, sdslen(key->ptr));
         // TODO: 集群相关
         /* if (server.cluster_enabled) slotToKeyDel(key); */
         return 1;
@@ -225,20 +260,44 @@ robj* dbUnshareStringValue(redisDb* db, robj* key, robj* o) {
 }
 
 /*
- * 清空服务器的所有数据库
+ * 清空编号为dbnum的数据库，dbnum为-1时清空服务器的所有数据库，
+ * async为1时将数据库交给bio线程释放，返回被删除的键数量
  */
-long long emptyDb(void(callback)(void*)) {
+long long emptyDb(int dbnum, int async, void(callback)(void*)) {
 
-    int j;
+    int j, startdb, enddb;
     long long removed = 0;
 
-    for (j = 0; j < server.dbnum; j++) {
+    if (dbnum < -1 || dbnum >= server.dbnum) return -1;
+
+    if (dbnum == -1) {
+        startdb = 0;
+        enddb = server.dbnum - 1;
+    } else {
+        startdb = enddb = dbnum;
+    }
+
+    for (j = startdb; j <= enddb; j++) {
 
         removed += dictSize(server.db[j].dict);
 
+        if (async) {
+            emptyDbAsync(&server.db[j]);
+            continue;
+        }
+
         dictEmpty(server.db[j].dict, callback);
 
         dictEmpty(server.db[j].expires, callback);
+
+        raxFree(server.db[j].expires_index);
+        server.db[j].expires_index = raxNew();
+
+        // 清空键空间索引，保持索引的启用状态
+        if (server.db[j].keyindex) {
+            raxFree(server.db[j].keyindex);
+            server.db[j].keyindex = raxNew();
+        }
     }
 
     // TODO: 集群相关
@@ -267,12 +326,12 @@ int selectDb(redisClient* c, int id) {
 /* Type agnostic commands operating on the key space */
 
 /*
- * DEL命令
+ * DEL和UNLINK命令的底层实现
  * 
  * 删除键，删除之前先检查键是否过期，调用expireIfNeeded；
- * 如果未过期，调用dbDelete；
+ * 如果未过期，调用dbDelete或dbAsyncDelete；
  */
-void delCommand(redisClient* c) {
+static void delGenericCommand(redisClient* c, int lazy) {
 
     int deleted = 0;
     int j;
@@ -283,8 +342,10 @@ void delCommand(redisClient* c) {
         // 先检查键是否过期，如果过期将其删除
         expireIfNeeded(c->db, c->argv[j]);
 
-        // 尝试删除键
-        if (dbDelete(c->db, c->argv[j])) {
+        // 尝试删除键，lazy为1时大的值对象交给bio线程释放
+        if (lazy ? dbAsyncDelete(c->db, c->argv[j]) : dbDelete(c->db, c->argv[j])) {
+
+            signalModifiedKey(c->db, c->argv[j]);
 
             // 维护键空间改动次数的统计信息，与持久化有关
             server.dirty++;
@@ -296,6 +357,69 @@ void delCommand(redisClient* c) {
     addReplyLongLong(c, deleted);
 }
 
+/*
+ * DEL命令
+ */
+void delCommand(redisClient* c) {
+    delGenericCommand(c, 0);
+}
+
+/*
+ * UNLINK命令
+ *
+ * 与DEL相同，但大的值对象交给bio线程释放，命令本身的执行时间与值的大小无关
+ */
+void unlinkCommand(redisClient* c) {
+    delGenericCommand(c, 1);
+}
+
+/*
+ * 解析FLUSHDB/FLUSHALL的可选参数ASYNC
+ */
+static int getFlushCommandFlags(redisClient* c, int* async) {
+    if (c->argc > 1) {
+        if (c->argc > 2 || strcasecmp(c->argv[1]->ptr, "async")) {
+            addReply(c, shared.syntaxerr);
+            return REDIS_ERR;
+        }
+        *async = 1;
+    } else {
+        *async = 0;
+    }
+    return REDIS_OK;
+}
+
+/*
+ * FLUSHDB [ASYNC]命令
+ *
+ * 清空客户端当前的数据库
+ */
+void flushdbCommand(redisClient* c) {
+    int async;
+
+    if (getFlushCommandFlags(c, &async) == REDIS_ERR) return;
+
+    // 先通知监视了这个数据库中已有键的客户端
+    signalFlushedDb(c->db->id);
+    server.dirty += emptyDb(c->db->id, async, NULL);
+    addReply(c, shared.ok);
+}
+
+/*
+ * FLUSHALL [ASYNC]命令
+ *
+ * 清空服务器的所有数据库
+ */
+void flushallCommand(redisClient* c) {
+    int async;
+
+    if (getFlushCommandFlags(c, &async) == REDIS_ERR) return;
+
+    signalFlushedDb(-1);
+    server.dirty += emptyDb(-1, async, NULL);
+    addReply(c, shared.ok);
+}
+
 /*
  * EXISTS命令
  *
@@ -363,7 +487,9 @@ void randomkeyCommand(redisClient* c) {
  * KEYS命令
  *
  * 遍历整个数据库，返回名字与模式匹配的键，
- * 遍历过程中会检查键是否过期，如果过期将其删除，不会返回
+ * 遍历过程中会检查键是否过期，如果过期将其删除，不会返回；
+ * 模式只编译一次(见stringmatcherNew)；
+ * 如果数据库启用了键空间索引且模式带有字面量前缀，只访问匹配前缀的子树
  */
 void keysCommand(redisClient* c) {
 
@@ -377,15 +503,57 @@ void keysCommand(redisClient* c) {
     unsigned long numkeys = 0;
     void* replylen = addDeferredMultiBulkLength(c);
 
+    // 模式只编译一次，之后对每个键使用编译后的匹配器
+    stringmatcher* matcher = stringmatcherNew(pattern, plen, 0);
+    sds prefix = matcher->prefix;
+
+    allkeys = (matcher->type == STRINGMATCH_ALL);
+
+    // 使用键空间索引，只访问匹配字面量前缀的子树
+    if (c->db->keyindex && sdslen(prefix) > 0) {
+        raxIterator ri;
+        list* matched = listCreate();
+        listNode* ln;
+
+        // 先收集匹配的键，再检查是否过期，删除过期键会修改索引
+        raxStart(&ri, c->db->keyindex);
+        raxSeek(&ri, ">=", (unsigned char*)prefix, sdslen(prefix));
+        while (raxNext(&ri)) {
+            if (ri.key_len < sdslen(prefix) || memcmp(ri.key, prefix, sdslen(prefix)) != 0)
+                break;
+
+            if (stringmatcherMatch(matcher, (char*)ri.key, ri.key_len))
+                listAddNodeTail(matched, createStringObject((char*)ri.key, ri.key_len));
+        }
+        raxStop(&ri);
+
+        while ((ln = listFirst(matched)) != NULL) {
+            robj* keyobj = listNodeValue(ln);
+
+            // 删除过期键
+            if (expireIfNeeded(c->db, keyobj) == 0) {
+                addReplyBulk(c, keyobj);
+                numkeys++;
+            }
+
+            decrRefCount(keyobj);
+            listDelNode(matched, ln);
+        }
+        listRelease(matched);
+
+        stringmatcherFree(matcher);
+        setDeferredMultiBulkLength(c, replylen, numkeys);
+        return;
+    }
+
     // 遍历整个数据库，返回名字与模式匹配的键
     // 安全迭代器使用场景，遍历过程中需要对过期的键进行删除
     di = dictGetSafeIterator(c->db->dict);
-    allkeys = (pattern[0] == '*' && pattern[1] == '\0');
     while ((de = dictNext(di)) != NULL) {
         sds key = dictGetKey(de);
         robj* keyobj;
 
-        if (allkeys || stringmatchlen(pattern, plen, key, sdslen(key), 0)) {
+        if (allkeys || stringmatcherMatch(matcher, key, sdslen(key))) {
 
             keyobj = createStringObject(key, sdslen(key));
 
@@ -400,6 +568,7 @@ void keysCommand(redisClient* c) {
     }
     dictReleaseIterator(di);
 
+    stringmatcherFree(matcher);
     setDeferredMultiBulkLength(c, replylen, numkeys);
 }
 
@@ -431,7 +600,10 @@ void scanCallback(void* privdata, const dictEntry* de) {
     } else if (o->type == REDIS_ZSET) {
         key = dictGetKey(de);
         incrRefCount(key);
-        val = createStringObjectFromLongDouble(*(double*)dictGetVal(de));
+        if (o->encoding == REDIS_ENCODING_BTREE)
+            val = createStringObjectFromLongDouble(dictGetDoubleVal(de));
+        else
+            val = createStringObjectFromLongDouble(*(double*)dictGetVal(de));
     } else {
         exit(1);
     }
@@ -462,6 +634,136 @@ int parseScanCursorOrReply(redisClient* c, robj* o, unsigned long* cursor) {
     return REDIS_OK;
 }
 
+/*
+ * 将游标从游标表中摘下，游标本身不释放
+ */
+static void keyIndexCursorUnlink(listNode* ln) {
+
+    keyIndexCursor* kc = listNodeValue(ln);
+
+    dictDelete(server.keyindex_cursors, (void*)kc->id);
+    listDelNode(server.keyindex_cursor_queue, ln);
+}
+
+/*
+ * 释放一个已经摘下的游标
+ */
+static void keyIndexCursorFree(keyIndexCursor* kc) {
+    sdsfree(kc->seek);
+    zfree(kc);
+}
+
+/*
+ * 保存db中下一次从键seek处继续的迭代，返回新的游标id，
+ * kc不为NULL时复用上一页取出的游标；游标按最近使用的顺序排列，
+ * 数量达到上限时删除最久没有使用的游标
+ */
+static unsigned long keyIndexCursorSave(redisDb* db, keyIndexCursor* kc, unsigned char* seek, size_t len) {
+
+    if (kc == NULL) {
+        if (dictSize(server.keyindex_cursors) >= REDIS_KEYINDEX_CURSOR_MAX) {
+            listNode* ln = listFirst(server.keyindex_cursor_queue);
+            keyIndexCursor* oldest = listNodeValue(ln);
+
+            keyIndexCursorUnlink(ln);
+            keyIndexCursorFree(oldest);
+        }
+        kc = zmalloc(sizeof(*kc));
+    } else {
+        sdsfree(kc->seek);
+    }
+
+    // 游标0表示新的迭代，分配时跳过0和仍在使用的id
+    while (server.keyindex_cursor_next == 0 ||
+           dictFind(server.keyindex_cursors, (void*)server.keyindex_cursor_next) != NULL)
+        server.keyindex_cursor_next++;
+
+    kc->id = server.keyindex_cursor_next++;
+    kc->dbid = db->id;
+    kc->seek = sdsnewlen(seek, len);
+
+    listAddNodeTail(server.keyindex_cursor_queue, kc);
+    dictAdd(server.keyindex_cursors, (void*)kc->id, listLast(server.keyindex_cursor_queue));
+
+    return kc->id;
+}
+
+/*
+ * 查找db中id为cursor的游标，找不到返回NULL
+ */
+static listNode* keyIndexCursorLookup(redisDb* db, unsigned long cursor) {
+
+    dictEntry* de;
+    listNode* ln;
+
+    if ((de = dictFind(server.keyindex_cursors, (void*)cursor)) == NULL) return NULL;
+
+    ln = dictGetVal(de);
+    return ((keyIndexCursor*)listNodeValue(ln))->dbid == db->id ? ln : NULL;
+}
+
+/*
+ * 使用键空间索引执行SCAN，按字典序收集以prefix为前缀的键，
+ * 每次最多收集count个键，下一个未返回的键保存在服务器的游标表中，
+ * 因此游标可以在任意连接上继续使用，也可以同时进行多个迭代；
+ * 每个迭代只占用一个游标: 继续迭代时取出旧游标，还有剩余的键时以新的id放回，迭代结束时释放，
+ * 游标不会因为超时失效，只有在游标数量达到上限时才删除最久没有使用的游标；
+ * 迭代期间一直存在的键保证会被返回且只返回一次；
+ * 游标不存在(已经用过或属于其他数据库)或前缀不一致时向客户端回复错误并返回REDIS_ERR
+ */
+static int keyIndexScan(redisClient* c, sds prefix, unsigned long* cursor, long count, list* keys) {
+
+    raxIterator ri;
+    size_t plen = sdslen(prefix);
+    long collected = 0;
+    keyIndexCursor* kc = NULL;
+
+    raxStart(&ri, c->db->keyindex);
+
+    if (*cursor == 0) {
+        raxSeek(&ri, ">=", (unsigned char*)prefix, plen);
+    } else {
+        listNode* ln = keyIndexCursorLookup(c->db, *cursor);
+
+        // 游标必须对应同一个前缀下的迭代
+        if (ln == NULL) {
+            raxStop(&ri);
+            addReplyError(c, "invalid or expired cursor");
+            return REDIS_ERR;
+        }
+        kc = listNodeValue(ln);
+        if (sdslen(kc->seek) < plen || memcmp(kc->seek, prefix, plen) != 0) {
+            raxStop(&ri);
+            addReplyError(c, "invalid or expired cursor");
+            return REDIS_ERR;
+        }
+        keyIndexCursorUnlink(ln);
+        raxSeek(&ri, ">=", (unsigned char*)kc->seek, sdslen(kc->seek));
+    }
+
+    *cursor = 0;
+    while (raxNext(&ri)) {
+        if (ri.key_len < plen || memcmp(ri.key, prefix, plen) != 0) break;
+
+        // 已经收集了count个键并且还有剩余的键，记录下一个键的位置
+        if (collected == count) {
+            *cursor = keyIndexCursorSave(c->db, kc, ri.key, ri.key_len);
+            kc = NULL;
+            break;
+        }
+
+        listAddNodeTail(keys, createStringObject((char*)ri.key, ri.key_len));
+        collected++;
+    }
+
+    raxStop(&ri);
+
+    // 迭代结束，释放取出的游标
+    if (kc) keyIndexCursorFree(kc);
+
+    return REDIS_OK;
+}
+
 /*
  * SCAN，HSCAN，SSCAN命令的底层实现
  * 如果o为NULL，函数将使用当前数据库作为迭代对象；
@@ -482,6 +784,7 @@ void scanGenericCommand(redisClient* c, robj* o, unsigned long cursor) {
     sds pat;
     int patlen;
     int use_pattern = 0;
+    stringmatcher* matcher = NULL;
     dict* ht;
 
     /* Object must be NULL (to iterate keys names), or the type of the object
@@ -528,24 +831,43 @@ void scanGenericCommand(redisClient* c, robj* o, unsigned long cursor) {
         }
     }
 
+    // 编译后的模式缓存在客户端中，同一个模式的后续SCAN调用直接复用
+    if (use_pattern) {
+        if (c->scan_matcher == NULL || sdscmp(c->scan_matcher->pattern, pat) != 0) {
+            stringmatcherFree(c->scan_matcher);
+            c->scan_matcher = stringmatcherNew(pat, patlen, 0);
+        }
+        matcher = c->scan_matcher;
+    }
+
     /* Step2: Iterate the collection. */
 
     /* Handle the case of a hash table. */
     ht = NULL;
-    if (o == NULL) {
+    if (o == NULL && use_pattern && c->db->keyindex) {
+        // 模式带有字面量前缀时，使用键空间索引只访问匹配的子树，
+        // 否则退化为迭代字典
+        if (sdslen(matcher->prefix) > 0) {
+            if (keyIndexScan(c, matcher->prefix, &cursor, count, keys) == REDIS_ERR) goto cleanup;
+        } else {
+            ht = c->db->dict;
+        }
+    } else if (o == NULL) {
         ht = c->db->dict;
     } else if (o->type == REDIS_SET && o->encoding == REDIS_ENCODING_HT) {
         ht = o->ptr;
     } else if (o->type == REDIS_HASH && o->encoding == REDIS_ENCODING_HT) {
         ht = o->ptr;
         count *= 2;    /* We return key / value for this type. */
-    } else if (o->type == REDIS_ZSET && o->encoding == REDIS_ENCODING_SKIPLIST) {
+    } else if (o->type == REDIS_ZSET && (o->encoding == REDIS_ENCODING_SKIPLIST || o->encoding == REDIS_ENCODING_BTREE)) {
         zset* zs = o->ptr;
         ht = zs->dict;
         count *= 2;    /* We return key / value for this type. */
     }
 
-    if (ht) {
+    if (o == NULL && ht == NULL) {
+        /* Already collected from the key index. */
+    } else if (ht) {
         void* privdata[2];
 
         privdata[0] = keys;
@@ -554,6 +876,14 @@ void scanGenericCommand(redisClient* c, robj* o, unsigned long cursor) {
         do {
             cursor = dictScan(ht, cursor, scanCallback, privdata);
         } while (cursor && listLength(keys) < count);
+    } else if (o->type == REDIS_SET && o->encoding == REDIS_ENCODING_ROARING) {
+        roaringIterator ri;
+        int64_t ll;
+
+        roaringInitIterator(o->ptr, &ri);
+        while (roaringIteratorNext(&ri, &ll))
+            listAddNodeTail(keys, createStringObjectFromLongLong(ll));
+        cursor = 0;
     } else if (o->type == REDIS_SET) {
         int pos = 0;
         int64_t ll;
@@ -562,15 +892,16 @@ void scanGenericCommand(redisClient* c, robj* o, unsigned long cursor) {
             listAddNodeTail(keys, createStringObjectFromLongLong(ll));
         cursor = 0;
     } else if (o->type == REDIS_HASH || o->type == REDIS_ZSET) {
-        unsigned char* p = ziplistIndex(o->ptr, 0);
+        unsigned char* lp = (o->encoding == REDIS_ENCODING_PACKHASH) ? ((packhash*) o->ptr)->lp : o->ptr;
+        unsigned char* p = lpIndex(lp, 0);
         unsigned char* vstr;
         unsigned int vlen;
         long long vll;
 
         while (p) {
-            ziplistGet(p, &vstr, &vlen, &vll);
+            lpGet(p, &vstr, &vlen, &vll);
             listAddNodeTail(keys, (vstr != NULL) ? createStringObject((char*)vstr, vlen) : createStringObjectFromLongLong(vll));
-            p = ziplistNext(o->ptr, p);
+            p = lpNext(lp, p);
         }
         cursor = 0;
     } else {
@@ -588,7 +919,7 @@ void scanGenericCommand(redisClient* c, robj* o, unsigned long cursor) {
         /* Filter element if it does not match the pattern. */
         if (!filter && use_pattern) {
             if (sdsEncodedObject(kobj)) {
-                if (!stringmatchlen(pat, patlen, kobj->ptr, sdslen(kobj->ptr), 0))
+                if (!stringmatcherMatch(matcher, kobj->ptr, sdslen(kobj->ptr)))
                     filter = 1;
             } else {
                 char buf[REDIS_LONGSTR_SIZE];
@@ -596,7 +927,7 @@ void scanGenericCommand(redisClient* c, robj* o, unsigned long cursor) {
 
                 assert(kobj->encoding == REDIS_ENCODING_INT);
                 len = ll2string(buf, sizeof(buf), (long)kobj->ptr);
-                if (!stringmatchlen(pat, patlen, buf, len, 0)) filter = 1;
+                if (!stringmatcherMatch(matcher, buf, len)) filter = 1;
             }
         }
 
@@ -633,7 +964,7 @@ void scanGenericCommand(redisClient* c, robj* o, unsigned long cursor) {
     addReplyMultiBulkLen(c, listLength(keys));
     while ((node = listFirst(keys)) != NULL) {
         robj* kobj = listNodeValue(node);
-        addReplyBulk(c, kobj);
+        addReplyBulkCopy(c, kobj);
         decrRefCount(kobj);
         listDelNode(keys, node);
     }
@@ -658,6 +989,52 @@ void scanCommand(redisClient* c) {
     scanGenericCommand(c, NULL, cursor);
 }
 
+/*
+ * KEYINDEX命令
+ *
+ * KEYINDEX ENABLE | DISABLE | STATS
+ *
+ * 为当前数据库启用/停用键空间索引，或者返回索引的键数量、节点数量以及内存开销，
+ * 启用时需要遍历整个键空间建立索引
+ */
+void keyindexCommand(redisClient* c) {
+
+    redisDb* db = c->db;
+
+    if (!strcasecmp(c->argv[1]->ptr, "enable") && c->argc == 2) {
+        if (db->keyindex == NULL) {
+            dictIterator* di = dictGetIterator(db->dict);
+            dictEntry* de;
+
+            db->keyindex = raxNew();
+            while ((de = dictNext(di)) != NULL) {
+                sds key = dictGetKey(de);
+                raxInsert(db->keyindex, (unsigned char*)key, sdslen(key));
+            }
+            dictReleaseIterator(di);
+        }
+        addReply(c, shared.ok);
+    } else if (!strcasecmp(c->argv[1]->ptr, "disable") && c->argc == 2) {
+        if (db->keyindex) {
+            raxFree(db->keyindex);
+            db->keyindex = NULL;
+        }
+        addReply(c, shared.ok);
+    } else if (!strcasecmp(c->argv[1]->ptr, "stats") && c->argc == 2) {
+        addReplyMultiBulkLen(c, 8);
+        addReplyBulkCString(c, "enabled");
+        addReplyLongLong(c, db->keyindex != NULL);
+        addReplyBulkCString(c, "keys");
+        addReplyLongLong(c, db->keyindex ? (long long)raxSize(db->keyindex) : 0);
+        addReplyBulkCString(c, "nodes");
+        addReplyLongLong(c, db->keyindex ? (long long)db->keyindex->numnodes : 0);
+        addReplyBulkCString(c, "bytes");
+        addReplyLongLong(c, db->keyindex ? (long long)raxAllocSize(db->keyindex) : 0);
+    } else {
+        addReplyError(c, "Syntax error, try KEYINDEX (ENABLE | DISABLE | STATS)");
+    }
+}
+
 /*
  * DBSIZE命令
  *
@@ -796,6 +1173,8 @@ void renameGenericCommand(redisClient* c, int nx) {
 
     dbDelete(c->db, c->argv[1]);
 
+    signalModifiedKey(c->db, c->argv[1]);
+    signalModifiedKey(c->db, c->argv[2]);
     server.dirty++;
 
     addReply(c, nx ? shared.cone : shared.ok);
@@ -872,6 +1251,8 @@ void moveCommand(redisClient* c) {
 
     dbDelete(src, c->argv[1]);
 
+    signalModifiedKey(src, c->argv[1]);
+    signalModifiedKey(dst, c->argv[1]);
     server.dirty++;
 
     addReply(c, shared.cone);
@@ -883,15 +1264,147 @@ void moveCommand(redisClient* c) {
 
 /* Expires API */
 
+/*
+ * 过期索引中元素的最大栈上缓冲区长度，更长的键使用堆内存
+ */
+#define EXPIRE_INDEX_STATIC_KEY 128
+
+/*
+ * 构造过期索引中的元素: 8字节大端序的过期时间(翻转符号位使负数也有序)加上键名，
+ * 元素按字典序排列即按过期时间排列
+ */
+static unsigned char* expireIndexElement(long long when, sds key, unsigned char* buf, size_t* len) {
+
+    uint64_t t = (uint64_t)when ^ ((uint64_t)1 << 63);
+    int j;
+
+    *len = 8 + sdslen(key);
+    if (*len > EXPIRE_INDEX_STATIC_KEY) buf = zmalloc(*len);
+
+    for (j = 7; j >= 0; j--) {
+        buf[j] = t & 0xff;
+        t >>= 8;
+    }
+    memcpy(buf + 8, key, sdslen(key));
+
+    return buf;
+}
+
+/*
+ * 从过期索引的元素中解析出过期时间
+ */
+static long long expireIndexTime(unsigned char* ele) {
+
+    uint64_t t = 0;
+    int j;
+
+    for (j = 0; j < 8; j++) t = (t << 8) | ele[j];
+
+    return (long long)(t ^ ((uint64_t)1 << 63));
+}
+
+/*
+ * 将键key及其过期时间when加入/移出过期索引
+ */
+static void expireIndexUpdate(redisDb* db, sds key, long long when, int add) {
+
+    unsigned char buf[EXPIRE_INDEX_STATIC_KEY];
+    unsigned char* ele;
+    size_t len;
+
+    ele = expireIndexElement(when, key, buf, &len);
+
+    if (add)
+        raxInsert(db->expires_index, ele, len);
+    else
+        raxRemove(db->expires_index, ele, len);
+
+    if (ele != buf) zfree(ele);
+}
+
+/*
+ * 从过期字典和过期索引中删除键key，键不存在过期时间时返回0
+ */
+static int removeExpireEntry(redisDb* db, sds key) {
+
+    dictEntry* de = dictFind(db->expires, key);
+
+    if (de == NULL) return 0;
+
+    expireIndexUpdate(db, dictGetKey(de), dictGetSignedIntegerVal(de), 0);
+
+    dictDelete(db->expires, key);
+
+    return 1;
+}
+
+/*
+ * 按过期时间从早到晚，取出最多count个在now时已经过期的键，
+ * 保存它们在过期字典中的节点，返回取出的数量，
+ * 调用者可以在之后逐个删除这些键
+ */
+int getDueExpires(redisDb* db, long long now, dictEntry** due, int count) {
+
+    raxIterator ri;
+    int n = 0;
+
+    if (count <= 0) return 0;
+
+    raxStart(&ri, db->expires_index);
+    raxSeek(&ri, "^", NULL, 0);
+    while (n < count && raxNext(&ri)) {
+        dictEntry* de;
+        sds key;
+
+        // 之后的键都还没有过期
+        if (expireIndexTime(ri.key) >= now) break;
+
+        key = sdsnewlen(ri.key + 8, ri.key_len - 8);
+        de = dictFind(db->expires, key);
+        sdsfree(key);
+
+        assert(de != NULL);
+        due[n++] = de;
+    }
+    raxStop(&ri);
+
+    return n;
+}
+
+/*
+ * 统计在now时已经过期但还没有被删除的键的数量(积压)，最多统计max个，
+ * 如果oldest不为NULL，保存最早的过期时间，没有积压时为-1
+ */
+unsigned long long countOverdueExpires(redisDb* db, long long now, unsigned long long max, long long* oldest) {
+
+    raxIterator ri;
+    unsigned long long n = 0;
+
+    if (oldest) *oldest = -1;
+
+    raxStart(&ri, db->expires_index);
+    raxSeek(&ri, "^", NULL, 0);
+    while (n < max && raxNext(&ri)) {
+        long long when = expireIndexTime(ri.key);
+
+        if (when >= now) break;
+        if (n == 0 && oldest) *oldest = when;
+        n++;
+    }
+    raxStop(&ri);
+
+    return n;
+}
+
 /*
  * 移除键key的过期时间，键必须在键空间存在，
- * 如果键key设置了过期时间，则从过期字典中将键key删除
+ * 如果键key设置了过期时间，则从过期字典和过期索引中将键key删除
  */
 int removeExpire(redisDb* db, robj* key) {
 
     assert(dictFind(db->dict, key->ptr) != NULL);
 
-    return dictDelete(db->expires, key->ptr) == DICT_OK;
+    return removeExpireEntry(db, key->ptr);
 }
 
 /*
@@ -908,10 +1421,18 @@ void setExpire(redisDb* db, robj* key, long long when) {
 
     assert(kde != NULL);
 
-    de = dictReplaceRaw(db->expires, dictGetKey(kde));
+    // 先移除过期索引中旧的过期时间
+    de = dictFind(db->expires, dictGetKey(kde));
+    if (de) {
+        expireIndexUpdate(db, dictGetKey(de), dictGetSignedIntegerVal(de), 0);
+    } else {
+        de = dictReplaceRaw(db->expires, dictGetKey(kde));
+    }
 
     // 设置键的过期时间
     dictSetSignedIntegerVal(de, when);
+
+    expireIndexUpdate(db, dictGetKey(kde), when, 1);
 }
 
 /*
@@ -1016,6 +1537,7 @@ void expireGenericCommand(redisClient* c, long long basetime, int unit) {
         robj* aux;
 
         assert(dbDelete(c->db, key));
+        signalModifiedKey(c->db, key);
         server.dirty++;
 
         // 传播显式的DEL命令
@@ -1036,12 +1558,58 @@ void expireGenericCommand(redisClient* c, long long basetime, int unit) {
 
         addReply(c, shared.cone);
 
+        signalModifiedKey(c->db, key);
         server.dirty++;
 
         return;
     }
 }
 
+/*
+ * MEXPIRE，MPEXPIRE命令的底层实现
+ *
+ * 为多个键设置相同的过期时间，回复设置成功(或因为时间已经过去而被删除)的键的数量
+ */
+void mexpireGenericCommand(redisClient* c, long long basetime, int unit) {
+
+    long long when;
+    int j, set = 0, deleted = 0;
+
+    if (getLongLongFromObjectOrReply(c, c->argv[1], &when, NULL) != REDIS_OK)
+        return;
+
+    if (unit == UNIT_SECONDS) when *= 1000;
+    when += basetime;
+
+    for (j = 2; j < c->argc; j++) {
+        robj* key = c->argv[j];
+
+        if (lookupKeyRead(c->db, key) == NULL) continue;
+
+        if (when <= mstime() && !server.loading /* && !server.masterhost */) {
+            assert(dbDelete(c->db, key));
+            deleted++;
+        } else {
+            setExpire(c->db, key, when);
+        }
+
+        signalModifiedKey(c->db, key);
+        set++;
+        server.dirty++;
+    }
+
+    // 设置的时间已经过期，键被删除，将命令改写为DEL key [key ...]进行传播
+    /* Replicate/AOF this as an explicit DEL. */
+    if (deleted) {
+        decrRefCount(c->argv[1]);
+        memmove(c->argv + 1, c->argv + 2, sizeof(robj*) * (c->argc - 2));
+        c->argc--;
+        rewriteClientCommandArgument(c, 0, shared.del);
+    }
+
+    addReplyLongLong(c, set);
+}
+
 /*
  * EXPIRE命令
  *
@@ -1068,6 +1636,28 @@ void pexpireatCommand(redisClient* c) {
     expireGenericCommand(c, 0, UNIT_MILLISECONDS);
 }
 
+/*
+ * MEXPIRE命令
+ *
+ * MEXPIRE seconds key [key ...]
+ *
+ * 一次为多个键设置相同的过期时间(s)
+ */
+void mexpireCommand(redisClient* c) {
+    mexpireGenericCommand(c, mstime(), UNIT_SECONDS);
+}
+
+/*
+ * MPEXPIRE命令
+ *
+ * MPEXPIRE milliseconds key [key ...]
+ *
+ * 一次为多个键设置相同的过期时间(ms)
+ */
+void mpexpireCommand(redisClient* c) {
+    mexpireGenericCommand(c, mstime(), UNIT_MILLISECONDS);
+}
+
 /*
  * TTL，PTTL命令的底层实现
  */
@@ -1132,6 +1722,7 @@ void persistCommand(redisClient* c) {
 
         if (removeExpire(c->db, c->argv[1])) {
             addReply(c, shared.cone);
+            signalModifiedKey(c->db, c->argv[1]);
             server.dirty++;
         } else {
             addReply(c, shared.czero);
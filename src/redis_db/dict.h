@@ -32,6 +32,7 @@ typedef struct dictEntry {
         void* val;
         uint64_t u64;
         int64_t s64;
+        double d;
     } v;
 
     // 指向下一个哈希冲突的节点
@@ -176,6 +177,9 @@ typedef void (dictScanFunction)(void* privdata, const dictEntry* de);
 #define dictSetUnsignedIntegerVal(entry, _val_) \
     do { entry->v.u64 = _val_; } while (0)
 
+#define dictSetDoubleVal(entry, _val_) \
+    do { entry->v.d = _val_; } while (0)
+
 // 释放字典节点的键
 #define dictFreeKey(d, entry) \
     if ((d)->type->keyDestructor) \
@@ -206,6 +210,8 @@ typedef void (dictScanFunction)(void* privdata, const dictEntry* de);
 
 #define dictGetUnsignedIntegerVal(he) ((he)->v.u64)
 
+#define dictGetDoubleVal(he) ((he)->v.d)
+
 // 返回字典的大小
 #define dictSlots(d) ((d)->ht[0].size + (d)->ht[1].size)
 
@@ -0,0 +1,171 @@
+//
+// Created by zouyi on 2021/11/13.
+//
+
+/*
+ * 示例模块，把常见的多次往返的读-改-写操作放到服务器中一次完成
+ *
+ * 编译: make modules
+ * 加载: MODULE LOAD ./hellomodule.so
+ */
+
+#include "redismodule.h"
+
+/*
+ * HELLO.PUSH.CAPPED key maxlen element [element ...]
+ *
+ * 将元素添加到列表表头，然后从表尾删除元素直到长度不超过maxlen，回复列表的长度，
+ * 相当于一个事务中的LPUSH和LTRIM
+ */
+int HelloPushCapped_RedisCommand(RedisModuleCtx* ctx, RedisModuleString** argv, int argc) {
+    RedisModuleKey* key;
+    long long maxlen;
+    int j;
+
+    if (RedisModule_StringToLongLong(argv[2], &maxlen) != REDISMODULE_OK || maxlen < 0)
+        return RedisModule_ReplyWithError(ctx, "ERR invalid maxlen");
+
+    key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ | REDISMODULE_WRITE);
+    if (RedisModule_KeyType(key) != REDISMODULE_KEYTYPE_EMPTY && RedisModule_KeyType(key) != REDISMODULE_KEYTYPE_LIST)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    for (j = 3; j < argc; j++)
+        RedisModule_ListPush(key, REDISMODULE_LIST_HEAD, argv[j]);
+    while (RedisModule_ValueLength(key) > (size_t) maxlen)
+        RedisModule_ListPop(key, REDISMODULE_LIST_TAIL);
+
+    return RedisModule_ReplyWithLongLong(ctx, RedisModule_ValueLength(key));
+}
+
+/*
+ * HELLO.HGETSET key field value
+ *
+ * 设置哈希域的值，回复旧的值，域不存在时回复空
+ */
+int HelloHGetSet_RedisCommand(RedisModuleCtx* ctx, RedisModuleString** argv, int argc) {
+    RedisModuleKey* key;
+    RedisModuleString* old;
+
+    key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ | REDISMODULE_WRITE);
+    if (RedisModule_KeyType(key) != REDISMODULE_KEYTYPE_EMPTY && RedisModule_KeyType(key) != REDISMODULE_KEYTYPE_HASH)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    old = RedisModule_HashGet(key, argv[2]);
+    RedisModule_HashSet(key, argv[2], argv[3]);
+
+    return old ? RedisModule_ReplyWithString(ctx, old) : RedisModule_ReplyWithNull(ctx);
+}
+
+/*
+ * HELLO.SUM遍历时使用的状态
+ */
+struct sumState {
+
+    double sum;
+
+    // 遇到不是数字的元素
+    int invalid;
+};
+
+static int sumCallback(RedisModuleCtx* ctx, RedisModuleString* field, RedisModuleString* value, void* privdata) {
+    struct sumState* state = privdata;
+    double d;
+
+    // 列表和集合累加元素，哈希累加值，有序集合累加分值
+    if (RedisModule_StringToDouble(value ? value : field, &d) != REDISMODULE_OK) {
+        state->invalid = 1;
+        return REDISMODULE_ERR;
+    }
+    state->sum += d;
+    return REDISMODULE_OK;
+}
+
+/*
+ * HELLO.SUM key
+ *
+ * 列表或集合中所有元素的和，哈希中所有值的和，或者有序集合中所有分值的和
+ */
+int HelloSum_RedisCommand(RedisModuleCtx* ctx, RedisModuleString** argv, int argc) {
+    RedisModuleKey* key;
+    struct sumState state = {0, 0};
+
+    key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ);
+    if (RedisModule_KeyType(key) == REDISMODULE_KEYTYPE_STRING)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    RedisModule_KeyForEach(key, sumCallback, &state);
+    if (state.invalid)
+        return RedisModule_ReplyWithError(ctx, "ERR element is not a valid float");
+
+    return RedisModule_ReplyWithDouble(ctx, state.sum);
+}
+
+/*
+ * HELLO.FILTER遍历时使用的状态
+ */
+struct filterState {
+
+    double min;
+
+    double max;
+
+    long count;
+};
+
+static int filterCallback(RedisModuleCtx* ctx, RedisModuleString* field, RedisModuleString* value, void* privdata) {
+    struct filterState* state = privdata;
+    double score;
+
+    RedisModule_StringToDouble(value, &score);
+    if (score >= state->min && score <= state->max) {
+        RedisModule_ReplyWithString(ctx, field);
+        state->count++;
+    }
+    return REDISMODULE_OK;
+}
+
+/*
+ * HELLO.FILTER key min max
+ *
+ * 有序集合中分值在[min, max]之间的成员，按照成员在集合中的顺序，元素数量在遍历完之后才知道
+ */
+int HelloFilter_RedisCommand(RedisModuleCtx* ctx, RedisModuleString** argv, int argc) {
+    RedisModuleKey* key;
+    struct filterState state = {0, 0, 0};
+
+    if (RedisModule_StringToDouble(argv[2], &state.min) != REDISMODULE_OK ||
+        RedisModule_StringToDouble(argv[3], &state.max) != REDISMODULE_OK)
+        return RedisModule_ReplyWithError(ctx, "ERR min or max is not a float");
+
+    key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ);
+    if (RedisModule_KeyType(key) != REDISMODULE_KEYTYPE_EMPTY && RedisModule_KeyType(key) != REDISMODULE_KEYTYPE_ZSET)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    RedisModule_ReplyWithArray(ctx, REDISMODULE_POSTPONED_ARRAY_LEN);
+    RedisModule_KeyForEach(key, filterCallback, &state);
+    RedisModule_ReplySetArrayLength(ctx, state.count);
+
+    return REDISMODULE_OK;
+}
+
+/*
+ * 模块入口，MODULE LOAD时调用
+ */
+int RedisModule_OnLoad(RedisModuleCtx* ctx, RedisModuleString** argv, int argc) {
+    if (RedisModule_Init(ctx, "hello", 1, REDISMODULE_APIVER_1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "hello.push.capped", HelloPushCapped_RedisCommand, -4, "wm", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "hello.hgetset", HelloHGetSet_RedisCommand, 4, "wm", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "hello.sum", HelloSum_RedisCommand, 2, "r", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "hello.filter", HelloFilter_RedisCommand, 4, "r", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    return REDISMODULE_OK;
+}
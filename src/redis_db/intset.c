@@ -7,6 +7,16 @@
 #include "intset.h"
 #include "zmalloc.h"
 
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// 二分查找把范围缩小到这个数量的元素以内之后，改为向量化的线性查找
+#define INTSET_LINEAR_SEARCH 32
+
+// 一个集合的长度超过另一个集合的INTSET_GALLOP_RATIO倍时，求交集和差集使用跳跃查找(galloping)代替归并
+#define INTSET_GALLOP_RATIO 16
+
 /*
  * 返回值v所需最小编码字节/类型
  */
@@ -87,14 +97,76 @@ static intset* intsetResize(intset* is, uint32_t len) {
     return is;
 }
 
+/*
+ * 统计整数集合[lo, hi)范围内小于value的元素数量，value必须在整数集合的编码范围内，
+ * 由于元素有序排列，lo加上这个数量就是第一个不小于value的元素的位置，
+ * 编译器支持时使用SSE2/SSE4.2/AVX2指令一次比较多个元素(编译时通过SIMD_FLAGS指定，例如-mavx2)
+ */
+static uint32_t _intsetCountLess(intset* is, uint32_t lo, uint32_t hi, int64_t value) {
+    uint32_t i = lo, count = 0;
+
+    if (is->encoding == INTSET_ENC_INT16) {
+        const int16_t* p = (const int16_t*)is->contents;
+#if defined(__AVX2__)
+        __m256i v = _mm256_set1_epi16((int16_t)value);
+        for (; i + 16 <= hi; i += 16) {
+            __m256i x = _mm256_loadu_si256((const __m256i*)(p + i));
+            // movemask每个字节一位，16位元素占2位
+            count += __builtin_popcount((unsigned int)_mm256_movemask_epi8(_mm256_cmpgt_epi16(v, x))) / 2;
+        }
+#elif defined(__SSE2__)
+        __m128i v = _mm_set1_epi16((int16_t)value);
+        for (; i + 8 <= hi; i += 8) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(p + i));
+            count += __builtin_popcount((unsigned int)_mm_movemask_epi8(_mm_cmplt_epi16(x, v))) / 2;
+        }
+#endif
+        for (; i < hi; i++) count += p[i] < value;
+    } else if (is->encoding == INTSET_ENC_INT32) {
+        const int32_t* p = (const int32_t*)is->contents;
+#if defined(__AVX2__)
+        __m256i v = _mm256_set1_epi32((int32_t)value);
+        for (; i + 8 <= hi; i += 8) {
+            __m256i x = _mm256_loadu_si256((const __m256i*)(p + i));
+            count += __builtin_popcount((unsigned int)_mm256_movemask_epi8(_mm256_cmpgt_epi32(v, x))) / 4;
+        }
+#elif defined(__SSE2__)
+        __m128i v = _mm_set1_epi32((int32_t)value);
+        for (; i + 4 <= hi; i += 4) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(p + i));
+            count += __builtin_popcount((unsigned int)_mm_movemask_epi8(_mm_cmplt_epi32(x, v))) / 4;
+        }
+#endif
+        for (; i < hi; i++) count += p[i] < value;
+    } else {
+        const int64_t* p = (const int64_t*)is->contents;
+#if defined(__AVX2__)
+        __m256i v = _mm256_set1_epi64x(value);
+        for (; i + 4 <= hi; i += 4) {
+            __m256i x = _mm256_loadu_si256((const __m256i*)(p + i));
+            count += __builtin_popcount((unsigned int)_mm256_movemask_epi8(_mm256_cmpgt_epi64(v, x))) / 8;
+        }
+#elif defined(__SSE4_2__)
+        __m128i v = _mm_set1_epi64x(value);
+        for (; i + 2 <= hi; i += 2) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(p + i));
+            count += __builtin_popcount((unsigned int)_mm_movemask_epi8(_mm_cmpgt_epi64(v, x))) / 8;
+        }
+#endif
+        for (; i < hi; i++) count += p[i] < value;
+    }
+
+    return count;
+}
+
 /*
  * 在整数集合中搜索值为value的元素，pos中存value应该插入的位置，
- * 由于整数集合是有序存放，所以进行二分查找
+ * 由于整数集合是有序存放，所以先进行二分查找，范围足够小之后进行向量化的线性查找
  * O(logN)
  */
 static uint8_t intsetSearch(intset* is, int64_t value, uint32_t* pos) {
-    int min = 0, max = is->length - 1, mid = -1;
-    int64_t cur = -1;
+    uint32_t min = 0, max = is->length, mid;
+    int64_t cur;
 
     // 如果是空整数集合，则应该插入到pos = 0位置
     if (is->length == 0) {
@@ -112,26 +184,25 @@ static uint8_t intsetSearch(intset* is, int64_t value, uint32_t* pos) {
         }
     }
 
-    // 二分查找
-    while (max >= min) {
-        mid = (min + max) / 2;
+    // 二分查找，在[min, max)范围内
+    while (max - min > INTSET_LINEAR_SEARCH) {
+        mid = min + (max - min) / 2;
         cur = _intsetGet(is, mid);
         if (value > cur) {
             min = mid + 1;
         } else if (value < cur) {
-            max = mid - 1;
+            max = mid;
         } else {
-            break;
+            if (pos) *pos = mid;
+            return 1;
         }
     }
 
-    if (value == cur) {
-        if (pos) *pos = mid;
-        return 1;
-    } else {
-        if (pos) *pos = min;
-        return 0;
-    }
+    // 线性查找第一个不小于value的元素
+    min += _intsetCountLess(is, min, max, value);
+
+    if (pos) *pos = min;
+    return min < max && _intsetGet(is, min) == value;
 }
 
 /*
@@ -291,3 +362,178 @@ uint32_t intsetLen(intset* is) {
 size_t intsetBlobLen(intset* is) {
     return sizeof(intset) + is->length * is->encoding;
 }
+
+/*
+ * 对元素类型为T的有序数组生成集合运算的函数，函数名以S结尾:
+ *
+ * _intsetGallopS: 从lo开始以1, 2, 4...的步长跳跃，再二分查找p[lo, len)中第一个不小于v的位置
+ * _intsetInterS/_intsetUnionS/_intsetDiffS: 将a和b的交集/并集/差集写入out，返回元素数量
+ */
+#define INTSET_DEFINE_KERNELS(T, S) \
+static uint32_t _intsetGallop##S(const T* p, uint32_t lo, uint32_t len, T v) { \
+    uint32_t hi = lo, step = 1, mid; \
+    while (hi < len && p[hi] < v) { \
+        lo = hi + 1; \
+        hi += step; \
+        step <<= 1; \
+    } \
+    if (hi > len) hi = len; \
+    while (lo < hi) { \
+        mid = lo + (hi - lo) / 2; \
+        if (p[mid] < v) lo = mid + 1; else hi = mid; \
+    } \
+    return lo; \
+} \
+\
+static uint32_t _intsetInter##S(const T* a, uint32_t alen, const T* b, uint32_t blen, T* out) { \
+    uint32_t i = 0, j = 0, n = 0; \
+    if (alen > blen) { \
+        const T* t = a; uint32_t tlen = alen; \
+        a = b; alen = blen; b = t; blen = tlen; \
+    } \
+    if ((uint64_t)alen * INTSET_GALLOP_RATIO < blen) { \
+        for (i = 0; i < alen && j < blen; i++) { \
+            j = _intsetGallop##S(b, j, blen, a[i]); \
+            if (j < blen && b[j] == a[i]) out[n++] = a[i]; \
+        } \
+        return n; \
+    } \
+    while (i < alen && j < blen) { \
+        T x = a[i], y = b[j]; \
+        if (x == y) out[n++] = x; \
+        i += x <= y; \
+        j += y <= x; \
+    } \
+    return n; \
+} \
+\
+static uint32_t _intsetUnion##S(const T* a, uint32_t alen, const T* b, uint32_t blen, T* out) { \
+    uint32_t i = 0, j = 0, n = 0; \
+    while (i < alen && j < blen) { \
+        T x = a[i], y = b[j]; \
+        out[n++] = (x <= y) ? x : y; \
+        i += x <= y; \
+        j += y <= x; \
+    } \
+    while (i < alen) out[n++] = a[i++]; \
+    while (j < blen) out[n++] = b[j++]; \
+    return n; \
+} \
+\
+static uint32_t _intsetDiff##S(const T* a, uint32_t alen, const T* b, uint32_t blen, T* out) { \
+    uint32_t i = 0, j = 0, n = 0; \
+    if ((uint64_t)alen * INTSET_GALLOP_RATIO < blen) { \
+        for (i = 0; i < alen; i++) { \
+            j = _intsetGallop##S(b, j, blen, a[i]); \
+            if (j == blen || b[j] != a[i]) out[n++] = a[i]; \
+        } \
+        return n; \
+    } \
+    while (i < alen && j < blen) { \
+        T x = a[i], y = b[j]; \
+        if (x < y) out[n++] = x; \
+        i += x <= y; \
+        j += y <= x; \
+    } \
+    while (i < alen) out[n++] = a[i++]; \
+    return n; \
+}
+
+INTSET_DEFINE_KERNELS(int16_t, 16)
+INTSET_DEFINE_KERNELS(int32_t, 32)
+INTSET_DEFINE_KERNELS(int64_t, 64)
+
+#define INTSET_OP_INTER 0
+#define INTSET_OP_UNION 1
+#define INTSET_OP_DIFF 2
+
+/*
+ * 返回以enc编码保存is中元素的新整数集合，enc不小于is的编码
+ */
+static intset* _intsetCopyEncoded(intset* is, uint8_t enc) {
+    intset* copy = zmalloc(sizeof(intset) + is->length * enc);
+    uint32_t i;
+
+    copy->encoding = enc;
+    copy->length = is->length;
+    for (i = 0; i < is->length; i++)
+        _intsetSet(copy, i, _intsetGet(is, i));
+
+    return copy;
+}
+
+/*
+ * 计算a和b的交集/并集/差集，返回新的整数集合，
+ * 两个集合编码不同时先把编码较小的集合复制为较大的编码，再对同类型的有序数组运算
+ */
+static intset* intsetSetOperation(intset* a, intset* b, int op) {
+    uint8_t enc = a->encoding > b->encoding ? a->encoding : b->encoding;
+    intset* ea = (a->encoding == enc) ? a : _intsetCopyEncoded(a, enc);
+    intset* eb = (b->encoding == enc) ? b : _intsetCopyEncoded(b, enc);
+    uint32_t cap, n;
+    intset* r;
+
+    if (op == INTSET_OP_INTER)
+        cap = a->length < b->length ? a->length : b->length;
+    else if (op == INTSET_OP_UNION)
+        cap = a->length + b->length;
+    else
+        cap = a->length;
+
+    r = zmalloc(sizeof(intset) + cap * enc);
+    r->encoding = enc;
+
+    if (enc == INTSET_ENC_INT64) {
+        int64_t *pa = (int64_t*)ea->contents, *pb = (int64_t*)eb->contents, *out = (int64_t*)r->contents;
+        if (op == INTSET_OP_INTER) n = _intsetInter64(pa, ea->length, pb, eb->length, out);
+        else if (op == INTSET_OP_UNION) n = _intsetUnion64(pa, ea->length, pb, eb->length, out);
+        else n = _intsetDiff64(pa, ea->length, pb, eb->length, out);
+    } else if (enc == INTSET_ENC_INT32) {
+        int32_t *pa = (int32_t*)ea->contents, *pb = (int32_t*)eb->contents, *out = (int32_t*)r->contents;
+        if (op == INTSET_OP_INTER) n = _intsetInter32(pa, ea->length, pb, eb->length, out);
+        else if (op == INTSET_OP_UNION) n = _intsetUnion32(pa, ea->length, pb, eb->length, out);
+        else n = _intsetDiff32(pa, ea->length, pb, eb->length, out);
+    } else {
+        int16_t *pa = (int16_t*)ea->contents, *pb = (int16_t*)eb->contents, *out = (int16_t*)r->contents;
+        if (op == INTSET_OP_INTER) n = _intsetInter16(pa, ea->length, pb, eb->length, out);
+        else if (op == INTSET_OP_UNION) n = _intsetUnion16(pa, ea->length, pb, eb->length, out);
+        else n = _intsetDiff16(pa, ea->length, pb, eb->length, out);
+    }
+
+    if (ea != a) zfree(ea);
+    if (eb != b) zfree(eb);
+
+    r->length = n;
+    return intsetResize(r, n);
+}
+
+/*
+ * 返回a和b的交集，结果是新创建的整数集合
+ */
+intset* intsetIntersect(intset* a, intset* b) {
+    return intsetSetOperation(a, b, INTSET_OP_INTER);
+}
+
+/*
+ * 返回a和b的并集，结果是新创建的整数集合
+ */
+intset* intsetUnion(intset* a, intset* b) {
+    return intsetSetOperation(a, b, INTSET_OP_UNION);
+}
+
+/*
+ * 返回a中不属于b的元素组成的差集，结果是新创建的整数集合
+ */
+intset* intsetDifference(intset* a, intset* b) {
+    return intsetSetOperation(a, b, INTSET_OP_DIFF);
+}
+
+/*
+ * 复制整数集合
+ */
+intset* intsetDup(intset* is) {
+    intset* copy = zmalloc(intsetBlobLen(is));
+
+    memcpy(copy, is, intsetBlobLen(is));
+    return copy;
+}
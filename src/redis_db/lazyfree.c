@@ -0,0 +1,234 @@
+//
+// Created by zouyi on 2021/11/4.
+//
+
+#include "redis.h"
+#include "bio.h"
+
+/*
+ * 惰性释放(lazy free)
+ *
+ * 删除一个包含大量元素的集合、哈希或有序集合时，逐个释放元素会阻塞主线程，
+ * 因此将值对象从键空间中摘下后交给bio线程释放，主线程只做O(1)的工作
+ *
+ * bio线程调用的decrRefCount不是原子操作，所以交给bio线程的对象及其内部的所有内存都不能再被主线程访问:
+ * 对象本身只被键空间引用(refcount为1)；集合、哈希和有序集合独占自己的元素对象，
+ * 插入时保存参数的副本(setTypeAdd、hashTypeSet、zaddGenericCommand、zsetCreateFromSorted)，
+ * 回复元素时复制内容(addReplyBulkCopy)，元素的临时引用在命令返回前释放；
+ * 共享整数对象是永生的，bio线程对它们调用decrRefCount不会修改引用计数
+ */
+
+// 等待bio线程释放的对象数量
+static size_t lazyfree_objects = 0;
+
+// 等待bio线程释放的对象估算占用的字节数
+static size_t lazyfree_pending_bytes = 0;
+
+// bio线程已经释放的对象数量
+static size_t lazyfreed_objects = 0;
+
+/*
+ * 返回释放对象需要的工作量，即需要释放的内存块数量的估计，
+ * 紧凑编码(listpack、intset)和字符串只需要释放一块内存，返回1
+ */
+size_t lazyfreeGetFreeEffort(robj* obj) {
+
+    if (obj->type == REDIS_LIST && obj->encoding == REDIS_ENCODING_QUICKLIST) {
+        // 快速列表每个节点只需要释放节点和压缩列表两块内存
+        return ((quicklist*) obj->ptr)->len;
+    } else if (obj->type == REDIS_SET && obj->encoding == REDIS_ENCODING_HT) {
+        return dictSize((dict*) obj->ptr);
+    } else if (obj->type == REDIS_SET && obj->encoding == REDIS_ENCODING_ROARING) {
+        // roaring位图每个容器需要释放容器数据一块内存
+        return ((roaring*) obj->ptr)->size;
+    } else if (obj->type == REDIS_ZSET && obj->encoding == REDIS_ENCODING_SKIPLIST) {
+        zset* zs = obj->ptr;
+        return zs->zsl->length;
+    } else if (obj->type == REDIS_ZSET && obj->encoding == REDIS_ENCODING_BTREE) {
+        zset* zs = obj->ptr;
+        return zs->zbt->length;
+    } else if (obj->type == REDIS_HASH && obj->encoding == REDIS_ENCODING_HT) {
+        return dictSize((dict*) obj->ptr);
+    } else {
+        return 1;
+    }
+}
+
+#define LAZYFREE_SAMPLES 8
+
+/*
+ * 估算字符串对象占用的字节数
+ */
+static size_t lazyfreeStringObjectBytes(robj* o) {
+    if (o->encoding == REDIS_ENCODING_INT) return sizeof(robj);
+    return sizeof(robj) + sdsAllocSize(o->ptr);
+}
+
+/*
+ * 估算交给bio线程的对象占用的字节数: 采样前LAZYFREE_SAMPLES个元素或节点计算平均大小，乘以数量，
+ * 只用于统计和内存淘汰的计算，不要求精确
+ */
+static size_t lazyfreeEstimateBytes(robj* obj, size_t effort) {
+    size_t sampled = 0, bytes = 0, fixed = sizeof(robj);
+
+    if (obj->type == REDIS_SET && obj->encoding == REDIS_ENCODING_ROARING) {
+        // roaring位图可以直接计算出占用的字节数
+        return fixed + roaringBytes(obj->ptr);
+    } else if (obj->type == REDIS_LIST && obj->encoding == REDIS_ENCODING_QUICKLIST) {
+        quicklist* ql = obj->ptr;
+        quicklistNode* node = ql->head;
+
+        fixed += sizeof(quicklist);
+        while (node && sampled < LAZYFREE_SAMPLES) {
+            bytes += sizeof(quicklistNode) + quicklistNodeAllocSize(node);
+            sampled++;
+            node = node->next;
+        }
+    } else if (obj->encoding == REDIS_ENCODING_HT || obj->encoding == REDIS_ENCODING_SKIPLIST ||
+               obj->encoding == REDIS_ENCODING_BTREE) {
+        dict* d = (obj->type == REDIS_ZSET) ? ((zset*) obj->ptr)->dict : obj->ptr;
+        dictIterator* di = dictGetIterator(d);
+        dictEntry* de;
+
+        while ((de = dictNext(di)) != NULL && sampled < LAZYFREE_SAMPLES) {
+            bytes += sizeof(dictEntry) + lazyfreeStringObjectBytes(dictGetKey(de));
+            if (obj->type == REDIS_HASH)
+                bytes += lazyfreeStringObjectBytes(dictGetVal(de));
+            else if (obj->encoding == REDIS_ENCODING_BTREE)
+                bytes += sizeof(double) + sizeof(robj*);
+            else if (obj->type == REDIS_ZSET)
+                bytes += sizeof(zskiplistNode) + sizeof(struct zskiplistLevel);
+            sampled++;
+        }
+        dictReleaseIterator(di);
+        // 哈希表的桶数组
+        fixed += (d->ht[0].size + d->ht[1].size) * sizeof(dictEntry*);
+    }
+
+    if (sampled == 0) return fixed;
+    return fixed + bytes * effort / sampled;
+}
+
+/*
+ * 将对象交给bio线程释放，调用者放弃对obj的引用
+ */
+static void lazyfreeObjectAsync(robj* obj, size_t effort) {
+    size_t bytes = lazyfreeEstimateBytes(obj, effort);
+
+    __sync_add_and_fetch(&lazyfree_objects, 1);
+    __sync_add_and_fetch(&lazyfree_pending_bytes, bytes);
+    // 估算的字节数随任务一起传递，释放完成后从待释放字节数中扣除
+    bioCreateBackgroundJob(REDIS_BIO_LAZY_FREE, obj, NULL, (void*) bytes);
+}
+
+/*
+ * 释放键空间中被替换或删除的值对象，
+ * 如果释放的工作量超过阈值并且对象没有被共享，交给bio线程释放，否则同步释放
+ */
+void freeObjectAsync(robj* obj) {
+    size_t effort = lazyfreeGetFreeEffort(obj);
+
+    if (effort > LAZYFREE_THRESHOLD && obj->refcount == 1) {
+        lazyfreeObjectAsync(obj, effort);
+    } else {
+        decrRefCount(obj);
+    }
+}
+
+/*
+ * 从数据库中删除给定键key，大的值对象交给bio线程释放，
+ * 其余行为与dbDelete相同
+ */
+int dbAsyncDelete(redisDb* db, robj* key) {
+    dictEntry* de;
+
+    de = dictFind(db->dict, key->ptr);
+    if (de) {
+        robj* val = dictGetVal(de);
+        size_t effort = lazyfreeGetFreeEffort(val);
+
+        // 先将值从字典节点上摘下，字典的值释放函数遇到NULL时什么都不做
+        if (effort > LAZYFREE_THRESHOLD && val->refcount == 1) {
+            lazyfreeObjectAsync(val, effort);
+            dictSetVal(db->dict, de, NULL);
+        }
+    }
+
+    // 删除键和过期时间，释放键和未被摘下的值
+    return dbDelete(db, key);
+}
+
+/*
+ * 清空数据库db，将原来的键空间和过期字典交给bio线程释放，
+ * 数据库立即换上新的空字典
+ */
+void emptyDbAsync(redisDb* db) {
+    dict* oldht1 = db->dict;
+    dict* oldht2 = db->expires;
+
+    db->dict = dictCreate(&dbDictType, NULL);
+    db->expires = dictCreate(&keyptrDictType, NULL);
+
+    // 两个基数树索引的节点数与键的数量相同，同样交给bio线程释放
+    bioCreateBackgroundJob(REDIS_BIO_LAZY_FREE, NULL, NULL, db->expires_index);
+    db->expires_index = raxNew();
+    if (db->keyindex) {
+        bioCreateBackgroundJob(REDIS_BIO_LAZY_FREE, NULL, NULL, db->keyindex);
+        db->keyindex = raxNew();
+    }
+
+    // 整个数据库的内存占用无法廉价地估算，这里只计数不计字节数
+    __sync_add_and_fetch(&lazyfree_objects, dictSize(oldht1));
+    bioCreateBackgroundJob(REDIS_BIO_LAZY_FREE, NULL, oldht1, oldht2);
+}
+
+/*
+ * 由bio线程调用，释放对象
+ */
+void lazyfreeFreeObjectFromBioThread(robj* obj, size_t bytes) {
+    decrRefCount(obj);
+    __sync_sub_and_fetch(&lazyfree_objects, 1);
+    __sync_sub_and_fetch(&lazyfree_pending_bytes, bytes);
+    __sync_add_and_fetch(&lazyfreed_objects, 1);
+}
+
+/*
+ * 由bio线程调用，释放整个数据库的键空间和过期字典
+ */
+void lazyfreeFreeDatabaseFromBioThread(dict* ht1, dict* ht2) {
+    size_t numkeys = dictSize(ht1);
+
+    dictRelease(ht1);
+    dictRelease(ht2);
+    __sync_sub_and_fetch(&lazyfree_objects, numkeys);
+    __sync_add_and_fetch(&lazyfreed_objects, numkeys);
+}
+
+/*
+ * 由bio线程调用，释放基数树索引
+ */
+void lazyfreeFreeRaxFromBioThread(rax* rt) {
+    raxFree(rt);
+}
+
+/*
+ * 返回等待bio线程释放的对象数量
+ */
+size_t lazyfreeGetPendingObjectsCount(void) {
+    return __sync_add_and_fetch(&lazyfree_objects, 0);
+}
+
+/*
+ * 返回等待bio线程释放的对象估算占用的字节数，
+ * 这部分内存仍然计入zmalloc_used_memory()，但很快会被释放
+ */
+size_t lazyfreeGetPendingBytes(void) {
+    return __sync_add_and_fetch(&lazyfree_pending_bytes, 0);
+}
+
+/*
+ * 返回bio线程已经释放的对象数量
+ */
+size_t lazyfreeGetFreedObjectsCount(void) {
+    return __sync_add_and_fetch(&lazyfreed_objects, 0);
+}
@@ -0,0 +1,604 @@
+//
+// Created by zouyi on 2021/11/8.
+//
+
+/*
+ *  Listpack 内存布局:
+ *
+ *  <total-bytes> <num-elements> <element-1> ... <element-N> <end>
+ *
+ *  total-bytes : 4字节，整个listpack占用的字节数
+ *  num-elements: 2字节，元素数量，等于LP_HDR_NUMELE_UNKNOWN时需要遍历计数
+ *  end         : 1字节，0xFF
+ *
+ *  每个元素: <encoding+data> <backlen>
+ *
+ *  backlen保存encoding+data的长度，从右向左读取，每个字节的低7位是长度的一部分，
+ *  最高位为1表示左边还有更多字节，因此可以从下一个元素(或end)向左找到当前元素的起始位置
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "zmalloc.h"
+#include "utils.h"
+#include "listpack.h"
+
+#define LP_HDR_SIZE 6
+#define LP_HDR_NUMELE_UNKNOWN UINT16_MAX
+#define LP_EOF 0xFF
+
+#define LP_MAX_INT_ENCODING_LEN 9
+#define LP_MAX_BACKLEN_SIZE 5
+
+/*
+ * 元素的编码方式，由第一个字节的高位决定
+ *
+ * 0xxxxxxx                     : 7位无符号整数
+ * 10xxxxxx <data>              : 长度小于64的字符串
+ * 110xxxxx yyyyyyyy            : 13位有符号整数
+ * 1110xxxx yyyyyyyy <data>     : 长度小于4096的字符串
+ * 11110000 <4字节长度> <data>   : 更长的字符串
+ * 11110001/0010/0011/0100      : 16/24/32/64位有符号整数，小端序
+ */
+#define LP_ENCODING_7BIT_UINT 0
+#define LP_ENCODING_7BIT_UINT_MASK 0x80
+#define LP_ENCODING_IS_7BIT_UINT(byte) (((byte) & LP_ENCODING_7BIT_UINT_MASK) == LP_ENCODING_7BIT_UINT)
+
+#define LP_ENCODING_6BIT_STR 0x80
+#define LP_ENCODING_6BIT_STR_MASK 0xC0
+#define LP_ENCODING_IS_6BIT_STR(byte) (((byte) & LP_ENCODING_6BIT_STR_MASK) == LP_ENCODING_6BIT_STR)
+
+#define LP_ENCODING_13BIT_INT 0xC0
+#define LP_ENCODING_13BIT_INT_MASK 0xE0
+#define LP_ENCODING_IS_13BIT_INT(byte) (((byte) & LP_ENCODING_13BIT_INT_MASK) == LP_ENCODING_13BIT_INT)
+
+#define LP_ENCODING_12BIT_STR 0xE0
+#define LP_ENCODING_12BIT_STR_MASK 0xF0
+#define LP_ENCODING_IS_12BIT_STR(byte) (((byte) & LP_ENCODING_12BIT_STR_MASK) == LP_ENCODING_12BIT_STR)
+
+#define LP_ENCODING_32BIT_STR 0xF0
+#define LP_ENCODING_16BIT_INT 0xF1
+#define LP_ENCODING_24BIT_INT 0xF2
+#define LP_ENCODING_32BIT_INT 0xF3
+#define LP_ENCODING_64BIT_INT 0xF4
+
+#define LP_ENCODING_INT 0
+#define LP_ENCODING_STRING 1
+
+#define LP_BEFORE 0
+#define LP_REPLACE 1
+
+static uint32_t lpGetTotalBytes(const unsigned char* lp) {
+    return (uint32_t) lp[0] | ((uint32_t) lp[1] << 8) | ((uint32_t) lp[2] << 16) | ((uint32_t) lp[3] << 24);
+}
+
+static void lpSetTotalBytes(unsigned char* lp, uint32_t v) {
+    lp[0] = v & 0xff;
+    lp[1] = (v >> 8) & 0xff;
+    lp[2] = (v >> 16) & 0xff;
+    lp[3] = (v >> 24) & 0xff;
+}
+
+static uint32_t lpGetNumElements(const unsigned char* lp) {
+    return (uint32_t) lp[4] | ((uint32_t) lp[5] << 8);
+}
+
+static void lpSetNumElements(unsigned char* lp, uint32_t v) {
+    lp[4] = v & 0xff;
+    lp[5] = (v >> 8) & 0xff;
+}
+
+/*
+ * 创建一个空的listpack
+ */
+unsigned char* lpNew(void) {
+    unsigned char* lp = zmalloc(LP_HDR_SIZE + 1);
+
+    lpSetTotalBytes(lp, LP_HDR_SIZE + 1);
+    lpSetNumElements(lp, 0);
+    lp[LP_HDR_SIZE] = LP_EOF;
+    return lp;
+}
+
+/*
+ * 将整数v编码到intenc中，*enclen保存encoding+data的长度
+ */
+static void lpEncodeInteger(long long v, unsigned char* intenc, uint64_t* enclen) {
+    if (v >= 0 && v <= 127) {
+        intenc[0] = v;
+        *enclen = 1;
+    } else if (v >= -4096 && v <= 4095) {
+        uint64_t uv = (uint64_t) v & 0x1fff;
+        intenc[0] = (uv >> 8) | LP_ENCODING_13BIT_INT;
+        intenc[1] = uv & 0xff;
+        *enclen = 2;
+    } else if (v >= -32768 && v <= 32767) {
+        uint64_t uv = (uint64_t) v;
+        intenc[0] = LP_ENCODING_16BIT_INT;
+        intenc[1] = uv & 0xff;
+        intenc[2] = uv >> 8;
+        *enclen = 3;
+    } else if (v >= -8388608 && v <= 8388607) {
+        uint64_t uv = (uint64_t) v;
+        intenc[0] = LP_ENCODING_24BIT_INT;
+        intenc[1] = uv & 0xff;
+        intenc[2] = (uv >> 8) & 0xff;
+        intenc[3] = (uv >> 16) & 0xff;
+        *enclen = 4;
+    } else if (v >= INT32_MIN && v <= INT32_MAX) {
+        uint64_t uv = (uint64_t) v;
+        intenc[0] = LP_ENCODING_32BIT_INT;
+        intenc[1] = uv & 0xff;
+        intenc[2] = (uv >> 8) & 0xff;
+        intenc[3] = (uv >> 16) & 0xff;
+        intenc[4] = (uv >> 24) & 0xff;
+        *enclen = 5;
+    } else {
+        uint64_t uv = (uint64_t) v;
+        int j;
+        intenc[0] = LP_ENCODING_64BIT_INT;
+        for (j = 0; j < 8; j++) intenc[j + 1] = (uv >> (8 * j)) & 0xff;
+        *enclen = 9;
+    }
+}
+
+/*
+ * 决定元素ele的编码方式，
+ * 可以表示为整数的字符串编码到intenc中，返回LP_ENCODING_INT，否则返回LP_ENCODING_STRING，
+ * *enclen保存encoding+data的长度
+ */
+static int lpEncodeGetType(unsigned char* ele, uint32_t size, unsigned char* intenc, uint64_t* enclen) {
+    long long v;
+
+    if (size <= 20 && string2ll((char*) ele, size, &v)) {
+        lpEncodeInteger(v, intenc, enclen);
+        return LP_ENCODING_INT;
+    }
+
+    if (size < 64) *enclen = 1 + size;
+    else if (size < 4096) *enclen = 2 + size;
+    else *enclen = 5 + (uint64_t) size;
+    return LP_ENCODING_STRING;
+}
+
+/*
+ * 将长度l编码为backlen保存到buf中，返回backlen的字节数，buf为NULL时只计算字节数
+ */
+static unsigned long lpEncodeBacklen(unsigned char* buf, uint64_t l) {
+    if (l <= 127) {
+        if (buf) buf[0] = l;
+        return 1;
+    } else if (l < 16383) {
+        if (buf) {
+            buf[0] = l >> 7;
+            buf[1] = (l & 127) | 128;
+        }
+        return 2;
+    } else if (l < 2097151) {
+        if (buf) {
+            buf[0] = l >> 14;
+            buf[1] = ((l >> 7) & 127) | 128;
+            buf[2] = (l & 127) | 128;
+        }
+        return 3;
+    } else if (l < 268435455) {
+        if (buf) {
+            buf[0] = l >> 21;
+            buf[1] = ((l >> 14) & 127) | 128;
+            buf[2] = ((l >> 7) & 127) | 128;
+            buf[3] = (l & 127) | 128;
+        }
+        return 4;
+    } else {
+        if (buf) {
+            buf[0] = l >> 28;
+            buf[1] = ((l >> 21) & 127) | 128;
+            buf[2] = ((l >> 14) & 127) | 128;
+            buf[3] = ((l >> 7) & 127) | 128;
+            buf[4] = (l & 127) | 128;
+        }
+        return 5;
+    }
+}
+
+/*
+ * 从p指向的backlen最后一个字节开始向左解码，返回元素encoding+data的长度
+ */
+static uint64_t lpDecodeBacklen(unsigned char* p) {
+    uint64_t val = 0;
+    uint64_t shift = 0;
+
+    do {
+        val |= (uint64_t) (p[0] & 127) << shift;
+        if (!(p[0] & 128)) break;
+        shift += 7;
+        p--;
+    } while (shift < 35);
+    return val;
+}
+
+/*
+ * 将字符串的编码和内容写入buf
+ */
+static void lpEncodeString(unsigned char* buf, unsigned char* s, uint32_t len) {
+    if (len < 64) {
+        buf[0] = len | LP_ENCODING_6BIT_STR;
+        memcpy(buf + 1, s, len);
+    } else if (len < 4096) {
+        buf[0] = (len >> 8) | LP_ENCODING_12BIT_STR;
+        buf[1] = len & 0xff;
+        memcpy(buf + 2, s, len);
+    } else {
+        buf[0] = LP_ENCODING_32BIT_STR;
+        buf[1] = len & 0xff;
+        buf[2] = (len >> 8) & 0xff;
+        buf[3] = (len >> 16) & 0xff;
+        buf[4] = (len >> 24) & 0xff;
+        memcpy(buf + 5, s, len);
+    }
+}
+
+/*
+ * 返回p指向的元素encoding+data的长度
+ */
+static uint32_t lpCurrentEncodedSize(unsigned char* p) {
+    if (LP_ENCODING_IS_7BIT_UINT(p[0])) return 1;
+    if (LP_ENCODING_IS_6BIT_STR(p[0])) return 1 + (p[0] & 0x3f);
+    if (LP_ENCODING_IS_13BIT_INT(p[0])) return 2;
+    if (LP_ENCODING_IS_12BIT_STR(p[0])) return 2 + (((p[0] & 0xf) << 8) | p[1]);
+    if (p[0] == LP_ENCODING_16BIT_INT) return 3;
+    if (p[0] == LP_ENCODING_24BIT_INT) return 4;
+    if (p[0] == LP_ENCODING_32BIT_INT) return 5;
+    if (p[0] == LP_ENCODING_64BIT_INT) return 9;
+    if (p[0] == LP_ENCODING_32BIT_STR)
+        return 5 + ((uint32_t) p[1] | ((uint32_t) p[2] << 8) | ((uint32_t) p[3] << 16) | ((uint32_t) p[4] << 24));
+    if (p[0] == LP_EOF) return 1;
+    assert(0);
+    return 0;
+}
+
+/*
+ * 跳过p指向的元素，返回下一个元素(或end)的地址
+ */
+static unsigned char* lpSkip(unsigned char* p) {
+    unsigned long entrylen = lpCurrentEncodedSize(p);
+    entrylen += lpEncodeBacklen(NULL, entrylen);
+    return p + entrylen;
+}
+
+/*
+ * 返回p之后的元素，p是最后一个元素或end时返回NULL
+ */
+unsigned char* lpNext(unsigned char* lp, unsigned char* p) {
+    (void) lp;
+    if (p[0] == LP_EOF) return NULL;
+    p = lpSkip(p);
+    if (p[0] == LP_EOF) return NULL;
+    return p;
+}
+
+/*
+ * 返回p之前的元素，p是第一个元素时返回NULL，p可以指向end
+ */
+unsigned char* lpPrev(unsigned char* lp, unsigned char* p) {
+    uint64_t prevlen;
+
+    if (p - lp == LP_HDR_SIZE) return NULL;
+
+    // 前一个元素backlen的最后一个字节
+    p--;
+    prevlen = lpDecodeBacklen(p);
+    prevlen += lpEncodeBacklen(NULL, prevlen);
+    return p - prevlen + 1;
+}
+
+/*
+ * 返回索引index处的元素，index为负数时从表尾开始计数，越界时返回NULL
+ */
+unsigned char* lpIndex(unsigned char* lp, int index) {
+    unsigned char* p;
+
+    if (index >= 0) {
+        p = lp + LP_HDR_SIZE;
+        if (p[0] == LP_EOF) return NULL;
+        while (index-- > 0) {
+            p = lpNext(lp, p);
+            if (p == NULL) return NULL;
+        }
+    } else {
+        p = lp + lpGetTotalBytes(lp) - 1;
+        while (index++ < 0) {
+            p = lpPrev(lp, p);
+            if (p == NULL) return NULL;
+        }
+    }
+    return p;
+}
+
+/*
+ * 读取p指向的元素，字符串保存在*sval和*slen中，整数保存在*lval中并将*sval设为NULL，
+ * p为NULL或指向end时返回0
+ */
+unsigned int lpGet(unsigned char* p, unsigned char** sval, unsigned int* slen, long long* lval) {
+    uint64_t uval;
+    int bits = 0;
+
+    if (p == NULL || p[0] == LP_EOF) return 0;
+
+    if (sval) *sval = NULL;
+
+    if (LP_ENCODING_IS_7BIT_UINT(p[0])) {
+        *lval = p[0] & 0x7f;
+        return 1;
+    } else if (LP_ENCODING_IS_6BIT_STR(p[0])) {
+        *slen = p[0] & 0x3f;
+        *sval = p + 1;
+        return 1;
+    } else if (LP_ENCODING_IS_13BIT_INT(p[0])) {
+        uval = ((uint64_t) (p[0] & 0x1f) << 8) | p[1];
+        bits = 13;
+    } else if (LP_ENCODING_IS_12BIT_STR(p[0])) {
+        *slen = ((p[0] & 0xf) << 8) | p[1];
+        *sval = p + 2;
+        return 1;
+    } else if (p[0] == LP_ENCODING_16BIT_INT) {
+        uval = (uint64_t) p[1] | ((uint64_t) p[2] << 8);
+        bits = 16;
+    } else if (p[0] == LP_ENCODING_24BIT_INT) {
+        uval = (uint64_t) p[1] | ((uint64_t) p[2] << 8) | ((uint64_t) p[3] << 16);
+        bits = 24;
+    } else if (p[0] == LP_ENCODING_32BIT_INT) {
+        uval = (uint64_t) p[1] | ((uint64_t) p[2] << 8) | ((uint64_t) p[3] << 16) | ((uint64_t) p[4] << 24);
+        bits = 32;
+    } else if (p[0] == LP_ENCODING_64BIT_INT) {
+        int j;
+        uval = 0;
+        for (j = 0; j < 8; j++) uval |= (uint64_t) p[j + 1] << (8 * j);
+        bits = 64;
+    } else if (p[0] == LP_ENCODING_32BIT_STR) {
+        *slen = (uint32_t) p[1] | ((uint32_t) p[2] << 8) | ((uint32_t) p[3] << 16) | ((uint32_t) p[4] << 24);
+        *sval = p + 5;
+        return 1;
+    } else {
+        return 0;
+    }
+
+    // 符号扩展
+    if (bits < 64 && (uval & ((uint64_t) 1 << (bits - 1))))
+        *lval = (long long) (uval | (~(uint64_t) 0 << bits));
+    else
+        *lval = (long long) uval;
+    return 1;
+}
+
+/*
+ * 在p之前插入元素ele(where为LP_BEFORE)，或者将p指向的元素替换为ele(where为LP_REPLACE)，
+ * ele为NULL时删除p指向的元素
+ *
+ * *newp保存被插入元素的地址，删除时保存被删除元素之后的元素(可能是end)的地址
+ */
+static unsigned char* __lpInsert(unsigned char* lp, unsigned char* ele, uint32_t size,
+                                 unsigned char* p, int where, unsigned char** newp) {
+    unsigned char intenc[LP_MAX_INT_ENCODING_LEN];
+    unsigned char backlen[LP_MAX_BACKLEN_SIZE];
+    uint64_t enclen = 0;
+    unsigned long backlen_size = 0;
+    unsigned long poff = p - lp;
+    uint32_t replaced_len = 0;
+    uint64_t old_bytes, new_bytes;
+    int enctype = LP_ENCODING_STRING;
+    int delete = (ele == NULL);
+    unsigned char* dst;
+
+    if (delete) where = LP_REPLACE;
+
+    if (!delete) {
+        enctype = lpEncodeGetType(ele, size, intenc, &enclen);
+        backlen_size = lpEncodeBacklen(backlen, enclen);
+    }
+
+    if (where == LP_REPLACE) {
+        replaced_len = lpCurrentEncodedSize(p);
+        replaced_len += lpEncodeBacklen(NULL, replaced_len);
+    }
+
+    old_bytes = lpGetTotalBytes(lp);
+    new_bytes = old_bytes + enclen + backlen_size - replaced_len;
+    if (new_bytes > UINT32_MAX) return NULL;
+
+    // 先扩大内存再移动，或者先移动再缩小内存
+    if (new_bytes > old_bytes) lp = zrealloc(lp, new_bytes);
+    dst = lp + poff;
+
+    memmove(dst + enclen + backlen_size, dst + replaced_len, old_bytes - poff - replaced_len);
+
+    if (new_bytes < old_bytes) lp = zrealloc(lp, new_bytes);
+    dst = lp + poff;
+
+    if (newp) *newp = dst;
+
+    if (!delete) {
+        if (enctype == LP_ENCODING_INT) {
+            memcpy(dst, intenc, enclen);
+        } else {
+            lpEncodeString(dst, ele, size);
+        }
+        memcpy(dst + enclen, backlen, backlen_size);
+    }
+
+    lpSetTotalBytes(lp, new_bytes);
+    if (where == LP_BEFORE || delete) {
+        uint32_t num = lpGetNumElements(lp);
+        if (num != LP_HDR_NUMELE_UNKNOWN) {
+            num = delete ? num - 1 : num + 1;
+            // 超出2字节能表示的范围后，元素数量需要遍历计数
+            lpSetNumElements(lp, num >= LP_HDR_NUMELE_UNKNOWN ? LP_HDR_NUMELE_UNKNOWN : num);
+        }
+    }
+    return lp;
+}
+
+/*
+ * 将元素添加到表头或表尾
+ */
+unsigned char* lpPush(unsigned char* lp, unsigned char* s, unsigned int slen, int where) {
+    unsigned char* p;
+
+    if (where == LP_HEAD) {
+        p = lp + LP_HDR_SIZE;
+    } else {
+        p = lp + lpGetTotalBytes(lp) - 1;
+    }
+    return __lpInsert(lp, s, slen, p, LP_BEFORE, NULL);
+}
+
+/*
+ * 在p之前插入元素，p指向end时添加到表尾
+ */
+unsigned char* lpInsert(unsigned char* lp, unsigned char* p, unsigned char* s, unsigned int slen) {
+    return __lpInsert(lp, s, slen, p, LP_BEFORE, NULL);
+}
+
+/*
+ * 将*p指向的元素原地替换为s，*p更新为替换后的元素
+ */
+unsigned char* lpReplace(unsigned char* lp, unsigned char** p, unsigned char* s, unsigned int slen) {
+    return __lpInsert(lp, s, slen, *p, LP_REPLACE, p);
+}
+
+/*
+ * 将p指向的元素原地替换为整数lval，只有新的编码长度与原元素相同时才能原地替换，
+ * 此时不需要移动后面的元素，也不需要重新分配内存，成功返回1，否则返回0
+ */
+int lpReplaceIntegerInPlace(unsigned char* p, long long lval) {
+    unsigned char intenc[LP_MAX_INT_ENCODING_LEN];
+    uint64_t enclen;
+
+    lpEncodeInteger(lval, intenc, &enclen);
+    if (enclen != lpCurrentEncodedSize(p)) return 0;
+
+    // 编码长度相同，backlen也相同
+    memcpy(p, intenc, enclen);
+    return 1;
+}
+
+/*
+ * 删除*p指向的元素，*p更新为被删除元素之后的元素(可能是end)
+ */
+unsigned char* lpDelete(unsigned char* lp, unsigned char** p) {
+    return __lpInsert(lp, NULL, 0, *p, LP_REPLACE, p);
+}
+
+/*
+ * 从索引index开始删除num个元素
+ */
+unsigned char* lpDeleteRange(unsigned char* lp, int index, unsigned int num) {
+    unsigned char* first;
+    unsigned char* last;
+    uint32_t total, deleted = 0;
+    uint32_t numele;
+
+    if (num == 0) return lp;
+
+    first = lpIndex(lp, index);
+    if (first == NULL) return lp;
+
+    last = first;
+    while (deleted < num && last[0] != LP_EOF) {
+        last = lpSkip(last);
+        deleted++;
+    }
+
+    total = lpGetTotalBytes(lp);
+    memmove(first, last, total - (last - lp));
+    total -= last - first;
+    lp = zrealloc(lp, total);
+    lpSetTotalBytes(lp, total);
+
+    numele = lpGetNumElements(lp);
+    if (numele != LP_HDR_NUMELE_UNKNOWN) lpSetNumElements(lp, numele - deleted);
+    return lp;
+}
+
+/*
+ * 比较p指向的元素与长度为slen的字符串s，相等返回1
+ */
+unsigned int lpCompare(unsigned char* p, unsigned char* s, unsigned int slen) {
+    unsigned char* vstr;
+    unsigned int vlen;
+    long long vll, sll;
+
+    if (!lpGet(p, &vstr, &vlen, &vll)) return 0;
+
+    if (vstr) {
+        return vlen == slen && memcmp(vstr, s, slen) == 0;
+    }
+    // 元素是整数，s必须能够表示为同一个整数
+    if (slen > 20 || !string2ll((char*) s, slen, &sll)) return 0;
+    return vll == sll;
+}
+
+/*
+ * 从p开始查找与vstr相等的元素，每次比较之后跳过skip个元素，找不到时返回NULL
+ */
+unsigned char* lpFind(unsigned char* p, unsigned char* vstr, unsigned int vlen, unsigned int skip) {
+    unsigned int skipcnt = 0;
+    long long vll = 0;
+    int vencoded = -1;
+
+    while (p[0] != LP_EOF) {
+        if (skipcnt == 0) {
+            if (LP_ENCODING_IS_6BIT_STR(p[0]) || LP_ENCODING_IS_12BIT_STR(p[0]) || p[0] == LP_ENCODING_32BIT_STR) {
+                unsigned char* sval;
+                unsigned int slen;
+                long long lval;
+
+                lpGet(p, &sval, &slen, &lval);
+                if (slen == vlen && memcmp(sval, vstr, vlen) == 0) return p;
+            } else {
+                long long lval;
+                unsigned char* sval;
+                unsigned int slen;
+
+                // 只在第一次遇到整数元素时尝试将vstr转为整数
+                if (vencoded == -1) vencoded = (vlen <= 20 && string2ll((char*) vstr, vlen, &vll));
+                if (vencoded) {
+                    lpGet(p, &sval, &slen, &lval);
+                    if (lval == vll) return p;
+                }
+            }
+            skipcnt = skip;
+        } else {
+            skipcnt--;
+        }
+        p = lpSkip(p);
+    }
+    return NULL;
+}
+
+/*
+ * 返回元素数量
+ */
+unsigned int lpLength(unsigned char* lp) {
+    uint32_t numele = lpGetNumElements(lp);
+    unsigned char* p;
+    uint32_t count = 0;
+
+    if (numele != LP_HDR_NUMELE_UNKNOWN) return numele;
+
+    p = lp + LP_HDR_SIZE;
+    while (p[0] != LP_EOF) {
+        count++;
+        p = lpSkip(p);
+    }
+    if (count < LP_HDR_NUMELE_UNKNOWN) lpSetNumElements(lp, count);
+    return count;
+}
+
+/*
+ * 返回listpack占用的字节数
+ */
+size_t lpBytes(unsigned char* lp) {
+    return lpGetTotalBytes(lp);
+}
@@ -0,0 +1,36 @@
+//
+// Created by zouyi on 2021/11/8.
+//
+
+#ifndef TINYREDIS_LISTPACK_H
+#define TINYREDIS_LISTPACK_H
+
+#include <stddef.h>
+
+/*
+ * Listpack 是压缩列表的替代格式，每个元素在尾部保存自身的长度(backlen)，
+ * 不保存前一个元素的长度，因此插入或删除元素不会引起压缩列表那样的连锁更新
+ *
+ * 接口与压缩列表保持一致，元素指针p可以用lpNext/lpPrev移动，用lpGet读取
+ */
+
+#define LP_HEAD 0
+#define LP_TAIL 1
+
+unsigned char* lpNew(void);
+unsigned char* lpPush(unsigned char* lp, unsigned char* s, unsigned int slen, int where);
+unsigned char* lpIndex(unsigned char* lp, int index);
+unsigned char* lpNext(unsigned char* lp, unsigned char* p);
+unsigned char* lpPrev(unsigned char* lp, unsigned char* p);
+unsigned int lpGet(unsigned char* p, unsigned char** sval, unsigned int* slen, long long* lval);
+unsigned char* lpInsert(unsigned char* lp, unsigned char* p, unsigned char* s, unsigned int slen);
+unsigned char* lpReplace(unsigned char* lp, unsigned char** p, unsigned char* s, unsigned int slen);
+int lpReplaceIntegerInPlace(unsigned char* p, long long lval);
+unsigned char* lpDelete(unsigned char* lp, unsigned char** p);
+unsigned char* lpDeleteRange(unsigned char* lp, int index, unsigned int num);
+unsigned int lpCompare(unsigned char* p, unsigned char* s, unsigned int slen);
+unsigned char* lpFind(unsigned char* p, unsigned char* vstr, unsigned int vlen, unsigned int skip);
+unsigned int lpLength(unsigned char* lp);
+size_t lpBytes(unsigned char* lp);
+
+#endif //TINYREDIS_LISTPACK_H
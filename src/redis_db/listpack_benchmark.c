@@ -0,0 +1,175 @@
+//
+// Created by zouyi on 2021/11/8.
+//
+
+/*
+ * 压缩列表与listpack在连锁更新最坏情况下的插入性能对比
+ *
+ * 压缩列表的每个节点保存前一个节点的长度(previous_entry_length)，
+ * 前一个节点长度小于254字节时用1字节保存，否则用5字节保存。
+ * 当表中所有节点长度都在250~253字节之间时，在表头插入一个长度不小于254字节的节点，
+ * 会使后面的每个节点依次扩展previous_entry_length并重新分配内存，也就是连锁更新
+ *
+ * listpack的元素只保存自身的长度，插入和删除只移动一次内存
+ *
+ * 编译: make listpack-benchmark
+ * 运行: ./listpack_benchmark [节点数量] [重复次数]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "zmalloc.h"
+#include "ziplist.h"
+#include "listpack.h"
+
+#define SMALL_ENTRY_LEN 250
+#define LARGE_ENTRY_LEN 254
+
+static long long ustime(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static unsigned char* zlBuild(int entries, unsigned char* small) {
+    unsigned char* zl = ziplistNew();
+    int i;
+
+    for (i = 0; i < entries; i++)
+        zl = ziplistPush(zl, small, SMALL_ENTRY_LEN, ZIPLIST_TAIL);
+    return zl;
+}
+
+static unsigned char* lpBuild(int entries, unsigned char* small) {
+    unsigned char* lp = lpNew();
+    int i;
+
+    for (i = 0; i < entries; i++)
+        lp = lpPush(lp, small, SMALL_ENTRY_LEN, LP_TAIL);
+    return lp;
+}
+
+/*
+ * 场景1: 在全部由250字节节点组成的表头插入一个254字节节点，每轮使用新建的表
+ */
+static void benchHeadInsert(int entries, int rounds, unsigned char* small, unsigned char* large) {
+    long long zl_us = 0, lp_us = 0, start;
+    int i;
+
+    for (i = 0; i < rounds; i++) {
+        unsigned char* zl = zlBuild(entries, small);
+        unsigned char* lp = lpBuild(entries, small);
+
+        start = ustime();
+        zl = ziplistPush(zl, large, LARGE_ENTRY_LEN, ZIPLIST_HEAD);
+        zl_us += ustime() - start;
+
+        start = ustime();
+        lp = lpPush(lp, large, LARGE_ENTRY_LEN, LP_HEAD);
+        lp_us += ustime() - start;
+
+        zfree(zl);
+        zfree(lp);
+    }
+
+    printf("head insert of a %d-byte entry into %d x %d-byte entries (%d rounds)\n",
+           LARGE_ENTRY_LEN, entries, SMALL_ENTRY_LEN, rounds);
+    printf("  ziplist : %.2f us/op\n", (double) zl_us / rounds);
+    printf("  listpack: %.2f us/op\n", (double) lp_us / rounds);
+}
+
+/*
+ * 场景2: 在同一个表上反复插入并删除表头的254字节节点
+ */
+static void benchHeadInsertDelete(int entries, int rounds, unsigned char* small, unsigned char* large) {
+    unsigned char* zl = zlBuild(entries, small);
+    unsigned char* lp = lpBuild(entries, small);
+    unsigned char* p;
+    long long start, zl_us, lp_us;
+    int i;
+
+    start = ustime();
+    for (i = 0; i < rounds; i++) {
+        zl = ziplistPush(zl, large, LARGE_ENTRY_LEN, ZIPLIST_HEAD);
+        p = ziplistIndex(zl, 0);
+        zl = ziplistDelete(zl, &p);
+    }
+    zl_us = ustime() - start;
+
+    start = ustime();
+    for (i = 0; i < rounds; i++) {
+        lp = lpPush(lp, large, LARGE_ENTRY_LEN, LP_HEAD);
+        p = lpIndex(lp, 0);
+        lp = lpDelete(lp, &p);
+    }
+    lp_us = ustime() - start;
+
+    printf("insert+delete of a %d-byte head entry over %d x %d-byte entries (%d rounds)\n",
+           LARGE_ENTRY_LEN, entries, SMALL_ENTRY_LEN, rounds);
+    printf("  ziplist : %.2f us/op, %zu bytes\n", (double) zl_us / rounds, ziplistBlobLen(zl));
+    printf("  listpack: %.2f us/op, %zu bytes\n", (double) lp_us / rounds, lpBytes(lp));
+
+    zfree(zl);
+    zfree(lp);
+}
+
+/*
+ * 场景3: 在表中间交替插入大小节点，每次插入都可能改变后继节点的previous_entry_length
+ */
+static void benchMiddleInsert(int entries, unsigned char* small, unsigned char* large) {
+    unsigned char* zl = ziplistNew();
+    unsigned char* lp = lpNew();
+    unsigned char* p;
+    long long start, zl_us, lp_us;
+    int i;
+
+    start = ustime();
+    for (i = 0; i < entries; i++) {
+        p = ziplistIndex(zl, i / 2);
+        if (p == NULL)
+            zl = ziplistPush(zl, (i & 1) ? large : small, (i & 1) ? LARGE_ENTRY_LEN : SMALL_ENTRY_LEN, ZIPLIST_TAIL);
+        else
+            zl = ziplistInsert(zl, p, (i & 1) ? large : small, (i & 1) ? LARGE_ENTRY_LEN : SMALL_ENTRY_LEN);
+    }
+    zl_us = ustime() - start;
+
+    start = ustime();
+    for (i = 0; i < entries; i++) {
+        p = lpIndex(lp, i / 2);
+        if (p == NULL)
+            lp = lpPush(lp, (i & 1) ? large : small, (i & 1) ? LARGE_ENTRY_LEN : SMALL_ENTRY_LEN, LP_TAIL);
+        else
+            lp = lpInsert(lp, p, (i & 1) ? large : small, (i & 1) ? LARGE_ENTRY_LEN : SMALL_ENTRY_LEN);
+    }
+    lp_us = ustime() - start;
+
+    printf("middle inserts alternating %d/%d-byte entries (%d inserts)\n",
+           SMALL_ENTRY_LEN, LARGE_ENTRY_LEN, entries);
+    printf("  ziplist : %.2f us/op\n", (double) zl_us / entries);
+    printf("  listpack: %.2f us/op\n", (double) lp_us / entries);
+
+    zfree(zl);
+    zfree(lp);
+}
+
+int main(int argc, char** argv) {
+    int entries = argc > 1 ? atoi(argv[1]) : 512;
+    int rounds = argc > 2 ? atoi(argv[2]) : 1000;
+    unsigned char small[SMALL_ENTRY_LEN];
+    unsigned char large[LARGE_ENTRY_LEN];
+
+    if (entries <= 0 || rounds <= 0) {
+        fprintf(stderr, "usage: %s [entries] [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    memset(small, 'a', sizeof(small));
+    memset(large, 'b', sizeof(large));
+
+    benchHeadInsert(entries, rounds, small, large);
+    benchHeadInsertDelete(entries, rounds, small, large);
+    benchMiddleInsert(entries, small, large);
+    return 0;
+}
@@ -0,0 +1,155 @@
+//
+// Created by zouyi on 2021/11/7.
+//
+
+#include <string.h>
+#include "lzf.h"
+
+typedef unsigned char u8;
+
+/*
+ * 哈希表大小为2^HLOG，保存每个3字节序列最近一次出现的位置
+ */
+#define HLOG 13
+#define HSIZE (1 << HLOG)
+
+#define MAX_LIT (1 << 5)
+#define MAX_OFF (1 << 13)
+#define MAX_REF ((1 << 8) + (1 << 3))
+
+#define LZF_HASH(p) ((((unsigned int) (p)[0] << 16) | ((p)[1] << 8) | (p)[2]) * 2654435761u >> (32 - HLOG))
+
+unsigned int lzf_compress(const void* in_data, unsigned int in_len, void* out_data, unsigned int out_len) {
+    unsigned int htab[HSIZE];
+    const u8* in = (const u8*) in_data;
+    const u8* ip = in;
+    const u8* in_end = ip + in_len;
+    u8* out = (u8*) out_data;
+    u8* op = out;
+    u8* out_end = op + out_len;
+    int lit = 0;
+
+    if (in_len == 0 || out_len < 2) return 0;
+
+    memset(htab, 0, sizeof(htab));
+
+    // 为第一段字面字节预留控制字节
+    op++;
+
+    while (ip + 2 < in_end) {
+        unsigned int h = LZF_HASH(ip);
+        const u8* ref = in + htab[h];
+        unsigned int off = ip - ref - 1;
+
+        htab[h] = ip - in;
+
+        if (ref < ip && off < MAX_OFF && ref[0] == ip[0] && ref[1] == ip[1] && ref[2] == ip[2]) {
+            unsigned int len = 2;
+            unsigned int maxlen = in_end - ip - len;
+
+            maxlen = maxlen > MAX_REF ? MAX_REF : maxlen;
+
+            // 回溯引用最多3个字节，再加上下一段的控制字节
+            if (op + 3 + 1 >= out_end) return 0;
+
+            // 结束当前的字面字节段，长度为0时收回预留的控制字节
+            op[-lit - 1] = lit - 1;
+            op -= !lit;
+
+            do {
+                len++;
+            } while (len < maxlen && ref[len] == ip[len]);
+
+            len -= 2;
+            ip++;
+
+            if (len < 7) {
+                *op++ = (off >> 8) + (len << 5);
+            } else {
+                *op++ = (off >> 8) + (7 << 5);
+                *op++ = len - 7;
+            }
+            *op++ = off;
+
+            lit = 0;
+            op++;
+
+            ip += len + 1;
+            if (ip + 2 >= in_end) break;
+
+            // 记录被引用跳过的最后一个位置，提高后续的匹配率
+            htab[LZF_HASH(ip - 1)] = ip - 1 - in;
+        } else {
+            if (op >= out_end) return 0;
+
+            lit++;
+            *op++ = *ip++;
+
+            if (lit == MAX_LIT) {
+                op[-lit - 1] = lit - 1;
+                lit = 0;
+                op++;
+            }
+        }
+    }
+
+    // 剩余不足3个字节，全部作为字面字节输出
+    if (op + 3 > out_end) return 0;
+
+    while (ip < in_end) {
+        lit++;
+        *op++ = *ip++;
+
+        if (lit == MAX_LIT) {
+            op[-lit - 1] = lit - 1;
+            lit = 0;
+            op++;
+        }
+    }
+
+    op[-lit - 1] = lit - 1;
+    op -= !lit;
+
+    return op - out;
+}
+
+unsigned int lzf_decompress(const void* in_data, unsigned int in_len, void* out_data, unsigned int out_len) {
+    const u8* ip = (const u8*) in_data;
+    const u8* in_end = ip + in_len;
+    u8* out = (u8*) out_data;
+    u8* op = out;
+    u8* out_end = op + out_len;
+
+    while (ip < in_end) {
+        unsigned int ctrl = *ip++;
+
+        if (ctrl < (1 << 5)) {
+            // 字面字节
+            ctrl++;
+            if (op + ctrl > out_end || ip + ctrl > in_end) return 0;
+            memcpy(op, ip, ctrl);
+            op += ctrl;
+            ip += ctrl;
+        } else {
+            // 回溯引用，源和目标可能重叠，必须逐字节复制
+            unsigned int len = ctrl >> 5;
+            const u8* ref = op - ((ctrl & 0x1f) << 8) - 1;
+
+            if (ip >= in_end) return 0;
+            if (len == 7) {
+                len += *ip++;
+                if (ip >= in_end) return 0;
+            }
+            ref -= *ip++;
+
+            len += 2;
+            if (op + len > out_end || ref < out) return 0;
+
+            do {
+                *op++ = *ref++;
+            } while (--len);
+        }
+    }
+
+    return op - out;
+}
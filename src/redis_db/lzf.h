@@ -0,0 +1,29 @@
+//
+// Created by zouyi on 2021/11/7.
+//
+
+#ifndef TINYREDIS_LZF_H
+#define TINYREDIS_LZF_H
+
+/*
+ * LZF压缩算法，与liblzf的压缩格式兼容
+ *
+ * 压缩后的数据由若干段组成，每段以一个控制字节开头:
+ * 000LLLLL                     : 后面跟着L+1个字面字节
+ * LLLooooo oooooooo            : 回溯引用，复制L+2个字节，偏移为o+1 (L < 7)
+ * 111ooooo LLLLLLLL oooooooo   : 回溯引用，复制L+9个字节，偏移为o+1
+ */
+
+/*
+ * 压缩in_data中的in_len个字节到out_data，
+ * 返回压缩后的长度，输出超过out_len个字节(不可压缩)时返回0
+ */
+unsigned int lzf_compress(const void* in_data, unsigned int in_len, void* out_data, unsigned int out_len);
+
+/*
+ * 解压in_data中的in_len个字节到out_data，
+ * 返回解压后的长度，数据损坏或输出超过out_len个字节时返回0
+ */
+unsigned int lzf_decompress(const void* in_data, unsigned int in_len, void* out_data, unsigned int out_len);
+
+#endif //TINYREDIS_LZF_H
@@ -0,0 +1,964 @@
+//
+// Created by zouyi on 2021/11/13.
+//
+
+#define REDISMODULE_CORE 1
+
+#include "redis.h"
+#include "redismodule.h"
+#include <dlfcn.h>
+
+/*
+ * 模块系统
+ *
+ * MODULE LOAD通过dlopen加载动态库并调用其中的RedisModule_OnLoad，模块注册的命令直接加入server.commands，
+ * 和内置命令一样经过processCommand的参数个数检查、事务排队和call()的传播，
+ * 实现函数是moduleCommandDispatcher，它为每次调用创建上下文，再转到模块的函数
+ */
+
+/*
+ * 已加载的模块
+ */
+typedef struct RedisModule {
+
+    // dlopen返回的句柄
+    void* handle;
+
+    // 模块名字，RedisModule_Init中指定
+    sds name;
+
+    // 模块版本
+    int ver;
+
+    // 模块使用的API版本
+    int apiver;
+
+    // 模块注册的命令，值为RedisModuleCommandProxy
+    list* commands;
+
+} RedisModule;
+
+/*
+ * 模块注册的命令，由redisCommand.module_cmd指向
+ */
+struct RedisModuleCommandProxy {
+
+    RedisModule* module;
+
+    // 模块中的实现函数
+    RedisModuleCmdFunc func;
+
+    // 加入命令表的命令
+    struct redisCommand* rediscmd;
+};
+
+typedef struct RedisModuleCommandProxy RedisModuleCommandProxy;
+
+/*
+ * 命令返回后自动释放的对象
+ */
+#define REDISMODULE_AM_STRING 0
+#define REDISMODULE_AM_KEY 1
+
+typedef struct autoMemEntry {
+
+    void* ptr;
+
+    int type;
+
+} autoMemEntry;
+
+/*
+ * 模块命令的执行上下文
+ */
+struct RedisModuleCtx {
+
+    // RedisModule_GetApi的地址，必须是第一个字段，RedisModule_Init从这里取得
+    void* getapifuncptr;
+
+    RedisModule* module;
+
+    // 执行命令的客户端，在RedisModule_OnLoad中为NULL
+    redisClient* client;
+
+    // 自动释放队列
+    autoMemEntry* amqueue;
+    int amqueue_len;
+    int amqueue_used;
+
+    // 长度待定的数组回复
+    void** postponed_arrays;
+    int postponed_arrays_count;
+};
+
+static int RM_GetApi(const char* funcname, void** targetPtrPtr);
+
+#define REDISMODULE_CTX_INIT {(void*) (unsigned long) &RM_GetApi, NULL, NULL, NULL, 0, 0, NULL, 0}
+
+/*
+ * 模块打开的键
+ */
+struct RedisModuleKey {
+
+    RedisModuleCtx* ctx;
+
+    redisDb* db;
+
+    robj* key;
+
+    // 键的值，键不存在时为NULL
+    robj* value;
+
+    // REDISMODULE_READ|REDISMODULE_WRITE
+    int mode;
+};
+
+// 模块名字 -> RedisModule
+static dict* modules;
+
+// API函数名 -> 函数指针
+static dict* moduleapi;
+
+/* --------------------------------------------------------------------------
+ * 内存管理与自动释放
+ * -------------------------------------------------------------------------- */
+
+/* Use like malloc(). Memory allocated with this function is reported in
+ * Redis INFO memory, used for keys eviction according to maxmemory settings
+ * and in general is taken into account as memory allocated by Redis. */
+static void* RM_Alloc(size_t bytes) {
+    return zmalloc(bytes);
+}
+
+static void* RM_Realloc(void* ptr, size_t bytes) {
+    return zrealloc(ptr, bytes);
+}
+
+static void RM_Free(void* ptr) {
+    zfree(ptr);
+}
+
+/*
+ * 将对象加入上下文的自动释放队列
+ */
+static void autoMemoryAdd(RedisModuleCtx* ctx, int type, void* ptr) {
+    if (ctx->amqueue_used == ctx->amqueue_len) {
+        ctx->amqueue_len = ctx->amqueue_len ? ctx->amqueue_len * 2 : 16;
+        ctx->amqueue = zrealloc(ctx->amqueue, sizeof(autoMemEntry) * ctx->amqueue_len);
+    }
+    ctx->amqueue[ctx->amqueue_used].type = type;
+    ctx->amqueue[ctx->amqueue_used].ptr = ptr;
+    ctx->amqueue_used++;
+}
+
+/*
+ * 对象已经被模块主动释放，从自动释放队列中移除，通常是最近加入的对象，所以从后向前查找
+ */
+static void autoMemoryForget(RedisModuleCtx* ctx, int type, void* ptr) {
+    int j;
+
+    for (j = ctx->amqueue_used - 1; j >= 0; j--) {
+        if (ctx->amqueue[j].type == type && ctx->amqueue[j].ptr == ptr) {
+            ctx->amqueue[j].ptr = NULL;
+            if (j == ctx->amqueue_used - 1) ctx->amqueue_used--;
+            return;
+        }
+    }
+}
+
+static void moduleFreeKey(RedisModuleKey* kp) {
+    decrRefCount(kp->key);
+    zfree(kp);
+}
+
+/*
+ * 命令返回后释放上下文中所有未释放的字符串和键
+ */
+static void moduleFreeContext(RedisModuleCtx* ctx) {
+    int j;
+
+    for (j = 0; j < ctx->amqueue_used; j++) {
+        void* ptr = ctx->amqueue[j].ptr;
+
+        if (ptr == NULL) continue;
+        if (ctx->amqueue[j].type == REDISMODULE_AM_STRING)
+            decrRefCount(ptr);
+        else
+            moduleFreeKey(ptr);
+    }
+    zfree(ctx->amqueue);
+
+    if (ctx->postponed_arrays) {
+        zfree(ctx->postponed_arrays);
+        printf("API misuse detected in module %s: RedisModule_ReplyWithArray(REDISMODULE_POSTPONED_ARRAY_LEN) "
+               "not matched by the same number of RedisModule_ReplySetArrayLength() calls.\n",
+               ctx->module ? ctx->module->name : "(unknown)");
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * 模块与命令注册
+ * -------------------------------------------------------------------------- */
+
+/*
+ * 模块命令的实现函数，所有模块命令的redisCommand.proc都指向这里
+ */
+static void moduleCommandDispatcher(redisClient* c) {
+    RedisModuleCommandProxy* cp = c->cmd->module_cmd;
+    RedisModuleCtx ctx = REDISMODULE_CTX_INIT;
+
+    ctx.module = cp->module;
+    ctx.client = c;
+    cp->func(&ctx, (RedisModuleString**) c->argv, c->argc);
+    moduleFreeContext(&ctx);
+}
+
+/*
+ * 注册命令，strflags与内置命令表的sflags相同，例如"wm"，
+ * arity，firstkey，lastkey，keystep的含义也与内置命令相同；
+ * 只能在RedisModule_OnLoad中调用，命令名字已经存在时返回REDISMODULE_ERR
+ */
+static int RM_CreateCommand(RedisModuleCtx* ctx, const char* name, RedisModuleCmdFunc cmdfunc, int arity,
+                            const char* strflags, int firstkey, int lastkey, int keystep) {
+    int flags;
+    sds cmdname;
+    struct redisCommand* rediscmd;
+    RedisModuleCommandProxy* cp;
+
+    if (ctx->module == NULL || ctx->client != NULL) return REDISMODULE_ERR;
+    if (arity == 0 || firstkey < 0 || keystep < 0) return REDISMODULE_ERR;
+    if (parseCommandFlags((char*) strflags, &flags) == REDIS_ERR) return REDISMODULE_ERR;
+
+    cmdname = sdsnew(name);
+    if (lookupCommandOrOriginal(cmdname) != NULL) {
+        sdsfree(cmdname);
+        return REDISMODULE_ERR;
+    }
+
+    cp = zmalloc(sizeof(*cp));
+    cp->module = ctx->module;
+    cp->func = cmdfunc;
+
+    rediscmd = zcalloc(sizeof(*rediscmd));
+    rediscmd->name = cmdname;
+    rediscmd->proc = moduleCommandDispatcher;
+    rediscmd->arity = arity;
+    rediscmd->sflags = sdsnew(strflags);
+    rediscmd->flags = flags;
+    rediscmd->firstkey = firstkey;
+    rediscmd->lastkey = lastkey;
+    rediscmd->keystep = keystep;
+    rediscmd->module_cmd = cp;
+    cp->rediscmd = rediscmd;
+
+    dictAdd(server.commands, sdsdup(cmdname), rediscmd);
+    dictAdd(server.orig_commands, sdsdup(cmdname), rediscmd);
+    listAddNodeTail(ctx->module->commands, cp);
+
+    return REDISMODULE_OK;
+}
+
+/*
+ * 由RedisModule_Init调用，创建模块并记录名字和版本
+ */
+static int RM_SetModuleAttribs(RedisModuleCtx* ctx, const char* name, int ver, int apiver) {
+    RedisModule* module;
+
+    if (ctx->module != NULL) return REDISMODULE_ERR;
+
+    module = zmalloc(sizeof(*module));
+    module->handle = NULL;
+    module->name = sdsnew(name);
+    module->ver = ver;
+    module->apiver = apiver;
+    module->commands = listCreate();
+    ctx->module = module;
+
+    return REDISMODULE_OK;
+}
+
+/*
+ * 命令即将从命令表中删除，清除客户端对它的引用，
+ * 事务队列中有这个命令的客户端，之后的EXEC会失败
+ */
+static void moduleForgetCommand(struct redisCommand* cmd) {
+    listIter li;
+    listNode* ln;
+
+    listRewind(server.clients, &li);
+    while ((ln = listNext(&li))) {
+        redisClient* c = listNodeValue(ln);
+        int j;
+
+        if (c->cmd == cmd) c->cmd = NULL;
+        if (c->lastcmd == cmd) c->lastcmd = NULL;
+        if (!(c->flags & REDIS_MULTI)) continue;
+        for (j = 0; j < c->mstate.count; j++) {
+            if (c->mstate.commands[j].cmd == cmd) {
+                c->flags |= REDIS_DIRTY_EXEC;
+                break;
+            }
+        }
+    }
+}
+
+/*
+ * 从命令表中删除模块注册的所有命令
+ */
+static void moduleUnregisterCommands(RedisModule* module) {
+    listIter li;
+    listNode* ln;
+
+    listRewind(module->commands, &li);
+    while ((ln = listNext(&li))) {
+        RedisModuleCommandProxy* cp = listNodeValue(ln);
+        struct redisCommand* cmd = cp->rediscmd;
+
+        moduleForgetCommand(cmd);
+        dictDelete(server.commands, cmd->name);
+        dictDelete(server.orig_commands, cmd->name);
+        sdsfree(cmd->name);
+        sdsfree(cmd->sflags);
+        zfree(cmd);
+        zfree(cp);
+        listDelNode(module->commands, ln);
+    }
+}
+
+static void moduleFreeModule(RedisModule* module) {
+    listRelease(module->commands);
+    sdsfree(module->name);
+    zfree(module);
+}
+
+/*
+ * 加载path指定的模块，module_argv是传给RedisModule_OnLoad的参数
+ */
+int moduleLoad(const char* path, robj** module_argv, int module_argc) {
+    int (*onload)(void*, void**, int);
+    void* handle;
+    RedisModuleCtx ctx = REDISMODULE_CTX_INIT;
+
+    handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (handle == NULL) {
+        printf("Module %s failed to load: %s\n", path, dlerror());
+        return REDIS_ERR;
+    }
+
+    onload = (int (*)(void*, void**, int)) (unsigned long) dlsym(handle, "RedisModule_OnLoad");
+    if (onload == NULL) {
+        dlclose(handle);
+        printf("Module %s does not export RedisModule_OnLoad() symbol. Module not loaded.\n", path);
+        return REDIS_ERR;
+    }
+
+    // 初始化失败，没有调用RedisModule_Init，或者同名的模块已经加载，撤销已经注册的命令
+    if (onload((void*) &ctx, (void**) module_argv, module_argc) == REDISMODULE_ERR ||
+        ctx.module == NULL || dictFind(modules, ctx.module->name) != NULL) {
+        if (ctx.module) {
+            moduleUnregisterCommands(ctx.module);
+            moduleFreeModule(ctx.module);
+        }
+        moduleFreeContext(&ctx);
+        dlclose(handle);
+        printf("Module %s initialization failed. Module not loaded\n", path);
+        return REDIS_ERR;
+    }
+
+    ctx.module->handle = handle;
+    dictAdd(modules, sdsdup(ctx.module->name), ctx.module);
+    printf("Module '%s' loaded from %s\n", ctx.module->name, path);
+    moduleFreeContext(&ctx);
+
+    return REDIS_OK;
+}
+
+/*
+ * 卸载模块，模块导出的RedisModule_OnUnload返回REDISMODULE_ERR时拒绝卸载
+ */
+int moduleUnload(sds name, char** errmsg) {
+    RedisModule* module = dictFetchValue(modules, name);
+    int (*onunload)(void*);
+
+    if (module == NULL) {
+        *errmsg = "no such module with that name";
+        return REDIS_ERR;
+    }
+
+    onunload = (int (*)(void*)) (unsigned long) dlsym(module->handle, "RedisModule_OnUnload");
+    if (onunload) {
+        RedisModuleCtx ctx = REDISMODULE_CTX_INIT;
+        int retval;
+
+        ctx.module = module;
+        retval = onunload((void*) &ctx);
+        moduleFreeContext(&ctx);
+        if (retval == REDISMODULE_ERR) {
+            *errmsg = "the module refused to unload";
+            return REDIS_ERR;
+        }
+    }
+
+    moduleUnregisterCommands(module);
+    if (dlclose(module->handle) == -1)
+        printf("Error when trying to close the %s module: %s\n", module->name, dlerror());
+
+    printf("Module %s unloaded\n", module->name);
+    dictDelete(modules, module->name);
+    moduleFreeModule(module);
+
+    return REDIS_OK;
+}
+
+/* --------------------------------------------------------------------------
+ * 回复
+ * -------------------------------------------------------------------------- */
+
+/*
+ * 在RedisModule_OnLoad中没有客户端，回复函数什么都不做
+ */
+
+static int RM_WrongArity(RedisModuleCtx* ctx) {
+    redisClient* c = ctx->client;
+
+    if (c == NULL) return REDISMODULE_OK;
+    addReplyErrorFormat(c, "wrong number of arguments for '%s' command", (char*) c->argv[0]->ptr);
+    return REDISMODULE_OK;
+}
+
+static int RM_ReplyWithLongLong(RedisModuleCtx* ctx, long long ll) {
+    if (ctx->client == NULL) return REDISMODULE_OK;
+    addReplyLongLong(ctx->client, ll);
+    return REDISMODULE_OK;
+}
+
+/*
+ * err是完整的错误，包括错误类型，例如"ERR invalid value"
+ */
+static int RM_ReplyWithError(RedisModuleCtx* ctx, const char* err) {
+    redisClient* c = ctx->client;
+
+    if (c == NULL) return REDISMODULE_OK;
+    addReplyString(c, "-", 1);
+    addReplyString(c, (char*) err, strlen(err));
+    addReplyString(c, "\r\n", 2);
+    return REDISMODULE_OK;
+}
+
+static int RM_ReplyWithSimpleString(RedisModuleCtx* ctx, const char* msg) {
+    if (ctx->client == NULL) return REDISMODULE_OK;
+    addReplyStatus(ctx->client, (char*) msg);
+    return REDISMODULE_OK;
+}
+
+/*
+ * 回复数组的长度，之后需要回复len个元素；
+ * len为REDISMODULE_POSTPONED_ARRAY_LEN时，元素回复完之后再用RedisModule_ReplySetArrayLength设置长度
+ */
+static int RM_ReplyWithArray(RedisModuleCtx* ctx, long len) {
+    redisClient* c = ctx->client;
+
+    if (c == NULL) return REDISMODULE_OK;
+    if (len == REDISMODULE_POSTPONED_ARRAY_LEN) {
+        ctx->postponed_arrays = zrealloc(ctx->postponed_arrays, sizeof(void*) * (ctx->postponed_arrays_count + 1));
+        ctx->postponed_arrays[ctx->postponed_arrays_count] = addDeferredMultiBulkLength(c);
+        ctx->postponed_arrays_count++;
+    } else {
+        addReplyMultiBulkLen(c, len);
+    }
+    return REDISMODULE_OK;
+}
+
+/*
+ * 设置最近一个长度待定的数组的长度
+ */
+static void RM_ReplySetArrayLength(RedisModuleCtx* ctx, long len) {
+    if (ctx->client == NULL || ctx->postponed_arrays_count == 0) return;
+
+    ctx->postponed_arrays_count--;
+    setDeferredMultiBulkLength(ctx->client, ctx->postponed_arrays[ctx->postponed_arrays_count], len);
+    if (ctx->postponed_arrays_count == 0) {
+        zfree(ctx->postponed_arrays);
+        ctx->postponed_arrays = NULL;
+    }
+}
+
+static int RM_ReplyWithStringBuffer(RedisModuleCtx* ctx, const char* buf, size_t len) {
+    if (ctx->client == NULL) return REDISMODULE_OK;
+    addReplyBulkCBuffer(ctx->client, (void*) buf, len);
+    return REDISMODULE_OK;
+}
+
+static int RM_ReplyWithString(RedisModuleCtx* ctx, RedisModuleString* str) {
+    if (ctx->client == NULL) return REDISMODULE_OK;
+    // 模块字符串可能是键中元素的引用，复制内容，回复链表不持有它
+    addReplyBulkCopy(ctx->client, str);
+    return REDISMODULE_OK;
+}
+
+static int RM_ReplyWithNull(RedisModuleCtx* ctx) {
+    if (ctx->client == NULL) return REDISMODULE_OK;
+    addReply(ctx->client, shared.nullbulk);
+    return REDISMODULE_OK;
+}
+
+static int RM_ReplyWithDouble(RedisModuleCtx* ctx, double d) {
+    if (ctx->client == NULL) return REDISMODULE_OK;
+    addReplyDouble(ctx->client, d);
+    return REDISMODULE_OK;
+}
+
+/* --------------------------------------------------------------------------
+ * 字符串
+ * -------------------------------------------------------------------------- */
+
+/*
+ * 交给模块的字符串都是RAW或EMBSTR编码，RedisModule_StringPtrLen可以直接返回sds
+ */
+static RedisModuleString* moduleAutoString(RedisModuleCtx* ctx, robj* o) {
+    autoMemoryAdd(ctx, REDISMODULE_AM_STRING, o);
+    return o;
+}
+
+static RedisModuleString* RM_CreateString(RedisModuleCtx* ctx, const char* ptr, size_t len) {
+    return moduleAutoString(ctx, createStringObject((char*) ptr, len));
+}
+
+static RedisModuleString* RM_CreateStringFromLongLong(RedisModuleCtx* ctx, long long ll) {
+    return moduleAutoString(ctx, createObject(REDIS_STRING, sdsfromlonglong(ll)));
+}
+
+static const char* RM_StringPtrLen(RedisModuleString* str, size_t* len) {
+    assert(sdsEncodedObject(str));
+    if (len) *len = sdslen(str->ptr);
+    return str->ptr;
+}
+
+static int RM_StringToLongLong(RedisModuleString* str, long long* ll) {
+    return getLongLongFromObject(str, ll) == REDIS_OK ? REDISMODULE_OK : REDISMODULE_ERR;
+}
+
+static int RM_StringToDouble(RedisModuleString* str, double* d) {
+    return getDoubleFromObject(str, d) == REDIS_OK ? REDISMODULE_OK : REDISMODULE_ERR;
+}
+
+/* --------------------------------------------------------------------------
+ * 键
+ * -------------------------------------------------------------------------- */
+
+/*
+ * 打开客户端当前数据库中的键，键不存在时也返回一个键，它的类型是REDISMODULE_KEYTYPE_EMPTY，
+ * 以REDISMODULE_WRITE打开时，写入操作会创建键
+ */
+static RedisModuleKey* RM_OpenKey(RedisModuleCtx* ctx, RedisModuleString* keyname, int mode) {
+    RedisModuleKey* kp;
+    redisDb* db;
+
+    if (ctx->client == NULL) return NULL;
+    db = ctx->client->db;
+
+    kp = zmalloc(sizeof(*kp));
+    kp->ctx = ctx;
+    kp->db = db;
+    kp->key = keyname;
+    incrRefCount(keyname);
+    kp->value = (mode & REDISMODULE_WRITE) ? lookupKeyWrite(db, keyname) : lookupKeyRead(db, keyname);
+    kp->mode = mode;
+    autoMemoryAdd(ctx, REDISMODULE_AM_KEY, kp);
+
+    return kp;
+}
+
+static void RM_CloseKey(RedisModuleKey* kp) {
+    if (kp == NULL) return;
+    autoMemoryForget(kp->ctx, REDISMODULE_AM_KEY, kp);
+    moduleFreeKey(kp);
+}
+
+static int RM_KeyType(RedisModuleKey* kp) {
+    if (kp == NULL || kp->value == NULL) return REDISMODULE_KEYTYPE_EMPTY;
+
+    switch (kp->value->type) {
+        case REDIS_STRING: return REDISMODULE_KEYTYPE_STRING;
+        case REDIS_LIST: return REDISMODULE_KEYTYPE_LIST;
+        case REDIS_SET: return REDISMODULE_KEYTYPE_SET;
+        case REDIS_ZSET: return REDISMODULE_KEYTYPE_ZSET;
+        case REDIS_HASH: return REDISMODULE_KEYTYPE_HASH;
+        default: return REDISMODULE_KEYTYPE_EMPTY;
+    }
+}
+
+/*
+ * 字符串的长度，或者其他类型的元素数量
+ */
+static size_t RM_ValueLength(RedisModuleKey* kp) {
+    if (kp == NULL || kp->value == NULL) return 0;
+
+    switch (kp->value->type) {
+        case REDIS_STRING: return stringObjectLen(kp->value);
+        case REDIS_LIST: return listTypeLength(kp->value);
+        case REDIS_SET: return setTypeSize(kp->value);
+        case REDIS_ZSET: return zsetLength(kp->value);
+        case REDIS_HASH: return hashTypeLength(kp->value);
+        default: return 0;
+    }
+}
+
+/*
+ * 写入操作之后调用，通知监视这个键的客户端，并让call()传播模块命令
+ */
+static void moduleKeyModified(RedisModuleKey* kp) {
+    signalModifiedKey(kp->db, kp->key);
+    server.dirty++;
+}
+
+/*
+ * 写入操作要求键以REDISMODULE_WRITE打开，键已经存在时类型必须是type，
+ * 键不存在时由create创建空的值并加入数据库
+ */
+static int moduleKeyPrepareWrite(RedisModuleKey* kp, int type, robj* (*create)(void)) {
+    if (!(kp->mode & REDISMODULE_WRITE)) return REDISMODULE_ERR;
+    if (kp->value) return kp->value->type == type ? REDISMODULE_OK : REDISMODULE_ERR;
+
+    kp->value = create();
+    dbAdd(kp->db, kp->key, kp->value);
+    return REDISMODULE_OK;
+}
+
+/*
+ * 写入操作使值变为空时删除键
+ */
+static void moduleDelKeyIfEmpty(RedisModuleKey* kp) {
+    if (RM_ValueLength(kp) == 0) {
+        dbDelete(kp->db, kp->key);
+        kp->value = NULL;
+    }
+}
+
+static int RM_DeleteKey(RedisModuleKey* kp) {
+    if (!(kp->mode & REDISMODULE_WRITE)) return REDISMODULE_ERR;
+
+    if (kp->value) {
+        dbDelete(kp->db, kp->key);
+        kp->value = NULL;
+        moduleKeyModified(kp);
+    }
+    return REDISMODULE_OK;
+}
+
+/*
+ * 与SET命令相同，覆盖任何类型的旧值并移除过期时间
+ */
+static int RM_StringSet(RedisModuleKey* kp, RedisModuleString* str) {
+    if (!(kp->mode & REDISMODULE_WRITE)) return REDISMODULE_ERR;
+
+    setKey(kp->db, kp->key, str, 0);
+    kp->value = str;
+    server.dirty++;
+    return REDISMODULE_OK;
+}
+
+/*
+ * 返回字符串的值，键不存在或者不是字符串时返回NULL
+ */
+static RedisModuleString* RM_StringGet(RedisModuleKey* kp) {
+    if (kp->value == NULL || kp->value->type != REDIS_STRING) return NULL;
+    return moduleAutoString(kp->ctx, getDecodedObject(kp->value));
+}
+
+static int RM_ListPush(RedisModuleKey* kp, int where, RedisModuleString* ele) {
+    if (moduleKeyPrepareWrite(kp, REDIS_LIST, createListpackObject) == REDISMODULE_ERR) return REDISMODULE_ERR;
+
+    listTypePush(kp->value, ele, where == REDISMODULE_LIST_HEAD ? REDIS_HEAD : REDIS_TAIL);
+    moduleKeyModified(kp);
+    return REDISMODULE_OK;
+}
+
+/*
+ * 弹出列表的一个元素，列表为空时删除键，键不存在或者不是列表时返回NULL
+ */
+static RedisModuleString* RM_ListPop(RedisModuleKey* kp, int where) {
+    robj* ele;
+    robj* decoded;
+
+    if (!(kp->mode & REDISMODULE_WRITE) || kp->value == NULL || kp->value->type != REDIS_LIST) return NULL;
+
+    ele = listTypePop(kp->value, where == REDISMODULE_LIST_HEAD ? REDIS_HEAD : REDIS_TAIL);
+    moduleDelKeyIfEmpty(kp);
+    moduleKeyModified(kp);
+
+    decoded = getDecodedObject(ele);
+    decrRefCount(ele);
+    return moduleAutoString(kp->ctx, decoded);
+}
+
+static int RM_HashSet(RedisModuleKey* kp, RedisModuleString* field, RedisModuleString* value) {
+    robj* argv[2];
+
+    if (moduleKeyPrepareWrite(kp, REDIS_HASH, createHashObject) == REDISMODULE_ERR) return REDISMODULE_ERR;
+
+    argv[0] = field;
+    argv[1] = value;
+    hashTypeTryConversion(kp->value, argv, 0, 1);
+    hashTypeSet(kp->value, field, value);
+    moduleKeyModified(kp);
+    return REDISMODULE_OK;
+}
+
+/*
+ * 返回哈希中field的值，field不存在，键不存在或者不是哈希时返回NULL
+ */
+static RedisModuleString* RM_HashGet(RedisModuleKey* kp, RedisModuleString* field) {
+    robj* value;
+    robj* decoded;
+
+    if (kp->value == NULL || kp->value->type != REDIS_HASH) return NULL;
+    if ((value = hashTypeGetObject(kp->value, field)) == NULL) return NULL;
+
+    // 返回值的副本，模块之后覆盖或者删除这个键时不会仍然引用哈希中的元素
+    decoded = getDecodedObject(value);
+    decrRefCount(value);
+    value = dupStringObject(decoded);
+    decrRefCount(decoded);
+    return moduleAutoString(kp->ctx, value);
+}
+
+static int RM_SetAdd(RedisModuleKey* kp, RedisModuleString* ele) {
+    if (!(kp->mode & REDISMODULE_WRITE)) return REDISMODULE_ERR;
+
+    if (kp->value == NULL) {
+        kp->value = setTypeCreate(ele);
+        dbAdd(kp->db, kp->key, kp->value);
+    } else if (kp->value->type != REDIS_SET) {
+        return REDISMODULE_ERR;
+    }
+
+    if (setTypeAdd(kp->value, ele)) moduleKeyModified(kp);
+    return REDISMODULE_OK;
+}
+
+/*
+ * ele是集合的成员时返回1，否则返回0
+ */
+static int RM_SetIsMember(RedisModuleKey* kp, RedisModuleString* ele) {
+    if (kp->value == NULL || kp->value->type != REDIS_SET) return 0;
+    return setTypeIsMember(kp->value, ele);
+}
+
+/*
+ * 取得有序集合成员ele的分值，成员不存在，键不存在或者不是有序集合时返回REDISMODULE_ERR
+ */
+static int RM_ZsetScore(RedisModuleKey* kp, RedisModuleString* ele, double* score) {
+    zsetopsrc op;
+
+    if (kp->value == NULL || kp->value->type != REDIS_ZSET) return REDISMODULE_ERR;
+
+    memset(&op, 0, sizeof(op));
+    op.subject = kp->value;
+    return zuiFind(&op, ele, score) ? REDISMODULE_OK : REDISMODULE_ERR;
+}
+
+/*
+ * 调用回调函数，field和value是新的引用，回调返回后释放
+ */
+static int moduleForEachCall(RedisModuleKey* kp, RedisModuleForEachFunc fn, void* privdata, robj* field, robj* value) {
+    robj* f = getDecodedObject(field);
+    robj* v = value ? getDecodedObject(value) : NULL;
+    int retval;
+
+    decrRefCount(field);
+    if (value) decrRefCount(value);
+
+    retval = fn(kp->ctx, f, v, privdata);
+
+    decrRefCount(f);
+    if (v) decrRefCount(v);
+    return retval;
+}
+
+/*
+ * 遍历列表，集合，哈希或者有序集合的所有元素，对每个元素调用fn，fn返回REDISMODULE_ERR时停止：
+ * 列表和集合的field是元素，value为NULL；哈希的field和value是域和值；有序集合的field是成员，value是分值；
+ * 遍历期间不能修改这个键，键是字符串时返回REDISMODULE_ERR
+ */
+static int RM_KeyForEach(RedisModuleKey* kp, RedisModuleForEachFunc fn, void* privdata) {
+    robj* o = kp->value;
+
+    if (o == NULL) return REDISMODULE_OK;
+
+    if (o->type == REDIS_LIST) {
+        listTypeIterator* li = listTypeInitIterator(o, 0, REDIS_TAIL);
+        listTypeEntry entry;
+
+        while (listTypeNext(li, &entry)) {
+            if (moduleForEachCall(kp, fn, privdata, listTypeGet(&entry), NULL) == REDISMODULE_ERR) break;
+        }
+        listTypeReleaseIterator(li);
+    } else if (o->type == REDIS_SET) {
+        setTypeIterator* si = setTypeInitIterator(o);
+        robj* ele;
+
+        while ((ele = setTypeNextObject(si)) != NULL) {
+            if (moduleForEachCall(kp, fn, privdata, ele, NULL) == REDISMODULE_ERR) break;
+        }
+        setTypeReleaseIterator(si);
+    } else if (o->type == REDIS_HASH) {
+        hashTypeIterator* hi = hashTypeInitIterator(o);
+
+        while (hashTypeNext(hi) != REDIS_ERR) {
+            robj* field = hashTypeCurrentObject(hi, REDIS_HASH_KEY);
+            robj* value = hashTypeCurrentObject(hi, REDIS_HASH_VALUE);
+
+            if (moduleForEachCall(kp, fn, privdata, field, value) == REDISMODULE_ERR) break;
+        }
+        hashTypeReleaseIterator(hi);
+    } else if (o->type == REDIS_ZSET) {
+        zsetopsrc op;
+        robj* ele;
+        double score;
+
+        memset(&op, 0, sizeof(op));
+        op.subject = o;
+        zuiInitIterator(&op);
+        while (zuiNext(&op, &ele, &score)) {
+            robj* value = createObject(REDIS_STRING, sdscatprintf(sdsempty(), "%.17g", score));
+
+            if (moduleForEachCall(kp, fn, privdata, ele, value) == REDISMODULE_ERR) break;
+        }
+        zuiClearIterator(&op);
+    } else {
+        return REDISMODULE_ERR;
+    }
+
+    return REDISMODULE_OK;
+}
+
+/* --------------------------------------------------------------------------
+ * API导出
+ * -------------------------------------------------------------------------- */
+
+/*
+ * 模块通过名字取得API函数，RedisModule_Init对每个API调用一次
+ */
+static int RM_GetApi(const char* funcname, void** targetPtrPtr) {
+    sds name = sdsnew(funcname);
+    dictEntry* he = dictFind(moduleapi, name);
+
+    sdsfree(name);
+    if (!he) return REDISMODULE_ERR;
+    *targetPtrPtr = dictGetVal(he);
+    return REDISMODULE_OK;
+}
+
+static int moduleRegisterApi(const char* funcname, void* funcptr) {
+    return dictAdd(moduleapi, sdsnew(funcname), funcptr);
+}
+
+#define REGISTER_API(name) \
+    moduleRegisterApi("RedisModule_" #name, (void*) (unsigned long) RM_ ## name)
+
+static void moduleRegisterCoreAPI(void) {
+    REGISTER_API(Alloc);
+    REGISTER_API(Realloc);
+    REGISTER_API(Free);
+    REGISTER_API(GetApi);
+    REGISTER_API(CreateCommand);
+    REGISTER_API(SetModuleAttribs);
+    REGISTER_API(WrongArity);
+    REGISTER_API(ReplyWithLongLong);
+    REGISTER_API(ReplyWithError);
+    REGISTER_API(ReplyWithSimpleString);
+    REGISTER_API(ReplyWithArray);
+    REGISTER_API(ReplySetArrayLength);
+    REGISTER_API(ReplyWithStringBuffer);
+    REGISTER_API(ReplyWithString);
+    REGISTER_API(ReplyWithNull);
+    REGISTER_API(ReplyWithDouble);
+    REGISTER_API(CreateString);
+    REGISTER_API(CreateStringFromLongLong);
+    REGISTER_API(StringPtrLen);
+    REGISTER_API(StringToLongLong);
+    REGISTER_API(StringToDouble);
+    REGISTER_API(OpenKey);
+    REGISTER_API(CloseKey);
+    REGISTER_API(KeyType);
+    REGISTER_API(ValueLength);
+    REGISTER_API(DeleteKey);
+    REGISTER_API(StringSet);
+    REGISTER_API(StringGet);
+    REGISTER_API(ListPush);
+    REGISTER_API(ListPop);
+    REGISTER_API(HashSet);
+    REGISTER_API(HashGet);
+    REGISTER_API(SetAdd);
+    REGISTER_API(SetIsMember);
+    REGISTER_API(ZsetScore);
+    REGISTER_API(KeyForEach);
+}
+
+/*
+ * 服务器启动时调用
+ */
+void moduleInitModulesSystem(void) {
+    modules = dictCreate(&commandTableDictType, NULL);
+    moduleapi = dictCreate(&commandTableDictType, NULL);
+    moduleRegisterCoreAPI();
+}
+
+/* --------------------------------------------------------------------------
+ * MODULE命令
+ * -------------------------------------------------------------------------- */
+
+/*
+ * MODULE LOAD path [arg ...]
+ * MODULE UNLOAD name
+ * MODULE LIST
+ */
+void moduleCommand(redisClient* c) {
+    char* subcmd = c->argv[1]->ptr;
+
+    if (!strcasecmp(subcmd, "load") && c->argc >= 3) {
+        robj** argv = NULL;
+        int argc = 0;
+
+        if (c->argc > 3) {
+            argc = c->argc - 3;
+            argv = &c->argv[3];
+        }
+
+        if (moduleLoad(c->argv[2]->ptr, argv, argc) == REDIS_OK)
+            addReply(c, shared.ok);
+        else
+            addReplyError(c, "Error loading the extension. Please check the server logs.");
+    } else if (!strcasecmp(subcmd, "unload") && c->argc == 3) {
+        char* errmsg;
+
+        // 事务中之后的命令可能是这个模块的命令
+        if (c->flags & REDIS_MULTI) {
+            addReplyError(c, "MODULE UNLOAD is not allowed inside a transaction");
+            return;
+        }
+
+        if (moduleUnload(c->argv[2]->ptr, &errmsg) == REDIS_OK)
+            addReply(c, shared.ok);
+        else
+            addReplyErrorFormat(c, "Error unloading module: %s", errmsg);
+    } else if (!strcasecmp(subcmd, "list") && c->argc == 2) {
+        dictIterator* di = dictGetIterator(modules);
+        dictEntry* de;
+
+        addReplyMultiBulkLen(c, dictSize(modules));
+        while ((de = dictNext(di)) != NULL) {
+            RedisModule* module = dictGetVal(de);
+
+            addReplyMultiBulkLen(c, 4);
+            addReplyBulkCString(c, "name");
+            addReplyBulkCBuffer(c, module->name, sdslen(module->name));
+            addReplyBulkCString(c, "ver");
+            addReplyLongLong(c, module->ver);
+        }
+        dictReleaseIterator(di);
+    } else {
+        addReplyError(c, "MODULE subcommand must be one of LOAD, UNLOAD, LIST");
+    }
+}
@@ -0,0 +1,331 @@
+//
+// Created by zouyi on 2021/11/14.
+//
+
+/*
+ * 示例模块hellomodule.so的测试
+ *
+ * 连接到运行中的服务器，通过MODULE LOAD加载模块，执行每一个hello.*命令并检查回复，
+ * 然后检查事务中不能执行MODULE UNLOAD，最后卸载模块并确认模块的命令已经不可用；
+ * 测试只使用以moduletest:开头的键，开始和结束时删除这些键
+ *
+ * 编译: make modules module-test
+ * 运行: ./module_test [端口] [模块路径]
+ */
+
+#define _XOPEN_SOURCE 600
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define REPLY_MAX_LEN 4096
+#define MAX_ARGS 16
+
+static char rbuf[1 << 16];
+static size_t rpos = 0, rlen = 0;
+
+static int failures = 0;
+
+static int readByte(int fd) {
+    if (rpos == rlen) {
+        ssize_t n = read(fd, rbuf, sizeof(rbuf));
+        if (n <= 0) {
+            fprintf(stderr, "connection lost\n");
+            exit(1);
+        }
+        rpos = 0;
+        rlen = n;
+    }
+    return (unsigned char) rbuf[rpos++];
+}
+
+/*
+ * 读取一行，返回行的长度，行中可能含有'\0'
+ */
+static size_t readLine(int fd, char* line, size_t size) {
+    size_t i = 0;
+    int ch;
+
+    while ((ch = readByte(fd)) != '\n') {
+        if (ch != '\r' && i + 1 < size) line[i++] = ch;
+    }
+    line[i] = '\0';
+    return i;
+}
+
+/*
+ * 读取一个回复，将其转为便于比较的文本追加到out中:
+ * 状态回复为状态本身，错误回复以'-'开头，整数回复以':'开头，
+ * 批量回复为内容本身，空回复为(nil)，多条批量回复为[元素,元素,...]
+ */
+static void readReply(int fd, char* out, size_t size) {
+    char line[REPLY_MAX_LEN];
+    size_t len = strlen(out);
+    size_t llen;
+    long n, i;
+
+    llen = readLine(fd, line, sizeof(line));
+    switch (line[0]) {
+        case '+':
+            snprintf(out + len, size - len, "%s", line + 1);
+            break;
+        case '-':
+            // 错误类型和错误信息之间的分隔符按空格比较
+            for (i = 0; i < (long) llen; i++)
+                if (line[i] == '\0') line[i] = ' ';
+            snprintf(out + len, size - len, "%s", line);
+            break;
+        case ':':
+            snprintf(out + len, size - len, "%s", line);
+            break;
+        case '$':
+            n = strtol(line + 1, NULL, 10);
+            if (n < 0) {
+                snprintf(out + len, size - len, "(nil)");
+                break;
+            }
+            for (i = 0; i < n + 2; i++) {
+                int ch = readByte(fd);
+                if (i < n && len + 1 < size) out[len++] = ch;
+            }
+            out[len] = '\0';
+            break;
+        case '*':
+            n = strtol(line + 1, NULL, 10);
+            if (n < 0) {
+                snprintf(out + len, size - len, "(nil)");
+                break;
+            }
+            snprintf(out + len, size - len, "[");
+            for (i = 0; i < n; i++) {
+                if (i) strncat(out, ",", size - strlen(out) - 1);
+                readReply(fd, out, size);
+            }
+            strncat(out, "]", size - strlen(out) - 1);
+            break;
+        default:
+            fprintf(stderr, "protocol error: %s\n", line);
+            exit(1);
+    }
+}
+
+static void writeAll(int fd, const char* buf, size_t len) {
+    while (len) {
+        ssize_t n = write(fd, buf, len);
+        if (n <= 0) {
+            perror("write");
+            exit(1);
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+/*
+ * 追加一个多条批量格式的命令，argv中的参数都是C字符串
+ */
+static size_t appendCommand(char* buf, int argc, char** argv) {
+    size_t len = sprintf(buf, "*%d\r\n", argc);
+    int i;
+
+    for (i = 0; i < argc; i++)
+        len += sprintf(buf + len, "$%zu\r\n%s\r\n", strlen(argv[i]), argv[i]);
+    return len;
+}
+
+/*
+ * 发送以NULL结尾的参数组成的命令，检查回复的文本是否等于want
+ */
+static void check(int fd, const char* want, ...) {
+    char buf[REPLY_MAX_LEN];
+    char reply[REPLY_MAX_LEN];
+    char* argv[MAX_ARGS];
+    int argc = 0, i;
+    va_list ap;
+
+    va_start(ap, want);
+    while (argc < MAX_ARGS && (argv[argc] = va_arg(ap, char*)) != NULL) argc++;
+    va_end(ap);
+
+    writeAll(fd, buf, appendCommand(buf, argc, argv));
+    reply[0] = '\0';
+    readReply(fd, reply, sizeof(reply));
+
+    if (strcmp(reply, want) != 0) {
+        failures++;
+        printf("FAIL:");
+        for (i = 0; i < argc; i++) printf(" %s", argv[i]);
+        printf("\n  expected: %s\n  got:      %s\n", want, reply);
+    }
+}
+
+static int connectServer(int port) {
+    struct sockaddr_in sa;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &sa.sin_addr);
+    if (fd < 0 || connect(fd, (struct sockaddr*) &sa, sizeof(sa)) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+static void cleanup(int fd) {
+    char buf[REPLY_MAX_LEN];
+    char reply[REPLY_MAX_LEN];
+    char* argv[] = {"del", "moduletest:list", "moduletest:capped", "moduletest:set", "moduletest:hash",
+                    "moduletest:zset", "moduletest:bad", "moduletest:str", "moduletest:missing"};
+
+    writeAll(fd, buf, appendCommand(buf, sizeof(argv) / sizeof(argv[0]), argv));
+    reply[0] = '\0';
+    readReply(fd, reply, sizeof(reply));
+}
+
+/*
+ * HELLO.PUSH.CAPPED: 表头添加后裁剪到maxlen
+ */
+static void testPushCapped(int fd) {
+    check(fd, ":3", "hello.push.capped", "moduletest:capped", "3", "a", "b", "c", "d", "e", NULL);
+    check(fd, "[e,d,c]", "lrange", "moduletest:capped", "0", "-1", NULL);
+    check(fd, ":3", "hello.push.capped", "moduletest:capped", "3", "f", NULL);
+    check(fd, "[f,e,d]", "lrange", "moduletest:capped", "0", "-1", NULL);
+    check(fd, ":0", "hello.push.capped", "moduletest:capped", "0", "g", NULL);
+    check(fd, ":0", "exists", "moduletest:capped", NULL);
+    check(fd, "-ERR invalid maxlen", "hello.push.capped", "moduletest:capped", "-1", "a", NULL);
+    check(fd, "-ERR invalid maxlen", "hello.push.capped", "moduletest:capped", "x", "a", NULL);
+    check(fd, "-WRONGTYPE Operation against a key holding the wrong kind of value",
+          "hello.push.capped", "moduletest:str", "3", "a", NULL);
+    check(fd, "-ERR wrong number of arguments for 'hello.push.capped' command",
+          "hello.push.capped", "moduletest:capped", "3", NULL);
+}
+
+/*
+ * HELLO.HGETSET: 设置域的值并回复旧值
+ */
+static void testHGetSet(int fd) {
+    check(fd, "(nil)", "hello.hgetset", "moduletest:hash", "f", "v1", NULL);
+    check(fd, "v1", "hello.hgetset", "moduletest:hash", "f", "v2", NULL);
+    check(fd, "v2", "hget", "moduletest:hash", "f", NULL);
+    check(fd, "-WRONGTYPE Operation against a key holding the wrong kind of value",
+          "hello.hgetset", "moduletest:str", "f", "v", NULL);
+    check(fd, "-ERR wrong number of arguments for 'hello.hgetset' command",
+          "hello.hgetset", "moduletest:hash", "f", NULL);
+}
+
+/*
+ * HELLO.SUM: 四种类型的求和
+ */
+static void testSum(int fd) {
+    check(fd, ":3", "rpush", "moduletest:list", "1", "2", "3.5", NULL);
+    check(fd, "6.5", "hello.sum", "moduletest:list", NULL);
+    check(fd, ":3", "sadd", "moduletest:set", "1", "2", "3", NULL);
+    check(fd, "6", "hello.sum", "moduletest:set", NULL);
+    check(fd, ":1", "hset", "moduletest:hash", "g", "10", NULL);
+    check(fd, "-ERR element is not a valid float", "hello.sum", "moduletest:hash", NULL);
+    check(fd, "v2", "hello.hgetset", "moduletest:hash", "f", "2.5", NULL);
+    check(fd, "12.5", "hello.sum", "moduletest:hash", NULL);
+    check(fd, ":4", "zadd", "moduletest:zset", "1", "a", "2", "b", "3", "c", "4", "d", NULL);
+    check(fd, "10", "hello.sum", "moduletest:zset", NULL);
+    check(fd, "0", "hello.sum", "moduletest:missing", NULL);
+    check(fd, ":2", "rpush", "moduletest:bad", "1", "x", NULL);
+    check(fd, "-ERR element is not a valid float", "hello.sum", "moduletest:bad", NULL);
+    check(fd, "-WRONGTYPE Operation against a key holding the wrong kind of value",
+          "hello.sum", "moduletest:str", NULL);
+}
+
+/*
+ * HELLO.FILTER: 按分值范围过滤有序集合成员，数组长度在遍历后设置
+ */
+static void testFilter(int fd) {
+    check(fd, "[b,c]", "hello.filter", "moduletest:zset", "2", "3", NULL);
+    check(fd, "[a,b,c,d]", "hello.filter", "moduletest:zset", "-inf", "+inf", NULL);
+    check(fd, "[]", "hello.filter", "moduletest:zset", "5", "6", NULL);
+    check(fd, "[]", "hello.filter", "moduletest:missing", "0", "1", NULL);
+    check(fd, "-ERR min or max is not a float", "hello.filter", "moduletest:zset", "x", "1", NULL);
+    check(fd, "-WRONGTYPE Operation against a key holding the wrong kind of value",
+          "hello.filter", "moduletest:list", "0", "1", NULL);
+}
+
+/*
+ * 模块命令在事务中排队执行，事务中不能卸载模块
+ */
+static void testMulti(int fd) {
+    check(fd, "OK", "multi", NULL);
+    check(fd, "QUEUED", "hello.sum", "moduletest:set", NULL);
+    check(fd, "QUEUED", "module", "unload", "hello", NULL);
+    check(fd, "QUEUED", "hello.filter", "moduletest:zset", "4", "4", NULL);
+    check(fd, "[6,-ERR MODULE UNLOAD is not allowed inside a transaction,[d]]", "exec", NULL);
+    check(fd, "[[name,hello,ver,:1]]", "module", "list", NULL);
+    check(fd, "6", "hello.sum", "moduletest:set", NULL);
+}
+
+/*
+ * 卸载模块后模块的命令不再可用，可以重新加载
+ */
+static void testUnload(int fd, const char* path) {
+    check(fd, "OK", "module", "unload", "hello", NULL);
+    check(fd, "[]", "module", "list", NULL);
+    check(fd, "-ERR unknown command 'hello.sum'", "hello.sum", "moduletest:set", NULL);
+    check(fd, "-ERR Error unloading module: no such module with that name", "module", "unload", "hello", NULL);
+
+    check(fd, "OK", "multi", NULL);
+    check(fd, "-ERR unknown command 'hello.sum'", "hello.sum", "moduletest:set", NULL);
+    check(fd, "-EXECABORT Transaction discarded because of previous errors.", "exec", NULL);
+
+    check(fd, "OK", "module", "load", path, NULL);
+    check(fd, "6", "hello.sum", "moduletest:set", NULL);
+    check(fd, "OK", "module", "unload", "hello", NULL);
+}
+
+int main(int argc, char** argv) {
+    int port = argc > 1 ? atoi(argv[1]) : 6379;
+    const char* module = argc > 2 ? argv[2] : "./hellomodule.so";
+    char path[PATH_MAX];
+    int fd;
+
+    if (port <= 0) {
+        fprintf(stderr, "usage: %s [port] [module path]\n", argv[0]);
+        return 1;
+    }
+
+    // 服务器的工作目录可能不同，使用绝对路径加载
+    if (realpath(module, path) == NULL) {
+        perror(module);
+        return 1;
+    }
+
+    fd = connectServer(port);
+    cleanup(fd);
+
+    check(fd, "OK", "module", "load", path, NULL);
+    check(fd, "[[name,hello,ver,:1]]", "module", "list", NULL);
+    check(fd, "OK", "set", "moduletest:str", "v", NULL);
+
+    testPushCapped(fd);
+    testHGetSet(fd);
+    testSum(fd);
+    testFilter(fd);
+    testMulti(fd);
+    testUnload(fd, path);
+
+    cleanup(fd);
+    close(fd);
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all module tests passed\n");
+    return 0;
+}
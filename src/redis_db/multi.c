@@ -0,0 +1,377 @@
+//
+// Created by zouyi on 2021/11/12.
+//
+
+#include "redis.h"
+
+/*
+ * 事务
+ *
+ * MULTI之后客户端发送的命令被放入事务队列，EXEC时按顺序一次执行完，中间不会执行其他客户端的命令；
+ * WATCH实现乐观锁，被监视的键在EXEC之前被修改时，EXEC放弃执行事务并回复空
+ */
+
+/*
+ * Client state initialization for MULTI/EXEC
+ */
+
+/*
+ * 初始化客户端的事务状态
+ */
+void initClientMultiState(redisClient* c) {
+    c->mstate.commands = NULL;
+    c->mstate.count = 0;
+    c->mstate.capacity = 0;
+}
+
+/*
+ * 释放事务队列中的所有命令
+ */
+/* Release all the resources associated with MULTI/EXEC state */
+void freeClientMultiState(redisClient* c) {
+    int j;
+
+    for (j = 0; j < c->mstate.count; j++) {
+        int i;
+        multiCmd* mc = c->mstate.commands + j;
+
+        for (i = 0; i < mc->argc; i++)
+            decrRefCount(mc->argv[i]);
+        zfree(mc->argv);
+    }
+    zfree(c->mstate.commands);
+}
+
+/*
+ * 将客户端当前的命令添加到事务队列的末尾，队列容量按倍数增长
+ */
+/* Add a new command into the MULTI commands queue */
+void queueMultiCommand(redisClient* c) {
+    multiCmd* mc;
+    int j;
+
+    if (c->mstate.count == c->mstate.capacity) {
+        c->mstate.capacity = c->mstate.capacity ? c->mstate.capacity * 2 : 4;
+        c->mstate.commands = zrealloc(c->mstate.commands, sizeof(multiCmd) * c->mstate.capacity);
+    }
+
+    mc = c->mstate.commands + c->mstate.count;
+    mc->cmd = c->cmd;
+    mc->argc = c->argc;
+    mc->argv = zmalloc(sizeof(robj*) * c->argc);
+    memcpy(mc->argv, c->argv, sizeof(robj*) * c->argc);
+    for (j = 0; j < c->argc; j++)
+        incrRefCount(mc->argv[j]);
+
+    c->mstate.count++;
+}
+
+/*
+ * 放弃事务，清空事务队列和监视的键
+ */
+void discardTransaction(redisClient* c) {
+    freeClientMultiState(c);
+    initClientMultiState(c);
+    c->flags &= ~(REDIS_MULTI | REDIS_DIRTY_CAS | REDIS_DIRTY_EXEC);
+    unwatchAllKeys(c);
+}
+
+/*
+ * 命令入队时出错(例如命令不存在、参数个数错误)，标记事务，之后的EXEC会失败
+ */
+/* Flag the transacation as DIRTY_EXEC so that EXEC will fail.
+ * Should be called every time there is an error while queueing a command. */
+void flagTransaction(redisClient* c) {
+    if (c->flags & REDIS_MULTI)
+        c->flags |= REDIS_DIRTY_EXEC;
+}
+
+/*
+ * MULTI命令
+ */
+void multiCommand(redisClient* c) {
+
+    if (c->flags & REDIS_MULTI) {
+        addReplyError(c, "MULTI calls can not be nested");
+        return;
+    }
+
+    c->flags |= REDIS_MULTI;
+
+    addReply(c, shared.ok);
+}
+
+/*
+ * DISCARD命令
+ */
+void discardCommand(redisClient* c) {
+
+    if (!(c->flags & REDIS_MULTI)) {
+        addReplyError(c, "DISCARD without MULTI");
+        return;
+    }
+
+    discardTransaction(c);
+
+    addReply(c, shared.ok);
+}
+
+/*
+ * 在事务中第一个写命令执行之前传播MULTI，EXEC本身由call()在事务修改了数据库时传播，
+ * 这样整个事务作为一个MULTI...EXEC块写入AOF
+ */
+/* Send a MULTI command to all the slaves and AOF file. Check the execCommand
+ * implementation for more information. */
+static void execCommandPropagateMulti(redisClient* c) {
+    robj* multistring = createStringObject("MULTI", 5);
+
+    propagate(server.multiCommand, c->db->id, &multistring, 1, REDIS_PROPAGATE_AOF | REDIS_PROPAGATE_REPL);
+    decrRefCount(multistring);
+}
+
+/*
+ * EXEC命令
+ */
+void execCommand(redisClient* c) {
+    int j;
+    robj** orig_argv;
+    int orig_argc;
+    struct redisCommand* orig_cmd;
+    // 是否需要传播MULTI/EXEC
+    int must_propagate = 0;
+
+    if (!(c->flags & REDIS_MULTI)) {
+        addReplyError(c, "EXEC without MULTI");
+        return;
+    }
+
+    // 被监视的键已经被修改(回复空)，或者命令入队时出错(回复EXECABORT)，放弃执行事务
+    /* Check if we need to propagate MULTI/EXEC to AOF / slaves. */
+    /* Exec all the queued commands */
+    if (c->flags & (REDIS_DIRTY_CAS | REDIS_DIRTY_EXEC)) {
+        addReply(c, c->flags & REDIS_DIRTY_EXEC ? shared.execaborterr : shared.nullmultibulk);
+        discardTransaction(c);
+        return;
+    }
+
+    // 事务开始执行之后不再需要监视，事务中的命令修改被监视的键不会使事务失败
+    /* Unwatch ASAP otherwise we'll waste CPU cycles */
+    unwatchAllKeys(c);
+
+    orig_argv = c->argv;
+    orig_argc = c->argc;
+    orig_cmd = c->cmd;
+
+    addReplyMultiBulkLen(c, c->mstate.count);
+    for (j = 0; j < c->mstate.count; j++) {
+        c->argc = c->mstate.commands[j].argc;
+        c->argv = c->mstate.commands[j].argv;
+        c->cmd = c->mstate.commands[j].cmd;
+
+        /* Propagate a MULTI request once we encounter the first write op.
+         * This way we'll deliver the MULTI/..../EXEC block as a whole and
+         * both the AOF and the replication link will have the same consistency
+         * and atomicity guarantees. */
+        if (!must_propagate && !(c->cmd->flags & REDIS_CMD_READONLY)) {
+            execCommandPropagateMulti(c);
+            must_propagate = 1;
+        }
+
+        call(c, REDIS_CALL_FULL);
+
+        // 命令可能修改了参数数组，保存回事务队列，之后由事务队列负责释放
+        /* Commands may alter argc/argv, restore mstate. */
+        c->mstate.commands[j].argc = c->argc;
+        c->mstate.commands[j].argv = c->argv;
+        c->mstate.commands[j].cmd = c->cmd;
+    }
+
+    c->argv = orig_argv;
+    c->argc = orig_argc;
+    c->cmd = orig_cmd;
+
+    discardTransaction(c);
+
+    // 让call()在EXEC之后传播EXEC，与之前传播的MULTI配对
+    /* Make sure the EXEC command will be propagated as well if MULTI
+     * was already propagated. */
+    if (must_propagate) server.dirty++;
+}
+
+/*
+ * WATCH/UNWATCH与乐观锁
+ *
+ * 每个数据库的watched_keys字典将被监视的键映射到监视它的客户端链表，
+ * 键被修改时signalModifiedKey在字典中查找一次，将链表中的客户端标记为REDIS_DIRTY_CAS；
+ * 客户端的watched_keys链表记录它监视的所有键，以及它在对应客户端链表中的节点，
+ * 取消监视时直接删除该节点，不需要在客户端链表中查找
+ */
+
+/*
+ * 客户端监视的一个键
+ */
+typedef struct watchedKey {
+
+    robj* key;
+
+    redisDb* db;
+
+    // 客户端在db->watched_keys[key]链表中的节点
+    listNode* node;
+
+} watchedKey;
+
+/*
+ * 让客户端监视键key
+ */
+/* Watch for the specified key */
+static void watchForKey(redisClient* c, robj* key) {
+    list* clients;
+    listIter li;
+    listNode* ln;
+    watchedKey* wk;
+
+    // 已经监视了这个键
+    /* Check if we are already watching for this key */
+    listRewind(c->watched_keys, &li);
+    while ((ln = listNext(&li))) {
+        wk = listNodeValue(ln);
+        if (wk->db == c->db && equalStringObjects(key, wk->key))
+            return; /* Key already watched */
+    }
+
+    /* This key is not already watched in this DB. Let's add it */
+    clients = dictFetchValue(c->db->watched_keys, key);
+    if (!clients) {
+        clients = listCreate();
+        dictAdd(c->db->watched_keys, key, clients);
+        incrRefCount(key);
+    }
+    listAddNodeTail(clients, c);
+
+    /* Add the new key to the list of keys watched by this client */
+    wk = zmalloc(sizeof(*wk));
+    wk->key = key;
+    wk->db = c->db;
+    wk->node = listLast(clients);
+    incrRefCount(key);
+    listAddNodeTail(c->watched_keys, wk);
+}
+
+/*
+ * 取消客户端对所有键的监视
+ */
+/* Unwatch all the keys watched by this client. To clean the EXEC dirty
+ * flag is up to the caller. */
+void unwatchAllKeys(redisClient* c) {
+    listIter li;
+    listNode* ln;
+
+    if (listLength(c->watched_keys) == 0) return;
+
+    listRewind(c->watched_keys, &li);
+    while ((ln = listNext(&li))) {
+        list* clients;
+        watchedKey* wk;
+
+        /* Lookup the watched key -> clients list and remove the client
+         * from the list */
+        wk = listNodeValue(ln);
+        clients = dictFetchValue(wk->db->watched_keys, wk->key);
+        assert(clients != NULL);
+        listDelNode(clients, wk->node);
+
+        // 没有客户端监视这个键时，从字典中删除
+        /* Kill the entry at all if this was the only client */
+        if (listLength(clients) == 0)
+            dictDelete(wk->db->watched_keys, wk->key);
+
+        /* Remove this watched key from the client->watched list */
+        listDelNode(c->watched_keys, ln);
+        decrRefCount(wk->key);
+        zfree(wk);
+    }
+}
+
+/*
+ * 键key被修改，将所有监视它的客户端标记为REDIS_DIRTY_CAS
+ */
+/* "Touch" a key, so that if this key is being WATCHed by some client the
+ * next EXEC will fail. */
+void touchWatchedKey(redisDb* db, robj* key) {
+    list* clients;
+    listIter li;
+    listNode* ln;
+
+    // 没有任何键被监视时直接返回
+    if (dictSize(db->watched_keys) == 0) return;
+
+    clients = dictFetchValue(db->watched_keys, key);
+    if (!clients) return;
+
+    /* Mark all the clients watching this key as REDIS_DIRTY_CAS */
+    /* Check if we are already watching for this key */
+    listRewind(clients, &li);
+    while ((ln = listNext(&li))) {
+        redisClient* c = listNodeValue(ln);
+
+        c->flags |= REDIS_DIRTY_CAS;
+    }
+}
+
+/*
+ * 数据库被清空，监视的键在清空前存在的客户端被标记为REDIS_DIRTY_CAS，dbid为-1表示所有数据库
+ */
+/* On FLUSHDB or FLUSHALL all the watched keys that are present before the
+ * flush but will be deleted as effect of the flushing operation should
+ * be touched. "dbid" is the DB that's getting the flush. -1 if it is
+ * a FLUSHALL operation (all the DBs flushed). */
+void touchWatchedKeysOnFlush(int dbid) {
+    listIter li1, li2;
+    listNode* ln;
+
+    /* For every client, check all the waited keys */
+    listRewind(server.clients, &li1);
+    while ((ln = listNext(&li1))) {
+        redisClient* c = listNodeValue(ln);
+
+        listRewind(c->watched_keys, &li2);
+        while ((ln = listNext(&li2))) {
+            watchedKey* wk = listNodeValue(ln);
+
+            /* For every watched key matching the specified DB, if the
+             * key exists, mark the client as dirty, as the key will be
+             * removed. */
+            if (dbid == -1 || wk->db->id == dbid) {
+                if (dictFind(wk->db->dict, wk->key->ptr) != NULL)
+                    c->flags |= REDIS_DIRTY_CAS;
+            }
+        }
+    }
+}
+
+/*
+ * WATCH命令
+ */
+void watchCommand(redisClient* c) {
+    int j;
+
+    if (c->flags & REDIS_MULTI) {
+        addReplyError(c, "WATCH inside MULTI is not allowed");
+        return;
+    }
+
+    for (j = 1; j < c->argc; j++)
+        watchForKey(c, c->argv[j]);
+
+    addReply(c, shared.ok);
+}
+
+/*
+ * UNWATCH命令
+ */
+void unwatchCommand(redisClient* c) {
+    unwatchAllKeys(c);
+    c->flags &= (~REDIS_DIRTY_CAS);
+    addReply(c, shared.ok);
+}
@@ -11,7 +11,7 @@
  * strings because of the trick they use to work (the header is before the
  * returned pointer), so we use this helper function. */
 size_t zmalloc_size_sds(sds s) {
-    return zmalloc_size(s - sizeof(struct sdshdr));
+    return zmalloc_size(sdsAllocPtr(s));
 }
 
 /* Return the amount of memory used by the sds string at object->ptr
@@ -130,8 +130,8 @@ redisClient* createClient(int fd) {
     // TODO: 复制相关，最后被写入的全局复制偏移量
     /* c->woff = 0; */
 
-    // TODO: 事务相关，事务进行时监视的键
-    /* c->watched_keys = listCreate(); */
+    // 事务进行时监视的键
+    c->watched_keys = listCreate();
 
     // TODO: 发布/订阅相关
     /* c->pubsub_channels = dictCreate(&setDictType, NULL); */
@@ -140,13 +140,14 @@ redisClient* createClient(int fd) {
     /* listSetMatchMethod(c->pubsub_patterns, listMatchObjects); */
 
     // ip:port对
+    c->scan_matcher = NULL;
     c->peerid = NULL;
 
     // 如果是带连接的客户端，则添加到服务器的客户端链表中
     if (fd != -1) listAddNodeTail(server.clients, c);
 
-    // TODO: 事务相关，初始化客户端的事务状态
-    /* initClientMultiState(c); */
+    // 初始化客户端的事务状态
+    initClientMultiState(c);
 
     return c;
 }
@@ -714,6 +715,18 @@ void addReplyBulkLongLong(redisClient* c, long long ll) {
     addReplyBulkCBuffer(c, buf, len);
 }
 
+/*
+ * 以大容量字符串的形式复制一个redis对象的内容到回复，回复链表不持有obj的引用，
+ * 用于回复集合、哈希和有序集合中的元素，元素只能被所属的容器引用(见lazyfree.c)
+ */
+void addReplyBulkCopy(redisClient* c, robj* obj) {
+    if (sdsEncodedObject(obj)) {
+        addReplyBulkCBuffer(c, obj->ptr, sdslen(obj->ptr));
+    } else {
+        addReplyBulkLongLong(c, (long) obj->ptr);
+    }
+}
+
 /* -----------------------------------------------------------------------------
  * 事件处理器相关API
  * -------------------------------------------------------------------------- */
@@ -867,10 +880,9 @@ void freeClient(redisClient* c) {
     // if (c->flags & REDIS_BLOCKED) unblockClient(c);
     // dictRelease(c->bpop.keys);
 
-    // TODO: 事务相关
     /* UNWATCH all the keys */
-    // unwatchAllKeys(c);
-    // listRelease(c->watched_keys);
+    unwatchAllKeys(c);
+    listRelease(c->watched_keys);
 
     // TODO: 发布/订阅相关
     /* Unsubscribe from all the pubsub channels */
@@ -952,9 +964,9 @@ void freeClient(redisClient* c) {
     if (c->name) decrRefCount(c->name);
     zfree(c->argv);
     
-    // TODO: 事务相关
-    // freeClientMultiState(c);
+    freeClientMultiState(c);
 
+    stringmatcherFree(c->scan_matcher);
     sdsfree(c->peerid);
     zfree(c);
 }
@@ -1632,8 +1644,7 @@ sds catClientInfoString(sds s, redisClient *client) {
                      // TODO: 发布/订阅相关
                      /* (int) dictSize(client->pubsub_channels) */ -1,
                      /* (int) listLength(client->pubsub_patterns) */ -1,
-                     // TODO: 事务相关
-                     /* (client->flags & REDIS_MULTI) ? client->mstate.count : -1 */ -1,
+                     (client->flags & REDIS_MULTI) ? client->mstate.count : -1,
                      (unsigned long long) sdslen(client->querybuf),
                      (unsigned long long) sdsavail(client->querybuf),
                      (unsigned long long) client->bufpos,
@@ -22,8 +22,8 @@ robj* createObject(int type, void* ptr) {
     o->ptr = ptr;
     o->refcount = 1;
 
-    /* Set the LRU to the current lruclock */
-    o->lru = getLRUClock();
+    /* Set the LRU to the current lruclock (or the LFU initial counter) */
+    o->lru = objectInitialLRU();
     return o;
 }
 
@@ -42,18 +42,19 @@ robj* createRawStringObject(char* ptr, size_t len) {
  *
  */
 robj* createEmbeddedStringObject(char* ptr, size_t len) {
-    robj* o = zmalloc(sizeof(robj) + sizeof(struct sdshdr) + len + 1);
-    // sh指向分配好的struct sdshdr首地址
-    struct sdshdr* sh = (void*)(o + 1);
+    robj* o = zmalloc(sizeof(robj) + sizeof(struct sdshdr8) + len + 1);
+    // sh指向分配好的struct sdshdr8首地址，嵌入字符串的长度不超过44，头部只需要3个字节
+    struct sdshdr8* sh = (void*)(o + 1);
 
     o->type = REDIS_STRING;
     o->encoding = REDIS_ENCODING_EMBSTR;
     o->ptr = sh + 1;
     o->refcount = 1;
-    o->lru = getLRUClock();
+    o->lru = objectInitialLRU();
 
     sh->len = len;
-    sh->free = 0;
+    sh->alloc = len;
+    sh->flags = SDS_TYPE_8;
     if (ptr) {
         memcpy(sh->buf, ptr, len);
         sh->buf[len] = '\0';
@@ -65,9 +66,9 @@ robj* createEmbeddedStringObject(char* ptr, size_t len) {
 
 /*
  * 可以使用REDIS_ENCODING_EMBSTR进行编码的字符串类型对象长度上限
- * 注意: 当长度等于39时刚好一共需要分配64字节空间
+ * 注意: 当长度等于44时，robj(16字节) + sdshdr8(3字节) + 44 + 1 刚好一共需要分配64字节空间
  */
-#define REDIS_ENCODING_EMBSTR_SIZE_LIMIT 39
+#define REDIS_ENCODING_EMBSTR_SIZE_LIMIT 44
 
 /*
  * 创建一个字符串类型的对象
@@ -91,7 +92,7 @@ robj* createStringObjectFromLongLong(long long value) {
     robj* o;
 
     // 初始化时定义的共享对象
-    if (value >= 0 && value <= REDIS_SHARED_INTEGERS) {
+    if (value >= 0 && value < REDIS_SHARED_INTEGERS) {
         incrRefCount(shared.integers[value]);
         o = shared.integers[value];
     } else {
@@ -158,39 +159,31 @@ robj* dupStringObject(robj* o) {
 }
 
 /*
- * 创建一个列表类型的对象，使用REIDS_ENCODING_LINKEDLIST编码
- * 注意: 这个列表类型对象的指针属性指向创建的list，设置释放该list节点的方法为decrRefCountVoid，
- * 意味着链表节点listNode中保存实际内容的指针指向的也是一个redis对象(嵌套字符串类型的对象)，通过引用计数来
- * 管理其内存资源的申请和释放
+ * 创建一个列表类型的对象，使用REDIS_ENCODING_QUICKLIST编码
+ * 注意: 快速列表直接在压缩列表中保存元素的值，不需要嵌套字符串类型的对象
  */
-robj* createListObject(void) {
+robj* createQuicklistObject(void) {
 
-    // 创建一个空的双向链表
-    list* l = listCreate();
+    quicklist* l = quicklistNew(server.list_max_ziplist_size, server.list_compress_depth);
 
-    // 创建一个列表类型的redis对象，使用REIDS_ENCODING_LINKEDLIST编码，底层使用的是双向链表
     robj* o = createObject(REDIS_LIST, l);
 
-    // 设置释放节点的函数指针
-    listSetFreeMethod(l, decrRefCountVoid);
-
-    // 设置底层编码属性
-    o->encoding = REDIS_ENCODING_LINKEDLIST;
+    o->encoding = REDIS_ENCODING_QUICKLIST;
 
     return o;
 }
 
 /*
- * 创建一个列表类型的对象，使用REDIS_ENCODING_ZIPLIST编码
- * 注意: 这个列表类型对象的指针属性等于创建的压缩列表首地址，不需要嵌套对象
+ * 创建一个列表类型的对象，使用REDIS_ENCODING_LISTPACK编码
+ * 注意: 这个列表类型对象的指针属性等于创建的listpack首地址，不需要嵌套对象
  */
-robj* createZiplistObject(void) {
+robj* createListpackObject(void) {
 
-    unsigned char* zl = ziplistNew();
+    unsigned char* zl = lpNew();
 
     robj* o = createObject(REDIS_LIST, zl);
 
-    o->encoding = REDIS_ENCODING_ZIPLIST;
+    o->encoding = REDIS_ENCODING_LISTPACK;
 
     return o;
 }
@@ -224,16 +217,16 @@ robj* createIntsetObject(void) {
 }
 
 /*
- * 创建一个哈希类型的对象，使用REDIS_ENCODING_ZIPLIST编码
+ * 创建一个哈希类型的对象，使用REDIS_ENCODING_LISTPACK编码
  * 注意: 哈希类型对象底层编码的转换(REDIS_ENCODING_HT)在t_hash.c中
  */
 robj* createHashObject(void) {
 
-    unsigned char* zl = ziplistNew();
+    unsigned char* zl = lpNew();
 
     robj* o = createObject(REDIS_HASH, zl);
 
-    o->encoding = REDIS_ENCODING_ZIPLIST;
+    o->encoding = REDIS_ENCODING_LISTPACK;
 
     return o;
 }
@@ -250,6 +243,7 @@ robj* createZsetObject(void) {
 
     zs->dict = dictCreate(&zsetDictType, NULL);
     zs->zsl = zslCreate();
+    zs->zbt = NULL;
 
     o = createObject(REDIS_ZSET, zs);
 
@@ -259,15 +253,15 @@ robj* createZsetObject(void) {
 }
 
 /*
- * 创建一个有序集合类型的对象，使用REDIS_ENCODING_ZIPLIST编码
+ * 创建一个有序集合类型的对象，使用REDIS_ENCODING_LISTPACK编码
  */
-robj* createZsetZiplistObject(void) {
+robj* createZsetListpackObject(void) {
 
-    unsigned char* zl = ziplistNew();
+    unsigned char* zl = lpNew();
 
     robj* o = createObject(REDIS_ZSET, zl);
 
-    o->encoding = REDIS_ENCODING_ZIPLIST;
+    o->encoding = REDIS_ENCODING_LISTPACK;
 
     return o;
 }
@@ -289,11 +283,11 @@ void freeStringObject(robj* o) {
 void freeListObject(robj* o) {
     switch (o->encoding) {
 
-        case REDIS_ENCODING_LINKEDLIST:
-            listRelease((list*) o->ptr);
+        case REDIS_ENCODING_QUICKLIST:
+            quicklistRelease(o->ptr);
             break;
 
-        case REDIS_ENCODING_ZIPLIST:
+        case REDIS_ENCODING_LISTPACK:
             zfree(o->ptr);
             break;
 
@@ -316,6 +310,10 @@ void freeSetObject(robj* o) {
             zfree(o->ptr);
             break;
 
+        case REDIS_ENCODING_ROARING:
+            roaringFree(o->ptr);
+            break;
+
         default:
             exit(1);
     }
@@ -337,7 +335,14 @@ void freeZsetObject(robj* o) {
             zfree(zs);
             break;
 
-        case REDIS_ENCODING_ZIPLIST:
+        case REDIS_ENCODING_BTREE:
+            zs = o->ptr;
+            dictRelease(zs->dict);
+            zbtFree(zs->zbt);
+            zfree(zs);
+            break;
+
+        case REDIS_ENCODING_LISTPACK:
             zfree(o->ptr);
             break;
 
@@ -356,10 +361,14 @@ void freeHashObject(robj* o) {
             dictRelease((dict*)o->ptr);
             break;
 
-        case REDIS_ENCODING_ZIPLIST:
+        case REDIS_ENCODING_LISTPACK:
             zfree(o->ptr);
             break;
 
+        case REDIS_ENCODING_PACKHASH:
+            packhashFree(o->ptr);
+            break;
+
         default:
             exit(1);
     }
@@ -369,7 +378,17 @@ void freeHashObject(robj* o) {
  * 增加对象的引用计数
  */
 void incrRefCount(robj* o) {
-    o->refcount++;
+    // 永生的共享对象不修改引用计数，可以安全地被bio线程访问
+    if (o->refcount != REDIS_SHARED_REFCOUNT) o->refcount++;
+}
+
+/*
+ * 将对象设置为永生的共享对象，引用计数不再变化，对象永远不会被释放
+ */
+robj* makeObjectShared(robj* o) {
+    assert(o->refcount == 1);
+    o->refcount = REDIS_SHARED_REFCOUNT;
+    return o;
 }
 
 /*
@@ -379,6 +398,8 @@ void decrRefCount(robj* o) {
 
     if (o->refcount <= 0) exit(1);
 
+    if (o->refcount == REDIS_SHARED_REFCOUNT) return;
+
     if (o->refcount == 1) {
         switch (o->type) {
             case REDIS_STRING:
@@ -820,9 +841,14 @@ char* strEncoding(int encoding) {
         case REDIS_ENCODING_HT: return "hashtable";
         case REDIS_ENCODING_LINKEDLIST: return "linkedlist";
         case REDIS_ENCODING_ZIPLIST: return "ziplist";
+        case REDIS_ENCODING_LISTPACK: return "listpack";
+        case REDIS_ENCODING_PACKHASH: return "packhash";
         case REDIS_ENCODING_INTSET: return "intset";
+        case REDIS_ENCODING_ROARING: return "roaring";
         case REDIS_ENCODING_SKIPLIST: return "skiplist";
+        case REDIS_ENCODING_BTREE: return "btree";
         case REDIS_ENCODING_EMBSTR: return "embstr";
+        case REDIS_ENCODING_QUICKLIST: return "quicklist";
         default: return "unknown";
     }
 }
@@ -839,3 +865,47 @@ unsigned long long estimateObjectIdleTime(robj* o) {
         return (lruclock  + (REDIS_LRU_CLOCK_MAX - o->lru)) * REDIS_LRU_CLOCK_RESOLUTION;
     }
 }
+
+/*
+ * 在不修改键的LRU/LFU信息的情况下查找键
+ */
+static robj* objectCommandLookup(redisClient* c, robj* key) {
+    dictEntry* de;
+
+    if ((de = dictFind(c->db->dict, key->ptr)) == NULL) return NULL;
+    return (robj*) dictGetVal(de);
+}
+
+/*
+ * OBJECT <REFCOUNT|ENCODING|IDLETIME|FREQ> <key>
+ */
+void objectCommand(redisClient* c) {
+    robj* o;
+
+    if ((o = objectCommandLookup(c, c->argv[2])) == NULL) {
+        addReply(c, shared.nullbulk);
+        return;
+    }
+
+    if (!strcasecmp(c->argv[1]->ptr, "refcount")) {
+        addReplyLongLong(c, o->refcount);
+    } else if (!strcasecmp(c->argv[1]->ptr, "encoding")) {
+        addReplyBulkCString(c, strEncoding(o->encoding));
+    } else if (!strcasecmp(c->argv[1]->ptr, "idletime")) {
+        // LFU策略下lru域保存的不是访问时间
+        if (REDIS_MAXMEMORY_IS_LFU(server.maxmemory_policy)) {
+            addReplyError(c, "An LFU maxmemory policy is selected, idle time not tracked.");
+            return;
+        }
+        addReplyLongLong(c, estimateObjectIdleTime(o) / 1000);
+    } else if (!strcasecmp(c->argv[1]->ptr, "freq")) {
+        if (!REDIS_MAXMEMORY_IS_LFU(server.maxmemory_policy)) {
+            addReplyError(c, "An LFU maxmemory policy is not selected, access frequency not tracked.");
+            return;
+        }
+        // 返回衰减后的计数器，但不写回对象
+        addReplyLongLong(c, LFUDecrAndReturn(o));
+    } else {
+        addReplyError(c, "Syntax error. Try OBJECT (refcount|encoding|idletime|freq)");
+    }
+}
@@ -0,0 +1,270 @@
+//
+// Created by zouyi on 2021/11/9.
+//
+
+#include <string.h>
+#include <assert.h>
+#include "zmalloc.h"
+#include "utils.h"
+#include "dict.h"
+#include "listpack.h"
+#include "packhash.h"
+
+#define PACKHASH_MIN_SIZE 16
+
+#define PACKHASH_TAG(h) ((unsigned char) ((h) >> 24))
+
+/*
+ * 计算lp中p指向的field的哈希值，整数编码的field按照字符串形式计算，与查找时保持一致
+ */
+static unsigned int phEntryHash(unsigned char* p) {
+    unsigned char* vstr;
+    unsigned int vlen;
+    long long vll;
+    char buf[32];
+
+    lpGet(p, &vstr, &vlen, &vll);
+    if (vstr == NULL) {
+        vlen = ll2string(buf, sizeof(buf), vll);
+        vstr = (unsigned char*) buf;
+    }
+    return dictGenHashFunction(vstr, vlen);
+}
+
+/*
+ * 分配size个槽的索引，并将lp中所有field重新加入索引
+ */
+static void phRebuild(packhash* ph, uint32_t size) {
+    unsigned char* p;
+    uint32_t mask = size - 1;
+
+    zfree(ph->slots);
+    ph->slots = zmalloc(size * (sizeof(uint32_t) + 1));
+    ph->tags = (unsigned char*) (ph->slots + size);
+    ph->size = size;
+    ph->nshifts = 0;
+    memset(ph->slots, 0, size * sizeof(uint32_t));
+
+    p = lpIndex(ph->lp, 0);
+    while (p != NULL) {
+        unsigned int h = phEntryHash(p);
+        uint32_t i = h & mask;
+
+        while (ph->slots[i] != 0) i = (i + 1) & mask;
+        ph->slots[i] = p - ph->lp;
+        ph->tags[i] = PACKHASH_TAG(h);
+
+        // 跳过value
+        p = lpNext(ph->lp, p);
+        assert(p != NULL);
+        p = lpNext(ph->lp, p);
+    }
+}
+
+/*
+ * 依次应用尚未应用的移动，返回槽中保存的偏移量off对应的field在lp中的实际偏移量
+ */
+static uint32_t phResolve(packhash* ph, uint32_t off) {
+    uint32_t k;
+
+    for (k = 0; k < ph->nshifts; k++) {
+        if (off > ph->shifts[k].off) off += ph->shifts[k].delta;
+    }
+    return off;
+}
+
+/*
+ * phResolve的逆运算，新加入索引的field按照移动发生之前的坐标保存，
+ * field不会位于被删除或者被修改的元素内部，因此逆运算总是存在
+ */
+static uint32_t phUnresolve(packhash* ph, uint32_t off) {
+    uint32_t k = ph->nshifts;
+
+    while (k--) {
+        if (off > ph->shifts[k].off) off -= ph->shifts[k].delta;
+    }
+    return off;
+}
+
+/*
+ * 返回能以不超过3/4的负载容纳count个field的槽数量
+ */
+static uint32_t phSizeFor(uint32_t count) {
+    uint32_t size = PACKHASH_MIN_SIZE;
+
+    while (size / 4 * 3 < count) size <<= 1;
+    return size;
+}
+
+/*
+ * 查找field所在的槽，找不到时返回-1
+ */
+static long phLookup(packhash* ph, unsigned char* field, unsigned int flen, unsigned int h) {
+    uint32_t mask = ph->size - 1;
+    uint32_t i = h & mask;
+    unsigned char tag = PACKHASH_TAG(h);
+
+    while (ph->slots[i] != 0) {
+        if (ph->tags[i] == tag && lpCompare(ph->lp + phResolve(ph, ph->slots[i]), field, flen)) return i;
+        i = (i + 1) & mask;
+    }
+    return -1;
+}
+
+/*
+ * lp中偏移量off之后的数据移动了delta个字节，记录这次移动，
+ * 记录已满时先将所有记录应用到索引中，每PACKHASH_MAX_SHIFTS次移动才遍历一次所有的槽
+ */
+static void phShiftOffsets(packhash* ph, uint32_t off, long delta) {
+    uint32_t i;
+
+    if (delta == 0) return;
+
+    if (ph->shifts == NULL) ph->shifts = zmalloc(PACKHASH_MAX_SHIFTS * sizeof(packhashShift));
+
+    if (ph->nshifts == PACKHASH_MAX_SHIFTS) {
+        for (i = 0; i < ph->size; i++) {
+            if (ph->slots[i] != 0) ph->slots[i] = phResolve(ph, ph->slots[i]);
+        }
+        ph->nshifts = 0;
+    }
+
+    ph->shifts[ph->nshifts].off = off;
+    ph->shifts[ph->nshifts].delta = delta;
+    ph->nshifts++;
+}
+
+/*
+ * 用listpack编码的哈希对象创建packhash，packhash接管lp
+ */
+packhash* packhashFromListpack(unsigned char* lp) {
+    packhash* ph = zmalloc(sizeof(packhash));
+
+    ph->lp = lp;
+    ph->slots = NULL;
+    ph->shifts = NULL;
+    ph->count = lpLength(lp) / 2;
+    phRebuild(ph, phSizeFor(ph->count));
+    return ph;
+}
+
+/*
+ * 释放packhash
+ */
+void packhashFree(packhash* ph) {
+    zfree(ph->lp);
+    zfree(ph->slots);
+    zfree(ph->shifts);
+    zfree(ph);
+}
+
+/*
+ * 返回field在lp中的位置，value是它之后的一个元素，找不到时返回NULL
+ */
+unsigned char* packhashFind(packhash* ph, unsigned char* field, unsigned int flen) {
+    long i = phLookup(ph, field, flen, dictGenHashFunction(field, flen));
+
+    return (i < 0) ? NULL : ph->lp + phResolve(ph, ph->slots[i]);
+}
+
+/*
+ * 设置field的值，field已存在时原地替换value并返回1，新增时添加到lp表尾并返回0
+ */
+int packhashSet(packhash* ph, unsigned char* field, unsigned int flen, unsigned char* value, unsigned int vlen) {
+    unsigned int h = dictGenHashFunction(field, flen);
+    long i = phLookup(ph, field, flen, h);
+
+    if (i >= 0) {
+        unsigned char* vptr = lpNext(ph->lp, ph->lp + phResolve(ph, ph->slots[i]));
+        uint32_t voff = vptr - ph->lp;
+        size_t oldbytes = lpBytes(ph->lp);
+
+        ph->lp = lpReplace(ph->lp, &vptr, value, vlen);
+        phShiftOffsets(ph, voff, (long) lpBytes(ph->lp) - (long) oldbytes);
+        return 1;
+    } else {
+        // 新的field位于原来的表尾结束符处，之前元素的偏移量不变
+        uint32_t foff = lpBytes(ph->lp) - 1;
+        uint32_t mask;
+
+        ph->lp = lpPush(ph->lp, field, flen, LP_TAIL);
+        ph->lp = lpPush(ph->lp, value, vlen, LP_TAIL);
+        ph->count++;
+
+        if (ph->count > ph->size / 4 * 3) {
+            phRebuild(ph, ph->size * 2);
+            return 0;
+        }
+
+        mask = ph->size - 1;
+        i = h & mask;
+        while (ph->slots[i] != 0) i = (i + 1) & mask;
+        ph->slots[i] = phUnresolve(ph, foff);
+        ph->tags[i] = PACKHASH_TAG(h);
+        return 0;
+    }
+}
+
+/*
+ * 删除field及其value，删除成功返回1
+ */
+int packhashDelete(packhash* ph, unsigned char* field, unsigned int flen) {
+    long i = phLookup(ph, field, flen, dictGenHashFunction(field, flen));
+    uint32_t mask = ph->size - 1;
+    uint32_t off, hole, j;
+    unsigned char* p;
+    size_t oldbytes;
+
+    if (i < 0) return 0;
+
+    off = phResolve(ph, ph->slots[i]);
+    p = ph->lp + off;
+    oldbytes = lpBytes(ph->lp);
+    ph->lp = lpDelete(ph->lp, &p);
+    ph->lp = lpDelete(ph->lp, &p);
+    ph->count--;
+
+    hole = i;
+    ph->slots[hole] = 0;
+    phShiftOffsets(ph, off, (long) lpBytes(ph->lp) - (long) oldbytes);
+
+    // 线性探测的删除: 将后续探测链上可以前移的槽依次前移，避免使用墓碑
+    j = hole;
+    while (1) {
+        uint32_t home;
+
+        j = (j + 1) & mask;
+        if (ph->slots[j] == 0) break;
+
+        home = phEntryHash(ph->lp + phResolve(ph, ph->slots[j])) & mask;
+
+        // home不在(hole, j]之间时，槽j可以移动到空出的槽hole
+        if ((hole <= j) ? (home <= hole || home > j) : (home <= hole && home > j)) {
+            ph->slots[hole] = ph->slots[j];
+            ph->tags[hole] = ph->tags[j];
+            ph->slots[j] = 0;
+            hole = j;
+        }
+    }
+
+    // 键值对数量远小于槽数量时收缩索引
+    if (ph->size > PACKHASH_MIN_SIZE && ph->count < ph->size / 8)
+        phRebuild(ph, phSizeFor(ph->count));
+
+    return 1;
+}
+
+/*
+ * 返回键值对数量
+ */
+unsigned long packhashLength(packhash* ph) {
+    return ph->count;
+}
+
+/*
+ * 返回packhash占用的字节数
+ */
+size_t packhashBytes(packhash* ph) {
+    return sizeof(packhash) + lpBytes(ph->lp) + ph->size * (sizeof(uint32_t) + 1) +
+           (ph->shifts ? PACKHASH_MAX_SHIFTS * sizeof(packhashShift) : 0);
+}
@@ -0,0 +1,68 @@
+//
+// Created by zouyi on 2021/11/9.
+//
+
+#ifndef TINYREDIS_PACKHASH_H
+#define TINYREDIS_PACKHASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * 带索引的紧凑哈希，用于中等大小(几百到上万个键值对)的哈希类型对象
+ *
+ * 键值对和listpack编码一样紧凑地保存在lp中(field, value交替)，
+ * 另外维护一个线性探测的开放寻址索引，每个槽保存field在lp中的字节偏移量和field哈希值的高8位(tag)，
+ * 查找时先比较tag，tag相同才读取lp中的field比较，因此查找接近字典的速度，内存接近listpack；
+ *
+ * 修改value的长度或者删除键值对会移动之后的数据，这些移动先记录在shifts中，
+ * 读取槽时再依次应用，记录满PACKHASH_MAX_SHIFTS个之后才一次性修正所有的槽
+ */
+#define PACKHASH_MAX_SHIFTS 64
+
+/*
+ * 一次尚未应用到索引的移动: lp中偏移量大于off的数据移动了delta个字节
+ */
+typedef struct packhashShift {
+
+    uint32_t off;
+
+    int32_t delta;
+
+} packhashShift;
+
+typedef struct packhash {
+
+    // field, value交替保存的listpack
+    unsigned char* lp;
+
+    // 索引槽，保存field在lp中的偏移量，0表示空槽(listpack头部之后的偏移量不会为0)，
+    // 偏移量是应用shifts之前的值
+    uint32_t* slots;
+
+    // 每个槽对应field哈希值的高8位，和slots在同一块内存中
+    unsigned char* tags;
+
+    // 槽数量，总是2的幂
+    uint32_t size;
+
+    // 键值对数量
+    uint32_t count;
+
+    // 按发生顺序排列的尚未应用的移动，第一次需要时分配PACKHASH_MAX_SHIFTS个
+    packhashShift* shifts;
+
+    // shifts中的移动数量
+    uint32_t nshifts;
+
+} packhash;
+
+packhash* packhashFromListpack(unsigned char* lp);
+void packhashFree(packhash* ph);
+unsigned char* packhashFind(packhash* ph, unsigned char* field, unsigned int flen);
+int packhashSet(packhash* ph, unsigned char* field, unsigned int flen, unsigned char* value, unsigned int vlen);
+int packhashDelete(packhash* ph, unsigned char* field, unsigned int flen);
+unsigned long packhashLength(packhash* ph);
+size_t packhashBytes(packhash* ph);
+
+#endif //TINYREDIS_PACKHASH_H
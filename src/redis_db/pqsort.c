@@ -0,0 +1,96 @@
+//
+// Created by zouyi on 2021/11/14.
+//
+
+#include "pqsort.h"
+
+/*
+ * 交换a和b指向的两个元素，每个元素es字节
+ */
+static inline void pqswap(char* a, char* b, size_t es) {
+    char t;
+
+    if (a == b) return;
+    while (es--) {
+        t = *a;
+        *a++ = *b;
+        *b++ = t;
+    }
+}
+
+/*
+ * 三个元素中值的地址
+ */
+static inline char* med3(char* a, char* b, char* c, int (*cmp)(const void*, const void*)) {
+    return cmp(a, b) < 0 ?
+           (cmp(b, c) < 0 ? b : (cmp(a, c) < 0 ? c : a)) :
+           (cmp(b, c) > 0 ? b : (cmp(a, c) < 0 ? a : c));
+}
+
+/*
+ * 对从lo开始的n个元素做部分排序，lrange和rrange是需要排好序的范围的首尾元素的地址
+ */
+static void _pqsort(char* lo, size_t n, size_t es, int (*cmp)(const void*, const void*), char* lrange, char* rrange) {
+    char* hi;
+    char* lt;
+    char* gt;
+    char* i;
+    char* j;
+    int r;
+
+    while (n > 7) {
+        hi = lo + (n - 1) * es;
+
+        // 三数取中作为枢纽，放到第一个位置
+        pqswap(lo, med3(lo, lo + (n / 2) * es, hi, cmp), es);
+
+        // 三路划分: [lo, lt)小于枢纽，[lt, gt]等于枢纽，(gt, hi]大于枢纽，
+        // lt始终指向一个等于枢纽的元素，重复元素很多时也不会退化
+        lt = lo;
+        i = lo + es;
+        gt = hi;
+        while (i <= gt) {
+            r = cmp(i, lt);
+            if (r < 0) {
+                pqswap(lt, i, es);
+                lt += es;
+                i += es;
+            } else if (r > 0) {
+                pqswap(i, gt, es);
+                gt -= es;
+            } else {
+                i += es;
+            }
+        }
+
+        // 只处理与[lrange, rrange]有交集的一边，两边都需要时递归处理较小的一边，循环处理较大的一边
+        if (lt > lrange && lo <= rrange) {
+            if (gt < rrange && hi >= lrange && (size_t) (lt - lo) > (size_t) (hi - gt)) {
+                _pqsort(gt + es, (hi - gt) / es, es, cmp, lrange, rrange);
+                n = (lt - lo) / es;
+            } else {
+                if (gt < rrange && hi >= lrange) {
+                    _pqsort(lo, (lt - lo) / es, es, cmp, lrange, rrange);
+                    lo = gt + es;
+                    n = (hi - gt) / es;
+                } else {
+                    n = (lt - lo) / es;
+                }
+            }
+        } else if (gt < rrange && hi >= lrange) {
+            lo = gt + es;
+            n = (hi - gt) / es;
+        } else {
+            return;
+        }
+    }
+
+    // 元素很少时使用插入排序
+    for (i = lo + es; i < lo + n * es; i += es)
+        for (j = i; j > lo && cmp(j - es, j) > 0; j -= es)
+            pqswap(j, j - es, es);
+}
+
+void pqsort(void* a, size_t n, size_t es, int (*cmp)(const void*, const void*), size_t lrange, size_t rrange) {
+    _pqsort((char*) a, n, es, cmp, (char*) a + lrange * es, (char*) a + rrange * es);
+}
@@ -0,0 +1,16 @@
+//
+// Created by zouyi on 2021/11/14.
+//
+
+#ifndef TINYREDIS_PQSORT_H
+#define TINYREDIS_PQSORT_H
+
+#include <stddef.h>
+
+/*
+ * 部分排序，参数与qsort相同，只保证下标在[lrange, rrange]之间的元素被放到排序后的位置，
+ * 划分之后完全落在范围之外的一边不再递归，只需要前几个元素时比完整排序少做很多比较
+ */
+void pqsort(void* a, size_t n, size_t es, int (*cmp)(const void*, const void*), size_t lrange, size_t rrange);
+
+#endif //TINYREDIS_PQSORT_H
@@ -0,0 +1,932 @@
+//
+// Created by zouyi on 2021/11/6.
+//
+
+#include <string.h>
+#include <assert.h>
+#include "zmalloc.h"
+#include "utils.h"
+#include "ziplist.h"
+#include "adlist.h"
+#include "quicklist.h"
+#include "lzf.h"
+
+/*
+ * fill为负数时，每个节点的压缩列表最多占用的字节数
+ */
+static const size_t optimization_level[] = {4096, 8192, 16384, 32768, 65536};
+
+/*
+ * fill为正数时，即使元素数量没有达到限制，节点也不能超过这个大小
+ */
+#define SIZE_SAFETY_LIMIT 8192
+
+/*
+ * 估算插入一个元素时压缩列表增加的字节数: previous_entry_length + encoding + content
+ */
+static size_t _quicklistEntryOverhead(size_t sz) {
+    size_t overhead = (sz < 254) ? 1 : 5;
+    if (sz < 64) overhead += 1;
+    else if (sz < 16384) overhead += 2;
+    else overhead += 5;
+    return sz + overhead;
+}
+
+/*
+ * 判断大小为sz的压缩列表是否满足节点大小限制
+ */
+static int _quicklistNodeSizeMeetsRequirement(size_t sz, int fill) {
+    if (fill >= 0) return sz <= SIZE_SAFETY_LIMIT;
+    return sz <= optimization_level[(-fill) - 1];
+}
+
+/*
+ * 判断节点是否还能插入一个长度为sz的元素
+ */
+static int _quicklistNodeAllowInsert(const quicklistNode* node, int fill, size_t sz) {
+    size_t new_sz;
+
+    if (node == NULL) return 0;
+
+    new_sz = node->sz + _quicklistEntryOverhead(sz);
+    if (!_quicklistNodeSizeMeetsRequirement(new_sz, fill)) return 0;
+    if (fill >= 0 && node->count >= (unsigned int) fill) return 0;
+    return 1;
+}
+
+/*
+ * 判断两个相邻节点合并之后是否仍然满足节点大小限制
+ */
+static int _quicklistNodeAllowMerge(const quicklistNode* a, const quicklistNode* b, int fill) {
+    // 两个压缩列表各有11字节的表头和表尾，合并之后只保留一份
+    size_t merge_sz;
+
+    if (!a || !b) return 0;
+
+    merge_sz = a->sz + b->sz - 11;
+    if (!_quicklistNodeSizeMeetsRequirement(merge_sz, fill)) return 0;
+    if (fill >= 0 && a->count + b->count > (unsigned int) fill) return 0;
+    return 1;
+}
+
+static quicklistNode* quicklistCreateNode(void) {
+    quicklistNode* node = zmalloc(sizeof(*node));
+    node->prev = node->next = NULL;
+    node->zl = NULL;
+    node->sz = 0;
+    node->count = 0;
+    node->encoding = QUICKLIST_NODE_ENCODING_RAW;
+    node->recompress = 0;
+    return node;
+}
+
+/*
+ * 更新节点的大小，只能在节点未被压缩时调用
+ */
+static void quicklistNodeUpdateSz(quicklistNode* node) {
+    node->sz = ziplistBlobLen(node->zl);
+}
+
+/*
+ * 小于这个大小的压缩列表不压缩
+ */
+#define MIN_COMPRESS_BYTES 48
+
+/*
+ * 压缩后至少要节省这么多字节，否则放弃压缩
+ */
+#define MIN_COMPRESS_IMPROVE 8
+
+/*
+ * 压缩统计，快速列表可能在bio线程中被释放，所以统计使用原子操作更新
+ */
+static quicklistStats stats;
+
+/*
+ * 使用LZF压缩节点的压缩列表，压缩成功返回1
+ */
+static int __quicklistCompressNode(quicklistNode* node) {
+    quicklistLZF* lzf;
+
+    node->recompress = 0;
+    if (node->sz < MIN_COMPRESS_BYTES) return 0;
+
+    lzf = zmalloc(sizeof(*lzf) + node->sz);
+    lzf->sz = lzf_compress(node->zl, node->sz, lzf->compressed, node->sz);
+    if (lzf->sz == 0 || lzf->sz + MIN_COMPRESS_IMPROVE >= node->sz) {
+        zfree(lzf);
+        __sync_add_and_fetch(&stats.compress_failures, 1);
+        return 0;
+    }
+    lzf = zrealloc(lzf, sizeof(*lzf) + lzf->sz);
+
+    __sync_add_and_fetch(&stats.compressions, 1);
+    __sync_add_and_fetch(&stats.compressed_nodes, 1);
+    __sync_add_and_fetch(&stats.compressed_raw_bytes, node->sz);
+    __sync_add_and_fetch(&stats.compressed_bytes, lzf->sz);
+
+    zfree(node->zl);
+    node->zl = (unsigned char*) lzf;
+    node->encoding = QUICKLIST_NODE_ENCODING_LZF;
+    return 1;
+}
+
+/*
+ * 从压缩的统计中扣除一个被压缩的节点
+ */
+static void quicklistStatsRemoveCompressed(const quicklistNode* node) {
+    quicklistLZF* lzf = (quicklistLZF*) node->zl;
+
+    __sync_sub_and_fetch(&stats.compressed_nodes, 1);
+    __sync_sub_and_fetch(&stats.compressed_raw_bytes, node->sz);
+    __sync_sub_and_fetch(&stats.compressed_bytes, lzf->sz);
+}
+
+/*
+ * 解压节点的压缩列表，成功返回1
+ */
+static int __quicklistDecompressNode(quicklistNode* node) {
+    quicklistLZF* lzf = (quicklistLZF*) node->zl;
+    unsigned char* zl = zmalloc(node->sz);
+
+    if (lzf_decompress(lzf->compressed, lzf->sz, zl, node->sz) == 0) {
+        zfree(zl);
+        return 0;
+    }
+
+    __sync_add_and_fetch(&stats.decompressions, 1);
+    quicklistStatsRemoveCompressed(node);
+
+    zfree(lzf);
+    node->zl = zl;
+    node->encoding = QUICKLIST_NODE_ENCODING_RAW;
+    return 1;
+}
+
+#define quicklistCompressNode(_node) do { \
+    if ((_node) && (_node)->encoding == QUICKLIST_NODE_ENCODING_RAW) \
+        __quicklistCompressNode(_node); \
+} while (0)
+
+#define quicklistDecompressNode(_node) do { \
+    if ((_node) && (_node)->encoding == QUICKLIST_NODE_ENCODING_LZF) \
+        __quicklistDecompressNode(_node); \
+} while (0)
+
+/*
+ * 为了读取或修改而临时解压节点，使用完之后调用quicklistRecompressOnly重新压缩
+ */
+#define quicklistDecompressNodeForUse(_node) do { \
+    if ((_node) && (_node)->encoding == QUICKLIST_NODE_ENCODING_LZF) { \
+        __quicklistDecompressNode(_node); \
+        (_node)->recompress = 1; \
+    } \
+} while (0)
+
+#define quicklistRecompressOnly(_node) do { \
+    if ((_node) && (_node)->recompress) quicklistCompressNode(_node); \
+} while (0)
+
+/*
+ * 保持两端各compress个节点不被压缩，并压缩刚好超出这个深度的两个节点，
+ * node不在两端的深度之内时也压缩node
+ *
+ * 快速列表插入或删除节点之后调用，只检查O(compress)个节点，
+ * 节点从深度之外移动到深度之内时在这里被解压
+ */
+static void __quicklistCompress(const quicklist* ql, quicklistNode* node) {
+    quicklistNode* forward = ql->head;
+    quicklistNode* reverse = ql->tail;
+    unsigned int depth = 0;
+    int in_depth = 0;
+
+    if (ql->compress == 0 || ql->len == 0) return;
+
+    while (depth++ < ql->compress) {
+        quicklistDecompressNode(forward);
+        quicklistDecompressNode(reverse);
+        forward->recompress = 0;
+        reverse->recompress = 0;
+
+        if (forward == node || reverse == node) in_depth = 1;
+
+        // 两端的深度已经覆盖了所有节点
+        if (forward == reverse || forward->next == reverse) return;
+
+        forward = forward->next;
+        reverse = reverse->prev;
+    }
+
+    if (node && !in_depth) quicklistCompressNode(node);
+
+    // forward和reverse是刚好超出深度的节点
+    quicklistCompressNode(forward);
+    quicklistCompressNode(reverse);
+}
+
+/*
+ * 释放节点
+ */
+static void quicklistFreeNode(quicklistNode* node) {
+    if (node->encoding == QUICKLIST_NODE_ENCODING_LZF) quicklistStatsRemoveCompressed(node);
+    zfree(node->zl);
+    zfree(node);
+}
+
+/*
+ * 返回节点的压缩列表(或压缩后的数据)实际占用的字节数
+ */
+size_t quicklistNodeAllocSize(const quicklistNode* node) {
+    if (node->encoding == QUICKLIST_NODE_ENCODING_LZF)
+        return sizeof(quicklistLZF) + ((quicklistLZF*) node->zl)->sz;
+    return node->sz;
+}
+
+/*
+ * 返回所有快速列表的压缩统计
+ */
+void quicklistGetStats(quicklistStats* st) {
+    st->compressed_nodes = __sync_add_and_fetch(&stats.compressed_nodes, 0);
+    st->compressed_raw_bytes = __sync_add_and_fetch(&stats.compressed_raw_bytes, 0);
+    st->compressed_bytes = __sync_add_and_fetch(&stats.compressed_bytes, 0);
+    st->compressions = __sync_add_and_fetch(&stats.compressions, 0);
+    st->decompressions = __sync_add_and_fetch(&stats.decompressions, 0);
+    st->compress_failures = __sync_add_and_fetch(&stats.compress_failures, 0);
+}
+
+/*
+ * 创建一个空的快速列表，每个节点最多占用8KB
+ */
+quicklist* quicklistCreate(void) {
+    return quicklistNew(-2, 0);
+}
+
+quicklist* quicklistNew(int fill, int compress) {
+    quicklist* ql = zmalloc(sizeof(*ql));
+    ql->head = ql->tail = NULL;
+    ql->count = 0;
+    ql->len = 0;
+    quicklistSetFill(ql, fill);
+    quicklistSetCompressDepth(ql, compress);
+    return ql;
+}
+
+/*
+ * 设置压缩深度，只应该在快速列表为空时设置
+ */
+void quicklistSetCompressDepth(quicklist* ql, int compress) {
+    if (compress > QUICKLIST_COMPRESS_MAX) compress = QUICKLIST_COMPRESS_MAX;
+    else if (compress < 0) compress = 0;
+    ql->compress = compress;
+}
+
+void quicklistSetFill(quicklist* ql, int fill) {
+    if (fill > QUICKLIST_FILL_MAX) fill = QUICKLIST_FILL_MAX;
+    else if (fill < QUICKLIST_FILL_MIN) fill = QUICKLIST_FILL_MIN;
+    else if (fill == 0) fill = -2;
+    ql->fill = fill;
+}
+
+/*
+ * 根据压缩列表zl创建快速列表，zl会被释放
+ */
+quicklist* quicklistCreateFromZiplist(int fill, int compress, unsigned char* zl) {
+    quicklist* ql = quicklistNew(fill, compress);
+    unsigned char* p = ziplistIndex(zl, 0);
+    unsigned char* vstr;
+    unsigned int vlen;
+    long long vlong;
+    char buf[32];
+
+    while (p) {
+        if (ziplistGet(p, &vstr, &vlen, &vlong)) {
+            if (!vstr) {
+                vlen = ll2string(buf, sizeof(buf), vlong);
+                vstr = (unsigned char*) buf;
+            }
+            quicklistPushTail(ql, vstr, vlen);
+        }
+        p = ziplistNext(zl, p);
+    }
+    zfree(zl);
+    return ql;
+}
+
+/*
+ * 释放整个快速列表
+ */
+void quicklistRelease(quicklist* ql) {
+    quicklistNode* current = ql->head;
+    quicklistNode* next;
+
+    while (current) {
+        next = current->next;
+        quicklistFreeNode(current);
+        current = next;
+    }
+    zfree(ql);
+}
+
+unsigned long quicklistCount(const quicklist* ql) {
+    return ql->count;
+}
+
+/*
+ * 将新节点new_node插入到old_node之后(after为1)或之前(after为0)，
+ * old_node为NULL时快速列表必须为空
+ */
+static void __quicklistInsertNode(quicklist* ql, quicklistNode* old_node,
+                                  quicklistNode* new_node, int after) {
+    if (after) {
+        new_node->prev = old_node;
+        if (old_node) {
+            new_node->next = old_node->next;
+            if (old_node->next) old_node->next->prev = new_node;
+            old_node->next = new_node;
+        }
+        if (ql->tail == old_node) ql->tail = new_node;
+    } else {
+        new_node->next = old_node;
+        if (old_node) {
+            new_node->prev = old_node->prev;
+            if (old_node->prev) old_node->prev->next = new_node;
+            old_node->prev = new_node;
+        }
+        if (ql->head == old_node) ql->head = new_node;
+    }
+    if (ql->len == 0) ql->head = ql->tail = new_node;
+    ql->len++;
+
+    __quicklistCompress(ql, new_node);
+}
+
+/*
+ * 从快速列表中删除节点并释放它
+ */
+static void __quicklistDelNode(quicklist* ql, quicklistNode* node) {
+    if (node->next) node->next->prev = node->prev;
+    if (node->prev) node->prev->next = node->next;
+    if (node == ql->tail) ql->tail = node->prev;
+    if (node == ql->head) ql->head = node->next;
+
+    ql->len--;
+    ql->count -= node->count;
+
+    quicklistFreeNode(node);
+
+    // 删除节点之后，原来在深度之外的节点可能进入深度之内
+    __quicklistCompress(ql, NULL);
+}
+
+/*
+ * 将节点b的元素追加到节点a之后，释放节点b，返回a
+ */
+static quicklistNode* _quicklistMergeNodes(quicklist* ql, quicklistNode* a, quicklistNode* b) {
+    unsigned char* p;
+    unsigned char* vstr;
+    unsigned int vlen;
+    long long vlong;
+    char buf[32];
+
+    quicklistDecompressNodeForUse(a);
+    quicklistDecompressNodeForUse(b);
+
+    p = ziplistIndex(b->zl, 0);
+    while (p) {
+        ziplistGet(p, &vstr, &vlen, &vlong);
+        if (!vstr) {
+            vlen = ll2string(buf, sizeof(buf), vlong);
+            vstr = (unsigned char*) buf;
+        }
+        a->zl = ziplistPush(a->zl, vstr, vlen, ZIPLIST_TAIL);
+        p = ziplistNext(b->zl, p);
+    }
+    a->count += b->count;
+    quicklistNodeUpdateSz(a);
+
+    // __quicklistDelNode会减去b的元素数量，这些元素已经转移到a
+    ql->count += b->count;
+    __quicklistDelNode(ql, b);
+    quicklistRecompressOnly(a);
+    return a;
+}
+
+/*
+ * 节点删除元素之后，如果与相邻节点合并后仍满足大小限制，就合并它们，
+ * 避免反复删除之后留下大量稀疏的小节点
+ *
+ * 返回合并后的节点(合并前位于左边的节点)，*right为被并入并释放的节点，*shift为被并入节点的元素在合并后节点中的起始索引，
+ * 没有发生合并时返回NULL
+ */
+static quicklistNode* _quicklistMergeAfterDelete(quicklist* ql, quicklistNode* node,
+                                                 quicklistNode** right, long* shift) {
+    quicklistNode* a = NULL;
+    quicklistNode* b = NULL;
+
+    if (_quicklistNodeAllowMerge(node->prev, node, ql->fill)) {
+        a = node->prev;
+        b = node;
+    } else if (_quicklistNodeAllowMerge(node, node->next, ql->fill)) {
+        a = node;
+        b = node->next;
+    } else {
+        return NULL;
+    }
+
+    *right = b;
+    *shift = a->count;
+    return _quicklistMergeNodes(ql, a, b);
+}
+
+/*
+ * 找到索引index处的元素所在的节点以及它在节点中的索引，index可以为负数，索引越界时返回0
+ *
+ * 根据索引的正负从表头或表尾开始，按节点的元素数量跳过整个节点，不需要访问(解压)压缩列表
+ */
+static int _quicklistLocate(const quicklist* ql, long long index, quicklistNode** node, int* offset) {
+    quicklistNode* n;
+    unsigned long long accum = 0;
+    unsigned long long idx;
+    int forward = index < 0 ? 0 : 1;
+
+    idx = forward ? index : (-index) - 1;
+    if (idx >= ql->count) return 0;
+
+    n = forward ? ql->head : ql->tail;
+    while (n) {
+        if (accum + n->count > idx) break;
+        accum += n->count;
+        n = forward ? n->next : n->prev;
+    }
+    if (!n) return 0;
+
+    *node = n;
+    if (forward) {
+        *offset = idx - accum;
+    } else {
+        *offset = n->count - 1 - (idx - accum);
+    }
+    return 1;
+}
+
+/*
+ * 将元素添加到表头，创建了新节点时返回1，否则返回0
+ */
+int quicklistPushHead(quicklist* ql, void* value, size_t sz) {
+    quicklistNode* orig_head = ql->head;
+
+    // 两端的节点总是不压缩的
+    quicklistDecompressNode(ql->head);
+    if (_quicklistNodeAllowInsert(ql->head, ql->fill, sz)) {
+        ql->head->zl = ziplistPush(ql->head->zl, value, sz, ZIPLIST_HEAD);
+        quicklistNodeUpdateSz(ql->head);
+    } else {
+        quicklistNode* node = quicklistCreateNode();
+        node->zl = ziplistPush(ziplistNew(), value, sz, ZIPLIST_HEAD);
+        quicklistNodeUpdateSz(node);
+        __quicklistInsertNode(ql, ql->head, node, 0);
+    }
+    ql->count++;
+    ql->head->count++;
+    return (orig_head != ql->head);
+}
+
+/*
+ * 将元素添加到表尾，创建了新节点时返回1，否则返回0
+ */
+int quicklistPushTail(quicklist* ql, void* value, size_t sz) {
+    quicklistNode* orig_tail = ql->tail;
+
+    quicklistDecompressNode(ql->tail);
+    if (_quicklistNodeAllowInsert(ql->tail, ql->fill, sz)) {
+        ql->tail->zl = ziplistPush(ql->tail->zl, value, sz, ZIPLIST_TAIL);
+        quicklistNodeUpdateSz(ql->tail);
+    } else {
+        quicklistNode* node = quicklistCreateNode();
+        node->zl = ziplistPush(ziplistNew(), value, sz, ZIPLIST_TAIL);
+        quicklistNodeUpdateSz(node);
+        __quicklistInsertNode(ql, ql->tail, node, 1);
+    }
+    ql->count++;
+    ql->tail->count++;
+    return (orig_tail != ql->tail);
+}
+
+void quicklistPush(quicklist* ql, void* value, size_t sz, int where) {
+    if (where == QUICKLIST_HEAD) {
+        quicklistPushHead(ql, value, sz);
+    } else {
+        quicklistPushTail(ql, value, sz);
+    }
+}
+
+/*
+ * 删除节点node中p指向的元素，节点必须未被压缩，节点变空时删除节点，
+ * 删除节点时返回1，否则返回0，*p更新为被删除元素之后的元素
+ */
+static int quicklistDelIndex(quicklist* ql, quicklistNode* node, unsigned char** p) {
+    int gone = 0;
+
+    node->zl = ziplistDelete(node->zl, p);
+    node->count--;
+    if (node->count == 0) {
+        gone = 1;
+        __quicklistDelNode(ql, node);
+    } else {
+        quicklistNodeUpdateSz(node);
+    }
+    // __quicklistDelNode已经减去了节点剩余的元素数量(为0)，这里减去被删除的元素
+    ql->count--;
+    return gone;
+}
+
+/*
+ * 删除迭代器刚刚返回的元素entry，并调整迭代器，使得下一次quicklistNext返回
+ * 被删除元素的下一个元素
+ */
+void quicklistDelEntry(quicklistIter* iter, quicklistEntry* entry) {
+    quicklistNode* prev = entry->node->prev;
+    quicklistNode* next = entry->node->next;
+    quicklistNode* node = entry->node;
+    quicklistNode* merged;
+    quicklistNode* right;
+    long shift;
+    int forward = (iter->direction == AL_START_HEAD);
+
+    if (quicklistDelIndex(iter->quicklist, node, &entry->zi)) {
+        // 节点已被删除，从相邻节点继续迭代
+        if (iter->decompressed == node) iter->decompressed = NULL;
+        iter->current = forward ? next : prev;
+        iter->offset = forward ? 0 : -1;
+        iter->zi = NULL;
+        return;
+    }
+
+    // 被删除元素之后的元素前移了一位
+    iter->current = node;
+    iter->offset = forward ? entry->offset : entry->offset - 1;
+    iter->zi = NULL;
+    if (forward && iter->offset >= (long) node->count) {
+        iter->current = next;
+        iter->offset = 0;
+    } else if (!forward && iter->offset < 0) {
+        iter->current = prev;
+        iter->offset = -1;
+    }
+
+    // 合并相邻的节点，并把迭代器的位置映射到合并后的节点
+    merged = _quicklistMergeAfterDelete(iter->quicklist, node, &right, &shift);
+    if (merged && iter->decompressed == right) iter->decompressed = NULL;
+    if (merged && iter->current == right) {
+        iter->current = merged;
+        if (iter->offset >= 0) iter->offset += shift;
+    } else if (merged && iter->current == merged && iter->offset < 0) {
+        // 反向迭代时-1表示左边节点原来的最后一个元素
+        iter->offset = shift - 1;
+    }
+}
+
+/*
+ * 从表头或表尾弹出一个元素
+ *
+ * 字符串值通过saver复制后保存在*data中，整数值保存在*sval中，
+ * 快速列表为空时返回0
+ */
+int quicklistPopCustom(quicklist* ql, int where, unsigned char** data, unsigned int* sz,
+                       long long* sval, void* (*saver)(unsigned char* data, unsigned int sz)) {
+    quicklistNode* node;
+    unsigned char* p;
+    unsigned char* vstr;
+    unsigned int vlen;
+    long long vlong;
+    int pos = (where == QUICKLIST_HEAD) ? 0 : -1;
+
+    if (ql->count == 0) return 0;
+
+    if (data) *data = NULL;
+    if (sz) *sz = 0;
+    if (sval) *sval = -123456789;
+
+    node = (where == QUICKLIST_HEAD) ? ql->head : ql->tail;
+    quicklistDecompressNode(node);
+    p = ziplistIndex(node->zl, pos);
+    if (ziplistGet(p, &vstr, &vlen, &vlong)) {
+        if (vstr) {
+            if (data) *data = saver(vstr, vlen);
+            if (sz) *sz = vlen;
+        } else {
+            if (sval) *sval = vlong;
+        }
+        quicklistDelIndex(ql, node, &p);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * 将节点node从索引offset处分裂为两个节点，节点必须未被压缩，
+ * [0, offset)留在node中，[offset, count)移到新节点，新节点插入到node之后
+ */
+static quicklistNode* _quicklistSplitNode(quicklist* ql, quicklistNode* node, int offset) {
+    quicklistNode* new_node = quicklistCreateNode();
+    size_t zl_sz = node->sz;
+
+    new_node->zl = zmalloc(zl_sz);
+    memcpy(new_node->zl, node->zl, zl_sz);
+
+    node->zl = ziplistDeleteRange(node->zl, offset, node->count - offset);
+    new_node->zl = ziplistDeleteRange(new_node->zl, 0, offset);
+    new_node->count = node->count - offset;
+    node->count = offset;
+    quicklistNodeUpdateSz(node);
+    quicklistNodeUpdateSz(new_node);
+
+    __quicklistInsertNode(ql, node, new_node, 1);
+    return new_node;
+}
+
+/*
+ * 在entry之前或之后插入元素
+ *
+ * 节点还有空间时直接插入，否则尝试插入到相邻节点的一端，
+ * 都不行时在插入位置分裂节点
+ *
+ * entry所在的节点由迭代器解压，相邻节点和分裂后的节点可能被压缩，使用前需要解压
+ */
+static void _quicklistInsert(quicklist* ql, quicklistEntry* entry, void* value, size_t sz, int after) {
+    quicklistNode* node = entry->node;
+    quicklistNode* new_node;
+    int fill = ql->fill;
+    int at_tail = after && entry->offset == (int) node->count - 1;
+    int at_head = !after && entry->offset == 0;
+
+    if (_quicklistNodeAllowInsert(node, fill, sz)) {
+        if (after) {
+            unsigned char* next = ziplistNext(node->zl, entry->zi);
+            if (next == NULL) {
+                node->zl = ziplistPush(node->zl, value, sz, ZIPLIST_TAIL);
+            } else {
+                node->zl = ziplistInsert(node->zl, next, value, sz);
+            }
+        } else {
+            node->zl = ziplistInsert(node->zl, entry->zi, value, sz);
+        }
+        node->count++;
+        quicklistNodeUpdateSz(node);
+    } else if (at_tail && _quicklistNodeAllowInsert(node->next, fill, sz)) {
+        new_node = node->next;
+        quicklistDecompressNodeForUse(new_node);
+        new_node->zl = ziplistPush(new_node->zl, value, sz, ZIPLIST_HEAD);
+        new_node->count++;
+        quicklistNodeUpdateSz(new_node);
+        quicklistRecompressOnly(new_node);
+    } else if (at_head && _quicklistNodeAllowInsert(node->prev, fill, sz)) {
+        new_node = node->prev;
+        quicklistDecompressNodeForUse(new_node);
+        new_node->zl = ziplistPush(new_node->zl, value, sz, ZIPLIST_TAIL);
+        new_node->count++;
+        quicklistNodeUpdateSz(new_node);
+        quicklistRecompressOnly(new_node);
+    } else if (at_tail || at_head) {
+        // 在节点的一端插入，并且相邻节点已满，创建一个新节点
+        new_node = quicklistCreateNode();
+        new_node->zl = ziplistPush(ziplistNew(), value, sz, ZIPLIST_HEAD);
+        new_node->count = 1;
+        quicklistNodeUpdateSz(new_node);
+        __quicklistInsertNode(ql, node, new_node, after);
+    } else {
+        // 在已满节点的中间插入，分裂节点，新元素放到分裂后的左半部分的末尾
+        int split = after ? entry->offset + 1 : entry->offset;
+        _quicklistSplitNode(ql, node, split);
+        if (_quicklistNodeAllowInsert(node, fill, sz)) {
+            quicklistDecompressNodeForUse(node);
+            node->zl = ziplistPush(node->zl, value, sz, ZIPLIST_TAIL);
+            node->count++;
+            quicklistNodeUpdateSz(node);
+            quicklistRecompressOnly(node);
+        } else {
+            new_node = quicklistCreateNode();
+            new_node->zl = ziplistPush(ziplistNew(), value, sz, ZIPLIST_HEAD);
+            new_node->count = 1;
+            quicklistNodeUpdateSz(new_node);
+            __quicklistInsertNode(ql, node, new_node, 1);
+        }
+    }
+    ql->count++;
+}
+
+void quicklistInsertBefore(quicklist* ql, quicklistEntry* entry, void* value, size_t sz) {
+    _quicklistInsert(ql, entry, value, sz, 0);
+}
+
+void quicklistInsertAfter(quicklist* ql, quicklistEntry* entry, void* value, size_t sz) {
+    _quicklistInsert(ql, entry, value, sz, 1);
+}
+
+/*
+ * 将索引index处的元素替换为data，成功返回1，索引越界返回0
+ */
+int quicklistReplaceAtIndex(quicklist* ql, long index, void* data, size_t sz) {
+    quicklistNode* node;
+    unsigned char* p;
+    int offset;
+
+    if (!_quicklistLocate(ql, index, &node, &offset)) return 0;
+
+    quicklistDecompressNodeForUse(node);
+    p = ziplistIndex(node->zl, offset);
+    node->zl = ziplistDelete(node->zl, &p);
+    // 被删除元素之后的元素(如果有的话)前移到了offset处
+    p = ziplistIndex(node->zl, offset);
+    if (p == NULL) {
+        node->zl = ziplistPush(node->zl, data, sz, ZIPLIST_TAIL);
+    } else {
+        node->zl = ziplistInsert(node->zl, p, data, sz);
+    }
+    quicklistNodeUpdateSz(node);
+    quicklistRecompressOnly(node);
+    return 1;
+}
+
+/*
+ * 尝试将索引index处的元素所在节点与相邻节点合并
+ */
+static void quicklistMergeAt(quicklist* ql, long index) {
+    quicklistNode* node;
+    quicklistNode* right;
+    long shift;
+    int offset;
+
+    if (_quicklistLocate(ql, index, &node, &offset))
+        _quicklistMergeAfterDelete(ql, node, &right, &shift);
+}
+
+/*
+ * 从索引start开始删除count个元素，start可以为负数，
+ * 删除了元素时返回1，否则返回0
+ */
+int quicklistDelRange(quicklist* ql, long start, long count) {
+    quicklistNode* node;
+    unsigned long extent;
+    long first;
+    int offset;
+
+    if (count <= 0) return 0;
+
+    // 删除的元素数量不能超过start之后的元素数量
+    extent = count;
+    if (start >= 0 && extent > ql->count - start) {
+        extent = ql->count - start;
+    } else if (start < 0 && extent > (unsigned long) (-start)) {
+        extent = -start;
+    }
+
+    if (!_quicklistLocate(ql, start, &node, &offset)) return 0;
+
+    first = start >= 0 ? start : (long) ql->count + start;
+
+    while (extent) {
+        quicklistNode* next = node->next;
+        unsigned long del;
+
+        if (offset == 0 && extent >= node->count) {
+            // 删除整个节点
+            del = node->count;
+            __quicklistDelNode(ql, node);
+        } else {
+            del = node->count - offset;
+            if (del > extent) del = extent;
+            quicklistDecompressNodeForUse(node);
+            node->zl = ziplistDeleteRange(node->zl, offset, del);
+            node->count -= del;
+            ql->count -= del;
+            quicklistNodeUpdateSz(node);
+            quicklistRecompressOnly(node);
+        }
+        extent -= del;
+        node = next;
+        offset = 0;
+        if (!node) break;
+    }
+
+    // 被删除区间两端的节点可能只剩下少量元素，尝试与相邻节点合并
+    if (first > 0) quicklistMergeAt(ql, first - 1);
+    quicklistMergeAt(ql, first);
+    return 1;
+}
+
+/*
+ * 创建迭代器，direction为AL_START_HEAD或AL_START_TAIL
+ */
+quicklistIter* quicklistGetIterator(quicklist* ql, int direction) {
+    quicklistIter* iter = zmalloc(sizeof(*iter));
+
+    iter->quicklist = ql;
+    iter->direction = direction;
+    iter->zi = NULL;
+    iter->decompressed = NULL;
+    if (direction == AL_START_HEAD) {
+        iter->current = ql->head;
+        iter->offset = 0;
+    } else {
+        iter->current = ql->tail;
+        iter->offset = -1;
+    }
+    return iter;
+}
+
+/*
+ * 创建从索引idx处的元素开始迭代的迭代器，索引越界时返回NULL
+ */
+quicklistIter* quicklistGetIteratorAtIdx(quicklist* ql, int direction, long long idx) {
+    quicklistNode* node;
+    int offset;
+
+    if (_quicklistLocate(ql, idx, &node, &offset)) {
+        quicklistIter* base = quicklistGetIterator(ql, direction);
+        base->current = node;
+        base->offset = offset;
+        return base;
+    }
+    return NULL;
+}
+
+/*
+ * 释放迭代器，重新压缩迭代器临时解压的节点
+ */
+void quicklistReleaseIterator(quicklistIter* iter) {
+    quicklistRecompressOnly(iter->decompressed);
+    zfree(iter);
+}
+
+/*
+ * 将zi指向的元素的值保存到entry中
+ */
+static void _quicklistEntryFill(quicklistEntry* entry, quicklistNode* node,
+                                unsigned char* zi, int offset) {
+    entry->node = node;
+    entry->zi = zi;
+    entry->offset = offset;
+    entry->value = NULL;
+    entry->longval = -123456789;
+    entry->sz = 0;
+    ziplistGet(zi, &entry->value, &entry->sz, &entry->longval);
+}
+
+/*
+ * 返回迭代器的下一个元素，迭代完毕时返回0
+ *
+ * 迭代过程中可以调用quicklistDelEntry删除刚刚返回的元素，
+ * 其他修改快速列表的操作都会使迭代器失效
+ *
+ * 返回的元素所在的节点被临时解压，entry在下一次调用quicklistNext之前有效，
+ * 离开节点后节点被重新压缩
+ */
+int quicklistNext(quicklistIter* iter, quicklistEntry* entry) {
+    int forward = (iter->direction == AL_START_HEAD);
+
+    entry->quicklist = iter->quicklist;
+
+    while (iter->current) {
+        quicklistNode* node = iter->current;
+
+        if (iter->zi == NULL) {
+            if (iter->decompressed != node) {
+                quicklistRecompressOnly(iter->decompressed);
+                iter->decompressed = node;
+            }
+            quicklistDecompressNodeForUse(node);
+            if (iter->offset < 0) iter->offset = node->count - 1;
+            iter->zi = ziplistIndex(node->zl, iter->offset);
+        }
+
+        if (iter->zi) {
+            _quicklistEntryFill(entry, node, iter->zi, iter->offset);
+
+            // 预先定位下一个元素
+            if (forward) {
+                iter->zi = ziplistNext(node->zl, iter->zi);
+                iter->offset++;
+            } else {
+                iter->zi = ziplistPrev(node->zl, iter->zi);
+                iter->offset--;
+            }
+            if (iter->zi == NULL) {
+                iter->current = forward ? node->next : node->prev;
+                iter->offset = forward ? 0 : -1;
+            }
+            return 1;
+        }
+
+        iter->current = forward ? node->next : node->prev;
+        iter->offset = forward ? 0 : -1;
+    }
+    return 0;
+}
+
+/*
+ * 比较压缩列表元素p1与长度为p2_len的字符串p2，相等返回1
+ */
+int quicklistCompare(unsigned char* p1, unsigned char* p2, int p2_len) {
+    return ziplistCompare(p1, p2, p2_len);
+}
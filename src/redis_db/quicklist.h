@@ -0,0 +1,178 @@
+//
+// Created by zouyi on 2021/11/6.
+//
+
+#ifndef TINYREDIS_QUICKLIST_H
+#define TINYREDIS_QUICKLIST_H
+
+/*
+ * 快速列表: 由压缩列表组成的双向链表
+ *
+ * 每个节点保存一个大小受限的压缩列表，两端的插入和弹出是O(1)的，
+ * 与每个元素一个listNode + robj + sds的双向链表相比，节省大量内存并减少指针跳转
+ */
+
+/*
+ * 快速列表节点
+ */
+typedef struct quicklistNode {
+
+    struct quicklistNode* prev;
+
+    struct quicklistNode* next;
+
+    // 压缩列表，节点被压缩时指向quicklistLZF
+    unsigned char* zl;
+
+    // 压缩列表(未压缩时)占用的字节数
+    unsigned int sz;
+
+    // 压缩列表中的元素数量
+    unsigned int count;
+
+    // QUICKLIST_NODE_ENCODING_RAW或QUICKLIST_NODE_ENCODING_LZF
+    unsigned int encoding : 2;
+
+    // 节点被临时解压使用，使用完之后需要重新压缩
+    unsigned int recompress : 1;
+
+} quicklistNode;
+
+/*
+ * 被压缩的节点保存的压缩列表
+ */
+typedef struct quicklistLZF {
+
+    // 压缩后的字节数
+    unsigned int sz;
+
+    char compressed[];
+
+} quicklistLZF;
+
+/*
+ * 快速列表
+ */
+typedef struct quicklist {
+
+    quicklistNode* head;
+
+    quicklistNode* tail;
+
+    // 所有压缩列表中的元素总数
+    unsigned long count;
+
+    // 节点数量
+    unsigned long len;
+
+    // 节点大小限制: 正数为每个节点的最大元素数量，
+    // -1 ~ -5 表示每个节点最多占用 4KB/8KB/16KB/32KB/64KB
+    int fill;
+
+    // 两端各有多少个节点不压缩，0表示不压缩
+    unsigned int compress;
+
+} quicklist;
+
+/*
+ * 快速列表迭代器，迭代过程中只允许通过quicklistDelEntry删除元素
+ */
+typedef struct quicklistIter {
+
+    quicklist* quicklist;
+
+    // 下一个要返回的元素所在的节点，以及它在节点中的位置
+    quicklistNode* current;
+
+    // 下一个要返回的元素，为NULL时根据offset重新定位
+    unsigned char* zi;
+
+    // 下一个要返回的元素在节点中的索引，-1表示节点的最后一个元素
+    long offset;
+
+    int direction;
+
+    // 迭代器为了读取而临时解压的节点
+    quicklistNode* decompressed;
+
+} quicklistIter;
+
+/*
+ * 快速列表中的一个元素
+ */
+typedef struct quicklistEntry {
+
+    quicklist* quicklist;
+
+    quicklistNode* node;
+
+    unsigned char* zi;
+
+    // 字符串值，或者整数值(value为NULL时)
+    unsigned char* value;
+    long long longval;
+    unsigned int sz;
+
+    // 元素在节点中的索引
+    int offset;
+
+} quicklistEntry;
+
+/*
+ * 节点压缩的统计信息，所有快速列表共享
+ */
+typedef struct quicklistStats {
+
+    // 当前被压缩的节点数量
+    unsigned long long compressed_nodes;
+
+    // 当前被压缩的节点压缩前和压缩后的字节数
+    unsigned long long compressed_raw_bytes;
+    unsigned long long compressed_bytes;
+
+    // 累计压缩、解压的次数，以及因为不可压缩而放弃压缩的次数
+    unsigned long long compressions;
+    unsigned long long decompressions;
+    unsigned long long compress_failures;
+
+} quicklistStats;
+
+#define QUICKLIST_HEAD 0
+#define QUICKLIST_TAIL 1
+
+#define QUICKLIST_NODE_ENCODING_RAW 1
+#define QUICKLIST_NODE_ENCODING_LZF 2
+
+/* quicklist node limits */
+#define QUICKLIST_FILL_MIN -5
+#define QUICKLIST_FILL_MAX (1 << 15)
+#define QUICKLIST_COMPRESS_MAX (1 << 16)
+
+quicklist* quicklistCreate(void);
+quicklist* quicklistNew(int fill, int compress);
+quicklist* quicklistCreateFromZiplist(int fill, int compress, unsigned char* zl);
+void quicklistSetFill(quicklist* ql, int fill);
+void quicklistSetCompressDepth(quicklist* ql, int compress);
+void quicklistRelease(quicklist* ql);
+unsigned long quicklistCount(const quicklist* ql);
+
+int quicklistPushHead(quicklist* ql, void* value, size_t sz);
+int quicklistPushTail(quicklist* ql, void* value, size_t sz);
+void quicklistPush(quicklist* ql, void* value, size_t sz, int where);
+int quicklistPopCustom(quicklist* ql, int where, unsigned char** data, unsigned int* sz,
+                       long long* sval, void* (*saver)(unsigned char* data, unsigned int sz));
+void quicklistInsertBefore(quicklist* ql, quicklistEntry* entry, void* value, size_t sz);
+void quicklistInsertAfter(quicklist* ql, quicklistEntry* entry, void* value, size_t sz);
+int quicklistReplaceAtIndex(quicklist* ql, long index, void* data, size_t sz);
+int quicklistDelRange(quicklist* ql, long start, long count);
+
+quicklistIter* quicklistGetIterator(quicklist* ql, int direction);
+quicklistIter* quicklistGetIteratorAtIdx(quicklist* ql, int direction, long long idx);
+int quicklistNext(quicklistIter* iter, quicklistEntry* entry);
+void quicklistDelEntry(quicklistIter* iter, quicklistEntry* entry);
+void quicklistReleaseIterator(quicklistIter* iter);
+int quicklistCompare(unsigned char* p1, unsigned char* p2, int p2_len);
+size_t quicklistNodeAllocSize(const quicklistNode* node);
+void quicklistGetStats(quicklistStats* stats);
+
+#endif //TINYREDIS_QUICKLIST_H
@@ -0,0 +1,543 @@
+//
+// Created by zouyi on 2021/11/2.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "rax.h"
+#include "zmalloc.h"
+
+/*
+ * 节点本身(不含子节点数组)占用的字节数
+ */
+#define raxNodeSize(labellen) (sizeof(raxNode) + (labellen))
+
+/*
+ * 创建一个边标签为s[0..len-1]的新节点
+ */
+static raxNode* raxNewNode(rax* rt, unsigned char* s, size_t len, int iskey) {
+
+    raxNode* n = zmalloc(raxNodeSize(len));
+
+    n->iskey = iskey;
+    n->numchildren = 0;
+    n->labellen = len;
+    n->children = NULL;
+    if (len) memcpy(n->label, s, len);
+
+    rt->numnodes++;
+    rt->alloc_bytes += raxNodeSize(len);
+
+    return n;
+}
+
+/*
+ * 释放单个节点(包括子节点数组，但不包括子节点本身)
+ */
+static void raxFreeNode(rax* rt, raxNode* n) {
+
+    rt->numnodes--;
+    rt->alloc_bytes -= raxNodeSize(n->labellen) + n->numchildren * sizeof(raxNode*);
+
+    zfree(n->children);
+    zfree(n);
+}
+
+/*
+ * 创建一个新的基数树
+ */
+rax* raxNew(void) {
+
+    rax* rt = zmalloc(sizeof(*rt));
+
+    rt->numele = 0;
+    rt->numnodes = 0;
+    rt->alloc_bytes = 0;
+    rt->head = raxNewNode(rt, NULL, 0, 0);
+
+    return rt;
+}
+
+/*
+ * 递归释放以n为根的子树
+ */
+static void raxRecursiveFree(rax* rt, raxNode* n) {
+
+    uint32_t j;
+
+    for (j = 0; j < n->numchildren; j++)
+        raxRecursiveFree(rt, n->children[j]);
+
+    raxFreeNode(rt, n);
+}
+
+/*
+ * 释放整个基数树
+ */
+void raxFree(rax* rt) {
+
+    raxRecursiveFree(rt, rt->head);
+
+    zfree(rt);
+}
+
+/*
+ * 在节点n的子节点中查找边标签首字节为c的子节点，
+ * 找到返回1，并将其下标保存到*idx；
+ * 否则返回0，*idx保存c应该插入的位置
+ */
+static int raxFindChild(raxNode* n, unsigned char c, uint32_t* idx) {
+
+    uint32_t lo = 0, hi = n->numchildren;
+
+    // 子节点按首字节有序，二分查找
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        unsigned char mc = n->children[mid]->label[0];
+
+        if (mc == c) {
+            *idx = mid;
+            return 1;
+        } else if (mc < c) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    *idx = lo;
+    return 0;
+}
+
+/*
+ * 将子节点child插入到节点n的子节点数组的idx位置
+ */
+static void raxAddChild(rax* rt, raxNode* n, uint32_t idx, raxNode* child) {
+
+    n->children = zrealloc(n->children, (n->numchildren + 1) * sizeof(raxNode*));
+
+    memmove(n->children + idx + 1, n->children + idx, (n->numchildren - idx) * sizeof(raxNode*));
+
+    n->children[idx] = child;
+    n->numchildren++;
+
+    rt->alloc_bytes += sizeof(raxNode*);
+}
+
+/*
+ * 从节点n的子节点数组中移除idx位置的子节点(不释放子节点)
+ */
+static void raxRemoveChild(rax* rt, raxNode* n, uint32_t idx) {
+
+    memmove(n->children + idx, n->children + idx + 1, (n->numchildren - idx - 1) * sizeof(raxNode*));
+
+    n->numchildren--;
+
+    if (n->numchildren == 0) {
+        zfree(n->children);
+        n->children = NULL;
+    } else {
+        n->children = zrealloc(n->children, n->numchildren * sizeof(raxNode*));
+    }
+
+    rt->alloc_bytes -= sizeof(raxNode*);
+}
+
+/*
+ * 将没有键、只有一个子节点的节点n与其子节点合并成一个节点，返回合并后的节点，
+ * 调用者负责将父节点中指向n的指针替换为返回值
+ */
+static raxNode* raxMergeWithChild(rax* rt, raxNode* n) {
+
+    raxNode* child = n->children[0];
+    size_t len = n->labellen + child->labellen;
+
+    raxNode* merged = zmalloc(raxNodeSize(len));
+
+    merged->iskey = child->iskey;
+    merged->numchildren = child->numchildren;
+    merged->labellen = len;
+    memcpy(merged->label, n->label, n->labellen);
+    memcpy(merged->label + n->labellen, child->label, child->labellen);
+
+    // 子节点数组直接转移给合并后的节点(占用的内存已经计算过)
+    merged->children = child->children;
+    child->children = NULL;
+    child->numchildren = 0;
+
+    rt->numnodes++;
+    rt->alloc_bytes += raxNodeSize(len);
+
+    raxFreeNode(rt, child);
+    raxFreeNode(rt, n);
+
+    return merged;
+}
+
+/*
+ * 向基数树中插入键s，
+ * 插入成功返回1，键已经存在返回0
+ */
+int raxInsert(rax* rt, unsigned char* s, size_t len) {
+
+    raxNode* n = rt->head;
+    size_t pos = 0;
+
+    while (1) {
+        uint32_t idx;
+        raxNode* child;
+        size_t m;
+
+        // 键在节点n处结束
+        if (pos == len) {
+            if (n->iskey) return 0;
+            n->iskey = 1;
+            rt->numele++;
+            return 1;
+        }
+
+        // 没有可以继续匹配的子节点，将键的剩余部分作为一个新的叶子节点
+        if (!raxFindChild(n, s[pos], &idx)) {
+            raxAddChild(rt, n, idx, raxNewNode(rt, s + pos, len - pos, 1));
+            rt->numele++;
+            return 1;
+        }
+
+        // 计算子节点边标签与键剩余部分的公共前缀长度
+        child = n->children[idx];
+        for (m = 1; m < child->labellen && pos + m < len; m++)
+            if (child->label[m] != s[pos + m]) break;
+
+        // 边标签完全匹配，继续向下查找
+        if (m == child->labellen) {
+            n = child;
+            pos += m;
+            continue;
+        }
+
+        // 边标签部分匹配，需要分裂子节点：
+        // 新建中间节点保存公共前缀，原子节点保存边标签的剩余部分
+        raxNode* mid = raxNewNode(rt, child->label, m, 0);
+        raxNode* tail = raxNewNode(rt, child->label + m, child->labellen - m, child->iskey);
+
+        tail->children = child->children;
+        tail->numchildren = child->numchildren;
+        child->children = NULL;
+        child->numchildren = 0;
+        raxFreeNode(rt, child);
+
+        mid->children = zmalloc(sizeof(raxNode*));
+        mid->children[0] = tail;
+        mid->numchildren = 1;
+        rt->alloc_bytes += sizeof(raxNode*);
+
+        n->children[idx] = mid;
+
+        n = mid;
+        pos += m;
+    }
+}
+
+/*
+ * 查找键s所在的节点，找到返回节点，否则返回NULL，
+ * 如果parents不为NULL，记录查找路径上的节点及其在父节点中的下标
+ */
+static raxNode* raxLowWalk(rax* rt, unsigned char* s, size_t len,
+                           raxNode** parents, uint32_t* idxs, size_t* depth) {
+
+    raxNode* n = rt->head;
+    size_t pos = 0;
+    size_t d = 0;
+
+    while (pos < len) {
+        uint32_t idx;
+        raxNode* child;
+
+        if (!raxFindChild(n, s[pos], &idx)) return NULL;
+
+        child = n->children[idx];
+        if (child->labellen > len - pos ||
+            memcmp(child->label, s + pos, child->labellen) != 0)
+            return NULL;
+
+        if (parents) {
+            parents[d] = n;
+            idxs[d] = idx;
+        }
+        d++;
+
+        n = child;
+        pos += child->labellen;
+    }
+
+    if (depth) *depth = d;
+
+    return n;
+}
+
+/*
+ * 检查键s是否存在于基数树中
+ */
+int raxFind(rax* rt, unsigned char* s, size_t len) {
+
+    raxNode* n = raxLowWalk(rt, s, len, NULL, NULL, NULL);
+
+    return n != NULL && n->iskey;
+}
+
+/*
+ * 从基数树中删除键s，
+ * 删除成功返回1，键不存在返回0
+ */
+int raxRemove(rax* rt, unsigned char* s, size_t len) {
+
+    raxNode* parents_static[RAX_ITER_STATIC_KEY];
+    uint32_t idxs_static[RAX_ITER_STATIC_KEY];
+    raxNode** parents = parents_static;
+    uint32_t* idxs = idxs_static;
+    size_t depth;
+    raxNode* n;
+
+    // 查找路径的深度不会超过键的长度，短键直接使用栈上的数组
+    if (len >= RAX_ITER_STATIC_KEY) {
+        parents = zmalloc(sizeof(raxNode*) * (len + 1));
+        idxs = zmalloc(sizeof(uint32_t) * (len + 1));
+    }
+
+    n = raxLowWalk(rt, s, len, parents, idxs, &depth);
+    if (n == NULL || !n->iskey) {
+        n = NULL;
+        goto cleanup;
+    }
+
+    n->iskey = 0;
+    rt->numele--;
+
+    // 根节点不参与压缩
+    if (depth > 0) {
+        raxNode* parent = parents[depth - 1];
+        uint32_t idx = idxs[depth - 1];
+
+        if (n->numchildren == 0) {
+            // 叶子节点直接删除
+            raxRemoveChild(rt, parent, idx);
+            raxFreeNode(rt, n);
+
+            // 父节点不再是键且只剩一个子节点时，与子节点合并
+            if (depth > 1 && !parent->iskey && parent->numchildren == 1) {
+                raxNode* grand = parents[depth - 2];
+                grand->children[idxs[depth - 2]] = raxMergeWithChild(rt, parent);
+            }
+        } else if (n->numchildren == 1) {
+            // 只有一个子节点的非键节点与子节点合并
+            parent->children[idx] = raxMergeWithChild(rt, n);
+        }
+    }
+
+cleanup:
+    if (parents != parents_static) {
+        zfree(parents);
+        zfree(idxs);
+    }
+
+    return n != NULL;
+}
+
+/*
+ * 返回基数树中键的数量
+ */
+uint64_t raxSize(rax* rt) {
+    return rt->numele;
+}
+
+/*
+ * 返回基数树占用的内存字节数
+ */
+size_t raxAllocSize(rax* rt) {
+    return sizeof(*rt) + rt->alloc_bytes;
+}
+
+/*
+ * 基数树迭代器
+ */
+
+/*
+ * 初始化迭代器，需要调用raxSeek定位后才能调用raxNext
+ */
+void raxStart(raxIterator* it, rax* rt) {
+
+    it->rt = rt;
+
+    it->key = it->key_static;
+    it->key_len = 0;
+    it->key_max = RAX_ITER_STATIC_KEY;
+
+    it->stack = it->stack_static;
+    it->stack_items = 0;
+    it->stack_max = RAX_ITER_STATIC_STACK;
+}
+
+/*
+ * 确保迭代器的键缓冲区至少有len字节
+ */
+static void raxIteratorKeyReserve(raxIterator* it, size_t len) {
+
+    if (len <= it->key_max) return;
+
+    while (it->key_max < len) it->key_max *= 2;
+
+    if (it->key == it->key_static) {
+        it->key = zmalloc(it->key_max);
+        memcpy(it->key, it->key_static, RAX_ITER_STATIC_KEY);
+    } else {
+        it->key = zrealloc(it->key, it->key_max);
+    }
+}
+
+/*
+ * 将节点n压入迭代器栈中，并将其边标签追加到当前路径
+ */
+static void raxIteratorPush(raxIterator* it, raxNode* n, long childidx, size_t keylen) {
+
+    raxStackFrame* f;
+
+    if (it->stack_items == it->stack_max) {
+        it->stack_max *= 2;
+        if (it->stack == it->stack_static) {
+            it->stack = zmalloc(sizeof(raxStackFrame) * it->stack_max);
+            memcpy(it->stack, it->stack_static, sizeof(it->stack_static));
+        } else {
+            it->stack = zrealloc(it->stack, sizeof(raxStackFrame) * it->stack_max);
+        }
+    }
+
+    raxIteratorKeyReserve(it, keylen + n->labellen);
+    memcpy(it->key + keylen, n->label, n->labellen);
+
+    f = it->stack + it->stack_items++;
+    f->node = n;
+    f->childidx = childidx;
+    f->keylen = keylen + n->labellen;
+}
+
+/*
+ * 将迭代器定位到第一个满足条件的键之前，op可以是：
+ * "^"  定位到最小的键
+ * ">=" 定位到第一个大于等于ele的键
+ * ">"  定位到第一个大于ele的键
+ * 定位成功返回1，op不合法返回0
+ */
+int raxSeek(raxIterator* it, const char* op, unsigned char* ele, size_t len) {
+
+    raxNode* n;
+    size_t pos = 0;
+    int eq;
+
+    if (!strcmp(op, "^")) {
+        ele = NULL;
+        len = 0;
+        eq = 1;
+    } else if (!strcmp(op, ">=")) {
+        eq = 1;
+    } else if (!strcmp(op, ">")) {
+        eq = 0;
+    } else {
+        return 0;
+    }
+
+    it->stack_items = 0;
+    it->key_len = 0;
+
+    n = it->rt->head;
+    raxIteratorPush(it, n, 0, 0);
+
+    while (1) {
+        raxStackFrame* top = it->stack + it->stack_items - 1;
+        uint32_t idx;
+        raxNode* child;
+        size_t m;
+
+        // ele在节点n处结束，n的子树中所有的键都大于ele，
+        // n本身等于ele，根据op决定是否返回
+        if (pos == len) {
+            top->childidx = eq ? -1 : 0;
+            break;
+        }
+
+        // 在这之后，n本身是ele的真前缀，一定小于ele，不需要返回
+        raxFindChild(n, ele[pos], &idx);
+        if (idx == n->numchildren) {
+            top->childidx = idx;
+            break;
+        }
+
+        child = n->children[idx];
+        if (child->label[0] != ele[pos]) {
+            // 子节点的首字节大于ele中对应字节，从该子节点开始都大于ele
+            top->childidx = idx;
+            break;
+        }
+
+        for (m = 1; m < child->labellen && pos + m < len; m++)
+            if (child->label[m] != ele[pos + m]) break;
+
+        if (m == child->labellen) {
+            // 边标签完全匹配，继续向下定位
+            top->childidx = idx + 1;
+            raxIteratorPush(it, child, 0, top->keylen);
+            n = child;
+            pos += m;
+        } else if (pos + m == len || child->label[m] > ele[pos + m]) {
+            // ele是子节点路径的真前缀，或者子节点路径大于ele，整棵子树都大于ele
+            top->childidx = idx;
+            break;
+        } else {
+            // 整棵子树都小于ele
+            top->childidx = idx + 1;
+            break;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * 按字典序返回下一个键，保存在it->key和it->key_len中，
+ * 有下一个键返回1，迭代完成返回0
+ */
+int raxNext(raxIterator* it) {
+
+    while (it->stack_items > 0) {
+        raxStackFrame* f = it->stack + it->stack_items - 1;
+
+        // 先返回节点本身
+        if (f->childidx == -1) {
+            f->childidx = 0;
+            if (f->node->iskey) {
+                it->key_len = f->keylen;
+                return 1;
+            }
+        }
+
+        // 再按顺序访问子节点
+        if ((uint32_t)f->childidx < f->node->numchildren) {
+            raxNode* child = f->node->children[f->childidx++];
+            raxIteratorPush(it, child, -1, f->keylen);
+        } else {
+            it->stack_items--;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * 释放迭代器占用的资源
+ */
+void raxStop(raxIterator* it) {
+
+    if (it->key != it->key_static) zfree(it->key);
+
+    if (it->stack != it->stack_static) zfree(it->stack);
+}
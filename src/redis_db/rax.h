@@ -0,0 +1,114 @@
+//
+// Created by zouyi on 2021/11/2.
+//
+
+#ifndef TINYREDIS_RAX_H
+#define TINYREDIS_RAX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * 基数树(压缩前缀树)，按字典序保存一组二进制安全的字符串，
+ * 用于数据库键空间的有序索引，支持前缀查找与字典序范围迭代
+ *
+ * 每个节点保存从父节点到自身的一段边标签，
+ * 子节点按照边标签的首字节升序排列，因此先序遍历即为字典序
+ */
+
+/*
+ * 基数树节点
+ */
+typedef struct raxNode {
+
+    // 从根节点到本节点的路径是否构成一个键
+    uint32_t iskey:1;
+
+    // 子节点数量
+    uint32_t numchildren:31;
+
+    // 边标签长度
+    uint32_t labellen;
+
+    // 子节点数组，按照边标签首字节升序排列
+    struct raxNode** children;
+
+    // 边标签
+    unsigned char label[];
+
+} raxNode;
+
+/*
+ * 基数树
+ */
+typedef struct rax {
+
+    // 根节点，边标签为空
+    raxNode* head;
+
+    // 树中键的数量
+    uint64_t numele;
+
+    // 树中节点的数量
+    uint64_t numnodes;
+
+    // 节点及子节点数组占用的字节数
+    size_t alloc_bytes;
+
+} rax;
+
+/*
+ * 迭代器栈帧，记录正在访问的节点、下一个要访问的子节点下标，
+ * 以及从根节点到该节点的路径长度
+ */
+typedef struct raxStackFrame {
+
+    raxNode* node;
+
+    // 为-1时表示节点本身尚未返回
+    long childidx;
+
+    size_t keylen;
+
+} raxStackFrame;
+
+#define RAX_ITER_STATIC_STACK 32
+#define RAX_ITER_STATIC_KEY 128
+
+/*
+ * 基数树迭代器，按字典序升序返回键，
+ * 迭代过程中不能修改基数树
+ */
+typedef struct raxIterator {
+
+    rax* rt;
+
+    // 当前键
+    unsigned char* key;
+    size_t key_len;
+    size_t key_max;
+
+    // 遍历栈
+    raxStackFrame* stack;
+    size_t stack_items;
+    size_t stack_max;
+
+    unsigned char key_static[RAX_ITER_STATIC_KEY];
+    raxStackFrame stack_static[RAX_ITER_STATIC_STACK];
+
+} raxIterator;
+
+rax* raxNew(void);
+void raxFree(rax* rt);
+int raxInsert(rax* rt, unsigned char* s, size_t len);
+int raxRemove(rax* rt, unsigned char* s, size_t len);
+int raxFind(rax* rt, unsigned char* s, size_t len);
+uint64_t raxSize(rax* rt);
+size_t raxAllocSize(rax* rt);
+
+void raxStart(raxIterator* it, rax* rt);
+int raxSeek(raxIterator* it, const char* op, unsigned char* ele, size_t len);
+int raxNext(raxIterator* it);
+void raxStop(raxIterator* it);
+
+#endif //TINYREDIS_RAX_H
@@ -164,6 +164,22 @@ struct redisCommand redisCommandTable[] = {
     {"move",moveCommand,3,"w",0,NULL,1,1,1,0,0},
     {"rename",renameCommand,3,"w",0,NULL,1,2,1,0,0},
     {"renamenx",renamenxCommand,3,"w",0,NULL,1,2,1,0,0},
+    {"keyindex",keyindexCommand,-2,"wa",0,NULL,0,0,0,0,0},
+    {"unlink",unlinkCommand,-2,"w",0,NULL,1,-1,1,0,0},
+    {"flushdb",flushdbCommand,-1,"w",0,NULL,0,0,0,0,0},
+    {"flushall",flushallCommand,-1,"w",0,NULL,0,0,0,0,0},
+    {"object",objectCommand,3,"r",0,NULL,2,2,2,0,0},
+    {"eviction",evictionCommand,2,"r",0,NULL,0,0,0,0,0},
+    {"config",configCommand,-2,"ar",0,NULL,0,0,0,0,0},
+    {"expire",expireCommand,3,"w",0,NULL,1,1,1,0,0},
+    {"expireat",expireatCommand,3,"w",0,NULL,1,1,1,0,0},
+    {"pexpire",pexpireCommand,3,"w",0,NULL,1,1,1,0,0},
+    {"pexpireat",pexpireatCommand,3,"w",0,NULL,1,1,1,0,0},
+    {"mexpire",mexpireCommand,-3,"w",0,NULL,2,-1,1,0,0},
+    {"mpexpire",mpexpireCommand,-3,"w",0,NULL,2,-1,1,0,0},
+    {"ttl",ttlCommand,2,"r",0,NULL,1,1,1,0,0},
+    {"pttl",pttlCommand,2,"r",0,NULL,1,1,1,0,0},
+    {"persist",persistCommand,2,"w",0,NULL,1,1,1,0,0},
 
     /* String commands */
     {"set", setCommand, -3, "wm", 0, NULL, 1, 1, 1, 0, 0},
@@ -171,12 +187,24 @@ struct redisCommand redisCommandTable[] = {
     {"setex",setexCommand,4,"wm",0,NULL,1,1,1,0,0},
     {"psetex",psetexCommand,4,"wm",0,NULL,1,1,1,0,0},
     {"get", getCommand, 2, "r", 0, NULL, 1, 1, 1, 0, 0},
+    {"getex",getexCommand,-2,"w",0,NULL,1,1,1,0,0},
     {"append",appendCommand,3,"wm",0,NULL,1,1,1,0,0},
+    {"setrange",setrangeCommand,4,"wm",0,NULL,1,1,1,0,0},
+    {"getrange",getrangeCommand,4,"r",0,NULL,1,1,1,0,0},
+    {"setbit",setbitCommand,4,"wm",0,NULL,1,1,1,0,0},
+    {"getbit",getbitCommand,3,"r",0,NULL,1,1,1,0,0},
+    {"bitcount",bitcountCommand,-2,"r",0,NULL,1,1,1,0,0},
+    {"bitpos",bitposCommand,-3,"r",0,NULL,1,1,1,0,0},
+    {"bitop",bitopCommand,-4,"wm",0,NULL,2,-1,1,0,0},
+    {"bitfield",bitfieldCommand,-2,"wm",0,NULL,1,1,1,0,0},
     {"incr",incrCommand,2,"wm",0,NULL,1,1,1,0,0},
     {"decr",decrCommand,2,"wm",0,NULL,1,1,1,0,0},
     {"incrby",incrbyCommand,3,"wm",0,NULL,1,1,1,0,0},
     {"decrby",decrbyCommand,3,"wm",0,NULL,1,1,1,0,0},
     {"incrbyfloat",incrbyfloatCommand,3,"wm",0,NULL,1,1,1,0,0},
+    {"mget",mgetCommand,-2,"r",0,NULL,1,-1,1,0,0},
+    {"mset",msetCommand,-3,"wm",0,NULL,1,-1,2,0,0},
+    {"msetnx",msetnxCommand,-3,"wm",0,NULL,1,-1,2,0,0},
 
     /* List commands */
     {"rpush",rpushCommand,-3,"wm",0,NULL,1,1,1,0,0},
@@ -184,31 +212,49 @@ struct redisCommand redisCommandTable[] = {
     {"rpushx",rpushxCommand,3,"wm",0,NULL,1,1,1,0,0},
     {"lpushx",lpushxCommand,3,"wm",0,NULL,1,1,1,0,0},
     {"linsert",linsertCommand,5,"wm",0,NULL,1,1,1,0,0},
-    {"rpop",rpopCommand,2,"w",0,NULL,1,1,1,0,0},
-    {"lpop",lpopCommand,2,"w",0,NULL,1,1,1,0,0},
+    {"rpop",rpopCommand,-2,"w",0,NULL,1,1,1,0,0},
+    {"lpop",lpopCommand,-2,"w",0,NULL,1,1,1,0,0},
     {"llen",llenCommand,2,"r",0,NULL,1,1,1,0,0},
     {"lindex",lindexCommand,3,"r",0,NULL,1,1,1,0,0},
+    {"lrange",lrangeCommand,4,"r",0,NULL,1,1,1,0,0},
+    {"lpos",lposCommand,-3,"r",0,NULL,1,1,1,0,0},
     {"lrem",lremCommand,4,"w",0,NULL,1,1,1,0,0},
     {"ltrim",ltrimCommand,4,"w",0,NULL,1,1,1,0,0},
     {"lset",lsetCommand,4,"wm",0,NULL,1,1,1,0,0},
+    {"lmove",lmoveCommand,5,"wm",0,NULL,1,2,1,0,0},
+    {"rpoplpush",rpoplpushCommand,3,"wm",0,NULL,1,2,1,0,0},
+    {"quicklist",quicklistCommand,2,"r",0,NULL,0,0,0,0,0},
 
     /* Hash commands */
-    {"hset",hsetCommand,4,"wm",0,NULL,1,1,1,0,0},
+    {"hset",hsetCommand,-4,"wm",0,NULL,1,1,1,0,0},
     {"hsetnx",hsetnxCommand,4,"wm",0,NULL,1,1,1,0,0},
     {"hget",hgetCommand,3,"r",0,NULL,1,1,1,0,0},
     {"hexists",hexistsCommand,3,"r",0,NULL,1,1,1,0,0},
     {"hdel",hdelCommand,-3,"w",0,NULL,1,1,1,0,0},
     {"hlen",hlenCommand,2,"r",0,NULL,1,1,1,0,0},
+    {"hmset",hmsetCommand,-4,"wm",0,NULL,1,1,1,0,0},
+    {"hmget",hmgetCommand,-3,"r",0,NULL,1,1,1,0,0},
+    {"hincrby",hincrbyCommand,4,"wm",0,NULL,1,1,1,0,0},
+    {"hincrbyfloat",hincrbyfloatCommand,4,"wm",0,NULL,1,1,1,0,0},
     {"hgetall",hgetallCommand,2,"r",0,NULL,1,1,1,0,0},
+    {"hkeys",hkeysCommand,2,"r",0,NULL,1,1,1,0,0},
+    {"hvals",hvalsCommand,2,"r",0,NULL,1,1,1,0,0},
+    {"hstrlen",hstrlenCommand,3,"r",0,NULL,1,1,1,0,0},
+    {"hscan",hscanCommand,-3,"rR",0,NULL,1,1,1,0,0},
 
     /* Set commands */
     {"sadd",saddCommand,-3,"wm",0,NULL,1,1,1,0,0},
     {"srem",sremCommand,-3,"w",0,NULL,1,1,1,0,0},
     {"scard",scardCommand,2,"r",0,NULL,1,1,1,0,0},
     {"sismember",sismemberCommand,3,"r",0,NULL,1,1,1,0,0},
+    {"smismember",smismemberCommand,-3,"r",0,NULL,1,1,1,0,0},
     {"sinter",sinterCommand,-2,"rS",0,NULL,1,-1,1,0,0},
+    {"sinterstore",sinterstoreCommand,-3,"wm",0,NULL,1,-1,1,0,0},
+    {"sintercard",sintercardCommand,-3,"r",0,NULL,0,0,0,0,0},
     {"sunion",sunionCommand,-2,"rS",0,NULL,1,-1,1,0,0},
     {"sdiff",sdiffCommand,-2,"rS",0,NULL,1,-1,1,0,0},
+    {"sunionstore",sunionstoreCommand,-3,"wm",0,NULL,1,-1,1,0,0},
+    {"sdiffstore",sdiffstoreCommand,-3,"wm",0,NULL,1,-1,1,0,0},
     {"srandmember",srandmemberCommand,-2,"rR",0,NULL,1,1,1,0,0},
     {"spop",spopCommand,2,"wRs",0,NULL,1,1,1,0,0},
 
@@ -221,7 +267,28 @@ struct redisCommand redisCommandTable[] = {
     {"zrank",zrankCommand,3,"r",0,NULL,1,1,1,0,0},
     {"zrevrank",zrevrankCommand,3,"r",0,NULL,1,1,1,0,0},
     {"zrem",zremCommand,-3,"w",0,NULL,1,1,1,0,0},
-    {"zscore",zscoreCommand,3,"r",0,NULL,1,1,1,0,0}
+    {"zincrby",zincrbyCommand,4,"wm",0,NULL,1,1,1,0,0},
+    {"zremrangebyscore",zremrangebyscoreCommand,4,"w",0,NULL,1,1,1,0,0},
+    {"zremrangebyrank",zremrangebyrankCommand,4,"w",0,NULL,1,1,1,0,0},
+    {"zrangebyscore",zrangebyscoreCommand,-4,"r",0,NULL,1,1,1,0,0},
+    {"zrevrangebyscore",zrevrangebyscoreCommand,-4,"r",0,NULL,1,1,1,0,0},
+    {"zrangebylex",zrangebylexCommand,-4,"r",0,NULL,1,1,1,0,0},
+    {"zrevrangebylex",zrevrangebylexCommand,-4,"r",0,NULL,1,1,1,0,0},
+    {"zlexcount",zlexcountCommand,4,"r",0,NULL,1,1,1,0,0},
+    {"zunionstore",zunionstoreCommand,-4,"wm",0,NULL,0,0,0,0,0},
+    {"zinterstore",zinterstoreCommand,-4,"wm",0,NULL,0,0,0,0,0},
+    {"zscore",zscoreCommand,3,"r",0,NULL,1,1,1,0,0},
+    /* Sort commands */
+    {"sort",sortCommand,-2,"wm",0,NULL,1,1,1,0,0},
+    {"sort_ro",sortroCommand,-2,"r",0,NULL,1,1,1,0,0},
+    /* Transaction commands */
+    {"multi",multiCommand,1,"rs",0,NULL,0,0,0,0,0},
+    {"exec",execCommand,1,"sM",0,NULL,0,0,0,0,0},
+    {"discard",discardCommand,1,"rs",0,NULL,0,0,0,0,0},
+    {"watch",watchCommand,-2,"rs",0,NULL,1,-1,1,0,0},
+    {"unwatch",unwatchCommand,1,"rs",0,NULL,0,0,0,0,0},
+    /* Module commands */
+    {"module",moduleCommand,-2,"as",0,NULL,0,0,0,0,0}
 };
 
 /* -----------------------------------------------------------------------------
@@ -267,6 +334,89 @@ void updateCachedTime(void) {
     server.mstime = mstime();
 }
 
+/* -----------------------------------------------------------------------------
+ * LFU(最不经常使用)相关
+ *
+ * LFU策略下，robj的24位lru域被拆分为两部分:
+ *
+ *           16 bits      8 bits
+ *      +----------------+--------+
+ *      + Last decr time | LOG_C  |
+ *      +----------------+--------+
+ *
+ * LOG_C是一个对数计数器，访问越频繁增长的概率越低，8位可以表示上百万次访问；
+ * Last decr time是计数器最近一次衰减的时间(分钟)，
+ * 计数器每经过lfu_decay_time分钟减1，使过去频繁访问而现在不再访问的键也会被淘汰
+ * -------------------------------------------------------------------------- */
+
+/*
+ * 返回分钟级的时间，只保留低16位
+ */
+unsigned long LFUGetTimeInMinutes(void) {
+    return (server.unixtime / 60) & 65535;
+}
+
+/*
+ * 返回距离时间ldt经过的分钟数，考虑16位时间回绕
+ */
+static unsigned long LFUTimeElapsed(unsigned long ldt) {
+    unsigned long now = LFUGetTimeInMinutes();
+    if (now >= ldt) return now - ldt;
+    return 65535 - ldt + now;
+}
+
+/*
+ * 以对数概率增加计数器，计数器越大，增加的概率越低
+ */
+static uint8_t LFULogIncr(uint8_t counter) {
+    double r, baseval, p;
+
+    if (counter == 255) return 255;
+
+    r = (double)rand() / RAND_MAX;
+    baseval = counter - REDIS_LFU_INIT_VAL;
+    if (baseval < 0) baseval = 0;
+    p = 1.0 / (baseval * server.lfu_log_factor + 1);
+    if (r < p) counter++;
+
+    return counter;
+}
+
+/*
+ * 按照经过的衰减周期数减少对象o的计数器，返回衰减后的计数器，
+ * 不会修改对象本身，访问时由updateLFU写回
+ */
+unsigned long LFUDecrAndReturn(robj* o) {
+    unsigned long ldt = o->lru >> 8;
+    unsigned long counter = o->lru & 255;
+    unsigned long num_periods = server.lfu_decay_time ? LFUTimeElapsed(ldt) / server.lfu_decay_time : 0;
+
+    if (num_periods)
+        counter = (num_periods > counter) ? 0 : counter - num_periods;
+
+    return counter;
+}
+
+/*
+ * 对象被访问时更新LFU信息: 先衰减，再按对数概率增加计数器
+ */
+void updateLFU(robj* val) {
+    unsigned long counter = LFUDecrAndReturn(val);
+
+    counter = LFULogIncr(counter);
+    val->lru = (LFUGetTimeInMinutes() << 8) | counter;
+}
+
+/*
+ * 新建对象时lru域的初始值，
+ * LFU策略下为当前时间加初始计数器，避免新建的键被立刻淘汰
+ */
+unsigned int objectInitialLRU(void) {
+    if (REDIS_MAXMEMORY_IS_LFU(server.maxmemory_policy))
+        return (LFUGetTimeInMinutes() << 8) | REDIS_LFU_INIT_VAL;
+    return getLRUClock();
+}
+
 /* -----------------------------------------------------------------------------
  * redis使用字典数据结构时定义的特有函数
  * -------------------------------------------------------------------------- */
@@ -415,6 +565,27 @@ dictType dbDictType = {
     dictRedisObjectDestructor
 };
 
+/*
+ * 键空间索引SCAN游标表的哈希函数，键为游标id本身
+ */
+unsigned int dictKeyIndexCursorHash(const void* key) {
+    unsigned long id = (unsigned long)key;
+    return dictGenHashFunction(&id, sizeof(id));
+}
+
+/*
+ * 键空间索引SCAN游标表的字典类型，键为游标id，值为游标所在的链表节点，
+ * 游标由db.c负责释放
+ */
+dictType keyIndexCursorDictType = {
+    dictKeyIndexCursorHash,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
 /*
  * 字典用作过期字典的底层实现时，使用的特有函数
  */
@@ -428,6 +599,30 @@ dictType keyptrDictType = {
     NULL
 };
 
+/*
+ * 值为链表的字典使用的销毁函数
+ */
+void dictListDestructor(void* privdata, void* val) {
+    DICT_NOTUSED(privdata);
+
+    listRelease((list*)val);
+}
+
+/*
+ * 键为redis对象，值为链表的字典使用的特有函数，例如被监视的键到客户端链表的映射
+ */
+/* Keylist hash table type has unencoded redis objects as keys and
+ * lists as values. It's used for blocking operations (BLPOP) and to
+ * map swapped keys to a list of clients waiting for this keys to be loaded. */
+dictType keylistDictType = {
+    dictEncObjHash,
+    NULL,
+    NULL,
+    dictEncObjKeyCompare,
+    dictRedisObjectDestructor,
+    dictListDestructor
+};
+
 /*
  * 字典用作命令表的底层实现时，使用的特有函数
  */
@@ -504,6 +699,46 @@ int incrementallyRehash(int dbid) {
     return 0;
 }
 
+/*
+ * 渐进式重置对象的lru域时，dictScan对每个键值对调用的函数，privdata为重置后的值
+ */
+static void resetLRUCallback(void* privdata, const dictEntry* de) {
+    robj* o = dictGetVal(de);
+
+    o->lru = *(unsigned int*)privdata;
+}
+
+/*
+ * 渐进式重置对象的lru域
+ *
+ * serverCron -> databasesCron -> incrementallyResetLRU
+ *
+ * LRU和LFU对lru域的解释不同，切换策略时CONFIG SET只记录需要重置，
+ * 由这个函数每次使用有限的时间，用dictScan从上一次停止的位置继续遍历键空间，
+ * 把对象的lru域重置为新策略下的初始值，全部数据库遍历完之后停止；
+ * 重置完成之前，还没有遍历到的对象的空闲时间或访问频率的估计可能不准确
+ */
+void incrementallyResetLRU(void) {
+    long long start = ustime();
+    // 每次调用最多使用的时间(微秒)，占serverCron周期的LRU_RESET_CYCLE_TIME_PERC
+    long long timelimit = 1000000 * LRU_RESET_CYCLE_TIME_PERC / server.hz / 100;
+    int iterations = 0;
+    // 同一次调用中的对象使用相同的初始值，避免每个对象都读取一次时钟
+    unsigned int lru = objectInitialLRU();
+
+    while (server.lru_reset_db != -1) {
+        dict* d = server.db[server.lru_reset_db].dict;
+
+        server.lru_reset_cursor = dictScan(d, server.lru_reset_cursor, resetLRUCallback, &lru);
+        if (server.lru_reset_cursor == 0) {
+            if (++server.lru_reset_db == server.dbnum) server.lru_reset_db = -1;
+        }
+
+        // 每遍历100个桶检查一次是否超时
+        if (++iterations % 100 == 0 && ustime() - start > timelimit) break;
+    }
+}
+
 /*
  * 如果有子进程，禁止字典resize
  *
@@ -526,6 +761,47 @@ void updateDictResizePolicy(void) {
  * redis命令表API
  * -------------------------------------------------------------------------- */
 
+/*
+ * 根据字符串表示的 FLAG 计算实际的 FLAG，遇到未知的 FLAG 时返回 REDIS_ERR，
+ * 内置命令和模块注册的命令都使用这个函数
+ */
+int parseCommandFlags(char *f, int *flags) {
+    *flags = 0;
+
+    while(*f != '\0') {
+        switch(*f) {
+            case 'w':
+                *flags |= REDIS_CMD_WRITE; break;
+            case 'r':
+                *flags |= REDIS_CMD_READONLY; break;
+            case 'm':
+                *flags |= REDIS_CMD_DENYOOM; break;
+            case 'a':
+                *flags |= REDIS_CMD_ADMIN; break;
+            case 'p':
+                *flags |= REDIS_CMD_PUBSUB; break;
+            case 's':
+                *flags |= REDIS_CMD_NOSCRIPT; break;
+            case 'R':
+                *flags |= REDIS_CMD_RANDOM; break;
+            case 'S':
+                *flags |= REDIS_CMD_SORT_FOR_SCRIPT; break;
+            case 'l':
+                *flags |= REDIS_CMD_LOADING; break;
+            case 't':
+                *flags |= REDIS_CMD_STALE; break;
+            case 'M':
+                *flags |= REDIS_CMD_SKIP_MONITOR; break;
+            case 'k':
+                *flags |= REDIS_CMD_ASKING; break;
+            default:
+                return REDIS_ERR;
+        }
+        f++;
+    }
+    return REDIS_OK;
+}
+
 /*
  * 根据redis.c文件顶部的命令列表，创建命令表
  */
@@ -543,43 +819,10 @@ void populateCommandTable(void) {
         // 指定命令
         struct redisCommand *c = redisCommandTable+j;
 
-        // 取出字符串 FLAG
-        char *f = c->sflags;
-
         int retval1, retval2;
 
         // 根据字符串 FLAG 生成实际 FLAG
-        while(*f != '\0') {
-            switch(*f) {
-                case 'w':
-                    c->flags |= REDIS_CMD_WRITE; break;
-                case 'r':
-                    c->flags |= REDIS_CMD_READONLY; break;
-                case 'm':
-                    c->flags |= REDIS_CMD_DENYOOM; break;
-                case 'a':
-                    c->flags |= REDIS_CMD_ADMIN; break;
-                case 'p':
-                    c->flags |= REDIS_CMD_PUBSUB; break;
-                case 's':
-                    c->flags |= REDIS_CMD_NOSCRIPT; break;
-                case 'R':
-                    c->flags |= REDIS_CMD_RANDOM; break;
-                case 'S':
-                    c->flags |= REDIS_CMD_SORT_FOR_SCRIPT; break;
-                case 'l':
-                    c->flags |= REDIS_CMD_LOADING; break;
-                case 't':
-                    c->flags |= REDIS_CMD_STALE; break;
-                case 'M':
-                    c->flags |= REDIS_CMD_SKIP_MONITOR; break;
-                case 'k':
-                    c->flags |= REDIS_CMD_ASKING; break;
-                default:
-                    exit(1);
-            }
-            f++;
-        }
+        if (parseCommandFlags(c->sflags, &c->flags) == REDIS_ERR) exit(1);
 
         // 将命令关联到命令表
         retval1 = dictAdd(server.commands, sdsnew(c->name), c);
@@ -706,6 +949,9 @@ int activeExpireCycleTryExpire(redisDb *db, dictEntry *de, long long now) {
  * 当带有过期时间的键比较少时，函数运行得比较保守；
  * 如果带有过期时间的键比较多，那么函数会以更积极的方式来删除过期键，从而可能地释放被过期键占用的内存。
  *
+ * 到期的键从按过期时间排序的过期索引(db->expires_index)中按顺序取出，
+ * 而不是在过期字典中随机抽样，因此只有很少一部分键到期时也不会浪费时间预算。
+ *
  * No more than REDIS_DBCRON_DBS_PER_CALL databases are tested at every
  * iteration.
  *
@@ -814,107 +1060,50 @@ void activeExpireCycle(int type) {
         // 那么下次会直接从下个 DB 开始处理
         current_db++;
 
-        /* Continue to expire if at the end of the cycle more than 25%
-         * of the keys were expired. */
+        /* If there is nothing to expire try next DB ASAP. */
+        // 获取数据库中带过期时间的键的数量
+        // 如果该数量为 0 ，直接跳过这个数据库
+        if (dictSize(db->expires) == 0) {
+            db->avg_ttl = 0;
+            continue;
+        }
+
+        // 随机抽取一个带过期时间的键，更新平均 TTL 统计数据
+        {
+            dictEntry *de = dictGetRandomKey(db->expires);
+            long long ttl = dictGetSignedIntegerVal(de)-mstime();
+
+            if (ttl < 0) ttl = 0;
+            if (db->avg_ttl == 0) db->avg_ttl = ttl;
+            db->avg_ttl = (db->avg_ttl+ttl)/2;
+        }
+
+        // 过期索引按过期时间排序，每次从最早的过期时间开始取出已经到期的键，
+        // 不需要随机抽样，每次检查的键都是需要删除的键
         do {
-            unsigned long num, slots;
-            long long now, ttl_sum;
-            int ttl_samples;
-
-            /* If there is nothing to expire try next DB ASAP. */
-            // 获取数据库中带过期时间的键的数量
-            // 如果该数量为 0 ，直接跳过这个数据库
-            if ((num = dictSize(db->expires)) == 0) {
-                db->avg_ttl = 0;
-                break;
-            }
-            // 获取过期字典的桶数量
-            slots = dictSlots(db->expires);
-            // 当前时间
-            now = mstime();
-
-            /* When there are less than 1% filled slots getting random
-             * keys is expensive, so stop here waiting for better times...
-             * The dictionary will be resized asap. */
-            // 这个数据库的过期字典负载因子低于 1% ，扫描起来太费力了（大部分都会 MISS）
-            // 跳过，等待字典收缩程序运行
-            if (num && slots > DICT_HT_INITIAL_SIZE &&
-                (num*100/slots < 1)) break;
-
-            /* The main collection cycle. Sample random keys among keys
-             * with an expire set, checking for expired ones.
-             *
-             * 样本计数器
-             */
-            // 已处理过期键计数器
-            expired = 0;
-            // 键的总 TTL 计数器
-            ttl_sum = 0;
-            // 总共处理的键计数器
-            ttl_samples = 0;
-
-            // 内循环每次最多只能检查 LOOKUPS_PER_LOOP 个键，ACTIVE_EXPIRE_CYCLE_LOOKUPS_PER_LOOP = 20
-            if (num > ACTIVE_EXPIRE_CYCLE_LOOKUPS_PER_LOOP)
-                num = ACTIVE_EXPIRE_CYCLE_LOOKUPS_PER_LOOP;
-
-            // 开始遍历数据库
-            while (num--) {
-                dictEntry *de;
-                long long ttl;
-
-                // 从 expires 中随机取出一个带过期时间的键
-                if ((de = dictGetRandomKey(db->expires)) == NULL) break;
-                // 计算 TTL
-                ttl = dictGetSignedIntegerVal(de)-now;
-                // 如果键已经过期，那么删除它，并将 expired 计数器增一
-                if (activeExpireCycleTryExpire(db,de,now)) expired++;
-                if (ttl < 0) ttl = 0;
-                // 累积键的 TTL
-                ttl_sum += ttl;
-                // 累积处理键的个数
-                ttl_samples++;
-            }
+            dictEntry *due[ACTIVE_EXPIRE_CYCLE_LOOKUPS_PER_LOOP];
+            long long now = mstime();
+            int k;
 
-            /* Update the average TTL stats for this database. */
-            // 为这个数据库更新平均 TTL 统计数据
-            if (ttl_samples) {
-                // 计算当前平均值
-                long long avg_ttl = ttl_sum/ttl_samples;
-
-                // 如果这是第一次设置数据库平均 TTL ，那么进行初始化
-                if (db->avg_ttl == 0) db->avg_ttl = avg_ttl;
-                // 取数据库的上次平均 TTL 和今次平均 TTL 的平均值
-                /* Smooth the value averaging with the previous one. */
-                db->avg_ttl = (db->avg_ttl+avg_ttl)/2;
-            }
+            // 内循环每次最多只能删除 LOOKUPS_PER_LOOP 个键，ACTIVE_EXPIRE_CYCLE_LOOKUPS_PER_LOOP = 20
+            expired = getDueExpires(db,now,due,ACTIVE_EXPIRE_CYCLE_LOOKUPS_PER_LOOP);
+            for (k = 0; k < expired; k++)
+                activeExpireCycleTryExpire(db,due[k],now);
 
             /* We can't block forever here even if there are many keys to
              * expire. So after a given amount of milliseconds return to the
              * caller waiting for the other active expire cycle. */
             // 我们不能用太长时间处理过期键，
             // 所以这个函数执行一定时间之后就要返回
-
-            // 更新遍历次数
             iteration++;
-
-            // 每遍历 16 次执行一次
-            if ((iteration & 0xf) == 0 && /* check once every 16 iterations. */
-                (ustime()-start) > timelimit)
-            {
-                // 如果遍历次数正好是 16 的倍数
-                // 并且遍历的时间超过了 timelimit
-                // 那么断开 timelimit_exit
+            if (expired && (ustime()-start) > timelimit) {
+                // 还有没有处理完的到期键，下次在 beforeSleep 中以快速模式继续处理
                 timelimit_exit = 1;
+                return;
             }
 
-            // 已经超时了，返回
-            if (timelimit_exit) return;
-
-            /* We don't repeat the cycle if there are less than 25% of keys
-             * found expired in the current DB. */
-            // 如果已删除的过期键占当前总数据库带过期时间的键数量的 25 %(随机抽取ACTIVE_EXPIRE_CYCLE_LOOKUPS_PER_LOOP作为样本检查)
-            // 那么不再遍历
-        } while (expired > ACTIVE_EXPIRE_CYCLE_LOOKUPS_PER_LOOP/4);
+            // 本次取出的键少于 LOOKUPS_PER_LOOP 个，说明这个数据库中已经没有到期的键
+        } while (expired == ACTIVE_EXPIRE_CYCLE_LOOKUPS_PER_LOOP);
     }
 }
 
@@ -1167,6 +1356,10 @@ void databasesCron(void) {
                 }
             }
         }
+
+        // 切换LRU/LFU策略后，渐进式重置对象的lru域，
+        // 有子进程时不修改对象，避免大量的写时复制
+        if (server.lru_reset_db != -1) incrementallyResetLRU();
     }
 }
 
@@ -1296,6 +1489,50 @@ int serverCron(struct aeEventLoop *eventLoop, long long id, void *clientData) {
                 printf("DB %d: %lld keys (%lld volatile) in %lld slots HT.\n",j,used,vkeys,size);
                 /* dictPrintStats(server.dict); */
             }
+
+            // 打印已经到期但还没有被主动过期删除的键(积压)，
+            // 没有积压时只检查过期索引中的第一个键，有积压时最多数到ACTIVE_EXPIRE_CYCLE_BACKLOG_MAX个，
+            // 超过时只打印下限，避免积压很多时统计本身阻塞主线程
+            if (vkeys) {
+                long long now = mstime(), oldest;
+                unsigned long long overdue;
+
+                overdue = countOverdueExpires(server.db+j,now,ACTIVE_EXPIRE_CYCLE_BACKLOG_MAX,&oldest);
+                if (overdue) {
+                    printf("DB %d: %llu%s overdue keys, oldest overdue by %lld ms.\n",j,overdue,
+                        overdue == ACTIVE_EXPIRE_CYCLE_BACKLOG_MAX ? "+" : "",now-oldest);
+                }
+            }
+
+            // 打印键空间索引的内存开销
+            if (server.db[j].keyindex) {
+                printf("DB %d: key index %llu keys, %llu nodes, %zu bytes.\n",j,
+                    (unsigned long long)raxSize(server.db[j].keyindex),
+                    (unsigned long long)server.db[j].keyindex->numnodes,
+                    raxAllocSize(server.db[j].keyindex));
+            }
+        }
+
+        // 打印淘汰的统计信息
+        if (server.stat_eviction_runs) {
+            printf("Eviction: %lld keys in %lld runs (%lld over budget), slowest run %lld us.\n",
+                server.stat_evictedkeys,server.stat_eviction_runs,
+                server.stat_eviction_exhausted,server.stat_eviction_max_us);
+        }
+
+        // 打印惰性释放的统计信息
+        if (lazyfreeGetPendingObjectsCount() || lazyfreeGetFreedObjectsCount()) {
+            printf("Lazy free: %zu pending objects (~%zu bytes), %zu freed in background.\n",
+                lazyfreeGetPendingObjectsCount(),lazyfreeGetPendingBytes(),
+                lazyfreeGetFreedObjectsCount());
+        }
+
+        // 打印快速列表节点压缩的统计信息
+        if (server.list_compress_depth) {
+            quicklistStats qs;
+            quicklistGetStats(&qs);
+            printf("Quicklist: %llu compressed nodes (%llu -> %llu bytes), %llu decompressions.\n",
+                qs.compressed_nodes,qs.compressed_raw_bytes,qs.compressed_bytes,qs.decompressions);
         }
     }
 
@@ -1593,8 +1830,12 @@ void evictionPoolPopulate(dict *sampledict, dict *keydict, struct evictionPoolEn
          * again in the key dictionary to obtain the value object. */
         if (sampledict != keydict) de = dictFind(keydict, key);
         o = dictGetVal(de);
-        // 取出第j个对象的空转时间
-        idle = estimateObjectIdleTime(o);
+        // 取出第j个对象的空转时间，
+        // LFU策略下用255减去访问频率作为"空转时间"，访问频率越低越先被淘汰
+        if (REDIS_MAXMEMORY_IS_LFU(server.maxmemory_policy))
+            idle = 255 - LFUDecrAndReturn(o);
+        else
+            idle = estimateObjectIdleTime(o);
 
         // 将第j个对象插入到驱逐池中，插入排序
         /* Insert the element inside the pool.
@@ -1639,10 +1880,10 @@ void evictionPoolPopulate(dict *sampledict, dict *keydict, struct evictionPoolEn
 }
 
 /*
- * 如果使用内存超出设置，则根据策略释放内存
+ * 计算参与淘汰判断的内存占用
  */
-int freeMemoryIfNeeded(void) {
-    size_t mem_used, mem_tofree, mem_freed;
+static size_t evictionMemoryUsage(void) {
+    size_t mem_used;
     // TODO: 复制相关
     // int slaves = listLength(server.slaves);
 
@@ -1674,17 +1915,57 @@ int freeMemoryIfNeeded(void) {
         mem_used -= aofRewriteBufferSize();
     }
 
-    // 如果目前使用的内存大小比设置的 maxmemory 要小，那么无须执行进一步操作
+    // 3）等待bio线程惰性释放的内存，这部分内存很快会被释放，不应为此淘汰更多的键
+    {
+        size_t pending = lazyfreeGetPendingBytes();
+        mem_used = (mem_used > pending) ? mem_used - pending : 0;
+    }
+
+    return mem_used;
+}
+
+/*
+ * 记录一次淘汰的耗时
+ */
+static void evictionRecordLatency(long long us) {
+    int bucket = 0;
+
+    while (bucket < REDIS_EVICTION_HIST_BUCKETS - 1 && (us >> (bucket + 1)) > 0) bucket++;
+    server.stat_eviction_hist[bucket]++;
+    server.stat_eviction_runs++;
+    if (us > server.stat_eviction_max_us) server.stat_eviction_max_us = us;
+}
+
+/*
+ * 根据策略淘汰键，直到内存占用不超过target字节，
+ * 每次调用最多淘汰 maxmemory_eviction_keys 个键，最多执行 maxmemory_eviction_time 微秒，
+ * 避免一次写入高峰让单个命令阻塞几十毫秒
+ *
+ * 返回值:
+ * REDIS_EVICT_OK       内存占用已经不超过target
+ * REDIS_EVICT_RUNNING  预算耗尽，剩下的工作由 evictionTimeProc 继续完成
+ * REDIS_EVICT_FAIL     没有可以淘汰的键，或者策略禁止淘汰
+ */
+static int performEvictions(size_t target) {
+    size_t mem_used, mem_tofree, mem_freed;
+    long long start, evicted = 0;
+    int result = REDIS_EVICT_OK;
+
+    mem_used = evictionMemoryUsage();
+
+    // 如果目前使用的内存大小比 target 要小，那么无须执行进一步操作
     /* Check if we are over the memory limit. */
-    if (mem_used <= server.maxmemory) return REDIS_OK;
+    if (mem_used <= target) return REDIS_EVICT_OK;
 
-    // 如果占用内存比 maxmemory 要大，但是 maxmemory 策略为不淘汰，那么直接返回
+    // 如果占用内存比 target 要大，但是 maxmemory 策略为不淘汰，那么直接返回
     if (server.maxmemory_policy == REDIS_MAXMEMORY_NO_EVICTION)
-        return REDIS_ERR; /* We need to free memory, but policy forbids. */
+        return REDIS_EVICT_FAIL; /* We need to free memory, but policy forbids. */
+
+    start = ustime();
 
     // 计算需要释放多少字节的内存
     /* Compute how much memory we need to free. */
-    mem_tofree = mem_used - server.maxmemory;
+    mem_tofree = mem_used - target;
 
     // 初始化已释放内存的字节数为 0
     mem_freed = 0;
@@ -1701,12 +1982,13 @@ int freeMemoryIfNeeded(void) {
             redisDb *db = server.db+j;
             dict *dict;
 
-            // 如果策略是 allkeys-lru 或者 allkeys-random，那么淘汰的目标为所有数据库键(从数据库键空间采样)
+            // 如果策略是 allkeys-lru 、 allkeys-lfu 或者 allkeys-random，那么淘汰的目标为所有数据库键(从数据库键空间采样)
             if (server.maxmemory_policy == REDIS_MAXMEMORY_ALLKEYS_LRU ||
+                server.maxmemory_policy == REDIS_MAXMEMORY_ALLKEYS_LFU ||
                 server.maxmemory_policy == REDIS_MAXMEMORY_ALLKEYS_RANDOM)
             {
                 dict = server.db[j].dict;
-            // 如果策略是 volatile-lru 、 volatile-random 或者 volatile-ttl，那么淘汰的目标为带过期时间的数据库键(从过期字典中采样)
+            // 如果策略是 volatile-lru 、 volatile-lfu 、 volatile-random 或者 volatile-ttl，那么淘汰的目标为带过期时间的数据库键(从过期字典中采样)
             } else {
                 dict = server.db[j].expires;
             }
@@ -1723,10 +2005,11 @@ int freeMemoryIfNeeded(void) {
                 bestkey = dictGetKey(de);
             }
  
-            // 如果使用的是 LRU 策略，那么从采样出来的键值对中选出 IDLE 时间最长的那个键
-            /* volatile-lru and allkeys-lru policy */
+            // 如果使用的是 LRU/LFU 策略，那么从采样出来的键值对中选出 IDLE 时间最长(访问频率最低)的那个键
+            /* volatile-lru, allkeys-lru, volatile-lfu and allkeys-lfu policy */
             else if (server.maxmemory_policy == REDIS_MAXMEMORY_ALLKEYS_LRU ||
-                     server.maxmemory_policy == REDIS_MAXMEMORY_VOLATILE_LRU)
+                     server.maxmemory_policy == REDIS_MAXMEMORY_VOLATILE_LRU ||
+                     REDIS_MAXMEMORY_IS_LFU(server.maxmemory_policy))
             {
                 struct evictionPoolEntry *pool = db->eviction_pool;
 
@@ -1823,10 +2106,123 @@ int freeMemoryIfNeeded(void) {
             }
         }
 
-        if (!keys_freed) return REDIS_ERR; /* nothing to free... */
+        evicted += keys_freed;
+
+        if (!keys_freed) {
+            result = REDIS_EVICT_FAIL; /* nothing to free... */
+            break;
+        }
+
+        // 每轮(每个数据库最多一个键)结束后检查预算
+        if (mem_freed < mem_tofree &&
+            (evicted >= server.maxmemory_eviction_keys ||
+             ustime() - start >= server.maxmemory_eviction_time))
+        {
+            server.stat_eviction_exhausted++;
+            result = REDIS_EVICT_RUNNING;
+            break;
+        }
     }
 
-    return REDIS_OK;
+    if (evicted) evictionRecordLatency(ustime() - start);
+
+    return result;
+}
+
+/*
+ * 后台淘汰的目标: maxmemory的低水位
+ */
+static size_t evictionLowWaterTarget(void) {
+    return (size_t)((double)server.maxmemory * server.maxmemory_lowwater / 100);
+}
+
+// 后台淘汰的时间事件是否已经注册
+static int eviction_timeproc_running = 0;
+
+/*
+ * 后台淘汰的时间事件处理器，每次事件循环执行一次预算内的淘汰，
+ * 内存降到低水位或者没有键可以淘汰时注销自己
+ */
+static int evictionTimeProc(aeEventLoop* eventLoop, long long id, void* clientData) {
+    REDIS_NOTUSED(eventLoop);
+    REDIS_NOTUSED(id);
+    REDIS_NOTUSED(clientData);
+
+    if (server.maxmemory && performEvictions(evictionLowWaterTarget()) == REDIS_EVICT_RUNNING)
+        return 0; /* Run again ASAP, without sleeping in the event loop. */
+
+    eviction_timeproc_running = 0;
+    return AE_NOMORE;
+}
+
+/*
+ * 注册后台淘汰的时间事件(如果还没有注册)
+ */
+static void startEvictionTimeProc(void) {
+    if (eviction_timeproc_running) return;
+    if (aeCreateTimeEvent(server.el, 0, evictionTimeProc, NULL, NULL) != AE_ERR)
+        eviction_timeproc_running = 1;
+}
+
+/*
+ * 如果使用内存超出设置，则根据策略释放内存，在执行命令前调用
+ *
+ * 预算耗尽时也返回 REDIS_OK ，允许命令执行，剩余的淘汰工作由后台的时间事件继续，
+ * 只有没有键可以淘汰时才返回 REDIS_ERR
+ */
+int freeMemoryIfNeeded(void) {
+    int result = performEvictions(server.maxmemory);
+
+    if (result == REDIS_EVICT_RUNNING) startEvictionTimeProc();
+    return result == REDIS_EVICT_FAIL ? REDIS_ERR : REDIS_OK;
+}
+
+/*
+ * 在beforeSleep中调用，内存超过低水位时启动后台淘汰，
+ * 从而在写入高峰到来之前预留出空间
+ */
+void evictionBeforeSleep(void) {
+    if (!server.maxmemory || server.maxmemory_policy == REDIS_MAXMEMORY_NO_EVICTION) return;
+
+    if (evictionMemoryUsage() > evictionLowWaterTarget()) startEvictionTimeProc();
+}
+
+/*
+ * EVICTION STATS
+ *
+ * 返回淘汰的统计信息以及耗时直方图，直方图只返回非空的桶，
+ * 每个桶以其上界(微秒)标识，统计信息由 CONFIG RESETSTAT 重置
+ */
+void evictionCommand(redisClient* c) {
+    void* replylen;
+    long numbuckets = 0;
+    int j;
+
+    if (strcasecmp(c->argv[1]->ptr, "stats")) {
+        addReplyError(c, "Syntax error, try EVICTION STATS");
+        return;
+    }
+
+    addReplyMultiBulkLen(c, 12);
+    addReplyBulkCString(c, "evicted_keys");
+    addReplyLongLong(c, server.stat_evictedkeys);
+    addReplyBulkCString(c, "runs");
+    addReplyLongLong(c, server.stat_eviction_runs);
+    addReplyBulkCString(c, "budget_exhausted");
+    addReplyLongLong(c, server.stat_eviction_exhausted);
+    addReplyBulkCString(c, "max_us");
+    addReplyLongLong(c, server.stat_eviction_max_us);
+    addReplyBulkCString(c, "lowwater_bytes");
+    addReplyLongLong(c, (long long)evictionLowWaterTarget());
+    addReplyBulkCString(c, "histogram_us");
+    replylen = addDeferredMultiBulkLength(c);
+    for (j = 0; j < REDIS_EVICTION_HIST_BUCKETS; j++) {
+        if (server.stat_eviction_hist[j] == 0) continue;
+        addReplyLongLong(c, 1LL << (j + 1));
+        addReplyLongLong(c, server.stat_eviction_hist[j]);
+        numbuckets++;
+    }
+    setDeferredMultiBulkLength(c, replylen, numbuckets * 2);
 }
 
 /* -----------------------------------------------------------------------------
@@ -2040,14 +2436,12 @@ int processCommand(redisClient *c) {
     c->cmd = c->lastcmd = lookupCommand(c->argv[0]->ptr);
     // 未查找到命令
     if (!c->cmd) {
-        // TODO: 事务相关
-        // flagTransaction(c);
+        flagTransaction(c);
         addReplyErrorFormat(c, "unknown command '%s'", (char*)c->argv[0]->ptr);
         return REDIS_OK;
     // 命令参数个数错误
     } else if ((c->cmd->arity > 0 && c->cmd->arity != c->argc) || (c->argc < -c->cmd->arity)) {
-        // TODO: 事务相关
-        // flagTransaction(c);
+        flagTransaction(c);
         addReplyErrorFormat(c,"wrong number of arguments for '%s' command", c->cmd->name);
         return REDIS_OK;
     }
@@ -2139,8 +2533,7 @@ int processCommand(redisClient *c) {
         // 如果即将要执行的命令可能占用大量内存（REDIS_CMD_DENYOOM）
         // 并且前面的内存释放失败的话，那么向客户端返回内存错误
         if ((c->cmd->flags & REDIS_CMD_DENYOOM) && retval == REDIS_ERR) {
-            // TODO: 事务相关
-            // flagTransaction(c);
+            flagTransaction(c);
             addReply(c, shared.oomerr);
             return REDIS_OK;
         }
@@ -2155,8 +2548,7 @@ int processCommand(redisClient *c) {
         /* server.masterhost == NULL && */
         (c->cmd->flags & REDIS_CMD_WRITE /* || c->cmd->proc == pingCommand */))
     {
-        // TODO: 事务相关
-        // flagTransaction(c);
+        flagTransaction(c);
         if (server.aof_last_write_status == REDIS_OK)
             addReply(c, shared.bgsaveerr);
         else
@@ -2246,29 +2638,26 @@ int processCommand(redisClient *c) {
     //     return REDIS_OK;
     // }
 
-    // TODO: 事务相关
     /* Exec the command */
-    // if (c->flags & REDIS_MULTI &&
-    //     c->cmd->proc != execCommand && c->cmd->proc != discardCommand &&
-    //     c->cmd->proc != multiCommand && c->cmd->proc != watchCommand)
-    // {
-    //     // 在事务上下文中，除 EXEC 、 DISCARD 、 MULTI 和 WATCH 命令之外其他所有命令都会被入队到事务队列中
-    //     queueMultiCommand(c);
-    //     addReply(c,shared.queued);
-    // } else {
-
-    // 执行命令，默认启用慢日志 & 开启统计 & 开启命令传播
-    call(c, REDIS_CALL_FULL);
-
-    // TODO: 复制相关
-    // c->woff = server.master_repl_offset;
+    if (c->flags & REDIS_MULTI &&
+        c->cmd->proc != execCommand && c->cmd->proc != discardCommand &&
+        c->cmd->proc != multiCommand && c->cmd->proc != watchCommand)
+    {
+        // 在事务上下文中，除 EXEC 、 DISCARD 、 MULTI 和 WATCH 命令之外其他所有命令都会被入队到事务队列中
+        queueMultiCommand(c);
+        addReply(c,shared.queued);
+    } else {
+        // 执行命令，默认启用慢日志 & 开启统计 & 开启命令传播
+        call(c, REDIS_CALL_FULL);
 
-    // TODO: 阻塞相关
-    // 处理那些解除了阻塞的键
-    // if (listLength(server.ready_keys))
-    //     handleClientsBlockedOnLists();
+        // TODO: 复制相关
+        // c->woff = server.master_repl_offset;
 
-    // }
+        // TODO: 阻塞相关
+        // 处理那些解除了阻塞的键
+        // if (listLength(server.ready_keys))
+        //     handleClientsBlockedOnLists();
+    }
 
     return REDIS_OK;
 }
@@ -2455,7 +2844,7 @@ void createSharedObjects(void) {
 
     // 常用整数
     for (j = 0; j < REDIS_SHARED_INTEGERS; j++) {
-        shared.integers[j] = createObject(REDIS_STRING,(void*)(long)j);
+        shared.integers[j] = makeObjectShared(createObject(REDIS_STRING,(void*)(long)j));
         shared.integers[j]->encoding = REDIS_ENCODING_INT;
     }
 
@@ -2782,15 +3171,27 @@ void initServerConfig() {
     server.maxmemory = REDIS_DEFAULT_MAXMEMORY;
     server.maxmemory_policy = REDIS_DEFAULT_MAXMEMORY_POLICY;
     server.maxmemory_samples = REDIS_DEFAULT_MAXMEMORY_SAMPLES;
+    server.maxmemory_eviction_keys = REDIS_DEFAULT_MAXMEMORY_EVICTION_KEYS;
+    server.maxmemory_eviction_time = REDIS_DEFAULT_MAXMEMORY_EVICTION_TIME;
+    server.maxmemory_lowwater = REDIS_DEFAULT_MAXMEMORY_LOWWATER;
+    server.lfu_log_factor = REDIS_DEFAULT_LFU_LOG_FACTOR;
+    server.lfu_decay_time = REDIS_DEFAULT_LFU_DECAY_TIME;
+    server.lazyfree_lazy_server_del = 1;
+    server.lru_reset_db = -1;
+    server.lru_reset_cursor = 0;
 
     // 底层编码转换
     server.hash_max_ziplist_entries = REDIS_HASH_MAX_ZIPLIST_ENTRIES;
     server.hash_max_ziplist_value = REDIS_HASH_MAX_ZIPLIST_VALUE;
+    server.hash_max_packhash_entries = REDIS_HASH_MAX_PACKHASH_ENTRIES;
     server.list_max_ziplist_entries = REDIS_LIST_MAX_ZIPLIST_ENTRIES;
     server.list_max_ziplist_value = REDIS_LIST_MAX_ZIPLIST_VALUE;
+    server.list_max_ziplist_size = REDIS_LIST_MAX_ZIPLIST_SIZE;
+    server.list_compress_depth = REDIS_LIST_COMPRESS_DEPTH;
     server.set_max_intset_entries = REDIS_SET_MAX_INTSET_ENTRIES;
     server.zset_max_ziplist_entries = REDIS_ZSET_MAX_ZIPLIST_ENTRIES;
     server.zset_max_ziplist_value = REDIS_ZSET_MAX_ZIPLIST_VALUE;
+    server.zset_max_skiplist_entries = REDIS_ZSET_MAX_SKIPLIST_ENTRIES;
 
     // TODO: 基数统计相关
     /* server.hll_sparse_max_bytes = REDIS_DEFAULT_HLL_SPARSE_MAX_BYTES; */
@@ -2907,6 +3308,10 @@ void resetServerStats(void) {
     server.stat_numconnections = 0;
     server.stat_expiredkeys = 0;
     server.stat_evictedkeys = 0;
+    server.stat_eviction_runs = 0;
+    server.stat_eviction_exhausted = 0;
+    server.stat_eviction_max_us = 0;
+    memset(server.stat_eviction_hist, 0, sizeof(server.stat_eviction_hist));
     server.stat_keyspace_misses = 0;
     server.stat_keyspace_hits = 0;
     server.stat_fork_time = 0;
@@ -2988,18 +3393,24 @@ void initServer() {
     for (j = 0; j < server.dbnum; j++) {
         server.db[j].dict = dictCreate(&dbDictType, NULL);
         server.db[j].expires = dictCreate(&keyptrDictType, NULL);
+        server.db[j].expires_index = raxNew();
 
         // TODO: 阻塞相关
         // server.db[j].blocking_keys = dictCreate(&keylistDictType,NULL);
         // server.db[j].ready_keys = dictCreate(&setDictType,NULL);
-        // TODO: 事务相关
-        // server.db[j].watched_keys = dictCreate(&keylistDictType,NULL);
+        server.db[j].watched_keys = dictCreate(&keylistDictType, NULL);
 
         server.db[j].eviction_pool = evictionPoolAlloc();
+        server.db[j].keyindex = NULL;
         server.db[j].id = j;
         server.db[j].avg_ttl = 0;
     }
 
+    // 创建键空间索引SCAN游标表
+    server.keyindex_cursors = dictCreate(&keyIndexCursorDictType, NULL);
+    server.keyindex_cursor_queue = listCreate();
+    server.keyindex_cursor_next = 1;
+
     // TODO: 发布/订阅相关
     // 创建 PUBSUB 相关结构
     // server.pubsub_channels = dictCreate(&keylistDictType,NULL);
@@ -3092,6 +3503,9 @@ void initServer() {
     // 初始化脚本系统
     // scriptingInit();
 
+    // 初始化模块系统，模块通过MODULE LOAD命令加载
+    moduleInitModulesSystem();
+
     // TODO: 慢查询相关
     // 初始化慢查询日志功能
     // slowlogInit();
@@ -3141,6 +3555,9 @@ void beforeSleep(struct aeEventLoop* eventLoop) {
     if (server.active_expire_enabled /* && server.masterhost == NULL */)
         activeExpireCycle(ACTIVE_EXPIRE_CYCLE_FAST);
 
+    // 内存超过低水位时启动后台淘汰
+    evictionBeforeSleep();
+
     // TODO: 复制相关
     /* Send all the slaves an ACK request if at least one client blocked
      * during the previous event loop iteration. */
@@ -25,9 +25,15 @@
 #include "sds.h"
 #include "adlist.h"
 #include "ziplist.h"
+#include "listpack.h"
+#include "packhash.h"
+#include "roaring.h"
+#include "zbtree.h"
+#include "quicklist.h"
 #include "zskiplist.h"
 #include "dict.h"
 #include "intset.h"
+#include "rax.h"
 #include "config.h"
 
 /* 执行函数的状态码 */
@@ -50,6 +56,7 @@
 #define REDIS_MAX_WRITE_PER_EVENT (1024 * 64)
 #define REDIS_SHARED_SELECT_CMDS 10
 #define REDIS_SHARED_INTEGERS 10000
+#define REDIS_SHARED_REFCOUNT INT_MAX   /* Refcount of immortal shared objects */
 #define REDIS_SHARED_BULKHDR_LEN 32
 #define REDIS_MAX_LOGMSG_LEN    1024    /* Default maximum length of syslog messages */
 #define REDIS_AOF_REWRITE_PERC  100
@@ -85,6 +92,15 @@
 #define REDIS_DEFAULT_REPL_DISABLE_TCP_NODELAY 0
 #define REDIS_DEFAULT_MAXMEMORY 0
 #define REDIS_DEFAULT_MAXMEMORY_SAMPLES 5
+#define REDIS_DEFAULT_MAXMEMORY_EVICTION_KEYS 64        /* Max keys evicted per call */
+#define REDIS_DEFAULT_MAXMEMORY_EVICTION_TIME 1000      /* Max microseconds per call */
+#define REDIS_DEFAULT_MAXMEMORY_LOWWATER 100            /* Percent of maxmemory */
+#define REDIS_EVICTION_HIST_BUCKETS 24                  /* Log2 buckets, in microseconds */
+
+/* Return values of performEvictions() */
+#define REDIS_EVICT_OK 0        /* Memory usage is under the target */
+#define REDIS_EVICT_RUNNING 1   /* Budget exhausted, more keys to evict */
+#define REDIS_EVICT_FAIL 2      /* Nothing left to evict */
 #define REDIS_DEFAULT_AOF_FILENAME "appendonly.aof"
 #define REDIS_DEFAULT_AOF_NO_FSYNC_ON_REWRITE 0
 #define REDIS_DEFAULT_ACTIVE_REHASHING 1
@@ -101,6 +117,8 @@
 #define ACTIVE_EXPIRE_CYCLE_SLOW_TIME_PERC 25 /* CPU max % for keys collection */
 #define ACTIVE_EXPIRE_CYCLE_SLOW 0
 #define ACTIVE_EXPIRE_CYCLE_FAST 1
+#define ACTIVE_EXPIRE_CYCLE_BACKLOG_MAX 1000 /* Max overdue keys counted per DB for the stats log. */
+#define LRU_RESET_CYCLE_TIME_PERC 10 /* CPU max % for resetting lru after a policy switch */
 
 /* Protocol and I/O related defines */
 #define REDIS_MAX_QUERYBUF_LEN  (1024*1024*1024)    /* 1GB max query buffer. */
@@ -110,6 +128,7 @@
 #define REDIS_MBULK_BIG_ARG     (1024*32)
 #define REDIS_LONGSTR_SIZE 21                       /* Bytes needed for long -> str */
 #define REDIS_AOF_AUTOSYNC_BYTES (1024*1024*32)     /* fdatasync every 32MB */
+#define REDIS_KEYINDEX_CURSOR_MAX 65536             /* Max unfinished index SCAN iterations */
 /* When configuring the Redis eventloop, we setup it so that the total number
  * of file descriptors we can handle are server.maxclients + RESERVED_FDS + FDSET_INCR
  * that is our safety margin. */
@@ -138,6 +157,11 @@
 #define REDIS_ENCODING_INTSET 6        /* 底层整数集合 */
 #define REDIS_ENCODING_SKIPLIST 7      /* 底层跳表&字典 */
 #define REDIS_ENCODING_EMBSTR 8        /* 底层sds */
+#define REDIS_ENCODING_QUICKLIST 9     /* 底层快速列表(压缩列表组成的双向链表) */
+#define REDIS_ENCODING_LISTPACK 10     /* 底层listpack */
+#define REDIS_ENCODING_PACKHASH 11     /* 底层listpack&开放寻址索引 */
+#define REDIS_ENCODING_ROARING 12      /* 底层roaring位图 */
+#define REDIS_ENCODING_BTREE 13      /* 底层B+树&字典 */
 
 /* 列表方向 */
 /* List related stuff */
@@ -158,6 +182,8 @@
 #define LIST_MAX_ZIPLIST_ENTRIES 512
 #define LIST_MAX_ZIPLIST_VALUE 64
 #define SET_MAX_INTSET_ENTRIES 512
+#define SET_ROARING_SPARSE_CONTAINERS 1024      /* 容器数量超过该值时检查roaring位图是否过于稀疏 */
+#define SET_ROARING_MIN_CONTAINER_CARD 4        /* 平均每个容器的元素少于该值时转为哈希表 */
 
 /* Anti-warning macro */
 #define REDIS_NOTUSED(V) ((void) V)
@@ -184,8 +210,18 @@
 #define REDIS_MAXMEMORY_ALLKEYS_LRU 3
 #define REDIS_MAXMEMORY_ALLKEYS_RANDOM 4
 #define REDIS_MAXMEMORY_NO_EVICTION 5
+#define REDIS_MAXMEMORY_VOLATILE_LFU 6
+#define REDIS_MAXMEMORY_ALLKEYS_LFU 7
 #define REDIS_DEFAULT_MAXMEMORY_POLICY REDIS_MAXMEMORY_NO_EVICTION
 
+// LFU策略下，robj的lru域被拆分为两部分:
+// 高16位为计数器最近一次衰减的时间(分钟)，低8位为对数计数器
+#define REDIS_MAXMEMORY_IS_LFU(policy) ((policy) == REDIS_MAXMEMORY_VOLATILE_LFU || \
+                                        (policy) == REDIS_MAXMEMORY_ALLKEYS_LFU)
+#define REDIS_LFU_INIT_VAL 5
+#define REDIS_DEFAULT_LFU_LOG_FACTOR 10
+#define REDIS_DEFAULT_LFU_DECAY_TIME 1
+
 /* Client flags */
 #define REDIS_SLAVE (1<<0)   /* This client is a slave server */
 #define REDIS_MASTER (1<<1)  /* This client is a master server */
@@ -275,13 +311,24 @@
 #define REDIS_PROPAGATE_REPL 2
 
 /* Zip structure related defaults */
-#define REDIS_HASH_MAX_ZIPLIST_ENTRIES 512
+#define REDIS_HASH_MAX_ZIPLIST_ENTRIES 128
 #define REDIS_HASH_MAX_ZIPLIST_VALUE 64
+#define REDIS_HASH_MAX_PACKHASH_ENTRIES 16384
 #define REDIS_LIST_MAX_ZIPLIST_ENTRIES 512
 #define REDIS_LIST_MAX_ZIPLIST_VALUE 64
+#define REDIS_LIST_MAX_ZIPLIST_SIZE -2
+#define REDIS_LIST_COMPRESS_DEPTH 0
 #define REDIS_SET_MAX_INTSET_ENTRIES 512
 #define REDIS_ZSET_MAX_ZIPLIST_ENTRIES 128
 #define REDIS_ZSET_MAX_ZIPLIST_VALUE 64
+#define REDIS_ZSET_MAX_SKIPLIST_ENTRIES 1024
+
+/*
+ * 集合和有序集合的集合操作类型
+ */
+#define REDIS_OP_UNION 0
+#define REDIS_OP_DIFF 1
+#define REDIS_OP_INTER 2
 
 /*
  * 命令标志
@@ -307,10 +354,15 @@
  */
 typedef struct zset {
 
+    // REDIS_ENCODING_SKIPLIST编码时值是指向跳跃表节点中分值的指针，
+    // REDIS_ENCODING_BTREE编码时值是分值本身(dictGetDoubleVal)
     dict* dict;
 
     zskiplist* zsl;
 
+    // REDIS_ENCODING_BTREE编码使用，此时zsl为NULL
+    zbtree* zbt;
+
 } zset;
 
 /*
@@ -323,6 +375,18 @@ typedef struct {
     int minex, maxex;
 } zrangespec;
 
+/*
+ * 有序集合，表示字典序开区间/闭区间范围的结构，
+ * min和max为shared.minstring/shared.maxstring时表示负无穷/正无穷
+ */
+typedef struct {
+
+    robj* min;
+    robj* max;
+
+    int minex, maxex;
+} zlexrangespec;
+
 /*
  * 列表类型迭代器结构体定义
  */
@@ -336,7 +400,8 @@ typedef struct {
 
     unsigned char* zi;
 
-    listNode* ln;
+    // 快速列表迭代器
+    quicklistIter* iter;
 
 } listTypeIterator;
 
@@ -349,7 +414,7 @@ typedef struct {
 
     unsigned char* zi;
 
-    listNode* ln;
+    quicklistEntry entry;
 
 } listTypeEntry;
 
@@ -366,6 +431,8 @@ typedef struct {
 
     dictIterator* di;
 
+    roaringIterator ri;
+
 } setTypeIterator;
 
 /*
@@ -390,6 +457,32 @@ typedef struct {
 #define REDIS_HASH_KEY 1
 #define REDIS_HASH_VALUE 2
 
+/*
+ * 有序集合的输入迭代器，输入可以是集合或有序集合，集合元素的分值视为1，
+ * 用于ZUNIONSTORE，ZINTERSTORE以及模块遍历有序集合
+ */
+typedef struct {
+
+    robj* subject;
+
+    double weight;
+
+    // 集合
+    setTypeIterator* si;
+
+    // listpack编码的有序集合
+    unsigned char* eptr;
+    unsigned char* sptr;
+
+    // 跳跃表编码的有序集合
+    zskiplistNode* node;
+
+    // B+树编码的有序集合
+    zbtreePos pos;
+    int valid;
+
+} zsetopsrc;
+
 /*
  * 客户端缓冲区限制
  */
@@ -484,6 +577,36 @@ struct sharedObjectsStruct {
     *bulkhdr[REDIS_SHARED_BULKHDR_LEN];  /* "$<value>\r\n" */
 };
 
+/*
+ * 事务队列中的一个命令
+ */
+/* Client MULTI/EXEC state */
+typedef struct multiCmd {
+
+    robj** argv;
+
+    int argc;
+
+    struct redisCommand* cmd;
+
+} multiCmd;
+
+/*
+ * 客户端的事务状态
+ */
+typedef struct multiState {
+
+    // 事务队列，按入队顺序保存命令
+    multiCmd* commands;     /* Array of MULTI commands */
+
+    // 已入队的命令数量
+    int count;              /* Total number of MULTI commands */
+
+    // 事务队列数组的容量
+    int capacity;
+
+} multiState;
+
 /*
  * Redis数据库结构体定义
  */
@@ -498,18 +621,26 @@ typedef struct redisDb {
     // 过期字典
     dict* expires;    /* Timeout of keys with a timeout set */
 
+    // 过期索引，按照过期时间排序的基数树，
+    // 元素为8字节大端序的过期时间加上键名，主动过期时按顺序取出到期的键
+    rax* expires_index;
+
     // TODO: 阻塞相关
     /* dict* blocking_keys; */
 
     // TODO: 阻塞相关
     /* dict* ready_keys; */
 
-    // TODO: 事务相关
-    /* dict* watched_keys; */
+    // 正在被WATCH命令监视的键，键为被监视的键，值为监视这个键的客户端链表
+    dict* watched_keys;
 
     // 驱逐池
     struct evictionPoolEntry* eviction_pool;
 
+    // 键空间的有序索引(基数树)，为NULL表示未启用，
+    // 启用后带有字面量前缀的模式只需要访问匹配的子树
+    rax* keyindex;
+
     // 数据库id
     int id;           /* Database ID */
 
@@ -518,6 +649,23 @@ typedef struct redisDb {
 
 } redisDb;
 
+/*
+ * 键空间索引SCAN游标，记录迭代下一个要返回的键，
+ * 游标本身只是一个编号，停止位置保存在服务器中，每一页换一个新的编号
+ */
+typedef struct keyIndexCursor {
+
+    // 游标id，不为0
+    unsigned long id;
+
+    // 游标所属的数据库id
+    int dbid;
+
+    // 下一个要返回的键，下一次调用从大于等于该键的位置继续
+    sds seek;
+
+} keyIndexCursor;
+
 /*
  * redis客户端状态结构
  *
@@ -615,9 +763,8 @@ typedef struct redisClient {
     // 从服务器的监听端口号
     /* int slave_listening_port; */
 
-    // TODO: 事务相关
     // 事务状态
-    /* multiState mstate; */
+    multiState mstate;      /* MULTI/EXEC state */
 
     // TODO: 阻塞相关
     // 阻塞类型
@@ -629,9 +776,8 @@ typedef struct redisClient {
     // 最后被写入的全局复制偏移量
     /* long long woff; */
 
-    // TODO: 事务相关
     // 被监视的键
-    /* list* watched_keys; */
+    list* watched_keys;     /* Keys WATCHED for MULTI/EXEC CAS */
 
     // TODO: 发布/订阅相关
     // 记录客户端所有订阅的频道的集合
@@ -639,6 +785,9 @@ typedef struct redisClient {
     // 记录所有订阅频道的客户端信息的链表
     /* list* pubsub_patterns; */
 
+    // 上一次SCAN使用的编译后的模式，MATCH模式不变时直接复用
+    stringmatcher* scan_matcher;
+
     // ip:port对
     sds peerid;
 
@@ -705,6 +854,9 @@ struct redisCommand {
 
     // 统计信息，记录命令被执行的总次数
     long long calls;
+
+    // 模块注册的命令指向模块中的实现函数，内置命令为NULL
+    struct RedisModuleCommandProxy* module_cmd;
 };
 
 
@@ -729,6 +881,16 @@ struct redisServer {
     // 一个数组，保存着服务器中的所有数据库
     redisDb* db;
 
+    // 键空间索引SCAN的游标表，游标id -> keyIndexCursor所在的链表节点，
+    // 游标可以在任意连接上继续使用，迭代结束或超出数量上限后被删除
+    dict* keyindex_cursors;
+
+    // 按最近使用顺序排列的键空间索引SCAN游标，表头最久没有使用
+    list* keyindex_cursor_queue;
+
+    // 下一个分配的键空间索引SCAN游标id
+    unsigned long keyindex_cursor_next;
+
     // 命令表
     dict* commands;
 
@@ -870,6 +1032,16 @@ struct redisServer {
     // 因为回收内存而被释放的键的数量
     long long stat_evictedkeys;
 
+    // 执行了淘汰的次数，以及其中因预算耗尽而提前返回的次数
+    long long stat_eviction_runs;
+    long long stat_eviction_exhausted;
+
+    // 每次淘汰耗时的直方图，第i个桶记录耗时在[2^i, 2^(i+1))微秒之间的次数
+    long long stat_eviction_hist[REDIS_EVICTION_HIST_BUCKETS];
+
+    // 单次淘汰的最长耗时(微秒)
+    long long stat_eviction_max_us;
+
     // 键命中次数
     long long stat_keyspace_hits;
 
@@ -1107,6 +1279,27 @@ struct redisServer {
 
     int maxmemory_samples;
 
+    // 单次淘汰最多删除的键数量和最长执行时间(微秒)
+    int maxmemory_eviction_keys;
+    long long maxmemory_eviction_time;
+
+    // 低水位(maxmemory的百分比)，beforeSleep在内存超过低水位时提前淘汰键
+    int maxmemory_lowwater;
+
+    // LFU对数计数器的增长因子，越大计数器增长越慢
+    int lfu_log_factor;
+
+    // LFU计数器衰减的周期(分钟)，每经过一个周期计数器减1
+    int lfu_decay_time;
+
+    // 切换LRU/LFU策略后渐进式重置lru域的进度，
+    // 正在重置的数据库(-1表示没有需要重置的对象)，以及该数据库的dictScan游标
+    int lru_reset_db;
+    unsigned long lru_reset_cursor;
+
+    // 删除或覆盖键时，是否将大的值对象交给bio线程释放
+    int lazyfree_lazy_server_del;
+
     // TODO: 阻塞相关
     /* Blocked clients */
     /* unsigned int bpop_blocked_clients; */
@@ -1131,16 +1324,28 @@ struct redisServer {
 
     size_t hash_max_ziplist_value;
 
+    // 超过hash_max_ziplist_entries之后，使用带索引的紧凑编码的最大键值对数量
+    size_t hash_max_packhash_entries;
+
     size_t list_max_ziplist_entries;
 
     size_t list_max_ziplist_value;
 
+    // 快速列表每个节点的大小限制，含义见quicklist.h中的fill
+    int list_max_ziplist_size;
+
+    // 快速列表两端不压缩的节点数量，0表示不压缩
+    int list_compress_depth;
+
     size_t set_max_intset_entries;
 
     size_t zset_max_ziplist_entries;
 
     size_t zset_max_ziplist_value;
 
+    // 超过这个元素数量的有序集合从跳跃表转为B+树
+    size_t zset_max_skiplist_entries;
+
     size_t hll_sparse_max_bytes;
 
     time_t unixtime;
@@ -1198,6 +1403,11 @@ extern struct sharedObjectsStruct shared;
 extern dictType setDictType;
 extern dictType zsetDictType;
 extern dictType hashDictType;
+extern dictType dbDictType;
+extern dictType keyIndexCursorDictType;
+extern dictType keyptrDictType;
+extern dictType keylistDictType;
+extern dictType commandTableDictType;
 extern double R_Zero, R_PosInf, R_NegInf, R_Nan;
 
 /*
@@ -1210,10 +1420,17 @@ int htNeedsResize(dict* dict);
  */
 unsigned int getLRUClock(void);
 
+/* LFU */
+unsigned int objectInitialLRU(void);
+unsigned long LFUGetTimeInMinutes(void);
+unsigned long LFUDecrAndReturn(robj* o);
+void updateLFU(robj* val);
+
 /* Redis object implementation */
 void decrRefCount(robj* o);
 void decrRefCountVoid(void* o);
 void incrRefCount(robj* o);
+robj* makeObjectShared(robj* o);
 robj* resetRefCount(robj* obj);
 void freeStringObject(robj* o);
 void freeListObject(robj* o);
@@ -1231,27 +1448,33 @@ robj* getDecodedObject(robj* o);
 size_t stringObjectLen(robj* o);
 robj* createStringObjectFromLongLong(long long value);
 robj* createStringObjectFromLongDouble(long double value);
-robj* createListObject(void);
-robj* createZiplistObject(void);
+robj* createQuicklistObject(void);
+robj* createListpackObject(void);
 robj* createSetObject(void);
 robj* createIntsetObject(void);
 robj* createHashObject(void);
 robj* createZsetObject(void);
-robj* createZsetZiplistObject(void);
+robj* createZsetListpackObject(void);
 int checkType(redisClient* c, robj* o, int type);
 int getLongFromObjectOrReply(redisClient* c, robj* o, long* target, const char* msg);
 int getLongLongFromObjectOrReply(redisClient* c, robj* o, long long* target, const char* msg);
 int getDoubleFromObjectOrReply(redisClient* c, robj* o, double* target, const char* msg);
 int getLongDoubleFromObjectOrReply(redisClient* c, robj* o, long double* target, const char* msg);
 int getLongLongFromObject(robj* o, long long* target);
+int getDoubleFromObject(robj* o, double* target);
 int getLongDoubleFromObject(robj* o, long double* target);
 char* strEncoding(int encoding);
 int compareStringObjects(robj* a, robj* b);
 int collateStringObjects(robj* a, robj* b);
 int equalStringObjects(robj* a, robj* b);
 unsigned long long estimateObjectIdleTime(robj* o);
+void objectCommand(redisClient* c);
 #define sdsEncodedObject(objptr) (objptr->encoding == REDIS_ENCODING_RAW || objptr->encoding == REDIS_ENCODING_EMBSTR)
 
+/* Bitops */
+size_t redisPopcount(void* s, long count);
+long redisBitpos(void* s, unsigned long count, int bit);
+
 /* List data type */
 void listTypeTryConversion(robj* subject, robj* value);
 void listTypePush(robj* subject, robj* value, int where);
@@ -1264,6 +1487,7 @@ robj* listTypeGet(listTypeEntry* entry);
 void listTypeInsert(listTypeEntry* entry, robj* value, int where);
 int listTypeEqual(listTypeEntry* entry, robj* o);
 void listTypeDelete(listTypeEntry* entry);
+void listTypeDelRange(robj* subject, long start, long count);
 void listTypeConvert(robj* subject, int enc);
 
 /* Set data type */
@@ -1308,7 +1532,34 @@ zskiplistNode* zslGetElementByRank(zskiplist* zsl, unsigned long rank);
 int zslValueGteMin(double value, zrangespec* spec);
 int zslValueLteMax(double value, zrangespec* spec);
 int zslParseRange(robj* min, robj* max, zrangespec* spec);
-// encoding is ziplist
+unsigned long zslDeleteRangeByScore(zskiplist* zsl, zrangespec* range, dict* dict);
+unsigned long zslDeleteRangeByRank(zskiplist* zsl, unsigned int start, unsigned int end, dict* dict);
+int zslParseLexRange(robj* min, robj* max, zlexrangespec* spec);
+void zslFreeLexRange(zlexrangespec* spec);
+int compareStringObjectsForLexRange(robj* a, robj* b);
+int zslLexValueGteMin(robj* value, zlexrangespec* spec);
+int zslLexValueLteMax(robj* value, zlexrangespec* spec);
+zskiplistNode* zslFirstInLexRange(zskiplist* zsl, zlexrangespec* range);
+zskiplistNode* zslLastInLexRange(zskiplist* zsl, zlexrangespec* range);
+
+// zbtree
+zbtree* zbtCreate(void);
+void zbtFree(zbtree* zbt);
+void zbtInsert(zbtree* zbt, double score, robj* obj);
+int zbtDelete(zbtree* zbt, double score, robj* obj);
+int zbtNext(zbtreePos* pos);
+int zbtPrev(zbtreePos* pos);
+unsigned long zbtFirstInRange(zbtree* zbt, zrangespec* range, zbtreePos* pos);
+unsigned long zbtLastInRange(zbtree* zbt, zrangespec* range, zbtreePos* pos);
+unsigned long zbtCountInRange(zbtree* zbt, zrangespec* range);
+unsigned long zbtFirstInLexRange(zbtree* zbt, zlexrangespec* range, zbtreePos* pos);
+unsigned long zbtLastInLexRange(zbtree* zbt, zlexrangespec* range, zbtreePos* pos);
+unsigned long zbtCountInLexRange(zbtree* zbt, zlexrangespec* range);
+unsigned long zbtDeleteRangeByRank(zbtree* zbt, unsigned long start, unsigned long end, dict* dict);
+unsigned long zbtDeleteRangeByScore(zbtree* zbt, zrangespec* range, dict* dict);
+unsigned long zbtGetRank(zbtree* zbt, double score, robj* obj);
+int zbtGetElementByRank(zbtree* zbt, unsigned long rank, zbtreePos* pos);
+// encoding is listpack
 unsigned char* zzlInsert(unsigned char* zl, robj* ele, double score);
 double zzlGetScore(unsigned char* sptr);
 void zzlNext(unsigned char* zl, unsigned char** eptr, unsigned char** sptr);
@@ -1316,6 +1567,11 @@ void zzlPrev(unsigned char* zl, unsigned char** eptr, unsigned char** sptr);
 // zset
 unsigned int zsetLength(robj* zobj);
 void zsetConvert(robj* zobj, int encoding);
+void zuiInitIterator(zsetopsrc* op);
+void zuiClearIterator(zsetopsrc* op);
+unsigned long zuiLength(zsetopsrc* op);
+int zuiNext(zsetopsrc* op, robj** ele, double* score);
+int zuiFind(zsetopsrc* op, robj* ele, double* score);
 
 /* db.c -- Keyspace access API */
 int removeExpire(redisDb* db, robj* key);
@@ -1330,16 +1586,34 @@ robj* lookupKeyReadOrReply(redisClient* c, robj* key, robj* reply);
 robj* lookupKeyWriteOrReply(redisClient* c, robj* key, robj* reply);
 void dbAdd(redisDb* db, robj* key, robj* val);
 void dbOverwrite(redisDb* db, robj* key, robj* val);
-void setKey(redisDb* db, robj* key, robj* val);
+void setKey(redisDb* db, robj* key, robj* val, int keepttl);
 int dbExists(redisDb* db, robj* key);
 robj* dbRandomKey(redisDb* db);
 int dbDelete(redisDb* db, robj* key);
 robj* dbUnshareStringValue(redisDb* db, robj* key, robj* o);
-long long emptyDb(void(callback)(void*));
+long long emptyDb(int dbnum, int async, void(callback)(void*));
 int selectDb(redisClient* c, int id);
+int parseScanCursorOrReply(redisClient* c, robj* o, unsigned long* cursor);
+void scanGenericCommand(redisClient* c, robj* o, unsigned long cursor);
+int getDueExpires(redisDb* db, long long now, dictEntry** due, int count);
+unsigned long long countOverdueExpires(redisDb* db, long long now, unsigned long long max, long long* oldest);
 void signalModifiedKey(redisDb* db, robj* key);
 void signalFlushedDb(int dbid);
 
+/* lazyfree.c -- Background freeing of large values */
+// 释放工作量(需要释放的内存块数)超过该值的对象才交给bio线程释放
+#define LAZYFREE_THRESHOLD 64
+size_t lazyfreeGetFreeEffort(robj* obj);
+void freeObjectAsync(robj* obj);
+int dbAsyncDelete(redisDb* db, robj* key);
+void emptyDbAsync(redisDb* db);
+void lazyfreeFreeObjectFromBioThread(robj* obj, size_t bytes);
+void lazyfreeFreeDatabaseFromBioThread(dict* ht1, dict* ht2);
+void lazyfreeFreeRaxFromBioThread(rax* rt);
+size_t lazyfreeGetPendingObjectsCount(void);
+size_t lazyfreeGetPendingBytes(void);
+size_t lazyfreeGetFreedObjectsCount(void);
+
 /* networking.c -- Networking and Client related operations */
 redisClient* createClient(int fd);
 void freeClient(redisClient* c);
@@ -1353,6 +1627,7 @@ void setDeferredMultiBulkLength(redisClient* c, void* node, long length);
 void addReplySds(redisClient* c, sds s);
 void addReplyError(redisClient* c, char* err);
 void addReplyErrorFormat(redisClient *c, const char *fmt, ...);
+void addReplyString(redisClient* c, char* s, size_t len);
 void addReplyStatus(redisClient* c, char* status);
 void addReplyDouble(redisClient* c, double d);
 void addReplyLongLong(redisClient* c, long long ll);
@@ -1360,6 +1635,7 @@ void addReplyBulk(redisClient* c, robj* obj);
 void addReplyBulkCString(redisClient* c, char* s);
 void addReplyBulkCBuffer(redisClient* c, void* p, size_t len);
 void addReplyBulkLongLong(redisClient* c, long long ll);
+void addReplyBulkCopy(redisClient* c, robj* obj);
 void addReplyMultiBulkLen(redisClient* c, long length);
 void acceptTcpHandler(aeEventLoop* el, int fd, void* privdata, int mask);
 void acceptUnixHandler(aeEventLoop* el, int fd, void* privdata, int mask);
@@ -1375,10 +1651,28 @@ void pauseClients(mstime_t duration);
 int clientsArePaused(void);
 unsigned long getClientOutputBufferMemoryUsage(redisClient *c);
 
+/* MULTI/EXEC/WATCH... */
+void initClientMultiState(redisClient* c);
+void freeClientMultiState(redisClient* c);
+void queueMultiCommand(redisClient* c);
+void discardTransaction(redisClient* c);
+void flagTransaction(redisClient* c);
+void unwatchAllKeys(redisClient* c);
+void touchWatchedKey(redisDb* db, robj* key);
+void touchWatchedKeysOnFlush(int dbid);
+
+/* Modules */
+void moduleInitModulesSystem(void);
+
 /* Core functions */
+int freeMemoryIfNeeded(void);
+void evictionBeforeSleep(void);
+void evictionCommand(redisClient* c);
+void resetServerStats(void);
 int processCommand(redisClient *c);
 struct redisCommand* lookupCommand(sds name);
 struct redisCommand *lookupCommandOrOriginal(sds name);
+int parseCommandFlags(char *f, int *flags);
 void call(redisClient* c, int flags);
 void propagate(struct redisCommand *cmd, int dbid, robj **argv, int argc, int flags);
 int prepareForShutdown(int flags);
@@ -1406,11 +1700,15 @@ void getRandomHexChars(char *p, unsigned int len);
 /* Configuration */
 void appendServerSaveParams(time_t seconds, int changes);
 void resetServerSaveParams();
+void configCommand(redisClient* c);
 
 /* Commands prototypes */
 
 /* Db commands */
 void delCommand(redisClient* c);
+void unlinkCommand(redisClient* c);
+void flushdbCommand(redisClient* c);
+void flushallCommand(redisClient* c);
 void existsCommand(redisClient* c);
 void selectCommand(redisClient* c);
 void randomkeyCommand(redisClient* c);
@@ -1423,6 +1721,16 @@ void shutdownCommand(redisClient* c);
 void moveCommand(redisClient* c);
 void renameCommand(redisClient* c);
 void renamenxCommand(redisClient* c);
+void keyindexCommand(redisClient* c);
+void expireCommand(redisClient* c);
+void expireatCommand(redisClient* c);
+void pexpireCommand(redisClient* c);
+void pexpireatCommand(redisClient* c);
+void mexpireCommand(redisClient* c);
+void mpexpireCommand(redisClient* c);
+void ttlCommand(redisClient* c);
+void pttlCommand(redisClient* c);
+void persistCommand(redisClient* c);
 
 /* String commands */
 void setCommand(redisClient* c);
@@ -1430,12 +1738,24 @@ void setnxCommand(redisClient* c);
 void setexCommand(redisClient* c);
 void psetexCommand(redisClient* c);
 void getCommand(redisClient* c);
+void getexCommand(redisClient* c);
 void appendCommand(redisClient* c);
+void setrangeCommand(redisClient* c);
+void getrangeCommand(redisClient* c);
+void setbitCommand(redisClient* c);
+void getbitCommand(redisClient* c);
+void bitcountCommand(redisClient* c);
+void bitposCommand(redisClient* c);
+void bitopCommand(redisClient* c);
+void bitfieldCommand(redisClient* c);
 void incrCommand(redisClient* c);
 void decrCommand(redisClient* c);
 void incrbyCommand(redisClient* c);
 void decrbyCommand(redisClient* c);
 void incrbyfloatCommand(redisClient* c);
+void mgetCommand(redisClient* c);
+void msetCommand(redisClient* c);
+void msetnxCommand(redisClient* c);
 
 /* List commands */
 void lpushCommand(redisClient* c);
@@ -1450,6 +1770,11 @@ void lindexCommand(redisClient* c);
 void lremCommand(redisClient* c);
 void ltrimCommand(redisClient* c);
 void lsetCommand(redisClient* c);
+void lrangeCommand(redisClient* c);
+void lposCommand(redisClient* c);
+void lmoveCommand(redisClient* c);
+void rpoplpushCommand(redisClient* c);
+void quicklistCommand(redisClient* c);
 
 /* Hash commands */
 void hsetCommand(redisClient* c);
@@ -1459,15 +1784,28 @@ void hexistsCommand(redisClient* c);
 void hdelCommand(redisClient* c);
 void hlenCommand(redisClient* c);
 void hgetallCommand(redisClient* c);
+void hmsetCommand(redisClient* c);
+void hmgetCommand(redisClient* c);
+void hincrbyCommand(redisClient* c);
+void hincrbyfloatCommand(redisClient* c);
+void hkeysCommand(redisClient* c);
+void hvalsCommand(redisClient* c);
+void hstrlenCommand(redisClient* c);
+void hscanCommand(redisClient* c);
 
 /* Set commands */
 void saddCommand(redisClient* c);
 void sremCommand(redisClient* c);
 void scardCommand(redisClient* c);
 void sismemberCommand(redisClient* c);
+void smismemberCommand(redisClient* c);
 void sinterCommand(redisClient* c);
+void sinterstoreCommand(redisClient* c);
+void sintercardCommand(redisClient* c);
 void sunionCommand(redisClient* c);
 void sdiffCommand(redisClient* c);
+void sunionstoreCommand(redisClient* c);
+void sdiffstoreCommand(redisClient* c);
 void srandmemberCommand(redisClient* c);
 void spopCommand(redisClient* c);
 
@@ -1481,5 +1819,29 @@ void zrankCommand(redisClient* c);
 void zrevrankCommand(redisClient* c);
 void zremCommand(redisClient* c);
 void zscoreCommand(redisClient* c);
+void zincrbyCommand(redisClient* c);
+void zremrangebyrankCommand(redisClient* c);
+void zremrangebyscoreCommand(redisClient* c);
+void zrangebyscoreCommand(redisClient* c);
+void zrevrangebyscoreCommand(redisClient* c);
+void zlexcountCommand(redisClient* c);
+void zunionstoreCommand(redisClient* c);
+void zinterstoreCommand(redisClient* c);
+void zrangebylexCommand(redisClient* c);
+void zrevrangebylexCommand(redisClient* c);
+
+/* Sort commands */
+void sortCommand(redisClient* c);
+void sortroCommand(redisClient* c);
+
+/* Transaction commands */
+void multiCommand(redisClient* c);
+void execCommand(redisClient* c);
+void discardCommand(redisClient* c);
+void watchCommand(redisClient* c);
+void unwatchCommand(redisClient* c);
+
+/* Module commands */
+void moduleCommand(redisClient* c);
 
 #endif //TINYREDIS_REDIS_H
@@ -0,0 +1,168 @@
+//
+// Created by zouyi on 2021/11/13.
+//
+
+#ifndef TINYREDIS_REDISMODULE_H
+#define TINYREDIS_REDISMODULE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * 模块API
+ *
+ * 模块是通过MODULE LOAD加载的动态库，需要导出RedisModule_OnLoad函数，
+ * 在其中调用RedisModule_Init，然后用RedisModule_CreateCommand注册命令；
+ * 模块不直接链接服务器的符号，所有API都是RedisModule_Init通过上下文中的RedisModule_GetApi取得的函数指针，
+ * 服务器内部的数据结构变化时，模块不需要重新编译
+ *
+ * 命令执行期间创建的字符串和打开的键在命令返回后自动释放
+ */
+
+/* ---------------- Defines common between core and modules --------------- */
+
+/* Error status return values. */
+#define REDISMODULE_OK 0
+#define REDISMODULE_ERR 1
+
+/* API versions. */
+#define REDISMODULE_APIVER_1 1
+
+/* API flags and constants */
+#define REDISMODULE_READ (1<<0)
+#define REDISMODULE_WRITE (1<<1)
+
+#define REDISMODULE_LIST_HEAD 0
+#define REDISMODULE_LIST_TAIL 1
+
+/* Key types. */
+#define REDISMODULE_KEYTYPE_EMPTY 0
+#define REDISMODULE_KEYTYPE_STRING 1
+#define REDISMODULE_KEYTYPE_LIST 2
+#define REDISMODULE_KEYTYPE_HASH 3
+#define REDISMODULE_KEYTYPE_SET 4
+#define REDISMODULE_KEYTYPE_ZSET 5
+
+/* Reply types. */
+#define REDISMODULE_POSTPONED_ARRAY_LEN -1
+
+/* Error messages. */
+#define REDISMODULE_ERRORMSG_WRONGTYPE "WRONGTYPE Operation against a key holding the wrong kind of value"
+
+/* ------------------------- End of common defines ------------------------ */
+
+#ifndef REDISMODULE_CORE
+
+typedef struct RedisModuleString RedisModuleString;
+
+#else
+
+/* 服务器内部的字符串就是字符串对象 */
+#define RedisModuleString robj
+
+#endif
+
+typedef struct RedisModuleCtx RedisModuleCtx;
+typedef struct RedisModuleKey RedisModuleKey;
+
+// 命令的实现函数
+typedef int (*RedisModuleCmdFunc)(RedisModuleCtx* ctx, RedisModuleString** argv, int argc);
+
+// RedisModule_KeyForEach的回调函数，返回REDISMODULE_ERR时停止遍历，
+// field和value只在回调期间有效
+typedef int (*RedisModuleForEachFunc)(RedisModuleCtx* ctx, RedisModuleString* field, RedisModuleString* value, void* privdata);
+
+#define REDISMODULE_API_FUNC(x) (*x)
+
+#ifndef REDISMODULE_CORE
+
+void* REDISMODULE_API_FUNC(RedisModule_Alloc)(size_t bytes);
+void* REDISMODULE_API_FUNC(RedisModule_Realloc)(void* ptr, size_t bytes);
+void REDISMODULE_API_FUNC(RedisModule_Free)(void* ptr);
+int REDISMODULE_API_FUNC(RedisModule_GetApi)(const char*, void*);
+int REDISMODULE_API_FUNC(RedisModule_CreateCommand)(RedisModuleCtx* ctx, const char* name, RedisModuleCmdFunc cmdfunc, int arity, const char* strflags, int firstkey, int lastkey, int keystep);
+int REDISMODULE_API_FUNC(RedisModule_SetModuleAttribs)(RedisModuleCtx* ctx, const char* name, int ver, int apiver);
+int REDISMODULE_API_FUNC(RedisModule_WrongArity)(RedisModuleCtx* ctx);
+int REDISMODULE_API_FUNC(RedisModule_ReplyWithLongLong)(RedisModuleCtx* ctx, long long ll);
+int REDISMODULE_API_FUNC(RedisModule_ReplyWithError)(RedisModuleCtx* ctx, const char* err);
+int REDISMODULE_API_FUNC(RedisModule_ReplyWithSimpleString)(RedisModuleCtx* ctx, const char* msg);
+int REDISMODULE_API_FUNC(RedisModule_ReplyWithArray)(RedisModuleCtx* ctx, long len);
+void REDISMODULE_API_FUNC(RedisModule_ReplySetArrayLength)(RedisModuleCtx* ctx, long len);
+int REDISMODULE_API_FUNC(RedisModule_ReplyWithStringBuffer)(RedisModuleCtx* ctx, const char* buf, size_t len);
+int REDISMODULE_API_FUNC(RedisModule_ReplyWithString)(RedisModuleCtx* ctx, RedisModuleString* str);
+int REDISMODULE_API_FUNC(RedisModule_ReplyWithNull)(RedisModuleCtx* ctx);
+int REDISMODULE_API_FUNC(RedisModule_ReplyWithDouble)(RedisModuleCtx* ctx, double d);
+RedisModuleString* REDISMODULE_API_FUNC(RedisModule_CreateString)(RedisModuleCtx* ctx, const char* ptr, size_t len);
+RedisModuleString* REDISMODULE_API_FUNC(RedisModule_CreateStringFromLongLong)(RedisModuleCtx* ctx, long long ll);
+const char* REDISMODULE_API_FUNC(RedisModule_StringPtrLen)(RedisModuleString* str, size_t* len);
+int REDISMODULE_API_FUNC(RedisModule_StringToLongLong)(RedisModuleString* str, long long* ll);
+int REDISMODULE_API_FUNC(RedisModule_StringToDouble)(RedisModuleString* str, double* d);
+RedisModuleKey* REDISMODULE_API_FUNC(RedisModule_OpenKey)(RedisModuleCtx* ctx, RedisModuleString* keyname, int mode);
+void REDISMODULE_API_FUNC(RedisModule_CloseKey)(RedisModuleKey* kp);
+int REDISMODULE_API_FUNC(RedisModule_KeyType)(RedisModuleKey* kp);
+size_t REDISMODULE_API_FUNC(RedisModule_ValueLength)(RedisModuleKey* kp);
+int REDISMODULE_API_FUNC(RedisModule_DeleteKey)(RedisModuleKey* key);
+int REDISMODULE_API_FUNC(RedisModule_StringSet)(RedisModuleKey* key, RedisModuleString* str);
+RedisModuleString* REDISMODULE_API_FUNC(RedisModule_StringGet)(RedisModuleKey* key);
+int REDISMODULE_API_FUNC(RedisModule_ListPush)(RedisModuleKey* kp, int where, RedisModuleString* ele);
+RedisModuleString* REDISMODULE_API_FUNC(RedisModule_ListPop)(RedisModuleKey* key, int where);
+int REDISMODULE_API_FUNC(RedisModule_HashSet)(RedisModuleKey* key, RedisModuleString* field, RedisModuleString* value);
+RedisModuleString* REDISMODULE_API_FUNC(RedisModule_HashGet)(RedisModuleKey* key, RedisModuleString* field);
+int REDISMODULE_API_FUNC(RedisModule_SetAdd)(RedisModuleKey* key, RedisModuleString* ele);
+int REDISMODULE_API_FUNC(RedisModule_SetIsMember)(RedisModuleKey* key, RedisModuleString* ele);
+int REDISMODULE_API_FUNC(RedisModule_ZsetScore)(RedisModuleKey* key, RedisModuleString* ele, double* score);
+int REDISMODULE_API_FUNC(RedisModule_KeyForEach)(RedisModuleKey* key, RedisModuleForEachFunc fn, void* privdata);
+
+#define REDISMODULE_GET_API(name) \
+    RedisModule_GetApi("RedisModule_" #name, ((void **)&RedisModule_ ## name))
+
+/*
+ * 模块在RedisModule_OnLoad中调用，取得所有API函数并注册模块的名字和版本
+ */
+/* This is included inline inside each Redis module. */
+static int RedisModule_Init(RedisModuleCtx* ctx, const char* name, int ver, int apiver) {
+    void* getapifuncptr = ((void**) ctx)[0];
+    RedisModule_GetApi = (int (*)(const char*, void*)) (unsigned long) getapifuncptr;
+    REDISMODULE_GET_API(Alloc);
+    REDISMODULE_GET_API(Realloc);
+    REDISMODULE_GET_API(Free);
+    REDISMODULE_GET_API(CreateCommand);
+    REDISMODULE_GET_API(SetModuleAttribs);
+    REDISMODULE_GET_API(WrongArity);
+    REDISMODULE_GET_API(ReplyWithLongLong);
+    REDISMODULE_GET_API(ReplyWithError);
+    REDISMODULE_GET_API(ReplyWithSimpleString);
+    REDISMODULE_GET_API(ReplyWithArray);
+    REDISMODULE_GET_API(ReplySetArrayLength);
+    REDISMODULE_GET_API(ReplyWithStringBuffer);
+    REDISMODULE_GET_API(ReplyWithString);
+    REDISMODULE_GET_API(ReplyWithNull);
+    REDISMODULE_GET_API(ReplyWithDouble);
+    REDISMODULE_GET_API(CreateString);
+    REDISMODULE_GET_API(CreateStringFromLongLong);
+    REDISMODULE_GET_API(StringPtrLen);
+    REDISMODULE_GET_API(StringToLongLong);
+    REDISMODULE_GET_API(StringToDouble);
+    REDISMODULE_GET_API(OpenKey);
+    REDISMODULE_GET_API(CloseKey);
+    REDISMODULE_GET_API(KeyType);
+    REDISMODULE_GET_API(ValueLength);
+    REDISMODULE_GET_API(DeleteKey);
+    REDISMODULE_GET_API(StringSet);
+    REDISMODULE_GET_API(StringGet);
+    REDISMODULE_GET_API(ListPush);
+    REDISMODULE_GET_API(ListPop);
+    REDISMODULE_GET_API(HashSet);
+    REDISMODULE_GET_API(HashGet);
+    REDISMODULE_GET_API(SetAdd);
+    REDISMODULE_GET_API(SetIsMember);
+    REDISMODULE_GET_API(ZsetScore);
+    REDISMODULE_GET_API(KeyForEach);
+
+    RedisModule_SetModuleAttribs(ctx, name, ver, apiver);
+    return REDISMODULE_OK;
+}
+
+#endif /* REDISMODULE_CORE */
+
+#endif //TINYREDIS_REDISMODULE_H
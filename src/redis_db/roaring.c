@@ -0,0 +1,734 @@
+//
+// Created by zouyi on 2021/11/10.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "zmalloc.h"
+#include "roaring.h"
+
+#define ROARING_BITMAP_WORDS 1024
+#define ROARING_BITMAP_BYTES (ROARING_BITMAP_WORDS * sizeof(uint64_t))
+
+#define ROARING_SIGN ((uint64_t) 1 << 63)
+
+/*
+ * 有符号整数与保持大小顺序的无符号整数之间的映射
+ */
+#define ROARING_ENCODE(v) ((uint64_t) (v) ^ ROARING_SIGN)
+#define ROARING_DECODE(u) ((int64_t) ((u) ^ ROARING_SIGN))
+
+#define ROARING_KEY(u) ((u) >> 16)
+#define ROARING_LOW(u) ((uint16_t) ((u) & 0xffff))
+
+/*
+ * Container API
+ */
+
+/*
+ * 在数组容器中二分查找low，找到返回下标，否则返回-(插入位置)-1
+ */
+static long arrayFind(const uint16_t* arr, uint32_t card, uint16_t low) {
+    long lo = 0, hi = (long) card - 1;
+
+    while (lo <= hi) {
+        long mid = (lo + hi) >> 1;
+        if (arr[mid] < low) lo = mid + 1;
+        else if (arr[mid] > low) hi = mid - 1;
+        else return mid;
+    }
+    return -(lo + 1);
+}
+
+static int bitmapTest(const uint64_t* words, uint16_t low) {
+    return (words[low >> 6] >> (low & 63)) & 1;
+}
+
+static uint32_t bitmapPopcount(const uint64_t* words) {
+    uint32_t card = 0;
+    int i;
+
+    for (i = 0; i < ROARING_BITMAP_WORDS; i++) card += __builtin_popcountll(words[i]);
+    return card;
+}
+
+/*
+ * 将数组容器转为位图容器
+ */
+static void containerToBitmap(roaringContainer* c) {
+    uint64_t* words = zcalloc(ROARING_BITMAP_BYTES);
+    uint16_t* arr = c->data;
+    uint32_t i;
+
+    for (i = 0; i < c->card; i++) words[arr[i] >> 6] |= (uint64_t) 1 << (arr[i] & 63);
+    zfree(arr);
+    c->data = words;
+    c->type = ROARING_CONTAINER_BITMAP;
+    c->cap = 0;
+}
+
+/*
+ * 元素数量不超过ROARING_ARRAY_MAX的位图容器转为数组容器
+ */
+static void containerShrink(roaringContainer* c) {
+    uint64_t* words = c->data;
+    uint16_t* arr;
+    uint32_t n = 0;
+    int i;
+
+    if (c->type != ROARING_CONTAINER_BITMAP || c->card > ROARING_ARRAY_MAX) return;
+
+    arr = zmalloc((c->card ? c->card : 1) * sizeof(uint16_t));
+    for (i = 0; i < ROARING_BITMAP_WORDS; i++) {
+        uint64_t w = words[i];
+        while (w) {
+            arr[n++] = i * 64 + __builtin_ctzll(w);
+            w &= w - 1;
+        }
+    }
+    zfree(words);
+    c->data = arr;
+    c->type = ROARING_CONTAINER_ARRAY;
+    c->cap = c->card ? c->card : 1;
+}
+
+static int containerAdd(roaringContainer* c, uint16_t low) {
+    if (c->type == ROARING_CONTAINER_ARRAY) {
+        uint16_t* arr = c->data;
+        long pos = arrayFind(arr, c->card, low);
+
+        if (pos >= 0) return 0;
+        pos = -pos - 1;
+
+        if (c->card == ROARING_ARRAY_MAX) {
+            containerToBitmap(c);
+            return containerAdd(c, low);
+        }
+
+        if (c->card == c->cap) {
+            c->cap = c->cap < 64 ? c->cap * 2 : c->cap + c->cap / 2;
+            if (c->cap > ROARING_ARRAY_MAX) c->cap = ROARING_ARRAY_MAX;
+            arr = c->data = zrealloc(arr, c->cap * sizeof(uint16_t));
+        }
+        memmove(arr + pos + 1, arr + pos, (c->card - pos) * sizeof(uint16_t));
+        arr[pos] = low;
+        c->card++;
+        return 1;
+    } else {
+        uint64_t* words = c->data;
+        uint64_t bit = (uint64_t) 1 << (low & 63);
+
+        if (words[low >> 6] & bit) return 0;
+        words[low >> 6] |= bit;
+        c->card++;
+        return 1;
+    }
+}
+
+static int containerRemove(roaringContainer* c, uint16_t low) {
+    if (c->type == ROARING_CONTAINER_ARRAY) {
+        uint16_t* arr = c->data;
+        long pos = arrayFind(arr, c->card, low);
+
+        if (pos < 0) return 0;
+        memmove(arr + pos, arr + pos + 1, (c->card - pos - 1) * sizeof(uint16_t));
+        c->card--;
+        return 1;
+    } else {
+        uint64_t* words = c->data;
+        uint64_t bit = (uint64_t) 1 << (low & 63);
+
+        if (!(words[low >> 6] & bit)) return 0;
+        words[low >> 6] &= ~bit;
+        c->card--;
+        containerShrink(c);
+        return 1;
+    }
+}
+
+static int containerContains(const roaringContainer* c, uint16_t low) {
+    if (c->type == ROARING_CONTAINER_ARRAY)
+        return arrayFind(c->data, c->card, low) >= 0;
+    return bitmapTest(c->data, low);
+}
+
+/*
+ * 返回容器中第rank小的元素，rank从0开始
+ */
+static uint16_t containerSelect(const roaringContainer* c, uint32_t rank) {
+    const uint64_t* words;
+    int i;
+
+    if (c->type == ROARING_CONTAINER_ARRAY) return ((uint16_t*) c->data)[rank];
+
+    words = c->data;
+    for (i = 0; i < ROARING_BITMAP_WORDS; i++) {
+        uint32_t cnt = __builtin_popcountll(words[i]);
+        uint64_t w = words[i];
+
+        if (rank >= cnt) {
+            rank -= cnt;
+            continue;
+        }
+        while (rank--) w &= w - 1;
+        return i * 64 + __builtin_ctzll(w);
+    }
+    assert(0);
+    return 0;
+}
+
+static void containerFree(roaringContainer* c) {
+    zfree(c->data);
+}
+
+static void containerCopy(roaringContainer* dst, const roaringContainer* src) {
+    size_t bytes = (src->type == ROARING_CONTAINER_ARRAY) ? src->card * sizeof(uint16_t) : ROARING_BITMAP_BYTES;
+
+    *dst = *src;
+    if (src->type == ROARING_CONTAINER_ARRAY) dst->cap = src->card ? src->card : 1;
+    dst->data = zmalloc(bytes ? bytes : sizeof(uint16_t));
+    memcpy(dst->data, src->data, bytes);
+}
+
+/*
+ * 将容器c中的元素合并到位图words中
+ */
+static void containerOrInto(uint64_t* words, const roaringContainer* c) {
+    if (c->type == ROARING_CONTAINER_ARRAY) {
+        const uint16_t* arr = c->data;
+        uint32_t i;
+
+        for (i = 0; i < c->card; i++) words[arr[i] >> 6] |= (uint64_t) 1 << (arr[i] & 63);
+    } else {
+        const uint64_t* src = c->data;
+        int i;
+
+        for (i = 0; i < ROARING_BITMAP_WORDS; i++) words[i] |= src[i];
+    }
+}
+
+/*
+ * 计算两个容器的交集，结果保存在dst中，dst->card可能为0
+ */
+static void containerAnd(roaringContainer* dst, const roaringContainer* a, const roaringContainer* b) {
+    dst->key = a->key;
+
+    if (a->type == ROARING_CONTAINER_BITMAP && b->type == ROARING_CONTAINER_BITMAP) {
+        const uint64_t* wa = a->data;
+        const uint64_t* wb = b->data;
+        uint64_t* words = zmalloc(ROARING_BITMAP_BYTES);
+        int i;
+
+        for (i = 0; i < ROARING_BITMAP_WORDS; i++) words[i] = wa[i] & wb[i];
+        dst->type = ROARING_CONTAINER_BITMAP;
+        dst->data = words;
+        dst->card = bitmapPopcount(words);
+        dst->cap = 0;
+        containerShrink(dst);
+        return;
+    }
+
+    // 至少有一个是数组容器，结果一定可以用数组容器保存
+    if (a->type == ROARING_CONTAINER_BITMAP) {
+        const roaringContainer* t = a;
+        a = b;
+        b = t;
+    }
+
+    {
+        const uint16_t* aa = a->data;
+        uint32_t cap = (b->type == ROARING_CONTAINER_ARRAY && b->card < a->card) ? b->card : a->card;
+        uint16_t* out = zmalloc((cap ? cap : 1) * sizeof(uint16_t));
+        uint32_t n = 0, i = 0, j = 0;
+
+        if (b->type == ROARING_CONTAINER_BITMAP) {
+            for (i = 0; i < a->card; i++)
+                if (bitmapTest(b->data, aa[i])) out[n++] = aa[i];
+        } else {
+            const uint16_t* bb = b->data;
+
+            while (i < a->card && j < b->card) {
+                if (aa[i] < bb[j]) i++;
+                else if (aa[i] > bb[j]) j++;
+                else {
+                    out[n++] = aa[i];
+                    i++;
+                    j++;
+                }
+            }
+        }
+        dst->type = ROARING_CONTAINER_ARRAY;
+        dst->data = out;
+        dst->card = n;
+        dst->cap = cap ? cap : 1;
+    }
+}
+
+/*
+ * 计算两个容器的并集，结果保存在dst中
+ */
+static void containerOr(roaringContainer* dst, const roaringContainer* a, const roaringContainer* b) {
+    dst->key = a->key;
+
+    if (a->type == ROARING_CONTAINER_ARRAY && b->type == ROARING_CONTAINER_ARRAY &&
+        a->card + b->card <= ROARING_ARRAY_MAX) {
+        const uint16_t* aa = a->data;
+        const uint16_t* bb = b->data;
+        uint32_t cap = a->card + b->card;
+        uint16_t* out = zmalloc(cap * sizeof(uint16_t));
+        uint32_t n = 0, i = 0, j = 0;
+
+        while (i < a->card && j < b->card) {
+            if (aa[i] < bb[j]) out[n++] = aa[i++];
+            else if (aa[i] > bb[j]) out[n++] = bb[j++];
+            else {
+                out[n++] = aa[i];
+                i++;
+                j++;
+            }
+        }
+        while (i < a->card) out[n++] = aa[i++];
+        while (j < b->card) out[n++] = bb[j++];
+
+        dst->type = ROARING_CONTAINER_ARRAY;
+        dst->data = out;
+        dst->card = n;
+        dst->cap = cap;
+    } else {
+        uint64_t* words = zcalloc(ROARING_BITMAP_BYTES);
+
+        containerOrInto(words, a);
+        containerOrInto(words, b);
+        dst->type = ROARING_CONTAINER_BITMAP;
+        dst->data = words;
+        dst->card = bitmapPopcount(words);
+        dst->cap = 0;
+        containerShrink(dst);
+    }
+}
+
+/*
+ * 计算容器a减去容器b的差集，结果保存在dst中，dst->card可能为0
+ */
+static void containerAndNot(roaringContainer* dst, const roaringContainer* a, const roaringContainer* b) {
+    dst->key = a->key;
+
+    if (a->type == ROARING_CONTAINER_ARRAY) {
+        const uint16_t* aa = a->data;
+        uint16_t* out = zmalloc((a->card ? a->card : 1) * sizeof(uint16_t));
+        uint32_t n = 0, i = 0, j = 0;
+
+        if (b->type == ROARING_CONTAINER_BITMAP) {
+            for (i = 0; i < a->card; i++)
+                if (!bitmapTest(b->data, aa[i])) out[n++] = aa[i];
+        } else {
+            const uint16_t* bb = b->data;
+
+            while (i < a->card) {
+                if (j == b->card || aa[i] < bb[j]) out[n++] = aa[i++];
+                else if (aa[i] > bb[j]) j++;
+                else {
+                    i++;
+                    j++;
+                }
+            }
+        }
+        dst->type = ROARING_CONTAINER_ARRAY;
+        dst->data = out;
+        dst->card = n;
+        dst->cap = a->card ? a->card : 1;
+    } else {
+        uint64_t* words = zmalloc(ROARING_BITMAP_BYTES);
+        int i;
+
+        memcpy(words, a->data, ROARING_BITMAP_BYTES);
+        if (b->type == ROARING_CONTAINER_BITMAP) {
+            const uint64_t* wb = b->data;
+            for (i = 0; i < ROARING_BITMAP_WORDS; i++) words[i] &= ~wb[i];
+        } else {
+            const uint16_t* bb = b->data;
+            uint32_t j;
+            for (j = 0; j < b->card; j++) words[bb[j] >> 6] &= ~((uint64_t) 1 << (bb[j] & 63));
+        }
+        dst->type = ROARING_CONTAINER_BITMAP;
+        dst->data = words;
+        dst->card = bitmapPopcount(words);
+        dst->cap = 0;
+        containerShrink(dst);
+    }
+}
+
+/*
+ * Roaring API
+ */
+
+/*
+ * 二分查找key对应的容器，找到返回下标，否则返回-(插入位置)-1
+ */
+static long roaringFindContainer(const roaring* r, uint64_t key) {
+    long lo = 0, hi = (long) r->size - 1;
+
+    while (lo <= hi) {
+        long mid = (lo + hi) >> 1;
+        uint64_t k = r->containers[mid].key;
+        if (k < key) lo = mid + 1;
+        else if (k > key) hi = mid - 1;
+        else return mid;
+    }
+    return -(lo + 1);
+}
+
+/*
+ * 树状数组
+ *
+ * ranks[i]保存下标在(i - lowbit(i), i]之间的容器的元素数量之和，
+ * 修改一个容器的元素数量和按排名查找容器都是O(log(size))
+ */
+#define ROARING_LOWBIT(i) ((i) & -(i))
+
+/*
+ * 用容器数组重建树状数组，O(size)
+ */
+static void roaringBuildRanks(roaring* r) {
+    uint32_t i, j;
+
+    r->ranks = zrealloc(r->ranks, (r->size + 1) * sizeof(uint64_t));
+    for (i = 1; i <= r->size; i++) r->ranks[i] = r->containers[i - 1].card;
+    for (i = 1; i <= r->size; i++) {
+        j = i + ROARING_LOWBIT(i);
+        if (j <= r->size) r->ranks[j] += r->ranks[i];
+    }
+    r->ranks_valid = 1;
+}
+
+/*
+ * 下标为pos的容器的元素数量增加delta，树状数组已经失效时什么都不做
+ */
+static void roaringUpdateRanks(roaring* r, uint32_t pos, int delta) {
+    uint32_t i;
+
+    if (!r->ranks_valid) return;
+    for (i = pos + 1; i <= r->size; i += ROARING_LOWBIT(i)) r->ranks[i] += delta;
+}
+
+/*
+ * 在下标pos处插入一个空的数组容器
+ */
+static roaringContainer* roaringInsertContainer(roaring* r, uint32_t pos, uint64_t key) {
+    roaringContainer* c;
+
+    if (r->size == r->alloc) {
+        r->alloc = r->alloc ? r->alloc * 2 : 4;
+        r->containers = zrealloc(r->containers, r->alloc * sizeof(roaringContainer));
+    }
+    memmove(r->containers + pos + 1, r->containers + pos, (r->size - pos) * sizeof(roaringContainer));
+    r->size++;
+    r->ranks_valid = 0;
+
+    c = r->containers + pos;
+    c->key = key;
+    c->card = 0;
+    c->cap = 4;
+    c->type = ROARING_CONTAINER_ARRAY;
+    c->data = zmalloc(c->cap * sizeof(uint16_t));
+    return c;
+}
+
+static void roaringDeleteContainer(roaring* r, uint32_t pos) {
+    containerFree(r->containers + pos);
+    memmove(r->containers + pos, r->containers + pos + 1, (r->size - pos - 1) * sizeof(roaringContainer));
+    r->size--;
+    r->ranks_valid = 0;
+}
+
+/*
+ * 将容器c添加到r的末尾，c的key必须大于r中所有容器的key，空容器直接释放
+ */
+static void roaringAppendContainer(roaring* r, roaringContainer* c) {
+    if (c->card == 0) {
+        containerFree(c);
+        return;
+    }
+    if (r->size == r->alloc) {
+        r->alloc = r->alloc ? r->alloc * 2 : 4;
+        r->containers = zrealloc(r->containers, r->alloc * sizeof(roaringContainer));
+    }
+    r->containers[r->size++] = *c;
+    r->card += c->card;
+    r->ranks_valid = 0;
+}
+
+/*
+ * 创建一个空的roaring位图
+ */
+roaring* roaringNew(void) {
+    roaring* r = zmalloc(sizeof(roaring));
+
+    r->containers = NULL;
+    r->size = 0;
+    r->alloc = 0;
+    r->card = 0;
+    r->ranks = NULL;
+    r->ranks_valid = 0;
+    return r;
+}
+
+/*
+ * 释放roaring位图
+ */
+void roaringFree(roaring* r) {
+    uint32_t i;
+
+    for (i = 0; i < r->size; i++) containerFree(r->containers + i);
+    zfree(r->containers);
+    zfree(r->ranks);
+    zfree(r);
+}
+
+/*
+ * 复制roaring位图
+ */
+roaring* roaringCopy(const roaring* r) {
+    roaring* copy = roaringNew();
+    uint32_t i;
+
+    for (i = 0; i < r->size; i++) {
+        roaringContainer c;
+        containerCopy(&c, r->containers + i);
+        roaringAppendContainer(copy, &c);
+    }
+    return copy;
+}
+
+/*
+ * 添加元素，元素已经存在时返回0
+ */
+int roaringAdd(roaring* r, int64_t value) {
+    uint64_t u = ROARING_ENCODE(value);
+    long pos = roaringFindContainer(r, ROARING_KEY(u));
+    roaringContainer* c;
+
+    if (pos >= 0) {
+        c = r->containers + pos;
+    } else {
+        c = roaringInsertContainer(r, -pos - 1, ROARING_KEY(u));
+    }
+
+    if (!containerAdd(c, ROARING_LOW(u))) return 0;
+    r->card++;
+    roaringUpdateRanks(r, c - r->containers, 1);
+    return 1;
+}
+
+/*
+ * 删除元素，元素不存在时返回0
+ */
+int roaringRemove(roaring* r, int64_t value) {
+    uint64_t u = ROARING_ENCODE(value);
+    long pos = roaringFindContainer(r, ROARING_KEY(u));
+
+    if (pos < 0) return 0;
+    if (!containerRemove(r->containers + pos, ROARING_LOW(u))) return 0;
+
+    r->card--;
+    if (r->containers[pos].card == 0)
+        roaringDeleteContainer(r, pos);
+    else
+        roaringUpdateRanks(r, pos, -1);
+    return 1;
+}
+
+/*
+ * 检查元素是否存在
+ */
+int roaringContains(const roaring* r, int64_t value) {
+    uint64_t u = ROARING_ENCODE(value);
+    long pos = roaringFindContainer(r, ROARING_KEY(u));
+
+    if (pos < 0) return 0;
+    return containerContains(r->containers + pos, ROARING_LOW(u));
+}
+
+/*
+ * 返回元素数量
+ */
+uint64_t roaringCardinality(const roaring* r) {
+    return r->card;
+}
+
+/*
+ * 返回容器数量
+ */
+uint32_t roaringContainerCount(const roaring* r) {
+    return r->size;
+}
+
+/*
+ * 取出第rank小的元素，rank从0开始，越界时返回0；
+ * 在树状数组上从高位到低位确定rank所在的容器，O(log(size))
+ */
+int roaringSelect(roaring* r, uint64_t rank, int64_t* value) {
+    uint32_t pos = 0, step = 1;
+    const roaringContainer* c;
+
+    if (rank >= r->card) return 0;
+    if (!r->ranks_valid) roaringBuildRanks(r);
+
+    while (step <= r->size / 2) step <<= 1;
+
+    // 找到前缀和不超过rank的最长容器前缀，rank所在的容器就是它之后的一个
+    for (; step; step >>= 1) {
+        if (pos + step <= r->size && r->ranks[pos + step] <= rank) {
+            pos += step;
+            rank -= r->ranks[pos];
+        }
+    }
+
+    c = r->containers + pos;
+    *value = ROARING_DECODE((c->key << 16) | containerSelect(c, rank));
+    return 1;
+}
+
+/*
+ * 随机返回一个元素，r不能为空
+ */
+int64_t roaringRandom(roaring* r) {
+    uint64_t rank = (((uint64_t) rand() << 31) ^ (uint64_t) rand()) % r->card;
+    int64_t value = 0;
+
+    roaringSelect(r, rank, &value);
+    return value;
+}
+
+/*
+ * 初始化迭代器
+ */
+void roaringInitIterator(const roaring* r, roaringIterator* it) {
+    it->r = r;
+    it->ci = 0;
+    it->pos = 0;
+}
+
+/*
+ * 取出下一个元素，遍历结束时返回0
+ */
+int roaringIteratorNext(roaringIterator* it, int64_t* value) {
+    while (it->ci < it->r->size) {
+        const roaringContainer* c = it->r->containers + it->ci;
+
+        if (c->type == ROARING_CONTAINER_ARRAY) {
+            if (it->pos < c->card) {
+                uint16_t low = ((uint16_t*) c->data)[it->pos++];
+                *value = ROARING_DECODE((c->key << 16) | low);
+                return 1;
+            }
+        } else {
+            const uint64_t* words = c->data;
+            uint32_t w = it->pos >> 6;
+
+            if (w < ROARING_BITMAP_WORDS) {
+                uint64_t word = words[w] & (~(uint64_t) 0 << (it->pos & 63));
+
+                while (word == 0 && ++w < ROARING_BITMAP_WORDS) word = words[w];
+                if (word != 0) {
+                    uint32_t low = w * 64 + __builtin_ctzll(word);
+                    it->pos = low + 1;
+                    *value = ROARING_DECODE((c->key << 16) | low);
+                    return 1;
+                }
+            }
+        }
+
+        it->ci++;
+        it->pos = 0;
+    }
+    return 0;
+}
+
+/*
+ * 返回a与b的交集，只对key相同的容器计算交集
+ */
+roaring* roaringAnd(const roaring* a, const roaring* b) {
+    roaring* r = roaringNew();
+    uint32_t i = 0, j = 0;
+
+    while (i < a->size && j < b->size) {
+        uint64_t ka = a->containers[i].key;
+        uint64_t kb = b->containers[j].key;
+
+        if (ka < kb) {
+            i++;
+        } else if (ka > kb) {
+            j++;
+        } else {
+            roaringContainer c;
+            containerAnd(&c, a->containers + i, b->containers + j);
+            roaringAppendContainer(r, &c);
+            i++;
+            j++;
+        }
+    }
+    return r;
+}
+
+/*
+ * 返回a与b的并集
+ */
+roaring* roaringOr(const roaring* a, const roaring* b) {
+    roaring* r = roaringNew();
+    uint32_t i = 0, j = 0;
+
+    while (i < a->size || j < b->size) {
+        roaringContainer c;
+
+        if (j == b->size || (i < a->size && a->containers[i].key < b->containers[j].key)) {
+            containerCopy(&c, a->containers + i++);
+        } else if (i == a->size || b->containers[j].key < a->containers[i].key) {
+            containerCopy(&c, b->containers + j++);
+        } else {
+            containerOr(&c, a->containers + i++, b->containers + j++);
+        }
+        roaringAppendContainer(r, &c);
+    }
+    return r;
+}
+
+/*
+ * 返回a减去b的差集
+ */
+roaring* roaringAndNot(const roaring* a, const roaring* b) {
+    roaring* r = roaringNew();
+    uint32_t i = 0, j = 0;
+
+    while (i < a->size) {
+        roaringContainer c;
+
+        while (j < b->size && b->containers[j].key < a->containers[i].key) j++;
+
+        if (j < b->size && b->containers[j].key == a->containers[i].key) {
+            containerAndNot(&c, a->containers + i, b->containers + j);
+        } else {
+            containerCopy(&c, a->containers + i);
+        }
+        roaringAppendContainer(r, &c);
+        i++;
+    }
+    return r;
+}
+
+/*
+ * 返回roaring位图占用的字节数
+ */
+size_t roaringBytes(const roaring* r) {
+    size_t bytes = sizeof(roaring) + r->alloc * sizeof(roaringContainer);
+    uint32_t i;
+
+    if (r->ranks) bytes += zmalloc_size(r->ranks);
+
+    for (i = 0; i < r->size; i++) {
+        const roaringContainer* c = r->containers + i;
+        bytes += (c->type == ROARING_CONTAINER_ARRAY) ? c->cap * sizeof(uint16_t) : ROARING_BITMAP_BYTES;
+    }
+    return bytes;
+}
@@ -0,0 +1,99 @@
+//
+// Created by zouyi on 2021/11/10.
+//
+
+#ifndef TINYREDIS_ROARING_H
+#define TINYREDIS_ROARING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Roaring位图，用于保存大量整数的集合
+ *
+ * 64位有符号整数先加上偏移映射为保持大小顺序的无符号整数，
+ * 高48位作为容器的key，低16位保存在容器中，容器按照key有序排列:
+ *
+ * 数组容器: 元素数量不超过ROARING_ARRAY_MAX时，低16位保存在有序的uint16_t数组中
+ * 位图容器: 元素数量超过ROARING_ARRAY_MAX时，使用65536位(8KB)的位图
+ */
+#define ROARING_ARRAY_MAX 4096
+
+#define ROARING_CONTAINER_ARRAY 0
+#define ROARING_CONTAINER_BITMAP 1
+
+typedef struct roaringContainer {
+
+    // 元素的高48位
+    uint64_t key;
+
+    // 容器中的元素数量
+    uint32_t card;
+
+    // 数组容器的容量，位图容器不使用
+    uint32_t cap;
+
+    // 容器类型，ROARING_CONTAINER_ARRAY或ROARING_CONTAINER_BITMAP
+    int type;
+
+    // 数组容器指向uint16_t数组，位图容器指向1024个uint64_t
+    void* data;
+
+} roaringContainer;
+
+typedef struct roaring {
+
+    // 按照key有序排列的容器
+    roaringContainer* containers;
+
+    // 容器数量
+    uint32_t size;
+
+    // 容器数组的容量
+    uint32_t alloc;
+
+    // 元素总数
+    uint64_t card;
+
+    // 各容器元素数量的树状数组(Fenwick树)，下标从1开始，用于按排名查找容器，
+    // 元素增删时原地更新，容器增删时标记失效，下一次按排名查找时重建
+    uint64_t* ranks;
+
+    // ranks是否与容器数组一致
+    int ranks_valid;
+
+} roaring;
+
+/*
+ * 按照从小到大顺序遍历roaring位图的迭代器
+ */
+typedef struct roaringIterator {
+
+    const roaring* r;
+
+    // 当前容器的下标
+    uint32_t ci;
+
+    // 数组容器中的下标，或者位图容器中的位
+    uint32_t pos;
+
+} roaringIterator;
+
+roaring* roaringNew(void);
+void roaringFree(roaring* r);
+roaring* roaringCopy(const roaring* r);
+int roaringAdd(roaring* r, int64_t value);
+int roaringRemove(roaring* r, int64_t value);
+int roaringContains(const roaring* r, int64_t value);
+uint64_t roaringCardinality(const roaring* r);
+uint32_t roaringContainerCount(const roaring* r);
+int roaringSelect(roaring* r, uint64_t rank, int64_t* value);
+int64_t roaringRandom(roaring* r);
+void roaringInitIterator(const roaring* r, roaringIterator* it);
+int roaringIteratorNext(roaringIterator* it, int64_t* value);
+roaring* roaringAnd(const roaring* a, const roaring* b);
+roaring* roaringOr(const roaring* a, const roaring* b);
+roaring* roaringAndNot(const roaring* a, const roaring* b);
+size_t roaringBytes(const roaring* r);
+
+#endif //TINYREDIS_ROARING_H
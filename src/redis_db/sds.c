@@ -6,37 +6,119 @@
 #include <string.h>
 #include <ctype.h>
 #include <assert.h>
+#include <limits.h>
 #include "sds.h"
 #include "zmalloc.h"
 
 /*
- * sdsnewlen: 通过C字符串/sds创建一个sdshdr
+ * 返回type类型的sds头部的字节数
+ */
+int sdsHdrSize(char type) {
+    switch(type&SDS_TYPE_MASK) {
+        case SDS_TYPE_5:
+            return sizeof(struct sdshdr5);
+        case SDS_TYPE_8:
+            return sizeof(struct sdshdr8);
+        case SDS_TYPE_16:
+            return sizeof(struct sdshdr16);
+        case SDS_TYPE_32:
+            return sizeof(struct sdshdr32);
+        case SDS_TYPE_64:
+            return sizeof(struct sdshdr64);
+    }
+    return 0;
+}
+
+/*
+ * 返回能保存长度为string_size的字符串的最小头部类型
+ */
+char sdsReqType(size_t string_size) {
+    if (string_size < 1<<5)
+        return SDS_TYPE_5;
+    if (string_size < 1<<8)
+        return SDS_TYPE_8;
+    if (string_size < 1<<16)
+        return SDS_TYPE_16;
+#if (LONG_MAX == LLONG_MAX)
+    if (string_size < 1ll<<32)
+        return SDS_TYPE_32;
+    return SDS_TYPE_64;
+#else
+    return SDS_TYPE_32;
+#endif
+}
+
+/*
+ * sdsnewlen: 通过C字符串/sds创建一个sds，头部类型由长度决定
  */
 sds sdsnewlen(const void* init, size_t initlen) {
 
-    struct sdshdr* sh;
+    void* sh;
+    sds s;
+    char type = sdsReqType(initlen);
+
+    // 空字符串通常是为了之后追加内容而创建的，sdshdr5不适合追加，使用sdshdr8
+    /* Empty strings are usually created in order to append. Use type 8
+     * since type 5 is not good at this. */
+    if (type == SDS_TYPE_5 && initlen == 0) type = SDS_TYPE_8;
+    int hdrlen = sdsHdrSize(type);
+    unsigned char* fp; /* flags pointer. */
 
     if (init) {
         // init指针不为空时，调用zmalloc
         // 只分配空间，不初始化
-        sh = zmalloc(sizeof(struct sdshdr) + initlen + 1);
+        sh = zmalloc(hdrlen + initlen + 1);
     } else {
         // init指针为空时，调用zcalloc
         // 分配空间，并初始化为0
-        sh = zcalloc(sizeof(struct sdshdr) + initlen + 1);
+        sh = zcalloc(hdrlen + initlen + 1);
     }
 
     if (sh == NULL) return NULL;
 
-    sh->len = initlen;
-    sh->free = 0;
-    // memcpy: 将init内容复制到sh->buf
+    s = (char*)sh + hdrlen;
+    fp = ((unsigned char*)s) - 1;
+    switch(type) {
+        case SDS_TYPE_5: {
+            *fp = type | (initlen << SDS_TYPE_BITS);
+            break;
+        }
+        case SDS_TYPE_8: {
+            SDS_HDR_VAR(8,s);
+            sh->len = initlen;
+            sh->alloc = initlen;
+            *fp = type;
+            break;
+        }
+        case SDS_TYPE_16: {
+            SDS_HDR_VAR(16,s);
+            sh->len = initlen;
+            sh->alloc = initlen;
+            *fp = type;
+            break;
+        }
+        case SDS_TYPE_32: {
+            SDS_HDR_VAR(32,s);
+            sh->len = initlen;
+            sh->alloc = initlen;
+            *fp = type;
+            break;
+        }
+        case SDS_TYPE_64: {
+            SDS_HDR_VAR(64,s);
+            sh->len = initlen;
+            sh->alloc = initlen;
+            *fp = type;
+            break;
+        }
+    }
+    // memcpy: 将init内容复制到buf
     // T = O(N)
     if (initlen && init)
-        memcpy(sh->buf, init, initlen);
-    sh->buf[initlen] = '\0';
+        memcpy(s, init, initlen);
+    s[initlen] = '\0';
 
-    return (char*)sh->buf;
+    return s;
 }
 /*
  * 拓展: memcpy和memmove的区别
@@ -71,21 +153,16 @@ sds sdsdup(const sds s) {
  */
 void sdsfree(sds s) {
     if (s == NULL) return;
-    zfree(s - sizeof(struct sdshdr));
+    zfree((char*)s - sdsHdrSize(s[-1]));
 }
 
 /*
  * sdsclear: 将sds置空
- * 惰性空间释放策略，只是修改len字段和free字段，并不实际释放空间
+ * 惰性空间释放策略，只是修改len字段，并不实际释放空间
  */
 void sdsclear(sds s) {
-
-    struct sdshdr* sh = (void*)(s - sizeof(struct sdshdr));
-
-    sh->free += sh->len;
-    sh->len = 0;
-
-    sh->buf[0] = '\0';
+    sdssetlen(s, 0);
+    s[0] = '\0';
 }
 
 /*
@@ -93,18 +170,20 @@ void sdsclear(sds s) {
  */
 sds sdsMakeRoomFor(sds s, size_t addlen) {
 
-    struct sdshdr* sh;
-    struct sdshdr* newsh;
+    void* sh;
+    void* newsh;
 
-    size_t free = sdsavail(s);
+    size_t avail = sdsavail(s);
 
     size_t len, newlen;
+    char type, oldtype = s[-1] & SDS_TYPE_MASK;
+    int hdrlen;
 
     // 如果剩下的空间能够满足需求，直接返回
-    if (free >= addlen) return s;
+    if (avail >= addlen) return s;
 
     len = sdslen(s);
-    sh = (void*)(s - (sizeof(struct sdshdr)));
+    sh = (char*)s - sdsHdrSize(oldtype);
 
     newlen = (len + addlen);
 
@@ -115,30 +194,97 @@ sds sdsMakeRoomFor(sds s, size_t addlen) {
         // 新的长度不小于SDS_MAX_PREALLOC，多分配SDS_MAX_PREALLOC
         newlen += SDS_MAX_PREALLOC;
 
-    /* zrealloc: 执行实际的虚拟内存空间申请
-     * 先判断当前的指针后是否有足够的连续空间，如果有，扩大mem_address指向的地址，并且将mem_address返回，
-     * 如果空间不够，先按照newsize指定的大小分配空间，将原有数据从头到尾拷贝到新分配的内存区域，而后释放原来mem_address所指内存区域
-     * （注意：原来指针是自动释放，不需要使用free），同时返回新分配的内存区域的首地址。即重新分配存储器块的地址。
-     */
-    newsh = zrealloc(sh, sizeof(struct sdshdr) + newlen + 1);
-
-    if (newsh == NULL) return NULL;
-
-    newsh->free = newlen - len;
+    // 被追加的字符串不使用sdshdr5，因为它无法记录剩余空间
+    type = sdsReqType(newlen);
+
+    /* Don't use type 5: the user is appending to the string and type 5 is
+     * not able to remember empty space, so sdsMakeRoomFor() must be called
+     * at every appending operation. */
+    if (type == SDS_TYPE_5) type = SDS_TYPE_8;
+
+    hdrlen = sdsHdrSize(type);
+    if (oldtype == type) {
+        /* zrealloc: 执行实际的虚拟内存空间申请
+         * 先判断当前的指针后是否有足够的连续空间，如果有，扩大mem_address指向的地址，并且将mem_address返回，
+         * 如果空间不够，先按照newsize指定的大小分配空间，将原有数据从头到尾拷贝到新分配的内存区域，而后释放原来mem_address所指内存区域
+         * （注意：原来指针是自动释放，不需要使用free），同时返回新分配的内存区域的首地址。即重新分配存储器块的地址。
+         */
+        newsh = zrealloc(sh, hdrlen + newlen + 1);
+        if (newsh == NULL) return NULL;
+        s = (char*)newsh + hdrlen;
+    } else {
+        // 头部大小改变，需要移动字符串内容，不能使用realloc
+        /* Since the header size changes, need to move the string forward,
+         * and can't use realloc */
+        newsh = zmalloc(hdrlen + newlen + 1);
+        if (newsh == NULL) return NULL;
+        memcpy((char*)newsh + hdrlen, s, len + 1);
+        zfree(sh);
+        s = (char*)newsh + hdrlen;
+        s[-1] = type;
+        sdssetlen(s, len);
+    }
+    sdssetalloc(s, newlen);
 
-    return newsh->buf;
+    return s;
 }
 
 /*
- * sdsRemoveFreeSpace: 释放sds多余的空间
+ * sdsRemoveFreeSpace: 释放sds多余的空间，必要时换用更小的头部
  */
 sds sdsRemoveFreeSpace(sds s) {
-    struct sdshdr* sh;
+    void* sh;
+    void* newsh;
+    char type, oldtype = s[-1] & SDS_TYPE_MASK;
+    int hdrlen, oldhdrlen = sdsHdrSize(oldtype);
+    size_t len = sdslen(s);
+
+    sh = (char*)s - oldhdrlen;
+
+    type = sdsReqType(len);
+    hdrlen = sdsHdrSize(type);
+
+    // 头部类型不变或者变大(不会发生)时直接realloc，否则分配新的内存并移动字符串内容
+    /* If the type is the same, or at least a large enough type is still
+     * required, we just realloc(), letting the allocator to do the copy
+     * only if really needed. Otherwise if the change is huge, we manually
+     * reallocate the string to use the different header type. */
+    if (oldtype == type || type > SDS_TYPE_8) {
+        newsh = zrealloc(sh, oldhdrlen + len + 1);
+        if (newsh == NULL) return NULL;
+        s = (char*)newsh + oldhdrlen;
+    } else {
+        newsh = zmalloc(hdrlen + len + 1);
+        if (newsh == NULL) return NULL;
+        memcpy((char*)newsh + hdrlen, s, len + 1);
+        zfree(sh);
+        s = (char*)newsh + hdrlen;
+        s[-1] = type;
+        sdssetlen(s, len);
+    }
+    sdssetalloc(s, len);
+    return s;
+}
 
-    sh = (void*)(s - sizeof(struct sdshdr));
-    sh = zrealloc(sh, sizeof(struct sdshdr) + sh->len + 1);
-    sh->free = 0;
-    return sh->buf;
+/*
+ * sdsgrowzero: 将sds扩展到长度len，新增的部分用0填充
+ */
+/* Grow the sds to have the specified length. Bytes that were not part of
+ * the original length of the sds will be set to zero.
+ *
+ * if the specified length is smaller than the current length, no operation
+ * is performed. */
+sds sdsgrowzero(sds s, size_t len) {
+    size_t curlen = sdslen(s);
+
+    if (len <= curlen) return s;
+    s = sdsMakeRoomFor(s, len - curlen);
+    if (s == NULL) return NULL;
+
+    /* Make sure added region doesn't contain garbage */
+    memset(s + curlen, 0, (len - curlen + 1)); /* also set trailing \0 byte */
+    sdssetlen(s, len);
+    return s;
 }
 
 /*
@@ -146,8 +292,6 @@ sds sdsRemoveFreeSpace(sds s) {
  */
 sds sdscatlen(sds s, const void* t, size_t len) {
 
-    struct sdshdr* sh;
-
     size_t curlen = sdslen(s);
 
     // 杜绝缓冲区溢出
@@ -158,11 +302,9 @@ sds sdscatlen(sds s, const void* t, size_t len) {
 
     // 将新增加的字符串复制到之前字符串后面
     // T = O(N)
-    sh = (void*)(s - sizeof(struct sdshdr));
     memcpy(s + curlen, t, len);
 
-    sh->len = curlen + len;
-    sh->free = sh->free - len;
+    sdssetlen(s, curlen + len);
 
     // 最后添加一个'\0'，兼容部分C字符串函数
     s[curlen + len] = '\0';
@@ -307,9 +449,17 @@ sds sdsfromlonglong(long long value) {
  * 4) The implicit null term.
  */
 size_t sdsAllocSize(sds s) {
-    struct sdshdr *sh = (void*) (s-(sizeof(struct sdshdr)));
+    size_t alloc = sdsalloc(s);
+    return sdsHdrSize(s[-1])+alloc+1;
+}
 
-    return sizeof(*sh)+sh->len+sh->free+1;
+/*
+ * 返回sds实际分配的内存块的首地址(即头部的地址)
+ */
+/* Return the pointer of the actual SDS allocation (normally SDS strings
+ * are referenced by the start of the string buffer). */
+void *sdsAllocPtr(sds s) {
+    return (void*) (s-sdsHdrSize(s[-1]));
 }
 
 /* Increment the sds length and decrements the left free space at the
@@ -349,22 +499,49 @@ size_t sdsAllocSize(sds s) {
  * 复杂度
  *  T = O(1)
  */
-void sdsIncrLen(sds s, int incr) {
-    struct sdshdr *sh = (void*) (s-(sizeof(struct sdshdr)));
-
-    // 确保 sds 空间足够
-    assert(sh->free >= incr);
-
-    // 更新属性
-    sh->len += incr;
-    sh->free -= incr;
-
-    // 这个 assert 其实可以忽略
-    // 因为前一个 assert 已经确保 sh->free - incr >= 0 了
-    assert(sh->free >= 0);
+void sdsIncrLen(sds s, ssize_t incr) {
+    unsigned char flags = s[-1];
+    size_t len;
+
+    // 确保 sds 空间足够，然后更新长度
+    switch(flags&SDS_TYPE_MASK) {
+        case SDS_TYPE_5: {
+            unsigned char *fp = ((unsigned char*)s)-1;
+            unsigned char oldlen = SDS_TYPE_5_LEN(flags);
+            assert((incr > 0 && oldlen+incr < 32) || (incr < 0 && oldlen >= (unsigned int)(-incr)));
+            *fp = SDS_TYPE_5 | ((oldlen+incr) << SDS_TYPE_BITS);
+            len = oldlen+incr;
+            break;
+        }
+        case SDS_TYPE_8: {
+            SDS_HDR_VAR(8,s);
+            assert((incr >= 0 && sh->alloc-sh->len >= incr) || (incr < 0 && sh->len >= (unsigned int)(-incr)));
+            len = (sh->len += incr);
+            break;
+        }
+        case SDS_TYPE_16: {
+            SDS_HDR_VAR(16,s);
+            assert((incr >= 0 && sh->alloc-sh->len >= incr) || (incr < 0 && sh->len >= (unsigned int)(-incr)));
+            len = (sh->len += incr);
+            break;
+        }
+        case SDS_TYPE_32: {
+            SDS_HDR_VAR(32,s);
+            assert((incr >= 0 && sh->alloc-sh->len >= (unsigned int)incr) || (incr < 0 && sh->len >= (unsigned int)(-incr)));
+            len = (sh->len += incr);
+            break;
+        }
+        case SDS_TYPE_64: {
+            SDS_HDR_VAR(64,s);
+            assert((incr >= 0 && sh->alloc-sh->len >= (uint64_t)incr) || (incr < 0 && sh->len >= (uint64_t)(-incr)));
+            len = (sh->len += incr);
+            break;
+        }
+        default: len = 0; /* Just to avoid compilation warnings. */
+    }
 
     // 放置新的结尾符号
-    s[sh->len] = '\0';
+    s[len] = '\0';
 }
 
 /*
@@ -455,7 +632,6 @@ sds sdscatprintf(sds s, const char *fmt, ...) {
  * %% - Verbatim "%" character.
  */
 sds sdscatfmt(sds s, char const *fmt, ...) {
-    struct sdshdr *sh = (void*) (s-(sizeof(struct sdshdr)));
     size_t initlen = sdslen(s);
     const char *f = fmt;
     int i;
@@ -471,9 +647,8 @@ sds sdscatfmt(sds s, char const *fmt, ...) {
         unsigned long long unum;
 
         /* Make sure there is always space for at least 1 char. */
-        if (sh->free == 0) {
+        if (sdsavail(s) == 0) {
             s = sdsMakeRoomFor(s,1);
-            sh = (void*) (s-(sizeof(struct sdshdr)));
         }
 
         switch(*f) {
@@ -485,13 +660,11 @@ sds sdscatfmt(sds s, char const *fmt, ...) {
                     case 'S':
                         str = va_arg(ap,char*);
                         l = (next == 's') ? strlen(str) : sdslen(str);
-                        if (sh->free < l) {
+                        if (sdsavail(s) < l) {
                             s = sdsMakeRoomFor(s,l);
-                            sh = (void*) (s-(sizeof(struct sdshdr)));
                         }
                         memcpy(s+i,str,l);
-                        sh->len += l;
-                        sh->free -= l;
+                        sdsinclen(s,l);
                         i += l;
                         break;
                     case 'i':
@@ -503,13 +676,11 @@ sds sdscatfmt(sds s, char const *fmt, ...) {
                         {
                             char buf[SDS_LLSTR_SIZE];
                             l = sdsll2str(buf,num);
-                            if (sh->free < l) {
+                            if (sdsavail(s) < l) {
                                 s = sdsMakeRoomFor(s,l);
-                                sh = (void*) (s-(sizeof(struct sdshdr)));
                             }
                             memcpy(s+i,buf,l);
-                            sh->len += l;
-                            sh->free -= l;
+                            sdsinclen(s,l);
                             i += l;
                         }
                         break;
@@ -522,27 +693,23 @@ sds sdscatfmt(sds s, char const *fmt, ...) {
                         {
                             char buf[SDS_LLSTR_SIZE];
                             l = sdsull2str(buf,unum);
-                            if (sh->free < l) {
+                            if (sdsavail(s) < l) {
                                 s = sdsMakeRoomFor(s,l);
-                                sh = (void*) (s-(sizeof(struct sdshdr)));
                             }
                             memcpy(s+i,buf,l);
-                            sh->len += l;
-                            sh->free -= l;
+                            sdsinclen(s,l);
                             i += l;
                         }
                         break;
                     default: /* Handle %% and generally %<unknown>. */
                         s[i++] = next;
-                        sh->len += 1;
-                        sh->free -= 1;
+                        sdsinclen(s,1);
                         break;
                 }
                 break;
             default:
                 s[i++] = *f;
-                sh->len += 1;
-                sh->free -= 1;
+                sdsinclen(s,1);
                 break;
         }
         f++;
@@ -576,8 +743,7 @@ sds sdscatfmt(sds s, char const *fmt, ...) {
  * s = sdsnew("Hello World");
  * sdsrange(s,1,-1); => "ello World"
  */
-void sdsrange(sds s, int start, int end) {
-    struct sdshdr *sh = (void*) (s-(sizeof(struct sdshdr)));
+void sdsrange(sds s, ssize_t start, ssize_t end) {
     size_t newlen, len = sdslen(s);
 
     if (len == 0) return;
@@ -591,9 +757,9 @@ void sdsrange(sds s, int start, int end) {
     }
     newlen = (start > end) ? 0 : (end-start)+1;
     if (newlen != 0) {
-        if (start >= (signed)len) {
+        if (start >= (ssize_t)len) {
             newlen = 0;
-        } else if (end >= (signed)len) {
+        } else if (end >= (ssize_t)len) {
             end = len-1;
             newlen = (start > end) ? 0 : (end-start)+1;
         }
@@ -603,14 +769,13 @@ void sdsrange(sds s, int start, int end) {
 
     // 如果有需要，对字符串进行移动
     // T = O(N)
-    if (start && newlen) memmove(sh->buf, sh->buf+start, newlen);
+    if (start && newlen) memmove(s, s+start, newlen);
 
     // 添加终结符
-    sh->buf[newlen] = 0;
+    s[newlen] = 0;
 
     // 更新属性
-    sh->free = sh->free+(sh->len-newlen);
-    sh->len = newlen;
+    sdssetlen(s,newlen);
 }
 
 /*
@@ -0,0 +1,634 @@
+//
+// Created by zouyi on 2021/11/14.
+//
+
+#include "redis.h"
+#include "pqsort.h"
+#include <math.h>
+
+/*
+ * SORT和SORT_RO
+ *
+ * 对列表、集合或者有序集合中的元素排序，可以按元素本身(数字或者ALPHA字典序)，
+ * 也可以按BY模式取得的外部键的值排序，用GET模式取出外部键的值作为结果，STORE把结果保存为列表；
+ * 外部键在排序之前一次全部取出，比较函数只比较内存中的分值或者对象
+ */
+
+/*
+ * 待排序的元素
+ */
+typedef struct redisSortObject {
+
+    robj* obj;
+
+    union {
+        // 按数字排序时使用的分值
+        double score;
+        // 按BY模式和ALPHA排序时使用的外部键的值
+        robj* cmpobj;
+    } u;
+
+} redisSortObject;
+
+/*
+ * BY和GET使用的模式，在命令开始时解析一次，之后对每个元素重复使用
+ */
+typedef struct sortPattern {
+
+    // 模式是"#"，取元素本身
+    int self;
+
+    // 键名中'*'之前和之后的部分，模式中没有'*'时prefix为NULL，不匹配任何键
+    sds prefix;
+    sds postfix;
+
+    // "->"之后的哈希域，为NULL时取字符串键的值
+    robj* field;
+
+    // 拼接键名使用的对象，所有元素共用同一个缓冲区
+    robj* keyobj;
+
+} sortPattern;
+
+/*
+ * 解析模式pattern
+ *
+ * 模式中的第一个'*'被替换为元素，'*'之后有"->field"时取哈希键中的域field
+ */
+static sortPattern* createSortPattern(robj* pattern) {
+    sortPattern* sp = zcalloc(sizeof(*sp));
+    sds spat = pattern->ptr;
+    char* star;
+    char* arrow;
+
+    if (spat[0] == '#' && spat[1] == '\0') {
+        sp->self = 1;
+        return sp;
+    }
+
+    /* If we can't find '*' in the pattern we return NULL as to GET a
+     * fixed key does not make sense. */
+    star = strchr(spat, '*');
+    if (star == NULL) return sp;
+
+    /* Find out if we're dealing with a hash dereference. */
+    arrow = strstr(star + 1, "->");
+    if (arrow != NULL && arrow[2] != '\0') {
+        sp->field = createStringObject(arrow + 2, sdslen(spat) - (arrow + 2 - spat));
+    } else {
+        arrow = spat + sdslen(spat);
+    }
+
+    sp->prefix = sdsnewlen(spat, star - spat);
+    sp->postfix = sdsnewlen(star + 1, arrow - star - 1);
+    sp->keyobj = createObject(REDIS_STRING, sdsempty());
+
+    return sp;
+}
+
+static void freeSortPattern(sortPattern* sp) {
+    sdsfree(sp->prefix);
+    sdsfree(sp->postfix);
+    if (sp->field) decrRefCount(sp->field);
+    if (sp->keyobj) decrRefCount(sp->keyobj);
+    zfree(sp);
+}
+
+static void freeSortPatternVoid(void* sp) {
+    freeSortPattern(sp);
+}
+
+/*
+ * 用元素subst替换模式中的'*'，返回对应的字符串键的值或者哈希域的值，
+ * 键不存在或者类型不对时返回NULL，返回的对象由调用者释放
+ */
+/* Return the value associated to the key with a name obtained using
+ * the following rules:
+ *
+ * 1) The first occurrence of '*' in 'pattern' is substituted with 'subst'.
+ *
+ * 2) If 'pattern' matches the "->" string, everything on the left of
+ *    the arrow is treated as the name of a hash field, and the part on the
+ *    left as the key name containing a hash. The value of the specified
+ *    field is returned.
+ *
+ * 3) If 'pattern' equals "#", the function simply returns 'subst' itself so
+ *    that the SORT command can be used like: SORT key GET # to retrieve
+ *    the Set/List elements directly. */
+static robj* lookupKeyByPattern(redisDb* db, sortPattern* sp, robj* subst) {
+    robj* o;
+    sds keyname;
+
+    if (sp->self) {
+        incrRefCount(subst);
+        return subst;
+    }
+    if (sp->prefix == NULL) return NULL;
+
+    // 键名对象被其他地方持有时不能原地修改，换一个新的
+    if (sp->keyobj->refcount > 1) {
+        decrRefCount(sp->keyobj);
+        sp->keyobj = createObject(REDIS_STRING, sdsempty());
+    }
+
+    keyname = sp->keyobj->ptr;
+    sdsclear(keyname);
+    keyname = sdscatlen(keyname, sp->prefix, sdslen(sp->prefix));
+    if (subst->encoding == REDIS_ENCODING_INT) {
+        char buf[32];
+        int len = ll2string(buf, sizeof(buf), (long) subst->ptr);
+
+        keyname = sdscatlen(keyname, buf, len);
+    } else {
+        keyname = sdscatlen(keyname, subst->ptr, sdslen(subst->ptr));
+    }
+    keyname = sdscatlen(keyname, sp->postfix, sdslen(sp->postfix));
+    sp->keyobj->ptr = keyname;
+
+    /* Lookup substituted key */
+    o = lookupKeyRead(db, sp->keyobj);
+    if (o == NULL) return NULL;
+
+    if (sp->field) {
+        if (o->type != REDIS_HASH) return NULL;
+
+        /* Retrieve value from hash by the field name. This operation
+         * already increases the refcount of the returned object. */
+        return hashTypeGetObject(o, sp->field);
+    }
+
+    if (o->type != REDIS_STRING) return NULL;
+
+    /* Every object that this function returns needs to have its refcount
+     * increased. sortCommand decreases it again. */
+    incrRefCount(o);
+    return o;
+}
+
+/*
+ * qsort和pqsort使用的比较函数，排序选项通过server.sort_*传入
+ */
+/* sortCompare() is used by qsort in sortCommand(). Given that qsort_r with
+ * the additional parameter is not standard but a BSD-specific we have to
+ * pass sorting parameters via the global 'server' structure */
+static int sortCompare(const void* s1, const void* s2) {
+    const redisSortObject* so1 = s1;
+    const redisSortObject* so2 = s2;
+    int cmp;
+
+    if (!server.sort_alpha) {
+        /* Numeric sorting. Here it's trivial as we precomputed scores */
+        if (so1->u.score > so2->u.score) {
+            cmp = 1;
+        } else if (so1->u.score < so2->u.score) {
+            cmp = -1;
+        } else {
+            /* Objects have the same score, but we don't want the comparison
+             * to be undefined, so we compare objects lexicographically.
+             * This way the result of SORT is deterministic. */
+            cmp = compareStringObjects(so1->obj, so2->obj);
+        }
+    } else {
+        /* Alphanumeric sorting */
+        if (server.sort_bypattern) {
+            if (!so1->u.cmpobj || !so2->u.cmpobj) {
+                /* At least one compare object is NULL */
+                if (so1->u.cmpobj == so2->u.cmpobj)
+                    cmp = 0;
+                else if (so1->u.cmpobj == NULL)
+                    cmp = -1;
+                else
+                    cmp = 1;
+            } else {
+                /* We have both the objects, compare them. */
+                if (server.sort_store) {
+                    cmp = compareStringObjects(so1->u.cmpobj, so2->u.cmpobj);
+                } else {
+                    /* Here we can use strcoll() directly as we are sure that
+                     * the objects are decoded string objects. */
+                    cmp = strcoll(so1->u.cmpobj->ptr, so2->u.cmpobj->ptr);
+                }
+            }
+        } else {
+            /* Compare elements directly. */
+            if (server.sort_store) {
+                cmp = compareStringObjects(so1->obj, so2->obj);
+            } else {
+                cmp = collateStringObjects(so1->obj, so2->obj);
+            }
+        }
+    }
+    return server.sort_desc ? -cmp : cmp;
+}
+
+/*
+ * 按有序集合中的顺序取出下标在[start, end]之间的成员，desc时从分值最大的一端开始
+ */
+static int sortLoadZsetRange(robj* zobj, redisSortObject* vector, long start, long end, int desc) {
+    zsetopsrc src;
+    robj* ele;
+    double score;
+    long skip, count, j = 0;
+
+    // 倒序时要取的是正序下标[len-1-end, len-1-start]，取出之后再翻转
+    skip = desc ? (long) zsetLength(zobj) - 1 - end : start;
+    count = end - start + 1;
+
+    memset(&src, 0, sizeof(src));
+    src.subject = zobj;
+    src.weight = 1.0;
+    zuiInitIterator(&src);
+    while (j < count && zuiNext(&src, &ele, &score)) {
+        if (skip > 0) {
+            skip--;
+            decrRefCount(ele);
+            continue;
+        }
+        vector[j].obj = ele;
+        vector[j].u.cmpobj = NULL;
+        j++;
+    }
+    zuiClearIterator(&src);
+
+    if (desc) {
+        long i;
+
+        for (i = 0; i < j / 2; i++) {
+            redisSortObject t = vector[i];
+            vector[i] = vector[j - 1 - i];
+            vector[j - 1 - i] = t;
+        }
+    }
+    return (int) j;
+}
+
+/*
+ * SORT和SORT_RO的实现，readonly为真时不接受STORE
+ */
+/* The SORT command is the most complex command in Redis. Warning: this code
+ * is optimized for speed and a bit less for readability */
+static void sortCommandGeneric(redisClient* c, int readonly) {
+    list* operations;
+    unsigned int outputlen = 0;
+    int desc = 0, alpha = 0;
+    long limit_start = 0, limit_count = -1, start, end;
+    int j, dontsort = 0, vectorlen;
+    int getop = 0; /* GET operation counter */
+    int int_convertion_error = 0;
+    int syntax_error = 0;
+    robj* sortval;
+    robj* storekey = NULL;
+    robj* sobj = NULL;
+    sortPattern* sortby = NULL;
+    redisSortObject* vector;
+
+    /* Lookup the key to sort. It must be of the right types */
+    sortval = lookupKeyRead(c->db, c->argv[1]);
+    if (sortval && sortval->type != REDIS_SET &&
+        sortval->type != REDIS_LIST &&
+        sortval->type != REDIS_ZSET) {
+        addReply(c, shared.wrongtypeerr);
+        return;
+    }
+
+    /* Create a list of operations to perform for every sorted element.
+     * Operations can be GET */
+    operations = listCreate();
+    listSetFreeMethod(operations, freeSortPatternVoid);
+    j = 2; /* options start at argv[2] */
+
+    /* The SORT command has an SQL-alike syntax, parse it */
+    while (j < c->argc) {
+        int leftargs = c->argc - j - 1;
+        if (!strcasecmp(c->argv[j]->ptr, "asc")) {
+            desc = 0;
+        } else if (!strcasecmp(c->argv[j]->ptr, "desc")) {
+            desc = 1;
+        } else if (!strcasecmp(c->argv[j]->ptr, "alpha")) {
+            alpha = 1;
+        } else if (!strcasecmp(c->argv[j]->ptr, "limit") && leftargs >= 2) {
+            if ((getLongFromObjectOrReply(c, c->argv[j + 1], &limit_start, NULL) != REDIS_OK) ||
+                (getLongFromObjectOrReply(c, c->argv[j + 2], &limit_count, NULL) != REDIS_OK)) {
+                syntax_error++;
+                break;
+            }
+            j += 2;
+        } else if (!readonly && !strcasecmp(c->argv[j]->ptr, "store") && leftargs >= 1) {
+            storekey = c->argv[j + 1];
+            j++;
+        } else if (!strcasecmp(c->argv[j]->ptr, "by") && leftargs >= 1) {
+            if (sortby) freeSortPattern(sortby);
+            sortby = createSortPattern(c->argv[j + 1]);
+
+            // 模式中没有'*'时所有元素的权重都相同，不需要排序
+            /* If the BY pattern does not contain '*', i.e. it is constant,
+             * we don't need to sort nor to lookup the weight keys. */
+            if (sortby->prefix == NULL) dontsort = 1;
+            j++;
+        } else if (!strcasecmp(c->argv[j]->ptr, "get") && leftargs >= 1) {
+            listAddNodeTail(operations, createSortPattern(c->argv[j + 1]));
+            getop++;
+            j++;
+        } else {
+            addReply(c, shared.syntaxerr);
+            syntax_error++;
+            break;
+        }
+        j++;
+    }
+
+    /* Handle syntax errors set during options parsing. */
+    if (syntax_error) {
+        listRelease(operations);
+        if (sortby) freeSortPattern(sortby);
+        return;
+    }
+
+    /* Load the sorting vector with all the objects to sort */
+    if (sortval)
+        incrRefCount(sortval);
+    else
+        sortval = createListpackObject();
+
+    // 集合没有固定的顺序，不排序直接保存的结果在不同的服务器上可能不同，改为按字典序排序
+    /* When sorting a set with no sort specified, we must sort the output
+     * so the result is consistent across scripting and replication.
+     *
+     * The other types (list, sorted set) will retain their native order
+     * even if no sort order is requested, so they remain stable across
+     * scripting and replication. */
+    if (dontsort && sortval->type == REDIS_SET && storekey) {
+        /* Force ALPHA sorting */
+        dontsort = 0;
+        alpha = 1;
+        freeSortPattern(sortby);
+        sortby = NULL;
+    }
+
+    /* Obtain the length of the object to sort. */
+    switch (sortval->type) {
+        case REDIS_LIST:
+            vectorlen = listTypeLength(sortval);
+            break;
+        case REDIS_SET:
+            vectorlen = setTypeSize(sortval);
+            break;
+        case REDIS_ZSET:
+            vectorlen = zsetLength(sortval);
+            break;
+        default:
+            vectorlen = 0;
+            exit(1); /* Avoid GCC warning */
+    }
+
+    /* Perform LIMIT start,count sanity checking. */
+    start = (limit_start < 0) ? 0 : limit_start;
+    end = (limit_count < 0) ? vectorlen - 1 : start + limit_count - 1;
+    if (start >= vectorlen) {
+        start = vectorlen - 1;
+        end = vectorlen - 2;
+    }
+    if (end >= vectorlen) end = vectorlen - 1;
+
+    // 列表和有序集合本身有序，不需要排序时只取出LIMIT指定的范围
+    /* Whenever possible, we load elements into the output array in a more
+     * direct way. This is possible if:
+     *
+     * 1) The object to sort is a sorted set or a list (internally sorted).
+     * 2) There is nothing to sort as dontsort is true (BY <constant string>).
+     *
+     * In this special case, if we have a LIMIT option that actually reduces
+     * the number of elements to fetch, we also optimize to just load the
+     * range we are interested in and allocating a vector that is big enough
+     * for the selected range length. */
+    if ((sortval->type == REDIS_ZSET || sortval->type == REDIS_LIST) &&
+        dontsort &&
+        (start != 0 || end != vectorlen - 1)) {
+        vectorlen = end - start + 1;
+    }
+
+    /* Load the sorting vector with all the objects to sort */
+    vector = zmalloc(sizeof(redisSortObject) * vectorlen);
+    j = 0;
+
+    if (sortval->type == REDIS_LIST && dontsort) {
+        /* Special handling for a list, if 'dontsort' is true.
+         * This makes sure we return elements in the list original
+         * ordering, accordingly to DESC / ASC options.
+         *
+         * Note that in this case we also handle LIMIT here in a direct
+         * way, just getting the required range, as an optimization. */
+        if (end >= start) {
+            listTypeIterator* li;
+            listTypeEntry entry;
+            li = listTypeInitIterator(sortval,
+                                      desc ? (long) (listTypeLength(sortval) - start - 1) : start,
+                                      desc ? REDIS_HEAD : REDIS_TAIL);
+
+            while (j < vectorlen && listTypeNext(li, &entry)) {
+                vector[j].obj = listTypeGet(&entry);
+                vector[j].u.cmpobj = NULL;
+                j++;
+            }
+            listTypeReleaseIterator(li);
+            /* Fix start/end: output code is not aware of the range. */
+            end -= start;
+            start = 0;
+        }
+    } else if (sortval->type == REDIS_LIST) {
+        listTypeIterator* li = listTypeInitIterator(sortval, 0, REDIS_TAIL);
+        listTypeEntry entry;
+        while (listTypeNext(li, &entry)) {
+            vector[j].obj = listTypeGet(&entry);
+            vector[j].u.cmpobj = NULL;
+            j++;
+        }
+        listTypeReleaseIterator(li);
+    } else if (sortval->type == REDIS_SET) {
+        setTypeIterator* si = setTypeInitIterator(sortval);
+        robj* ele;
+        while ((ele = setTypeNextObject(si)) != NULL) {
+            vector[j].obj = ele;
+            vector[j].u.cmpobj = NULL;
+            j++;
+        }
+        setTypeReleaseIterator(si);
+    } else if (sortval->type == REDIS_ZSET && dontsort) {
+        /* Special handling for a sorted set, if 'dontsort' is true.
+         * This makes sure we return elements in the sorted set original
+         * ordering, accordingly to DESC / ASC options.
+         *
+         * Note that in this case we also handle LIMIT here in a direct
+         * way, just getting the required range, as an optimization. */
+        if (end >= start) {
+            j = sortLoadZsetRange(sortval, vector, start, end, desc);
+            /* Fix start/end: output code is not aware of the range. */
+            end -= start;
+            start = 0;
+        }
+    } else if (sortval->type == REDIS_ZSET) {
+        zsetopsrc src;
+        robj* ele;
+        double score;
+
+        memset(&src, 0, sizeof(src));
+        src.subject = sortval;
+        src.weight = 1.0;
+        zuiInitIterator(&src);
+        while (zuiNext(&src, &ele, &score)) {
+            vector[j].obj = ele;
+            vector[j].u.cmpobj = NULL;
+            j++;
+        }
+        zuiClearIterator(&src);
+    } else {
+        exit(1);
+    }
+    assert(j == vectorlen);
+
+    // 一次取出所有元素的权重，排序期间不再访问数据库
+    /* Now it's time to load the right scores in the sorting vector */
+    if (dontsort == 0) {
+        for (j = 0; j < vectorlen; j++) {
+            robj* byval;
+            if (sortby) {
+                /* lookup value to sort by */
+                byval = lookupKeyByPattern(c->db, sortby, vector[j].obj);
+                if (!byval) continue;
+            } else {
+                /* use object itself to sort by */
+                byval = vector[j].obj;
+            }
+
+            if (alpha) {
+                if (sortby) vector[j].u.cmpobj = getDecodedObject(byval);
+            } else {
+                if (sdsEncodedObject(byval)) {
+                    char* eptr;
+
+                    errno = 0;
+                    vector[j].u.score = strtod(byval->ptr, &eptr);
+                    if (eptr[0] != '\0' || errno == ERANGE ||
+                        isnan(vector[j].u.score)) {
+                        int_convertion_error = 1;
+                    }
+                } else if (byval->encoding == REDIS_ENCODING_INT) {
+                    /* Don't need to decode the object if it's
+                     * integer-encoded (the only encoding supported) so
+                     * far. We can just cast it */
+                    vector[j].u.score = (long) byval->ptr;
+                } else {
+                    exit(1);
+                }
+            }
+
+            /* when the object was retrieved using lookupKeyByPattern,
+             * its refcount needs to be decreased. */
+            if (sortby) {
+                decrRefCount(byval);
+            }
+        }
+
+        server.sort_desc = desc;
+        server.sort_alpha = alpha;
+        server.sort_bypattern = sortby ? 1 : 0;
+        server.sort_store = storekey ? 1 : 0;
+
+        // LIMIT只取一部分时使用部分排序，只把[start, end]范围内的元素放到正确的位置
+        if (end >= start && (start != 0 || end != vectorlen - 1))
+            pqsort(vector, vectorlen, sizeof(redisSortObject), sortCompare, start, end);
+        else
+            qsort(vector, vectorlen, sizeof(redisSortObject), sortCompare);
+    }
+
+    /* Send command output to the output buffer, performing the specified
+     * GET/DEL/INCR/DECR operations if any. */
+    outputlen = getop ? getop * (end - start + 1) : end - start + 1;
+    if (int_convertion_error) {
+        addReplyError(c, "One or more scores can't be converted into double");
+    } else if (storekey == NULL) {
+        /* STORE option not specified, sent the sorting result to client */
+        addReplyMultiBulkLen(c, outputlen);
+        for (j = start; j <= end; j++) {
+            listNode* ln;
+            listIter li;
+
+            if (!getop) addReplyBulkCopy(c, vector[j].obj);
+            listRewind(operations, &li);
+            while ((ln = listNext(&li))) {
+                sortPattern* sop = ln->value;
+                robj* val = lookupKeyByPattern(c->db, sop, vector[j].obj);
+
+                if (!val) {
+                    addReply(c, shared.nullbulk);
+                } else {
+                    addReplyBulkCopy(c, val);
+                    decrRefCount(val);
+                }
+            }
+        }
+    } else {
+        sobj = createListpackObject();
+
+        /* STORE option specified, set the sorting result as a List object */
+        for (j = start; j <= end; j++) {
+            listNode* ln;
+            listIter li;
+
+            if (!getop) {
+                listTypePush(sobj, vector[j].obj, REDIS_TAIL);
+            } else {
+                listRewind(operations, &li);
+                while ((ln = listNext(&li))) {
+                    sortPattern* sop = ln->value;
+                    robj* val = lookupKeyByPattern(c->db, sop, vector[j].obj);
+
+                    if (!val) val = createStringObject("", 0);
+
+                    /* listTypePush does an incrRefCount, so we should take care
+                     * care of the incremented refcount caused by either
+                     * lookupKeyByPattern or createStringObject("",0) */
+                    listTypePush(sobj, val, REDIS_TAIL);
+                    decrRefCount(val);
+                }
+            }
+        }
+    }
+
+    /* Cleanup */
+    for (j = 0; j < vectorlen; j++) {
+        decrRefCount(vector[j].obj);
+        if (alpha && sortby && vector[j].u.cmpobj) decrRefCount(vector[j].u.cmpobj);
+    }
+    decrRefCount(sortval);
+
+    // 释放对元素的引用之后再写入目标键，目标键原来的值(可能就是被排序的键)会被交给bio线程释放
+    if (sobj) {
+        if (outputlen) {
+            setKey(c->db, storekey, sobj, 0);
+            server.dirty += outputlen;
+        } else if (dbDelete(c->db, storekey)) {
+            signalModifiedKey(c->db, storekey);
+            server.dirty++;
+        }
+        decrRefCount(sobj);
+        addReplyLongLong(c, outputlen);
+    }
+    listRelease(operations);
+    if (sortby) freeSortPattern(sortby);
+    zfree(vector);
+}
+
+/*
+ * SORT key [BY pattern] [LIMIT offset count] [GET pattern [GET pattern ...]] [ASC|DESC] [ALPHA] [STORE destination]
+ */
+void sortCommand(redisClient* c) {
+    sortCommandGeneric(c, 0);
+}
+
+/*
+ * SORT_RO，不接受STORE的只读版本
+ */
+void sortroCommand(redisClient* c) {
+    sortCommandGeneric(c, 1);
+}
@@ -2,6 +2,7 @@
 // Created by zouyi on 2021/9/7.
 //
 
+#include <math.h>
 #include "redis.h"
 
 /*
@@ -9,15 +10,23 @@
  */
 
 /*
- * 检查argv数组中的多个对象，是否需要将哈希类型对象底层编码由REDIS_ENCODING_ZIPLIST转为REDIS_ENCODING_HT
+ * 返回紧凑编码(REDIS_ENCODING_LISTPACK或REDIS_ENCODING_PACKHASH)的哈希类型对象保存键值对的listpack
+ */
+static unsigned char* hashTypeListpack(robj* o) {
+    if (o->encoding == REDIS_ENCODING_PACKHASH) return ((packhash*) o->ptr)->lp;
+    return o->ptr;
+}
+
+/*
+ * 检查argv数组中的多个对象，是否需要将哈希类型对象底层编码由紧凑编码转为REDIS_ENCODING_HT
  */
 void hashTypeTryConversion(robj* o, robj** argv, int start, int end) {
     int i;
 
-    if (o->encoding != REDIS_ENCODING_ZIPLIST) return;
+    if (o->encoding != REDIS_ENCODING_LISTPACK && o->encoding != REDIS_ENCODING_PACKHASH) return;
 
     for (i = start; i <= end; i++) {
-        if (sdsEncodedObject(argv[i]) && sdslen(argv[i]->ptr) > HASH_MAX_ZIPLIST_VALUE) {
+        if (sdsEncodedObject(argv[i]) && sdslen(argv[i]->ptr) > server.hash_max_ziplist_value) {
             // 将哈希类型对象底层编码转化为REDIS_ENCODING_HT
             hashTypeConvert(o, REDIS_ENCODING_HT);
             break;
@@ -33,34 +42,45 @@ void hashTypeTryObjectEncoding(robj* subject, robj** o1, robj** o2) {
 }
 
 /*
- * 从底层编码为REDIS_ENCODING_ZIPLIST的哈希类型对象中取出field键对应的值
+ * 在底层编码为REDIS_ENCODING_LISTPACK或REDIS_ENCODING_PACKHASH的哈希类型对象中查找field，
+ * 返回对应的值在listpack中的地址，field不存在时返回NULL
  */
-int hashTypeGetFromZiplist(robj* o, robj* field, unsigned char** vstr, unsigned int* vlen, long long* vll) {
+static unsigned char* hashTypeZiplistValuePtr(robj* o, unsigned char* field, unsigned int flen) {
     unsigned char* zl;
-    unsigned char* fptr = NULL;
-    unsigned char* vptr = NULL;
-    int ret;
+    unsigned char* fptr;
 
-    assert(o->encoding == REDIS_ENCODING_ZIPLIST);
-
-    field = getDecodedObject(field);
+    if (o->encoding == REDIS_ENCODING_PACKHASH) {
+        // 通过索引直接定位field
+        zl = ((packhash*) o->ptr)->lp;
+        fptr = packhashFind(o->ptr, field, flen);
+    } else {
+        assert(o->encoding == REDIS_ENCODING_LISTPACK);
 
-    zl = o->ptr;
-    fptr = ziplistIndex(zl, ZIPLIST_HEAD);
-    if (fptr != NULL) {
+        zl = o->ptr;
+        fptr = lpIndex(zl, LP_HEAD);
         // 查询键，skip = 1
-        fptr = ziplistFind(fptr, field->ptr, sdslen(field->ptr), 1);
-        if (fptr != NULL) {
-            // 在EDIS_ENCODING_ZIPLIST编码方式中，键值由压缩列表中连续的两个节点表示
-            vptr = ziplistNext(zl, fptr);
-            assert(vptr != NULL);
-        }
+        if (fptr != NULL) fptr = lpFind(fptr, field, flen, 1);
     }
 
+    if (fptr == NULL) return NULL;
+
+    // 键值由listpack中连续的两个节点表示
+    return lpNext(zl, fptr);
+}
+
+/*
+ * 从底层编码为REDIS_ENCODING_LISTPACK或REDIS_ENCODING_PACKHASH的哈希类型对象中取出field键对应的值
+ */
+int hashTypeGetFromZiplist(robj* o, robj* field, unsigned char** vstr, unsigned int* vlen, long long* vll) {
+    unsigned char* vptr;
+    int ret;
+
+    field = getDecodedObject(field);
+    vptr = hashTypeZiplistValuePtr(o, field->ptr, sdslen(field->ptr));
     decrRefCount(field);
 
     if (vptr != NULL) {
-        ret = ziplistGet(vptr, vstr, vlen, vll);
+        ret = lpGet(vptr, vstr, vlen, vll);
         assert(ret);
         return 0;
     }
@@ -91,7 +111,7 @@ int hashTypeGetFromHashTable(robj* o, robj* field, robj** value) {
 robj* hashTypeGetObject(robj* o, robj* field) {
     robj* value = NULL;
 
-    if (o->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (o->encoding == REDIS_ENCODING_LISTPACK || o->encoding == REDIS_ENCODING_PACKHASH) {
         unsigned char* vstr = NULL;
         unsigned int vlen = UINT_MAX;
         long long vll = LLONG_MAX;
@@ -122,7 +142,7 @@ robj* hashTypeGetObject(robj* o, robj* field) {
  */
 int hashTypeExists(robj* o, robj* field) {
 
-    if (o->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (o->encoding == REDIS_ENCODING_LISTPACK || o->encoding == REDIS_ENCODING_PACKHASH) {
         unsigned char* vstr = NULL;
         unsigned int vlen = UINT_MAX;
         long long vll = LLONG_MAX;
@@ -147,7 +167,7 @@ int hashTypeExists(robj* o, robj* field) {
 int hashTypeSet(robj* o, robj* field, robj* value) {
     int update = 0;
 
-    if (o->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (o->encoding == REDIS_ENCODING_LISTPACK) {
         unsigned char* zl;
         unsigned char* fptr;
         unsigned char* vptr;
@@ -156,24 +176,23 @@ int hashTypeSet(robj* o, robj* field, robj* value) {
         value = getDecodedObject(value);
 
         zl = o->ptr;
-        fptr = ziplistIndex(zl, ZIPLIST_HEAD);
+        fptr = lpIndex(zl, LP_HEAD);
         if (fptr != NULL) {
-            fptr = ziplistFind(fptr, field->ptr, sdslen(field->ptr), 1);
+            fptr = lpFind(fptr, field->ptr, sdslen(field->ptr), 1);
             if (fptr != NULL) {
-                vptr = ziplistNext(zl, fptr);
+                vptr = lpNext(zl, fptr);
                 assert(vptr != NULL);
 
                 update = 1;
 
-                zl = ziplistDelete(zl, &vptr);
-
-                zl = ziplistInsert(zl, vptr, value->ptr, sdslen(value->ptr));
+                // 原地替换旧的值
+                zl = lpReplace(zl, &vptr, value->ptr, sdslen(value->ptr));
             }
         }
 
         if (!update) {
-            zl = ziplistPush(zl, field->ptr, sdslen(field->ptr), ZIPLIST_TAIL);
-            zl = ziplistPush(zl, value->ptr, sdslen(field->ptr), ZIPLIST_TAIL);
+            zl = lpPush(zl, field->ptr, sdslen(field->ptr), LP_TAIL);
+            zl = lpPush(zl, value->ptr, sdslen(value->ptr), LP_TAIL);
         }
 
         o->ptr = zl;
@@ -181,20 +200,38 @@ int hashTypeSet(robj* o, robj* field, robj* value) {
         decrRefCount(field);
         decrRefCount(value);
 
-        if (hashTypeLength(o) > HASH_MAX_ZIPLIST_ENTRIES)
+        // 超过listpack的长度限制时，优先转为带索引的紧凑编码
+        if (hashTypeLength(o) > server.hash_max_ziplist_entries) {
+            if (hashTypeLength(o) <= server.hash_max_packhash_entries)
+                hashTypeConvert(o, REDIS_ENCODING_PACKHASH);
+            else
+                hashTypeConvert(o, REDIS_ENCODING_HT);
+        }
+
+    } else if (o->encoding == REDIS_ENCODING_PACKHASH) {
+
+        field = getDecodedObject(field);
+        value = getDecodedObject(value);
+
+        update = packhashSet(o->ptr, field->ptr, sdslen(field->ptr), value->ptr, sdslen(value->ptr));
+
+        decrRefCount(field);
+        decrRefCount(value);
+
+        if (hashTypeLength(o) > server.hash_max_packhash_entries)
             hashTypeConvert(o, REDIS_ENCODING_HT);
 
     } else if (o->encoding == REDIS_ENCODING_HT) {
 
-        /* Insert */
-        if (dictReplace(o->ptr, field, value)) {
-            incrRefCount(field);
+        // 哈希表保存域和值的副本，不和参数数组或者其他对象共享
+        robj* dupfield = dupStringObject(field);
+
+        // 更新时字典保留原来的域，释放多余的副本
         /* Update */
-        } else {
+        if (!dictReplace(o->ptr, dupfield, dupStringObject(value))) {
             update = 1;
+            decrRefCount(dupfield);
         }
-
-        incrRefCount(value);
     } else {
         exit(1);
     }
@@ -208,24 +245,28 @@ int hashTypeSet(robj* o, robj* field, robj* value) {
 int hashTypeDelete(robj* o, robj* field) {
     int deleted = 0;
 
-    if (o->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (o->encoding == REDIS_ENCODING_LISTPACK) {
         unsigned char* zl;
         unsigned char* fptr;
 
         field = getDecodedObject(field);
 
         zl = o->ptr;
-        fptr = ziplistIndex(zl, ZIPLIST_HEAD);
+        fptr = lpIndex(zl, LP_HEAD);
         if (fptr != NULL) {
-            fptr = ziplistFind(fptr, field->ptr, sdslen(field->ptr), 1);
+            fptr = lpFind(fptr, field->ptr, sdslen(field->ptr), 1);
             if (fptr != NULL) {
-                zl = ziplistDelete(zl, &fptr);
-                zl = ziplistDelete(zl, &fptr);
+                zl = lpDelete(zl, &fptr);
+                zl = lpDelete(zl, &fptr);
                 o->ptr = zl;
                 deleted = 1;
             }
         }
 
+        decrRefCount(field);
+    } else if (o->encoding == REDIS_ENCODING_PACKHASH) {
+        field = getDecodedObject(field);
+        deleted = packhashDelete(o->ptr, field->ptr, sdslen(field->ptr));
         decrRefCount(field);
     } else if (o->encoding == REDIS_ENCODING_HT) {
         if (dictDelete((dict*)o->ptr, field) == REDIS_OK) {
@@ -247,8 +288,10 @@ int hashTypeDelete(robj* o, robj* field) {
 unsigned long hashTypeLength(robj* o) {
     unsigned long length = ULONG_MAX;
 
-    if (o->encoding == REDIS_ENCODING_ZIPLIST) {
-        length = ziplistLen(o->ptr) / 2;
+    if (o->encoding == REDIS_ENCODING_LISTPACK) {
+        length = lpLength(o->ptr) / 2;
+    } else if (o->encoding == REDIS_ENCODING_PACKHASH) {
+        length = packhashLength(o->ptr);
     } else if (o->encoding == REDIS_ENCODING_HT) {
         length = dictSize((dict*)o->ptr);
     } else {
@@ -269,7 +312,10 @@ hashTypeIterator* hashTypeInitIterator(robj* subject) {
 
     hi->encoding = subject->encoding;
 
-    if (hi->encoding == REDIS_ENCODING_ZIPLIST) {
+    // REDIS_ENCODING_PACKHASH编码按顺序遍历其中的listpack，迭代方式与REDIS_ENCODING_LISTPACK相同
+    if (hi->encoding == REDIS_ENCODING_PACKHASH) hi->encoding = REDIS_ENCODING_LISTPACK;
+
+    if (hi->encoding == REDIS_ENCODING_LISTPACK) {
         hi->fptr = NULL;
         hi->vptr = NULL;
     } else if (hi->encoding == REDIS_ENCODING_HT) {
@@ -298,26 +344,26 @@ void hashTypeReleaseIterator(hashTypeIterator* hi) {
  */
 int hashTypeNext(hashTypeIterator* hi) {
 
-    if (hi->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (hi->encoding == REDIS_ENCODING_LISTPACK) {
         unsigned char* zl;
         unsigned char* fptr;
         unsigned char* vptr;
 
-        zl = hi->subject->ptr;
+        zl = hashTypeListpack(hi->subject);
         fptr = hi->fptr;
         vptr = hi->vptr;
 
         if (fptr == NULL) {
             assert(vptr == NULL);
-            fptr = ziplistIndex(zl, 0);
+            fptr = lpIndex(zl, 0);
         } else {
             assert(vptr != NULL);
-            fptr = ziplistNext(zl, vptr);
+            fptr = lpNext(zl, vptr);
         }
 
         if (fptr == NULL) return REDIS_ERR;
 
-        vptr = ziplistNext(zl, fptr);
+        vptr = lpNext(zl, fptr);
         assert(vptr != NULL);
 
         hi->fptr = fptr;
@@ -334,19 +380,19 @@ int hashTypeNext(hashTypeIterator* hi) {
 }
 
 /*
- * 从底层编码为REDIS_ENCODING_ZIPLIST的哈希类型对象中，取出迭代器当前指向键值对的键或值
+ * 从底层编码为REDIS_ENCODING_LISTPACK的哈希类型对象中，取出迭代器当前指向键值对的键或值
  */
 void hashTypeCurrentFromZiplist(hashTypeIterator* hi, int what, unsigned char** vstr, unsigned int* vlen, long long* vll) {
 
     int ret;
 
-    assert(hi->encoding == REDIS_ENCODING_ZIPLIST);
+    assert(hi->encoding == REDIS_ENCODING_LISTPACK);
 
     if (what & REDIS_HASH_KEY) {
-        ret = ziplistGet(hi->fptr, vstr, vlen, vll);
+        ret = lpGet(hi->fptr, vstr, vlen, vll);
         assert(ret);
     } else {
-        ret = ziplistGet(hi->vptr, vstr, vlen, vll);
+        ret = lpGet(hi->vptr, vstr, vlen, vll);
         assert(ret);
     }
 }
@@ -372,7 +418,7 @@ void hashTypeCurrentFromHashTable(hashTypeIterator* hi, int what, robj** dst) {
 robj* hashTypeCurrentObject(hashTypeIterator* hi, int what) {
     robj* dst;
 
-    if (hi->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (hi->encoding == REDIS_ENCODING_LISTPACK) {
         unsigned char* vstr = NULL;
         unsigned int vlen = UINT_MAX;
         long long vll = LLONG_MAX;
@@ -396,14 +442,20 @@ robj* hashTypeCurrentObject(hashTypeIterator* hi, int what) {
 }
 
 /*
- * 将底层编码为REDIS_ENCODING_ZIPLIST的哈希类型对象转为enc编码
+ * 将底层编码为REDIS_ENCODING_LISTPACK或REDIS_ENCODING_PACKHASH的哈希类型对象转为enc编码
  */
 void hashTypeConvertZiplist(robj* o, int enc) {
-    assert(o->encoding == REDIS_ENCODING_ZIPLIST);
+    assert(o->encoding == REDIS_ENCODING_LISTPACK || o->encoding == REDIS_ENCODING_PACKHASH);
 
-    if (enc == REDIS_ENCODING_ZIPLIST) {
+    if (enc == o->encoding) {
         /* Nothing to do... */
 
+    } else if (enc == REDIS_ENCODING_PACKHASH) {
+
+        // 键值对仍然保存在原来的listpack中，只需要建立索引
+        o->ptr = packhashFromListpack(o->ptr);
+        o->encoding = REDIS_ENCODING_PACKHASH;
+
     } else if (enc == REDIS_ENCODING_HT) {
 
         hashTypeIterator* hi;
@@ -430,7 +482,10 @@ void hashTypeConvertZiplist(robj* o, int enc) {
 
         hashTypeReleaseIterator(hi);
 
-        zfree(o->ptr);
+        if (o->encoding == REDIS_ENCODING_PACKHASH)
+            packhashFree(o->ptr);
+        else
+            zfree(o->ptr);
 
         o->encoding = REDIS_ENCODING_HT;
         o->ptr = dict;
@@ -441,11 +496,11 @@ void hashTypeConvertZiplist(robj* o, int enc) {
 }
 
 /*
- * 将底层编码为REDIS_ENCODING_ZIPLIST的哈希类型对象转为enc编码，只允许转为REDIS_ENCODING_HT编码
+ * 转换哈希类型对象的底层编码，紧凑编码可以转为REDIS_ENCODING_PACKHASH或REDIS_ENCODING_HT编码
  */
 void hashTypeConvert(robj* o, int enc) {
 
-    if (o->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (o->encoding == REDIS_ENCODING_LISTPACK || o->encoding == REDIS_ENCODING_PACKHASH) {
         hashTypeConvertZiplist(o, enc);
     } else if (o->encoding == REDIS_ENCODING_HT) {
         exit(1);
@@ -456,7 +511,6 @@ void hashTypeConvert(robj* o, int enc) {
 
 /*
  * 注意: 
- * signalModifiedKey函数与独立功能事务相关，在本代码中删除；
  * notifyKeyspaceEvent函数与独立功能发布/订阅相关，在本代码中删除；
  */
 
@@ -481,28 +535,63 @@ robj* hashTypeLookupWriteOrCreate(redisClient* c, robj* key) {
     return o;
 }
 
+/*
+ * HSET和HMSET命令的底层实现，一次设置多个键值对，
+ * 返回新添加的键值对数量，参数数量不正确时向客户端回复错误并返回-1
+ */
+static long hashTypeSetMultiple(redisClient* c) {
+
+    int j;
+    long created = 0;
+    robj* o;
+
+    if ((c->argc % 2) == 1) {
+        addReplyErrorFormat(c, "wrong number of arguments for '%s' command", c->cmd->name);
+        return -1;
+    }
+
+    if ((o = hashTypeLookupWriteOrCreate(c, c->argv[1])) == NULL) return -1;
+
+    // 如果需要的话，转换哈希对象的底层编码，所有键值对只检查一次
+    hashTypeTryConversion(o, c->argv, 2, c->argc - 1);
+
+    for (j = 2; j < c->argc; j += 2) {
+        hashTypeTryObjectEncoding(o, &c->argv[j], &c->argv[j + 1]);
+        if (!hashTypeSet(o, c->argv[j], c->argv[j + 1])) created++;
+    }
+
+    signalModifiedKey(c->db, c->argv[1]);
+    server.dirty += (c->argc - 2) / 2;
+
+    return created;
+}
+
 /*
  * HSET命令
  *
- * 如果哈希值对象不存在，则创建一个新的哈希值对象
+ * HSET key field value [field value ...]
+ *
+ * 如果哈希值对象不存在，则创建一个新的哈希值对象，返回新添加的键值对数量
  */
 void hsetCommand(redisClient* c) {
 
-    int update;
-    robj* o;
+    long created;
 
-    if ((o = hashTypeLookupWriteOrCreate(c, c->argv[1])) == NULL) return;
-
-    // 如果需要的话，转换哈希对象的底层编码
-    hashTypeTryConversion(o, c->argv, 2, 3);
+    if ((created = hashTypeSetMultiple(c)) < 0) return;
 
-    hashTypeTryObjectEncoding(o, &c->argv[2], &c->argv[3]);
+    addReplyLongLong(c, created);
+}
 
-    update = hashTypeSet(o, c->argv[2], c->argv[3]);
+/*
+ * HMSET命令
+ *
+ * HMSET key field value [field value ...]
+ */
+void hmsetCommand(redisClient* c) {
 
-    addReply(c, update ? shared.czero : shared.cone);
+    if (hashTypeSetMultiple(c) < 0) return;
 
-    server.dirty++;
+    addReply(c, shared.ok);
 }
 
 /*
@@ -526,6 +615,7 @@ void hsetnxCommand(redisClient* c) {
 
         addReply(c, shared.cone);
 
+        signalModifiedKey(c->db, c->argv[1]);
         server.dirty++;
     }
 }
@@ -542,7 +632,7 @@ static void addHashFieldToReply(redisClient* c, robj* o, robj* field) {
         return;
     }
 
-    if (o->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (o->encoding == REDIS_ENCODING_LISTPACK || o->encoding == REDIS_ENCODING_PACKHASH) {
         unsigned char* vstr = NULL;
         unsigned int vlen = UINT_MAX;
         long long vll = LLONG_MAX;
@@ -565,7 +655,7 @@ static void addHashFieldToReply(redisClient* c, robj* o, robj* field) {
         if (ret < 0) {
             addReply(c, shared.nullbulk);
         } else {
-            addReplyBulk(c, value);
+            addReplyBulkCopy(c, value);
         }
 
     } else {
@@ -585,6 +675,99 @@ void hgetCommand(redisClient* c) {
     addHashFieldToReply(c, o, c->argv[2]);
 }
 
+/*
+ * 遍历一次底层编码为REDIS_ENCODING_LISTPACK的哈希类型对象，查找count个field，
+ * vptrs[i]保存fields[i]对应的值在listpack中的地址，不存在的field对应NULL
+ */
+static void hashTypeZiplistMultiGet(unsigned char* zl, robj** fields, int count, unsigned char** vptrs) {
+    unsigned char* fptr;
+    unsigned char* vptr;
+    unsigned char* vstr;
+    unsigned int vlen;
+    long long vll;
+    char buf[REDIS_LONGSTR_SIZE];
+    int remaining = count;
+    int j;
+
+    for (j = 0; j < count; j++) vptrs[j] = NULL;
+
+    fptr = lpIndex(zl, LP_HEAD);
+    while (fptr != NULL && remaining > 0) {
+        vptr = lpNext(zl, fptr);
+        assert(vptr != NULL);
+
+        // 每个field只解码一次，整数编码的field转为字符串后与所有未找到的field比较
+        lpGet(fptr, &vstr, &vlen, &vll);
+        if (vstr == NULL) {
+            vlen = ll2string(buf, sizeof(buf), vll);
+            vstr = (unsigned char*) buf;
+        }
+
+        for (j = 0; j < count; j++) {
+            if (vptrs[j] == NULL && sdslen(fields[j]->ptr) == vlen && memcmp(fields[j]->ptr, vstr, vlen) == 0) {
+                vptrs[j] = vptr;
+                remaining--;
+            }
+        }
+
+        fptr = lpNext(zl, vptr);
+    }
+}
+
+/*
+ * HMGET命令
+ *
+ * HMGET key field [field ...]
+ *
+ * 返回多个field对应的值，不存在的field返回空值；
+ * REDIS_ENCODING_LISTPACK编码只遍历一次listpack，其他编码逐个查找
+ */
+void hmgetCommand(redisClient* c) {
+    robj* o;
+    int count = c->argc - 2;
+    int j;
+
+    o = lookupKeyRead(c->db, c->argv[1]);
+    if (o != NULL && o->type != REDIS_HASH) {
+        addReply(c, shared.wrongtypeerr);
+        return;
+    }
+
+    addReplyMultiBulkLen(c, count);
+
+    if (o != NULL && o->encoding == REDIS_ENCODING_LISTPACK) {
+        robj** fields = zmalloc(sizeof(robj*) * count);
+        unsigned char** vptrs = zmalloc(sizeof(unsigned char*) * count);
+
+        for (j = 0; j < count; j++) fields[j] = getDecodedObject(c->argv[j + 2]);
+
+        hashTypeZiplistMultiGet(o->ptr, fields, count, vptrs);
+
+        for (j = 0; j < count; j++) {
+            unsigned char* vstr = NULL;
+            unsigned int vlen = UINT_MAX;
+            long long vll = LLONG_MAX;
+
+            if (vptrs[j] == NULL) {
+                addReply(c, shared.nullbulk);
+            } else {
+                lpGet(vptrs[j], &vstr, &vlen, &vll);
+                if (vstr) {
+                    addReplyBulkCBuffer(c, vstr, vlen);
+                } else {
+                    addReplyBulkLongLong(c, vll);
+                }
+            }
+            decrRefCount(fields[j]);
+        }
+
+        zfree(fields);
+        zfree(vptrs);
+    } else {
+        for (j = 2; j < c->argc; j++) addHashFieldToReply(c, o, c->argv[j]);
+    }
+}
+
 /*
  * HEXISTS命令
  */
@@ -622,6 +805,7 @@ void hdelCommand(redisClient* c) {
 
     if (deleted) {
 
+        signalModifiedKey(c->db, c->argv[1]);
         server.dirty += deleted;
     }
 
@@ -645,7 +829,7 @@ void hlenCommand(redisClient* c) {
  */
 static void addHashIteratorCursorToReply(redisClient* c, hashTypeIterator* hi, int what) {
 
-    if (hi->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (hi->encoding == REDIS_ENCODING_LISTPACK) {
         unsigned char* vstr = NULL;
         unsigned int vlen = UINT_MAX;
         long long vll = LLONG_MAX;
@@ -660,7 +844,7 @@ static void addHashIteratorCursorToReply(redisClient* c, hashTypeIterator* hi, i
         robj* value;
 
         hashTypeCurrentFromHashTable(hi, what, &value);
-        addReplyBulk(c, value);
+        addReplyBulkCopy(c, value);
     } else {
         exit(1);
     }
@@ -710,3 +894,218 @@ void genericHgetallCommand(redisClient* c, int flags) {
 void hgetallCommand(redisClient* c) {
     genericHgetallCommand(c, REDIS_HASH_KEY | REDIS_HASH_VALUE);
 }
+
+/*
+ * HKEYS命令
+ *
+ * 返回哈希值对象中所有的键
+ */
+void hkeysCommand(redisClient* c) {
+    genericHgetallCommand(c, REDIS_HASH_KEY);
+}
+
+/*
+ * HVALS命令
+ *
+ * 返回哈希值对象中所有的值
+ */
+void hvalsCommand(redisClient* c) {
+    genericHgetallCommand(c, REDIS_HASH_VALUE);
+}
+
+/*
+ * HINCRBY命令
+ *
+ * HINCRBY key field increment
+ *
+ * 将field对应的整数值加上increment，field不存在时值从0开始；
+ * 紧凑编码中新值的编码长度不变时，直接在listpack中原地修改
+ */
+void hincrbyCommand(redisClient* c) {
+    long long value = 0;
+    long long incr;
+    unsigned char* vptr = NULL;
+    robj* o;
+
+    if (getLongLongFromObjectOrReply(c, c->argv[3], &incr, NULL) != REDIS_OK) return;
+
+    o = lookupKeyWrite(c->db, c->argv[1]);
+    if (o != NULL && checkType(c, o, REDIS_HASH)) return;
+
+    // 取出当前值
+    if (o != NULL && (o->encoding == REDIS_ENCODING_LISTPACK || o->encoding == REDIS_ENCODING_PACKHASH)) {
+        robj* field = getDecodedObject(c->argv[2]);
+
+        vptr = hashTypeZiplistValuePtr(o, field->ptr, sdslen(field->ptr));
+        decrRefCount(field);
+
+        if (vptr != NULL) {
+            unsigned char* vstr = NULL;
+            unsigned int vlen = UINT_MAX;
+
+            lpGet(vptr, &vstr, &vlen, &value);
+            if (vstr && !string2ll((char*) vstr, vlen, &value)) {
+                addReplyError(c, "hash value is not an integer");
+                return;
+            }
+        }
+    } else if (o != NULL) {
+        robj* current;
+
+        // 与紧凑编码一样使用string2ll严格解析，空字符串等不视为0
+        if (hashTypeGetFromHashTable(o, c->argv[2], &current) == 0) {
+            if (current->encoding == REDIS_ENCODING_INT) {
+                value = (long)current->ptr;
+            } else if (!string2ll(current->ptr, sdslen(current->ptr), &value)) {
+                addReplyError(c, "hash value is not an integer");
+                return;
+            }
+        }
+    }
+
+    if ((incr < 0 && value < 0 && incr < (LLONG_MIN - value)) ||
+        (incr > 0 && value > 0 && incr > (LLONG_MAX - value))) {
+        addReplyError(c, "increment or decrement would overflow");
+        return;
+    }
+    value += incr;
+
+    // 新值的编码长度与旧值不同，或者field不存在时，通过hashTypeSet设置
+    if (vptr == NULL || !lpReplaceIntegerInPlace(vptr, value)) {
+        robj* new = createStringObjectFromLongLong(value);
+
+        if (o == NULL) {
+            o = createHashObject();
+            dbAdd(c->db, c->argv[1], o);
+        }
+
+        hashTypeTryConversion(o, c->argv, 2, 2);
+        hashTypeTryObjectEncoding(o, &c->argv[2], NULL);
+        hashTypeSet(o, c->argv[2], new);
+        decrRefCount(new);
+    }
+
+    addReplyLongLong(c, value);
+
+    signalModifiedKey(c->db, c->argv[1]);
+    server.dirty++;
+}
+
+/*
+ * HINCRBYFLOAT命令
+ *
+ * HINCRBYFLOAT key field increment
+ *
+ * 将field对应的值加上浮点数increment，以HSET命令传播最终的值
+ */
+void hincrbyfloatCommand(redisClient* c) {
+    long double value = 0;
+    long double incr;
+    robj* o;
+    robj* current;
+    robj* new;
+    robj* aux;
+
+    if (getLongDoubleFromObjectOrReply(c, c->argv[3], &incr, NULL) != REDIS_OK) return;
+
+    o = lookupKeyWrite(c->db, c->argv[1]);
+    if (o != NULL && checkType(c, o, REDIS_HASH)) return;
+
+    // 对所有编码都使用string2ld严格解析当前值
+    if (o != NULL && (current = hashTypeGetObject(o, c->argv[2])) != NULL) {
+        if (current->encoding == REDIS_ENCODING_INT) {
+            value = (long)current->ptr;
+        } else if (!string2ld(current->ptr, sdslen(current->ptr), &value)) {
+            decrRefCount(current);
+            addReplyError(c, "hash value is not a valid float");
+            return;
+        }
+        decrRefCount(current);
+    }
+
+    value += incr;
+    if (isnan(value) || isinf(value)) {
+        addReplyError(c, "increment would produce NaN or Infinity");
+        return;
+    }
+
+    if (o == NULL) {
+        o = createHashObject();
+        dbAdd(c->db, c->argv[1], o);
+    }
+
+    new = createStringObjectFromLongDouble(value);
+    hashTypeTryConversion(o, c->argv, 2, 2);
+    hashTypeTryConversion(o, &new, 0, 0);
+    hashTypeTryObjectEncoding(o, &c->argv[2], NULL);
+    hashTypeSet(o, c->argv[2], new);
+
+    addReplyBulk(c, new);
+
+    signalModifiedKey(c->db, c->argv[1]);
+    server.dirty++;
+
+    // 将HINCRBYFLOAT重写为等价的HSET命令，避免浮点数精度和格式在从服务器或AOF重放时产生差异
+    aux = createStringObject("HSET", 4);
+    rewriteClientCommandArgument(c, 0, aux);
+    decrRefCount(aux);
+    rewriteClientCommandArgument(c, 3, new);
+    decrRefCount(new);
+}
+
+/*
+ * HSTRLEN命令
+ *
+ * HSTRLEN key field
+ *
+ * 返回field对应值的字符串长度，field不存在时返回0
+ */
+void hstrlenCommand(redisClient* c) {
+    robj* o;
+    size_t len = 0;
+
+    if ((o = lookupKeyReadOrReply(c, c->argv[1], shared.czero)) == NULL || checkType(c, o, REDIS_HASH))
+        return;
+
+    if (o->encoding == REDIS_ENCODING_LISTPACK || o->encoding == REDIS_ENCODING_PACKHASH) {
+        unsigned char* vstr = NULL;
+        unsigned int vlen = UINT_MAX;
+        long long vll = LLONG_MAX;
+
+        if (hashTypeGetFromZiplist(o, c->argv[2], &vstr, &vlen, &vll) == 0) {
+            if (vstr) {
+                len = vlen;
+            } else {
+                char buf[REDIS_LONGSTR_SIZE];
+                len = ll2string(buf, sizeof(buf), vll);
+            }
+        }
+    } else if (o->encoding == REDIS_ENCODING_HT) {
+        robj* value;
+
+        if (hashTypeGetFromHashTable(o, c->argv[2], &value) == 0) len = stringObjectLen(value);
+    } else {
+        exit(1);
+    }
+
+    addReplyLongLong(c, len);
+}
+
+/*
+ * HSCAN命令
+ *
+ * HSCAN key cursor [MATCH pattern] [COUNT count]
+ *
+ * 增量迭代哈希值对象中的键值对
+ */
+void hscanCommand(redisClient* c) {
+    robj* o;
+    unsigned long cursor;
+
+    if (parseScanCursorOrReply(c, c->argv[2], &cursor) == REDIS_ERR) return;
+
+    if ((o = lookupKeyReadOrReply(c, c->argv[1], shared.emptyscan)) == NULL || checkType(c, o, REDIS_HASH))
+        return;
+
+    scanGenericCommand(c, o, cursor);
+}
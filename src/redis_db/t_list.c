@@ -9,14 +9,14 @@
  */
 
 /*
- * 检查输入值value，如果超出限定长度，则将列表类型对象编码由REDIS_ENCODING_ZIPLIST转化为REDIS_ENCODING_LINKEDLIST
+ * 检查输入值value，如果超出限定长度，则将列表类型对象编码由REDIS_ENCODING_LISTPACK转化为REDIS_ENCODING_QUICKLIST
  */
 void listTypeTryConversion(robj* subject, robj* value) {
 
-    if (subject->encoding != REDIS_ENCODING_ZIPLIST) return;
+    if (subject->encoding != REDIS_ENCODING_LISTPACK) return;
 
     if (sdsEncodedObject(value) && sdslen(value->ptr) > LIST_MAX_ZIPLIST_VALUE)
-        listTypeConvert(subject, REDIS_ENCODING_LINKEDLIST);
+        listTypeConvert(subject, REDIS_ENCODING_QUICKLIST);
 }
 
 /*
@@ -27,29 +27,34 @@ void listTypePush(robj* subject, robj* value, int where) {
     // 检查是否需要进行编码转换以保存value
     listTypeTryConversion(subject, value);
 
-    // 检查列表元素数目是否已经超出限定，如果超出则转换编码为REDIS_ENCODING_LINKEDLIST
-    if (subject->encoding == REDIS_ENCODING_ZIPLIST && ziplistLen(subject->ptr) >= LIST_MAX_ZIPLIST_ENTRIES)
-        listTypeConvert(subject, REDIS_ENCODING_LINKEDLIST);
+    // 检查列表元素数目是否已经超出限定，如果超出则转换编码为REDIS_ENCODING_QUICKLIST
+    if (subject->encoding == REDIS_ENCODING_LISTPACK && lpLength(subject->ptr) >= LIST_MAX_ZIPLIST_ENTRIES)
+        listTypeConvert(subject, REDIS_ENCODING_QUICKLIST);
 
-    // 如果列表类型对象的底层使用的是压缩列表，则调用压缩列表API: ziplistPush
-    if (subject->encoding == REDIS_ENCODING_ZIPLIST) {
-        int pos = (where == REDIS_HEAD) ? ZIPLIST_HEAD : ZIPLIST_TAIL;
+    // 如果列表类型对象的底层使用的是listpack，则调用listpackAPI: lpPush
+    if (subject->encoding == REDIS_ENCODING_LISTPACK) {
+        int pos = (where == REDIS_HEAD) ? LP_HEAD : LP_TAIL;
         value = getDecodedObject(value);
-        subject->ptr = ziplistPush(subject->ptr, value->ptr, sdslen(value->ptr), pos);
+        subject->ptr = lpPush(subject->ptr, value->ptr, sdslen(value->ptr), pos);
+        decrRefCount(value);
+    // 如果列表类型对象的底层使用的是快速列表，则调用快速列表API: quicklistPush
+    } else if (subject->encoding == REDIS_ENCODING_QUICKLIST) {
+        int pos = (where == REDIS_HEAD) ? QUICKLIST_HEAD : QUICKLIST_TAIL;
+        value = getDecodedObject(value);
+        quicklistPush(subject->ptr, value->ptr, sdslen(value->ptr), pos);
         decrRefCount(value);
-    // 如果列表类型对象的底层使用的是双向链表，则调用双向链表API: listAddNodeHead & listAddNodeTail
-    } else if (subject->encoding == REDIS_ENCODING_LINKEDLIST) {
-        if (where == REDIS_HEAD) {
-            listAddNodeHead(subject->ptr, value);
-        } else {
-            listAddNodeTail(subject->ptr, value);
-        }
-        incrRefCount(value);
     } else {
         exit(1);
     }
 }
 
+/*
+ * 快速列表弹出元素时，用于将字符串值复制为字符串对象
+ */
+static void* listPopSaver(unsigned char* data, unsigned int sz) {
+    return createStringObject((char*)data, sz);
+}
+
 /*
  * 从列表的表头或表尾弹出一个元素
  */
@@ -57,8 +62,8 @@ robj* listTypePop(robj* subject, int where) {
 
     robj* value = NULL;
 
-    // 如果列表类型对象的底层使用的是压缩列表，则调用压缩列表API: ziplistIndex
-    if (subject->encoding == REDIS_ENCODING_ZIPLIST) {
+    // 如果列表类型对象的底层使用的是listpack，则调用listpackAPI: lpIndex
+    if (subject->encoding == REDIS_ENCODING_LISTPACK) {
         unsigned char* p;
         unsigned char* vstr;
         unsigned int vlen;
@@ -66,31 +71,22 @@ robj* listTypePop(robj* subject, int where) {
 
         int pos = (where == REDIS_HEAD) ? 0 : -1;
 
-        p = ziplistIndex(subject->ptr, pos);
-        if (ziplistGet(p, &vstr, &vlen, &vlong)) {
+        p = lpIndex(subject->ptr, pos);
+        if (lpGet(p, &vstr, &vlen, &vlong)) {
             if (vstr) {
                 value = createStringObject((char*)vstr, vlen);
             } else {
                 value = createStringObjectFromLongLong(vlong);
             }
-            subject->ptr = ziplistDelete(subject->ptr, &p);
-        }
-    // 如果列表类型对象的底层使用的是双向链表，则调用双向链表API: listFirst & listLast
-    } else if (subject->encoding == REDIS_ENCODING_LINKEDLIST) {
-
-        list* list = subject->ptr;
-        listNode* ln;
-
-        if (where == REDIS_HEAD) {
-            ln = listFirst(list);
-        } else {
-            ln = listLast(list);
+            subject->ptr = lpDelete(subject->ptr, &p);
         }
+    // 如果列表类型对象的底层使用的是快速列表，则调用快速列表API: quicklistPopCustom
+    } else if (subject->encoding == REDIS_ENCODING_QUICKLIST) {
+        long long vlong;
+        int pos = (where == REDIS_HEAD) ? QUICKLIST_HEAD : QUICKLIST_TAIL;
 
-        if (ln != NULL) {
-            value = listNodeValue(ln);
-            incrRefCount(value);
-            listDelNode(list, ln);
+        if (quicklistPopCustom(subject->ptr, pos, (unsigned char**) &value, NULL, &vlong, listPopSaver)) {
+            if (!value) value = createStringObjectFromLongLong(vlong);
         }
     } else {
         exit(1);
@@ -104,10 +100,10 @@ robj* listTypePop(robj* subject, int where) {
  */
 unsigned long listTypeLength(robj* subject) {
 
-    if (subject->encoding == REDIS_ENCODING_ZIPLIST) {
-        return ziplistLen(subject->ptr);
-    } else if (subject->encoding == REDIS_ENCODING_LINKEDLIST) {
-        return listLength((list*)subject->ptr);
+    if (subject->encoding == REDIS_ENCODING_LISTPACK) {
+        return lpLength(subject->ptr);
+    } else if (subject->encoding == REDIS_ENCODING_QUICKLIST) {
+        return quicklistCount(subject->ptr);
     } else {
         exit(1);
     }
@@ -126,10 +122,14 @@ listTypeIterator* listTypeInitIterator(robj* subject, long index, unsigned char
 
     li->direction = direction;
 
-    if (li->encoding == REDIS_ENCODING_ZIPLIST) {
-        li->zi = ziplistIndex(subject->ptr, index);
-    } else if (li->encoding == REDIS_ENCODING_LINKEDLIST) {
-        li->ln = listIndex(subject->ptr, index);
+    li->iter = NULL;
+
+    if (li->encoding == REDIS_ENCODING_LISTPACK) {
+        li->zi = lpIndex(subject->ptr, index);
+    } else if (li->encoding == REDIS_ENCODING_QUICKLIST) {
+        // REDIS_TAIL表示从表头向表尾迭代
+        int iter_direction = (direction == REDIS_TAIL) ? AL_START_HEAD : AL_START_TAIL;
+        li->iter = quicklistGetIteratorAtIdx(subject->ptr, iter_direction, index);
     } else {
         exit(1);
     }
@@ -141,6 +141,7 @@ listTypeIterator* listTypeInitIterator(robj* subject, long index, unsigned char
  * 释放指定的列表迭代器
  */
 void listTypeReleaseIterator(listTypeIterator* li) {
+    if (li->iter) quicklistReleaseIterator(li->iter);
     zfree(li);
 }
 
@@ -152,32 +153,22 @@ int listTypeNext(listTypeIterator* li, listTypeEntry* entry) {
 
     entry->li = li;
 
-    // 迭代压缩列表
-    if (li->encoding == REDIS_ENCODING_ZIPLIST) {
+    // 迭代listpack
+    if (li->encoding == REDIS_ENCODING_LISTPACK) {
         // 记录当前节点
         entry->zi = li->zi;
 
         if (entry->zi != NULL) {
             // 移动迭代器的指针
             if (li->direction == REDIS_TAIL)
-                li->zi = ziplistNext(li->subject->ptr, li->zi);
-            else
-                li->zi = ziplistPrev(li->subject->ptr, li->zi);
-            return 1;
-        }
-    // 迭代双向链表
-    } else if (li->encoding == REDIS_ENCODING_LINKEDLIST) {
-        // 记录当前节点
-        entry->ln = li->ln;
-
-        if (entry->ln != NULL) {
-            // 移动迭代器的指针
-            if (li->direction == REDIS_TAIL)
-                li->ln = li->ln->next;
+                li->zi = lpNext(li->subject->ptr, li->zi);
             else
-                li->ln = li->ln->prev;
+                li->zi = lpPrev(li->subject->ptr, li->zi);
             return 1;
         }
+    // 迭代快速列表，索引越界时没有创建迭代器
+    } else if (li->encoding == REDIS_ENCODING_QUICKLIST) {
+        return li->iter ? quicklistNext(li->iter, &entry->entry) : 0;
     } else {
         exit(1);
     }
@@ -194,22 +185,24 @@ robj* listTypeGet(listTypeEntry* entry) {
 
     robj* value = NULL;
 
-    if (li->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (li->encoding == REDIS_ENCODING_LISTPACK) {
         unsigned char* vstr;
         unsigned int vlen;
         long long vlong;
         assert(entry->zi != NULL);
-        if (ziplistGet(entry->zi, &vstr, &vlen, &vlong)) {
+        if (lpGet(entry->zi, &vstr, &vlen, &vlong)) {
             if (vstr) {
                 value = createStringObject((char*)vstr, vlen);
             } else {
                 value = createStringObjectFromLongLong(vlong);
             }
         }
-    } else if (li->encoding == REDIS_ENCODING_LINKEDLIST) {
-        assert(entry->ln != NULL);
-        value = listNodeValue(entry->ln);
-        incrRefCount(value);
+    } else if (li->encoding == REDIS_ENCODING_QUICKLIST) {
+        if (entry->entry.value) {
+            value = createStringObject((char*)entry->entry.value, entry->entry.sz);
+        } else {
+            value = createStringObjectFromLongLong(entry->entry.longval);
+        }
     } else {
         exit(1);
     }
@@ -224,30 +217,32 @@ void listTypeInsert(listTypeEntry* entry, robj* value, int where) {
 
     robj* subject = entry->li->subject;
 
-    if (entry->li->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (entry->li->encoding == REDIS_ENCODING_LISTPACK) {
 
         value = getDecodedObject(value);
 
         if (where == REDIS_TAIL) {
-            unsigned char* next = ziplistNext(subject->ptr, entry->zi);
+            unsigned char* next = lpNext(subject->ptr, entry->zi);
 
             if (next == NULL) {
-                subject->ptr = ziplistPush(subject->ptr, value->ptr, sdslen(value->ptr), REDIS_TAIL);
+                subject->ptr = lpPush(subject->ptr, value->ptr, sdslen(value->ptr), REDIS_TAIL);
             } else {
-                subject->ptr = ziplistInsert(subject->ptr, next, value->ptr, sdslen(value->ptr));
+                subject->ptr = lpInsert(subject->ptr, next, value->ptr, sdslen(value->ptr));
             }
         } else {
-            subject->ptr = ziplistInsert(subject->ptr, entry->zi, value->ptr, sdslen(value->ptr));
+            subject->ptr = lpInsert(subject->ptr, entry->zi, value->ptr, sdslen(value->ptr));
         }
         decrRefCount(value);
-    } else if (entry->li->encoding == REDIS_ENCODING_LINKEDLIST) {
+    } else if (entry->li->encoding == REDIS_ENCODING_QUICKLIST) {
+
+        value = getDecodedObject(value);
+
         if (where == REDIS_TAIL) {
-            listInsertNode(subject->ptr, entry->ln, value, AL_START_TAIL);
+            quicklistInsertAfter(subject->ptr, &entry->entry, value->ptr, sdslen(value->ptr));
         } else {
-            listInsertNode(subject->ptr, entry->ln, value, AL_START_HEAD);
+            quicklistInsertBefore(subject->ptr, &entry->entry, value->ptr, sdslen(value->ptr));
         }
-
-        incrRefCount(value);
+        decrRefCount(value);
     } else {
         exit(1);
     }
@@ -260,11 +255,12 @@ int listTypeEqual(listTypeEntry* entry, robj* o) {
 
     listTypeIterator* li = entry->li;
 
-    if (li->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (li->encoding == REDIS_ENCODING_LISTPACK) {
         assert(sdsEncodedObject(o));
-        return ziplistCompare(entry->zi, o->ptr, sdslen(o->ptr));
-    } else if (li->encoding == REDIS_ENCODING_LINKEDLIST) {
-        return equalStringObjects(o, listNodeValue(entry->ln));
+        return lpCompare(entry->zi, o->ptr, sdslen(o->ptr));
+    } else if (li->encoding == REDIS_ENCODING_QUICKLIST) {
+        assert(sdsEncodedObject(o));
+        return quicklistCompare(entry->entry.zi, o->ptr, sdslen(o->ptr));
     } else {
         exit(1);
     }
@@ -277,56 +273,67 @@ void listTypeDelete(listTypeEntry* entry) {
 
     listTypeIterator* li = entry->li;
 
-    if (li->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (li->encoding == REDIS_ENCODING_LISTPACK) {
         unsigned char* p = entry->zi;
 
-        li->subject->ptr = ziplistDelete(li->subject->ptr, &p);
+        li->subject->ptr = lpDelete(li->subject->ptr, &p);
 
         if (li->direction == REDIS_TAIL)
             li->zi = p;
         else
-            li->zi = ziplistPrev(li->subject->ptr, p);
-    } else if (entry->li->encoding == REDIS_ENCODING_LINKEDLIST) {
-
-        listNode* next;
-
-        if (li->direction == REDIS_TAIL)
-            next = entry->ln->next;
-        else
-            next = entry->ln->prev;
+            li->zi = lpPrev(li->subject->ptr, p);
+    } else if (entry->li->encoding == REDIS_ENCODING_QUICKLIST) {
+        quicklistDelEntry(li->iter, &entry->entry);
+    } else {
+        exit(1);
+    }
+}
 
-        listDelNode(li->subject->ptr, entry->ln);
+/*
+ * 删除从索引start开始的count个元素，start可以为负数
+ */
+void listTypeDelRange(robj* subject, long start, long count) {
 
-        li->ln = next;
+    if (subject->encoding == REDIS_ENCODING_LISTPACK) {
+        subject->ptr = lpDeleteRange(subject->ptr, start, count);
+    } else if (subject->encoding == REDIS_ENCODING_QUICKLIST) {
+        quicklistDelRange(subject->ptr, start, count);
     } else {
         exit(1);
     }
 }
 
 /*
- * 将列表对象的编码转换为REDIS_ENCODING_LINKEDLIST
+ * 将列表对象的编码转换为REDIS_ENCODING_QUICKLIST
  */
 void listTypeConvert(robj* subject, int enc) {
 
-    listTypeIterator* li;
-    listTypeEntry entry;
-
     assert(subject->type == REDIS_LIST);
+    assert(subject->encoding == REDIS_ENCODING_LISTPACK);
 
-    if (enc == REDIS_ENCODING_LINKEDLIST) {
-
-        list* l = listCreate();
-        listSetFreeMethod(l, decrRefCountVoid);
-
-        li = listTypeInitIterator(subject, 0, REDIS_TAIL);
-        while (listTypeNext(li, &entry)) listAddNodeTail(l, listTypeGet(&entry));
-        listTypeReleaseIterator(li);
-
-        subject->encoding = REDIS_ENCODING_LINKEDLIST;
+    if (enc == REDIS_ENCODING_QUICKLIST) {
+        quicklist* ql = quicklistNew(server.list_max_ziplist_size, server.list_compress_depth);
+        unsigned char* lp = subject->ptr;
+        unsigned char* p = lpIndex(lp, 0);
+        unsigned char* vstr;
+        unsigned int vlen;
+        long long vlong;
 
-        zfree(subject->ptr);
+        // 快速列表的节点仍然是压缩列表，逐个取出listpack中的元素添加到快速列表表尾
+        while (lpGet(p, &vstr, &vlen, &vlong)) {
+            if (vstr) {
+                quicklistPushTail(ql, vstr, vlen);
+            } else {
+                char buf[32];
+                int len = ll2string(buf, sizeof(buf), vlong);
+                quicklistPushTail(ql, buf, len);
+            }
+            p = lpNext(lp, p);
+        }
+        zfree(lp);
 
-        subject->ptr = l;
+        subject->ptr = ql;
+        subject->encoding = REDIS_ENCODING_QUICKLIST;
     } else {
         exit(1);
     }
@@ -334,7 +341,6 @@ void listTypeConvert(robj* subject, int enc) {
 
 /*
  * 注意: 
- * signalModifiedKey函数与独立功能事务相关，在本代码中删除；
  * notifyKeyspaceEvent函数与独立功能发布/订阅相关，在本代码中删除；
  */
 
@@ -372,7 +378,7 @@ void pushGenericCommand(redisClient* c, int where) {
         c->argv[j] = tryObjectEncoding(c->argv[j]);
 
         if (!lobj) {
-            lobj = createZiplistObject();
+            lobj = createListpackObject();
             dbAdd(c->db, c->argv[1], lobj);
         }
 
@@ -382,6 +388,7 @@ void pushGenericCommand(redisClient* c, int where) {
 
     addReplyLongLong(c, /* waiting + */ (lobj ? listTypeLength(lobj) : 0));
 
+    if (pushed) signalModifiedKey(c->db, c->argv[1]);
     server.dirty += pushed;
 }
 
@@ -420,7 +427,7 @@ void pushxGenericCommand(redisClient* c, robj* refval, robj* val, int where) {
          * convert the list inside the iterator. We don't want to loop over
          * the list twice (once to see if the value can be inserted and once
          * to do the actual insert), so we assume this value can be inserted
-         * and convert the ziplist to a regular list if necessary. */
+         * and convert the listpack to a regular list if necessary. */
         listTypeTryConversion(subject, val);
 
         /* Seek refval from head to tail */
@@ -435,11 +442,12 @@ void pushxGenericCommand(redisClient* c, robj* refval, robj* val, int where) {
         listTypeReleaseIterator(iter);
 
         if (inserted) {
-            /* Check if the length exceeds the ziplist length threshold. */
-            if (subject->encoding == REDIS_ENCODING_ZIPLIST &&
-                ziplistLen(subject->ptr) > server.list_max_ziplist_entries)
-                listTypeConvert(subject, REDIS_ENCODING_LINKEDLIST);
+            /* Check if the length exceeds the listpack length threshold. */
+            if (subject->encoding == REDIS_ENCODING_LISTPACK &&
+                lpLength(subject->ptr) > server.list_max_ziplist_entries)
+                listTypeConvert(subject, REDIS_ENCODING_QUICKLIST);
 
+            signalModifiedKey(c->db, c->argv[1]);
             server.dirty++;
         } else {
             /* Notify client of a failed insert */
@@ -452,6 +460,7 @@ void pushxGenericCommand(redisClient* c, robj* refval, robj* val, int where) {
 
         listTypePush(subject, val, where);
 
+        signalModifiedKey(c->db, c->argv[1]);
         server.dirty++;
     }
 
@@ -492,30 +501,119 @@ void linsertCommand(redisClient* c) {
     }
 }
 
+/*
+ * 将entry记录的节点的值添加到回复中，不需要为每个元素创建字符串对象
+ */
+static void addListEntryReply(redisClient* c, listTypeEntry* entry) {
+
+    if (entry->li->encoding == REDIS_ENCODING_LISTPACK) {
+        unsigned char* vstr;
+        unsigned int vlen;
+        long long vlong;
+
+        lpGet(entry->zi, &vstr, &vlen, &vlong);
+        if (vstr) {
+            addReplyBulkCBuffer(c, vstr, vlen);
+        } else {
+            addReplyBulkLongLong(c, vlong);
+        }
+    } else if (entry->li->encoding == REDIS_ENCODING_QUICKLIST) {
+        if (entry->entry.value) {
+            addReplyBulkCBuffer(c, entry->entry.value, entry->entry.sz);
+        } else {
+            addReplyBulkLongLong(c, entry->entry.longval);
+        }
+    } else {
+        exit(1);
+    }
+}
+
+/*
+ * 回复列表中索引start到end(包含)的元素，start和end必须是合法的非负索引，reverse为真时从end到start逆序回复
+ *
+ * 从离起始元素较近的一端定位，之后只顺序迭代一次，不需要对每个元素重新按索引查找
+ */
+static void addListRangeReply(redisClient* c, robj* o, long start, long end, int reverse) {
+    long llen = listTypeLength(o);
+    long rangelen = end - start + 1;
+    long from = reverse ? end : start;
+    listTypeIterator* li;
+    listTypeEntry entry;
+
+    // 负数索引从表尾开始定位
+    if (from > llen / 2) from -= llen;
+
+    addReplyMultiBulkLen(c, rangelen);
+    li = listTypeInitIterator(o, from, reverse ? REDIS_HEAD : REDIS_TAIL);
+    while (rangelen-- && listTypeNext(li, &entry))
+        addListEntryReply(c, &entry);
+    listTypeReleaseIterator(li);
+}
+
 /*
  * LPOP，RPOP命令的底层实现
+ *
+ * 带有count参数时，先按顺序回复要弹出的元素，再一次删除整个范围
  */
 void popGenericCommand(redisClient* c, int where) {
 
-    robj* o = lookupKeyWriteOrReply(c, c->argv[1], shared.nullbulk);
+    long count = 0;
+    int hascount = (c->argc == 3);
+    robj* o;
+
+    if (c->argc > 3) {
+        addReplyErrorFormat(c, "wrong number of arguments for '%s' command", (char*) c->argv[0]->ptr);
+        return;
+    }
+
+    if (hascount) {
+        if (getLongFromObjectOrReply(c, c->argv[2], &count, NULL) != REDIS_OK)
+            return;
+        if (count < 0) {
+            addReplyError(c, "value is out of range, must be positive");
+            return;
+        }
+    }
+
+    o = lookupKeyWriteOrReply(c, c->argv[1], hascount ? shared.nullmultibulk : shared.nullbulk);
 
     if (o == NULL || checkType(c, o, REDIS_LIST)) return;
 
-    robj* value = listTypePop(o, where);
+    if (!hascount) {
+        robj* value = listTypePop(o, where);
 
-    if (value == NULL) {
-        addReply(c, shared.nullbulk);
-    } else {
+        if (value == NULL) {
+            addReply(c, shared.nullbulk);
+            return;
+        }
 
         addReplyBulk(c, value);
         decrRefCount(value);
+    } else {
+        long llen = listTypeLength(o);
 
-        if (listTypeLength(o) == 0) {
-            dbDelete(c->db, c->argv[1]);
+        if (count > llen) count = llen;
+
+        if (count == 0) {
+            addReply(c, shared.emptymultibulk);
+            return;
         }
 
-        server.dirty++;
+        if (where == REDIS_HEAD) {
+            addListRangeReply(c, o, 0, count - 1, 0);
+            listTypeDelRange(o, 0, count);
+        } else {
+            addListRangeReply(c, o, llen - count, llen - 1, 1);
+            listTypeDelRange(o, -count, count);
+        }
+    }
+
+    if (listTypeLength(o) == 0) {
+        dbDelete(c->db, c->argv[1]);
     }
+
+    signalModifiedKey(c->db, c->argv[1]);
+    server.dirty += hascount ? count : 1;
 }
 
 /*
@@ -558,15 +656,15 @@ void lindexCommand(redisClient* c) {
     if (getLongFromObjectOrReply(c, c->argv[2], &index, NULL) != REDIS_OK)
         return;
 
-    if (o->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (o->encoding == REDIS_ENCODING_LISTPACK) {
         unsigned char* p;
         unsigned char* vstr;
         unsigned int vlen;
         long long vlong;
 
-        p = ziplistIndex(o->ptr, index);
+        p = lpIndex(o->ptr, index);
 
-        if (ziplistGet(p, &vstr, &vlen, &vlong)) {
+        if (lpGet(p, &vstr, &vlen, &vlong)) {
             if (vstr) {
                 value = createStringObject((char*)vstr, vlen);
             } else {
@@ -578,21 +676,175 @@ void lindexCommand(redisClient* c) {
             addReply(c, shared.nullbulk);
         }
 
-    } else if (o->encoding == REDIS_ENCODING_LINKEDLIST) {
+    } else if (o->encoding == REDIS_ENCODING_QUICKLIST) {
 
-        listNode* ln = listIndex(o->ptr, index);
+        quicklistEntry entry;
+        // 通过迭代器读取，被压缩的节点在读取之后重新压缩
+        quicklistIter* iter = quicklistGetIteratorAtIdx(o->ptr, AL_START_TAIL, index);
 
-        if (ln != NULL) {
-            value = listNodeValue(ln);
+        if (iter && quicklistNext(iter, &entry)) {
+            if (entry.value) {
+                value = createStringObject((char*)entry.value, entry.sz);
+            } else {
+                value = createStringObjectFromLongLong(entry.longval);
+            }
             addReplyBulk(c, value);
+            decrRefCount(value);
         } else {
             addReply(c, shared.nullbulk);
         }
+        if (iter) quicklistReleaseIterator(iter);
     } else {
         exit(1);
     }
 }
 
+/*
+ * LRANGE命令
+ */
+void lrangeCommand(redisClient* c) {
+
+    robj* o;
+    long start;
+    long end;
+    long llen;
+
+    if ((getLongFromObjectOrReply(c, c->argv[2], &start, NULL) != REDIS_OK) ||
+        (getLongFromObjectOrReply(c, c->argv[3], &end, NULL) != REDIS_OK))
+        return;
+
+    if ((o = lookupKeyReadOrReply(c, c->argv[1], shared.emptymultibulk)) == NULL || checkType(c, o, REDIS_LIST))
+        return;
+
+    llen = listTypeLength(o);
+
+    /* convert negative indexes */
+    if (start < 0) start = llen + start;
+    if (end < 0) end = llen + end;
+    if (start < 0) start = 0;
+
+    /* Invariant: start >= 0, so this test will be true when end < 0.
+     * The range is empty when start > end or start >= length. */
+    if (start > end || start >= llen) {
+        addReply(c, shared.emptymultibulk);
+        return;
+    }
+    if (end >= llen) end = llen - 1;
+
+    addListRangeReply(c, o, start, end, 0);
+}
+
+/*
+ * LPOS命令
+ *
+ * LPOS key element [RANK rank] [COUNT num-matches] [MAXLEN len]
+ *
+ * rank为负数时从表尾向表头查找，count为0时返回所有匹配的索引，maxlen限制最多比较的元素数量
+ */
+void lposCommand(redisClient* c) {
+
+    robj* o;
+    robj* ele;
+    long rank = 1;
+    long count = -1;
+    long maxlen = 0;
+    long index = 0;
+    long matches = 0;
+    long arraylen = 0;
+    long llen;
+    int direction = REDIS_TAIL;
+    void* arraylenptr = NULL;
+    listTypeIterator* li;
+    listTypeEntry entry;
+    int j;
+
+    for (j = 3; j < c->argc; j++) {
+        char* opt = c->argv[j]->ptr;
+        int moreargs = (c->argc - 1) - j;
+
+        if (!strcasecmp(opt, "rank") && moreargs) {
+            j++;
+            if (getLongFromObjectOrReply(c, c->argv[j], &rank, NULL) != REDIS_OK)
+                return;
+            if (rank == 0) {
+                addReplyError(c, "RANK can't be zero: use 1 to start from "
+                                 "the first match, 2 from the second ... "
+                                 "or use negative to start from the end of the list");
+                return;
+            }
+            if (rank == LONG_MIN) {
+                addReplyError(c, "value is out of range");
+                return;
+            }
+        } else if (!strcasecmp(opt, "count") && moreargs) {
+            j++;
+            if (getLongFromObjectOrReply(c, c->argv[j], &count, NULL) != REDIS_OK)
+                return;
+            if (count < 0) {
+                addReplyError(c, "COUNT can't be negative");
+                return;
+            }
+        } else if (!strcasecmp(opt, "maxlen") && moreargs) {
+            j++;
+            if (getLongFromObjectOrReply(c, c->argv[j], &maxlen, NULL) != REDIS_OK)
+                return;
+            if (maxlen < 0) {
+                addReplyError(c, "MAXLEN can't be negative");
+                return;
+            }
+        } else {
+            addReply(c, shared.syntaxerr);
+            return;
+        }
+    }
+
+    // 负数rank表示从表尾开始查找
+    if (rank < 0) {
+        rank = -rank;
+        direction = REDIS_HEAD;
+    }
+
+    if ((o = lookupKeyRead(c->db, c->argv[1])) == NULL) {
+        addReply(c, count != -1 ? shared.emptymultibulk : shared.nullbulk);
+        return;
+    }
+    if (checkType(c, o, REDIS_LIST)) return;
+
+    // 带有COUNT时回复数组，匹配数量在迭代结束后才知道
+    if (count != -1) arraylenptr = addDeferredMultiBulkLength(c);
+
+    /* Make sure ele is raw when we're dealing with a listpack */
+    ele = getDecodedObject(c->argv[2]);
+    llen = listTypeLength(o);
+
+    li = listTypeInitIterator(o, direction == REDIS_HEAD ? -1 : 0, direction);
+    while (listTypeNext(li, &entry) && (maxlen == 0 || index < maxlen)) {
+        if (listTypeEqual(&entry, ele)) {
+            matches++;
+            if (matches >= rank) {
+                if (arraylenptr) {
+                    arraylen++;
+                    addReplyLongLong(c, direction == REDIS_TAIL ? index : llen - index - 1);
+                    if (count && matches - rank + 1 >= count) break;
+                } else {
+                    break;
+                }
+            }
+        }
+        index++;
+    }
+    listTypeReleaseIterator(li);
+    decrRefCount(ele);
+
+    if (arraylenptr) {
+        setDeferredMultiBulkLength(c, arraylenptr, arraylen);
+    } else if (matches >= rank) {
+        addReplyLongLong(c, direction == REDIS_TAIL ? index : llen - index - 1);
+    } else {
+        addReply(c, shared.nullbulk);
+    }
+}
+
 /*
  * LREM命令
  */
@@ -612,9 +864,8 @@ void lremCommand(redisClient* c) {
     subject = lookupKeyWriteOrReply(c, c->argv[1], shared.czero);
     if (subject == NULL || checkType(c, subject, REDIS_LIST)) return;
 
-    /* Make sure obj is raw when we're dealing with a ziplist */
-    if (subject->encoding == REDIS_ENCODING_ZIPLIST)
-        obj = getDecodedObject(obj);
+    /* Make sure obj is raw when we're dealing with a listpack */
+    obj = getDecodedObject(obj);
 
     listTypeIterator* li;
 
@@ -636,12 +887,13 @@ void lremCommand(redisClient* c) {
     listTypeReleaseIterator(li);
 
     /* Clean up raw encoded object */
-    if (subject->encoding == REDIS_ENCODING_ZIPLIST)
-        decrRefCount(obj);
+    decrRefCount(obj);
 
     // 删除空列表对象
     if (listTypeLength(subject) == 0) dbDelete(c->db, c->argv[1]);
 
+    if (removed) signalModifiedKey(c->db, c->argv[1]);
+
     addReplyLongLong(c, removed);
 }
 
@@ -654,11 +906,8 @@ void ltrimCommand(redisClient* c) {
     long start;
     long end;
     long llen;
-    long j;
     long ltrim;
     long rtrim;
-    list* list;
-    listNode* ln;
 
     if ((getLongFromObjectOrReply(c, c->argv[2], &start, NULL) != REDIS_OK) ||
         (getLongFromObjectOrReply(c, c->argv[3], &end, NULL) != REDIS_OK))
@@ -687,29 +936,14 @@ void ltrimCommand(redisClient* c) {
 
     // 删除两端元素
     /* Remove list elements to perform the trim */
-    if (o->encoding == REDIS_ENCODING_ZIPLIST) {
-
-        o->ptr = ziplistDeleteRange(o->ptr, 0, ltrim);
-        o->ptr = ziplistDeleteRange(o->ptr, -rtrim, rtrim);
-    } else if (o->encoding == REDIS_ENCODING_LINKEDLIST) {
-        list = o->ptr;
-        for (j = 0; j < ltrim; j++) {
-            ln = listFirst(list);
-            listDelNode(list, ln);
-        }
-
-        for (j = 0; j < rtrim; j++) {
-            ln = listLast(list);
-            listDelNode(list, ln);
-        }
-    } else {
-        exit(1);
-    }
+    listTypeDelRange(o, 0, ltrim);
+    listTypeDelRange(o, -rtrim, rtrim);
 
     if (listTypeLength(o) == 0) {
         dbDelete(c->db, c->argv[1]);
     }
 
+    signalModifiedKey(c->db, c->argv[1]);
     server.dirty++;
 
     addReply(c, shared.ok);
@@ -735,41 +969,162 @@ void lsetCommand(redisClient* c) {
     // 查看保存value值对象是否需要转换列表的底层编码
     listTypeTryConversion(o, value);
 
-    if (o->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (o->encoding == REDIS_ENCODING_LISTPACK) {
 
         unsigned char* p;
         unsigned char* zl = o->ptr;
 
-        p = ziplistIndex(zl, index);
+        p = lpIndex(zl, index);
         if (p == NULL) {
             addReply(c, shared.outofrangeerr);
         } else {
-            o->ptr = ziplistDelete(o->ptr, &p);
             value = getDecodedObject(value);
-            o->ptr = ziplistInsert(o->ptr, p, value->ptr, sdslen(value->ptr));
+            o->ptr = lpReplace(o->ptr, &p, value->ptr, sdslen(value->ptr));
             decrRefCount(value);
 
             addReply(c, shared.ok);
 
+            signalModifiedKey(c->db, c->argv[1]);
             server.dirty++;
         }
 
-    } else if (o->encoding == REDIS_ENCODING_LINKEDLIST) {
+    } else if (o->encoding == REDIS_ENCODING_QUICKLIST) {
 
-        listNode* ln = listIndex(o->ptr, index);
+        value = getDecodedObject(value);
 
-        if (ln == NULL) {
+        if (!quicklistReplaceAtIndex(o->ptr, index, value->ptr, sdslen(value->ptr))) {
             addReply(c, shared.outofrangeerr);
         } else {
-            decrRefCount((robj*)listNodeValue(ln));
-            listNodeValue(ln) = value;
-            incrRefCount(value);
-
             addReply(c, shared.ok);
 
+            signalModifiedKey(c->db, c->argv[1]);
             server.dirty++;
         }
+        decrRefCount(value);
     } else {
         exit(1);
     }
 }
+
+/*
+ * LMOVE，RPOPLPUSH命令中将弹出的元素value添加到目标列表，目标列表不存在时创建
+ */
+static void lmoveHandlePush(redisClient* c, robj* dstkey, robj* dstobj, robj* value, int where) {
+
+    if (!dstobj) {
+        dstobj = createListpackObject();
+        dbAdd(c->db, dstkey, dstobj);
+    }
+
+    signalModifiedKey(c->db, dstkey);
+    listTypePush(dstobj, value, where);
+
+    addReplyBulk(c, value);
+}
+
+/*
+ * 解析LEFT或RIGHT参数
+ */
+static int getListPositionFromObjectOrReply(redisClient* c, robj* arg, int* position) {
+
+    if (!strcasecmp(arg->ptr, "right")) {
+        *position = REDIS_TAIL;
+    } else if (!strcasecmp(arg->ptr, "left")) {
+        *position = REDIS_HEAD;
+    } else {
+        addReply(c, shared.syntaxerr);
+        return REDIS_ERR;
+    }
+    return REDIS_OK;
+}
+
+/*
+ * LMOVE，RPOPLPUSH命令的底层实现
+ *
+ * 从源列表的wherefrom端弹出一个元素，添加到目标列表的whereto端，源列表和目标列表可以是同一个列表
+ */
+void lmoveGenericCommand(redisClient* c, int wherefrom, int whereto) {
+
+    robj* sobj;
+    robj* dobj;
+    robj* value;
+
+    if ((sobj = lookupKeyWriteOrReply(c, c->argv[1], shared.nullbulk)) == NULL || checkType(c, sobj, REDIS_LIST))
+        return;
+
+    // 先检查目标键的类型，类型错误时不弹出元素
+    dobj = lookupKeyWrite(c->db, c->argv[2]);
+    if (dobj && checkType(c, dobj, REDIS_LIST)) return;
+
+    value = listTypePop(sobj, wherefrom);
+    assert(value != NULL);
+
+    lmoveHandlePush(c, c->argv[2], dobj, value, whereto);
+    decrRefCount(value);
+
+    // 源列表和目标列表相同时，元素已经被重新添加，列表不会为空
+    if (listTypeLength(sobj) == 0) {
+        dbDelete(c->db, c->argv[1]);
+    }
+
+    signalModifiedKey(c->db, c->argv[1]);
+    server.dirty++;
+}
+
+/*
+ * LMOVE命令
+ *
+ * LMOVE source destination LEFT|RIGHT LEFT|RIGHT
+ */
+void lmoveCommand(redisClient* c) {
+    int wherefrom;
+    int whereto;
+
+    if (getListPositionFromObjectOrReply(c, c->argv[3], &wherefrom) != REDIS_OK) return;
+    if (getListPositionFromObjectOrReply(c, c->argv[4], &whereto) != REDIS_OK) return;
+    lmoveGenericCommand(c, wherefrom, whereto);
+}
+
+/*
+ * RPOPLPUSH命令
+ */
+void rpoplpushCommand(redisClient* c) {
+    lmoveGenericCommand(c, REDIS_TAIL, REDIS_HEAD);
+}
+
+/*
+ * QUICKLIST STATS
+ *
+ * 返回快速列表节点压缩的统计信息，compression_ratio为被压缩节点压缩前后的字节数之比
+ */
+void quicklistCommand(redisClient* c) {
+    quicklistStats qs;
+    char buf[64];
+
+    if (strcasecmp(c->argv[1]->ptr, "stats")) {
+        addReplyError(c, "Syntax error, try QUICKLIST STATS");
+        return;
+    }
+
+    quicklistGetStats(&qs);
+
+    addReplyMultiBulkLen(c, 16);
+    addReplyBulkCString(c, "compress_depth");
+    addReplyLongLong(c, server.list_compress_depth);
+    addReplyBulkCString(c, "compressed_nodes");
+    addReplyLongLong(c, qs.compressed_nodes);
+    addReplyBulkCString(c, "compressed_raw_bytes");
+    addReplyLongLong(c, qs.compressed_raw_bytes);
+    addReplyBulkCString(c, "compressed_bytes");
+    addReplyLongLong(c, qs.compressed_bytes);
+    addReplyBulkCString(c, "compression_ratio");
+    snprintf(buf, sizeof(buf), "%.2f",
+             qs.compressed_bytes ? (double) qs.compressed_raw_bytes / qs.compressed_bytes : 0.0);
+    addReplyBulkCString(c, buf);
+    addReplyBulkCString(c, "compressions");
+    addReplyLongLong(c, qs.compressions);
+    addReplyBulkCString(c, "decompressions");
+    addReplyLongLong(c, qs.decompressions);
+    addReplyBulkCString(c, "compress_failures");
+    addReplyLongLong(c, qs.compress_failures);
+}
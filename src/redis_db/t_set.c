@@ -21,16 +21,30 @@ robj* setTypeCreate(robj* value) {
     return createSetObject();
 }
 
+/*
+ * roaring位图的容器很多并且平均每个容器只有很少的元素时过于稀疏，
+ * 每次增删容器都要移动整个容器数组，这时改用REDIS_ENCODING_HT编码
+ */
+static int setRoaringTooSparse(roaring* r) {
+    uint32_t containers = roaringContainerCount(r);
+
+    return containers > SET_ROARING_SPARSE_CONTAINERS &&
+           roaringCardinality(r) < (uint64_t) containers * SET_ROARING_MIN_CONTAINER_CARD;
+}
+
 /*
  * 向指定集合中添加一个元素
  */
 int setTypeAdd(robj* subject, robj* value) {
     long long llval;
 
-    // 如果集合类型对象底层编码为REDIS_ENCODING_HT，则调用字典API: dictAdd
+    // 如果集合类型对象底层编码为REDIS_ENCODING_HT，则调用字典API: dictAdd，
+    // 字典保存value的副本，集合独占自己的元素，释放时可以交给bio线程(见lazyfree.c)
     if (subject->encoding == REDIS_ENCODING_HT) {
-        if (dictAdd(subject->ptr, value, NULL) == DICT_OK) {
-            incrRefCount(value);
+        dictEntry* de = dictAddRaw(subject->ptr, value);
+
+        if (de) {
+            dictSetKey((dict*) subject->ptr, de, dupStringObject(value));
             return 1;
         }
     // 如果集合类型对象底层编码为REDIS_ENCODING_INTSET，且value的值能表示成long long(intset能保存)，
@@ -42,15 +56,30 @@ int setTypeAdd(robj* subject, robj* value) {
             uint8_t success = 0;
             subject->ptr = intsetAdd(subject->ptr, llval, &success);
             if (success) {
+                // 元素全部是整数，超出整数集合的长度限制后转为roaring位图
                 if (intsetLen(subject->ptr) > SET_MAX_INTSET_ENTRIES)
-                    setTypeConvert(subject, REDIS_ENCODING_HT);
+                    setTypeConvert(subject, REDIS_ENCODING_ROARING);
                 return 1;
             }
         } else {
             setTypeConvert(subject, REDIS_ENCODING_HT);
 
-            assert(dictAdd(subject->ptr, value, NULL) == DICT_OK);
-            incrRefCount(value);
+            assert(dictAdd(subject->ptr, dupStringObject(value), NULL) == DICT_OK);
+            return 1;
+        }
+    // 如果集合类型对象底层编码为REDIS_ENCODING_ROARING，整数调用roaringAdd，否则先转为REDIS_ENCODING_HT编码；
+    // 添加后容器过于稀疏时也转为REDIS_ENCODING_HT编码
+    } else if (subject->encoding == REDIS_ENCODING_ROARING) {
+
+        if (isObjectRepresentableAsLongLong(value, &llval) == REDIS_OK) {
+            if (!roaringAdd(subject->ptr, llval)) return 0;
+            if (setRoaringTooSparse(subject->ptr))
+                setTypeConvert(subject, REDIS_ENCODING_HT);
+            return 1;
+        } else {
+            setTypeConvert(subject, REDIS_ENCODING_HT);
+
+            assert(dictAdd(subject->ptr, dupStringObject(value), NULL) == DICT_OK);
             return 1;
         }
     } else {
@@ -77,6 +106,10 @@ int setTypeRemove(robj* setobj, robj* value) {
             setobj->ptr = intsetRemove(setobj->ptr, llval, &success);
             if (success) return 1;
         }
+    } else if (setobj->encoding == REDIS_ENCODING_ROARING) {
+        if (isObjectRepresentableAsLongLong(value, &llval) == REDIS_OK) {
+            return roaringRemove(setobj->ptr, llval);
+        }
     } else {
         exit(1);
     }
@@ -96,6 +129,10 @@ int setTypeIsMember(robj* subject, robj* value) {
         if (isObjectRepresentableAsLongLong(value, &llval) == REDIS_OK) {
             return intsetFind((intset*)subject->ptr, llval);
         }
+    } else if (subject->encoding == REDIS_ENCODING_ROARING) {
+        if (isObjectRepresentableAsLongLong(value, &llval) == REDIS_OK) {
+            return roaringContains(subject->ptr, llval);
+        }
     } else {
         exit(1);
     }
@@ -118,6 +155,8 @@ setTypeIterator* setTypeInitIterator(robj* subject) {
         si->di = dictGetIterator(subject->ptr);
     } else if (si->encoding == REDIS_ENCODING_INTSET) {
         si->ii = 0;
+    } else if (si->encoding == REDIS_ENCODING_ROARING) {
+        roaringInitIterator(subject->ptr, &si->ri);
     } else {
         exit(1);
     }
@@ -152,6 +191,9 @@ int setTypeNext(setTypeIterator* si, robj** objele, int64_t* llele) {
     } else if (si->encoding == REDIS_ENCODING_INTSET) {
         if (!intsetGet(si->subject->ptr, si->ii++, llele))
             return -1;
+    } else if (si->encoding == REDIS_ENCODING_ROARING) {
+        if (!roaringIteratorNext(&si->ri, llele))
+            return -1;
     }
 
     return si->encoding;
@@ -172,6 +214,7 @@ robj* setTypeNextObject(setTypeIterator* si) {
         case -1:
             return NULL;
         case REDIS_ENCODING_INTSET:
+        case REDIS_ENCODING_ROARING:
             return createStringObjectFromLongLong(intele);
         case REDIS_ENCODING_HT:
             incrRefCount(objele);
@@ -191,6 +234,8 @@ int setTypeRandomElement(robj* setobj, robj** objele, int64_t* llele) {
         *objele = dictGetKey(de);
     } else if (setobj->encoding == REDIS_ENCODING_INTSET) {
         *llele = intsetRandom(setobj->ptr);
+    } else if (setobj->encoding == REDIS_ENCODING_ROARING) {
+        *llele = roaringRandom(setobj->ptr);
     } else {
         exit(1);
     }
@@ -207,26 +252,31 @@ unsigned long setTypeSize(robj* subject) {
         return dictSize((dict*)subject->ptr);
     } else if (subject->encoding == REDIS_ENCODING_INTSET) {
         return intsetLen((intset*)subject->ptr);
+    } else if (subject->encoding == REDIS_ENCODING_ROARING) {
+        return roaringCardinality(subject->ptr);
     } else {
         exit(1);
     }
 }
 
 /*
- * 将集合类型对象底层编码从REDIS_ENCODING_INTSET转REDIS_ENCODING_HT
+ * 转换集合类型对象的底层编码:
+ * REDIS_ENCODING_INTSET可以转为REDIS_ENCODING_ROARING或REDIS_ENCODING_HT，
+ * REDIS_ENCODING_ROARING可以转为REDIS_ENCODING_HT
  */
 void setTypeConvert(robj* setobj, int enc) {
 
     setTypeIterator* si;
 
-    assert(setobj->type == REDIS_SET && setobj->encoding == REDIS_ENCODING_INTSET);
+    assert(setobj->type == REDIS_SET &&
+           (setobj->encoding == REDIS_ENCODING_INTSET || setobj->encoding == REDIS_ENCODING_ROARING));
 
     if (enc == REDIS_ENCODING_HT) {
         int64_t intele;
         dict* d = dictCreate(&setDictType, NULL);
         robj* element;
 
-        dictExpand(d, intsetLen(setobj->ptr));
+        dictExpand(d, setTypeSize(setobj));
 
         si = setTypeInitIterator(setobj);
         while (setTypeNext(si, NULL, &intele) != -1) {
@@ -235,18 +285,184 @@ void setTypeConvert(robj* setobj, int enc) {
         }
         setTypeReleaseIterator(si);
 
+        if (setobj->encoding == REDIS_ENCODING_ROARING)
+            roaringFree(setobj->ptr);
+        else
+            zfree(setobj->ptr);
         setobj->encoding = REDIS_ENCODING_HT;
-        zfree(setobj->ptr);
         setobj->ptr = d;
+    } else if (enc == REDIS_ENCODING_ROARING && setobj->encoding == REDIS_ENCODING_INTSET) {
+        int64_t intele;
+        roaring* r = roaringNew();
+        uint32_t pos = 0;
+
+        while (intsetGet(setobj->ptr, pos++, &intele))
+            roaringAdd(r, intele);
+
+        zfree(setobj->ptr);
+        setobj->encoding = REDIS_ENCODING_ROARING;
+        setobj->ptr = r;
     } else {
         exit(1);
     }
 }
 
+/*
+ * 用roaring位图r创建集合类型对象，元素数量较少时使用REDIS_ENCODING_INTSET编码并释放r
+ */
+static robj* setTypeCreateFromRoaring(roaring* r) {
+    robj* o;
+
+    if (roaringCardinality(r) > SET_MAX_INTSET_ENTRIES) {
+        o = createObject(REDIS_SET, r);
+        o->encoding = REDIS_ENCODING_ROARING;
+        if (setRoaringTooSparse(r)) setTypeConvert(o, REDIS_ENCODING_HT);
+    } else {
+        roaringIterator ri;
+        int64_t intele;
+        uint8_t success;
+
+        o = createIntsetObject();
+        roaringInitIterator(r, &ri);
+        while (roaringIteratorNext(&ri, &intele))
+            o->ptr = intsetAdd(o->ptr, intele, &success);
+        roaringFree(r);
+    }
+    return o;
+}
+
+/*
+ * 用整数集合is创建集合类型对象，元素数量超过SET_MAX_INTSET_ENTRIES时转为REDIS_ENCODING_ROARING编码
+ */
+static robj* setTypeCreateFromIntset(intset* is) {
+    robj* o = createObject(REDIS_SET, is);
+
+    o->encoding = REDIS_ENCODING_INTSET;
+    if (intsetLen(is) > SET_MAX_INTSET_ENTRIES)
+        setTypeConvert(o, REDIS_ENCODING_ROARING);
+    return o;
+}
+
+/*
+ * 检查集合数组中的非空集合是否全部使用encoding编码
+ */
+static int setTypeAllEncoded(robj** sets, unsigned long setnum, int encoding) {
+    unsigned long j;
+
+    for (j = 0; j < setnum; j++) {
+        if (sets[j] && sets[j]->encoding != encoding) return 0;
+    }
+    return 1;
+}
+
+/*
+ * 对全部使用REDIS_ENCODING_ROARING编码的集合按容器直接计算交集、并集或差集，
+ * sets中的NULL表示不存在的集合，返回新创建的roaring位图
+ */
+static roaring* setTypeRoaringCombine(robj** sets, unsigned long setnum, int op) {
+    roaring* acc = (op == REDIS_OP_DIFF && sets[0] == NULL) ? roaringNew() : NULL;
+    unsigned long j;
+
+    for (j = 0; j < setnum; j++) {
+        roaring* next;
+
+        if (!sets[j]) continue;
+
+        if (acc == NULL) {
+            acc = roaringCopy(sets[j]->ptr);
+            continue;
+        }
+
+        if (op == REDIS_OP_INTER)
+            next = roaringAnd(acc, sets[j]->ptr);
+        else if (op == REDIS_OP_UNION)
+            next = roaringOr(acc, sets[j]->ptr);
+        else
+            next = roaringAndNot(acc, sets[j]->ptr);
+
+        roaringFree(acc);
+        acc = next;
+
+        // 交集和差集为空之后不会再有变化
+        if (op != REDIS_OP_UNION && roaringCardinality(acc) == 0) break;
+    }
+
+    return acc ? acc : roaringNew();
+}
+
+/*
+ * 对全部使用REDIS_ENCODING_INTSET编码的集合直接对有序数组计算交集、并集或差集，
+ * sets中的NULL表示不存在的集合，返回新创建的整数集合
+ */
+static intset* setTypeIntsetCombine(robj** sets, unsigned long setnum, int op) {
+    intset* acc = (op == REDIS_OP_DIFF && sets[0] == NULL) ? intsetNew() : NULL;
+    unsigned long j;
+
+    for (j = 0; j < setnum; j++) {
+        intset* next;
+
+        if (!sets[j]) continue;
+
+        if (acc == NULL) {
+            acc = intsetDup(sets[j]->ptr);
+            continue;
+        }
+
+        if (op == REDIS_OP_INTER)
+            next = intsetIntersect(acc, sets[j]->ptr);
+        else if (op == REDIS_OP_UNION)
+            next = intsetUnion(acc, sets[j]->ptr);
+        else
+            next = intsetDifference(acc, sets[j]->ptr);
+
+        zfree(acc);
+        acc = next;
+
+        // 交集和差集为空之后不会再有变化
+        if (op != REDIS_OP_UNION && intsetLen(acc) == 0) break;
+    }
+
+    return acc ? acc : intsetNew();
+}
+
+/*
+ * 将整数集合运算的结果dstset回复给客户端，或者保存到dstkey中，dstset的所有权交给这个函数
+ */
+static void setTypeReplyResult(redisClient* c, robj* dstset, robj* dstkey) {
+
+    if (!dstkey) {
+        setTypeIterator* si = setTypeInitIterator(dstset);
+        robj* eleobj;
+        int64_t intele;
+
+        // 过于稀疏的结果已经转为REDIS_ENCODING_HT编码
+        addReplyMultiBulkLen(c, setTypeSize(dstset));
+        while (setTypeNext(si, &eleobj, &intele) != -1) {
+            if (dstset->encoding == REDIS_ENCODING_HT)
+                addReplyBulk(c, eleobj);
+            else
+                addReplyBulkLongLong(c, intele);
+        }
+        setTypeReleaseIterator(si);
+        decrRefCount(dstset);
+    } else {
+        /* int deleted = */ dbDelete(c->db, dstkey);
+
+        if (setTypeSize(dstset) > 0) {
+            dbAdd(c->db, dstkey, dstset);
+            addReplyLongLong(c, setTypeSize(dstset));
+        } else {
+            decrRefCount(dstset);
+            addReply(c, shared.czero);
+        }
+
+        signalModifiedKey(c->db, dstkey);
+        server.dirty++;
+    }
+}
 
 /*
  * 注意: 
- * signalModifiedKey函数与独立功能事务相关，在本代码中删除；
  * notifyKeyspaceEvent函数与独立功能发布/订阅相关，在本代码中删除；
  */
 
@@ -279,6 +495,7 @@ void saddCommand(redisClient* c) {
         if (setTypeAdd(set, c->argv[j])) added++;
     }
 
+    if (added) signalModifiedKey(c->db, c->argv[1]);
     server.dirty += added;
 
     addReplyLongLong(c, added);
@@ -308,6 +525,7 @@ void sremCommand(redisClient* c) {
 
     if (deleted) {
 
+        signalModifiedKey(c->db, c->argv[1]);
         server.dirty += deleted;
     }
 
@@ -343,6 +561,27 @@ void sismemberCommand(redisClient* c) {
         addReply(c, shared.czero);
 }
 
+/*
+ * SMISMEMBER命令
+ */
+void smismemberCommand(redisClient* c) {
+    robj* set;
+    int j;
+
+    set = lookupKeyRead(c->db, c->argv[1]);
+    if (set != NULL && checkType(c, set, REDIS_SET))
+        return;
+
+    addReplyMultiBulkLen(c, c->argc - 2);
+    for (j = 2; j < c->argc; j++) {
+        c->argv[j] = tryObjectEncoding(c->argv[j]);
+        if (set != NULL && setTypeIsMember(set, c->argv[j]))
+            addReply(c, shared.cone);
+        else
+            addReply(c, shared.czero);
+    }
+}
+
 /*
  * 计算集合s1的基数减去集合s2的基数
  */
@@ -360,9 +599,12 @@ int qsortCompareSetByRevCardinality(const void* s1, const void* s2) {
 }
 
 /*
- * SINTER，SINTERSTORE命令底层实现
+ * SINTER，SINTERSTORE，SINTERCARD命令底层实现
+ *
+ * cardinality_only为真时只回复交集的元素数量，limit不为0时数量达到limit就停止计算
  */
-void sinterGenericCommand(redisClient* c, robj** setkeys, unsigned long setnum, robj* dstkey) {
+void sinterGenericCommand(redisClient* c, robj** setkeys, unsigned long setnum, robj* dstkey,
+                          int cardinality_only, unsigned long limit) {
 
     robj** sets = zmalloc(sizeof(robj*) * setnum);
 
@@ -383,9 +625,12 @@ void sinterGenericCommand(redisClient* c, robj** setkeys, unsigned long setnum,
             zfree(sets);
             if (dstkey) {
                 if (dbDelete(c->db, dstkey)) {
+                    signalModifiedKey(c->db, dstkey);
                     server.dirty++;
                 }
                 addReply(c, shared.czero);
+            } else if (cardinality_only) {
+                addReply(c, shared.czero);
             } else {
                 addReply(c, shared.emptymultibulk);
             }
@@ -405,12 +650,46 @@ void sinterGenericCommand(redisClient* c, robj** setkeys, unsigned long setnum,
      * algorithm's performance */
     qsort(sets, setnum, sizeof(robj*), qsortCompareSetsByCardinality);
 
+    // 交集不会比最小的集合大，limit不小于最小集合的基数时等同于没有限制
+    if (limit >= setTypeSize(sets[0])) limit = 0;
+
+    // 所有集合都是roaring位图时，只对key相同的容器求交集，不需要逐个元素查找，
+    // 带有limit的SINTERCARD逐个元素查找，数量达到limit时可以提前停止
+    if (limit == 0 && setTypeAllEncoded(sets, setnum, REDIS_ENCODING_ROARING)) {
+        roaring* r = setTypeRoaringCombine(sets, setnum, REDIS_OP_INTER);
+
+        if (cardinality_only) {
+            addReplyLongLong(c, roaringCardinality(r));
+            roaringFree(r);
+        } else {
+            setTypeReplyResult(c, setTypeCreateFromRoaring(r), dstkey);
+        }
+        zfree(sets);
+        return;
+    }
+
+    // 所有集合都是整数集合时，对有序数组归并或者跳跃查找求交集
+    if (limit == 0 && setTypeAllEncoded(sets, setnum, REDIS_ENCODING_INTSET)) {
+        intset* is = setTypeIntsetCombine(sets, setnum, REDIS_OP_INTER);
+
+        if (cardinality_only) {
+            addReplyLongLong(c, intsetLen(is));
+            zfree(is);
+        } else {
+            setTypeReplyResult(c, setTypeCreateFromIntset(is), dstkey);
+        }
+        zfree(sets);
+        return;
+    }
+
     /* The first thing we should output is the total number of elements...
      * since this is a multi-bulk write, but at this stage we don't know
      * the intersection set size, so we use a trick, append an empty object
      * to the output list and save the pointer to later modify it with the
      * right length */
-    if (!dstkey) {
+    if (cardinality_only) {
+        // SINTERCARD只计数，不需要回复元素
+    } else if (!dstkey) {
         replylen = addDeferredMultiBulkLength(c);
     } else {
         /* If we have a target key where to store the resulting set
@@ -428,9 +707,11 @@ void sinterGenericCommand(redisClient* c, robj** setkeys, unsigned long setnum,
 
             if (sets[j] == sets[0]) continue;
 
-            if (encoding == REDIS_ENCODING_INTSET) {
+            if (encoding == REDIS_ENCODING_INTSET || encoding == REDIS_ENCODING_ROARING) {
                 if (sets[j]->encoding == REDIS_ENCODING_INTSET && !intsetFind((intset*)sets[j]->ptr, intobj)) {
                     break;
+                } else if (sets[j]->encoding == REDIS_ENCODING_ROARING && !roaringContains(sets[j]->ptr, intobj)) {
+                    break;
                 /* in order to compare an integer with an object we
                  * have to use the generic function, creating an object
                  * for this */
@@ -451,6 +732,10 @@ void sinterGenericCommand(redisClient* c, robj** setkeys, unsigned long setnum,
                     sets[j]->encoding == REDIS_ENCODING_INTSET &&
                     !intsetFind((intset*)sets[j]->ptr, (long)eleobj->ptr)) {
                     break;
+                } else if (eleobj->encoding == REDIS_ENCODING_INT &&
+                           sets[j]->encoding == REDIS_ENCODING_ROARING &&
+                           !roaringContains(sets[j]->ptr, (long)eleobj->ptr)) {
+                    break;
                 /* else... object to object check is easy as we use the
                  * type agnostic API here. */
                 } else if (!setTypeIsMember(sets[j], eleobj)) {
@@ -462,17 +747,22 @@ void sinterGenericCommand(redisClient* c, robj** setkeys, unsigned long setnum,
         /* Only take action when all sets contain the member */
         if (j == setnum) {
 
+            // SINTERCARD
+            if (cardinality_only) {
+                cardinality++;
+                if (limit && cardinality >= limit) break;
+
             // SINTER
-            if (!dstkey) {
+            } else if (!dstkey) {
                 if (encoding == REDIS_ENCODING_HT)
-                    addReplyBulk(c, eleobj);
+                    addReplyBulkCopy(c, eleobj);
                 else
                     addReplyBulkLongLong(c, intobj);
                 cardinality++;
 
             // SINTERSTORE
             } else {
-                if (encoding == REDIS_ENCODING_INTSET) {
+                if (encoding == REDIS_ENCODING_INTSET || encoding == REDIS_ENCODING_ROARING) {
                     eleobj = createStringObjectFromLongLong(intobj);
                     setTypeAdd(dstset, eleobj);
                     decrRefCount(eleobj);
@@ -484,8 +774,12 @@ void sinterGenericCommand(redisClient* c, robj** setkeys, unsigned long setnum,
     }
     setTypeReleaseIterator(si);
 
+    // SINTERCARD
+    if (cardinality_only) {
+        addReplyLongLong(c, cardinality);
+
     // SINTERSTORE
-    if (dstkey) {
+    } else if (dstkey) {
         /* Store the resulting set into the target, if the intersection
          * is not an empty set. */
         // 若dstkey已经存在，则从键空间中将其删除
@@ -499,6 +793,7 @@ void sinterGenericCommand(redisClient* c, robj** setkeys, unsigned long setnum,
             addReply(c, shared.czero);
         }
 
+        signalModifiedKey(c->db, dstkey);
         server.dirty++;
 
     // SINTER
@@ -513,15 +808,55 @@ void sinterGenericCommand(redisClient* c, robj** setkeys, unsigned long setnum,
  * SINTER命令
  */
 void sinterCommand(redisClient* c) {
-    sinterGenericCommand(c, c->argv + 1, c->argc - 1, NULL);
+    sinterGenericCommand(c, c->argv + 1, c->argc - 1, NULL, 0, 0);
 }
 
 /*
- * 集合操作的类型
+ * SINTERSTORE命令
  */
-#define REDIS_OP_UNION 0
-#define REDIS_OP_DIFF 1
-#define REDIS_OP_INTER 2
+void sinterstoreCommand(redisClient* c) {
+    sinterGenericCommand(c, c->argv + 2, c->argc - 2, c->argv[1], 0, 0);
+}
+
+/*
+ * SINTERCARD命令
+ *
+ * SINTERCARD numkeys key [key ...] [LIMIT limit]
+ */
+void sintercardCommand(redisClient* c) {
+    long numkeys;
+    long limit = 0;
+    long j;
+
+    if (getLongFromObjectOrReply(c, c->argv[1], &numkeys, NULL) != REDIS_OK)
+        return;
+
+    if (numkeys < 1) {
+        addReplyError(c, "numkeys should be greater than 0");
+        return;
+    }
+
+    if (numkeys > c->argc - 2) {
+        addReplyError(c, "Number of keys can't be greater than number of args");
+        return;
+    }
+
+    for (j = 2 + numkeys; j < c->argc; j++) {
+        if (!strcasecmp(c->argv[j]->ptr, "limit") && j + 1 < c->argc) {
+            if (getLongFromObjectOrReply(c, c->argv[++j], &limit, NULL) != REDIS_OK)
+                return;
+            if (limit < 0) {
+                addReplyError(c, "LIMIT can't be negative");
+                return;
+            }
+        } else {
+            addReply(c, shared.syntaxerr);
+            return;
+        }
+    }
+
+    sinterGenericCommand(c, c->argv + 2, numkeys, NULL, 1, limit);
+}
 
 /*
  * SDIFF，SDIFFSTORE，SUNION，SUNIONSTORE命令底层实现
@@ -589,6 +924,20 @@ void sunionDiffGenericCommand(redisClient* c, robj** setkeys, int setnum, robj*
         }
     }
 
+    // 所有集合都是roaring位图时，按容器直接计算并集或差集
+    if (setTypeAllEncoded(sets, setnum, REDIS_ENCODING_ROARING)) {
+        setTypeReplyResult(c, setTypeCreateFromRoaring(setTypeRoaringCombine(sets, setnum, op)), dstkey);
+        zfree(sets);
+        return;
+    }
+
+    // 所有集合都是整数集合时，直接对有序数组计算并集或差集
+    if (setTypeAllEncoded(sets, setnum, REDIS_ENCODING_INTSET)) {
+        setTypeReplyResult(c, setTypeCreateFromIntset(setTypeIntsetCombine(sets, setnum, op)), dstkey);
+        zfree(sets);
+        return;
+    }
+
     /* We need a temp set object to store our union. If the dstkey
      * is not NULL (that is, we are inside an SUNIONSTORE operation) then
      * this set object will be the resulting object to set into the target key
@@ -698,6 +1047,7 @@ void sunionDiffGenericCommand(redisClient* c, robj** setkeys, int setnum, robj*
             addReply(c, shared.czero);
         }
 
+        signalModifiedKey(c->db, dstkey);
         server.dirty++;
     }
 
@@ -718,6 +1068,20 @@ void sdiffCommand(redisClient* c) {
     sunionDiffGenericCommand(c, c->argv + 1, c->argc - 1, NULL, REDIS_OP_DIFF);
 }
 
+/*
+ * SUNIONSTORE命令
+ */
+void sunionstoreCommand(redisClient* c) {
+    sunionDiffGenericCommand(c, c->argv + 2, c->argc - 2, c->argv[1], REDIS_OP_UNION);
+}
+
+/*
+ * SDIFFSTORE命令
+ */
+void sdiffstoreCommand(redisClient* c) {
+    sunionDiffGenericCommand(c, c->argv + 2, c->argc - 2, c->argv[1], REDIS_OP_DIFF);
+}
+
 
 /*
  * SRANDMEMBER命令带count参数时的底层实现
@@ -769,10 +1133,10 @@ void srandmemberWithCountCommand(redisClient* c) {
 
         while (count--) {
             encoding = setTypeRandomElement(set, &ele, &llele);
-            if (encoding == REDIS_ENCODING_INTSET) {
+            if (encoding == REDIS_ENCODING_INTSET || encoding == REDIS_ENCODING_ROARING) {
                 addReplyBulkLongLong(c, llele);
             } else {
-                addReplyBulk(c, ele);
+                addReplyBulkCopy(c, ele);
             }
         }
 
@@ -814,7 +1178,7 @@ void srandmemberWithCountCommand(redisClient* c) {
         while ((encoding = setTypeNext(si, &ele, &llele)) != -1) {
             int retval = DICT_ERR;
 
-            if (encoding == REDIS_ENCODING_INTSET) {
+            if (encoding == REDIS_ENCODING_INTSET || encoding == REDIS_ENCODING_ROARING) {
                 retval = dictAdd(d, createStringObjectFromLongLong(llele), NULL);
             } else {
                 retval = dictAdd(d, dupStringObject(ele), NULL);
@@ -848,7 +1212,7 @@ void srandmemberWithCountCommand(redisClient* c) {
 
             encoding = setTypeRandomElement(set, &ele, &llele);
 
-            if (encoding == REDIS_ENCODING_INTSET) {
+            if (encoding == REDIS_ENCODING_INTSET || encoding == REDIS_ENCODING_ROARING) {
                 ele = createStringObjectFromLongLong(llele);
             } else {
                 ele = dupStringObject(ele);
@@ -897,10 +1261,10 @@ void srandmemberCommand(redisClient* c) {
         return;
 
     encoding = setTypeRandomElement(set, &ele, &llele);
-    if (encoding == REDIS_ENCODING_INTSET) {
+    if (encoding == REDIS_ENCODING_INTSET || encoding == REDIS_ENCODING_ROARING) {
         addReplyBulkLongLong(c, llele);
     } else {
-        addReplyBulk(c, ele);
+        addReplyBulkCopy(c, ele);
     }
 }
 
@@ -922,6 +1286,9 @@ void spopCommand(redisClient* c) {
     if (encoding == REDIS_ENCODING_INTSET) {
         ele = createStringObjectFromLongLong(llele);
         set->ptr = intsetRemove(set->ptr, llele, NULL);
+    } else if (encoding == REDIS_ENCODING_ROARING) {
+        ele = createStringObjectFromLongLong(llele);
+        roaringRemove(set->ptr, llele);
     } else {
         incrRefCount(ele);
         setTypeRemove(set, ele);
@@ -945,5 +1312,6 @@ void spopCommand(redisClient* c) {
         dbDelete(c->db, c->argv[1]);
     }
 
+    signalModifiedKey(c->db, c->argv[1]);
     server.dirty++;
 }
@@ -7,7 +7,6 @@
 
 /*
  * 注意: 
- * signalModifiedKey函数与独立功能事务相关，在本代码中删除；
  * notifyKeyspaceEvent函数与独立功能发布/订阅相关，在本代码中删除；
  */
 
@@ -40,6 +39,7 @@ static int checkStringLength(redisClient* c, long long size) {
 #define REDIS_SET_NO_FLAGS 0
 #define REDIS_SET_NX (1<<0)    /* Set if key not exists. */
 #define REDIS_SET_XX (1<<1)    /* Set if key exists. */
+#define REDIS_SET_KEEPTTL (1<<2)    /* Keep the TTL of the old key. */
 
 void setGenericCommand(redisClient* c, int flags, robj* key, robj* val, robj* expire, int unit, robj* ok_reply, robj* abort_reply) {
 
@@ -65,7 +65,7 @@ void setGenericCommand(redisClient* c, int flags, robj* key, robj* val, robj* ex
         return;
     }
 
-    setKey(c->db, key, val);
+    setKey(c->db, key, val, flags & REDIS_SET_KEEPTTL);
 
     server.dirty++;
 
@@ -78,7 +78,7 @@ void setGenericCommand(redisClient* c, int flags, robj* key, robj* val, robj* ex
  *
  * 为给定键设置字符串值，可指定过期时间
  */
-/* SET key value [NX] [XX] [EX <seconds>] [PX <milliseconds>] */
+/* SET key value [NX] [XX] [KEEPTTL] [EX <seconds>] [PX <milliseconds>] */
 void setCommand(redisClient* c) {
 
     int j;
@@ -103,12 +103,20 @@ void setCommand(redisClient* c) {
             unit = UNIT_MILLISECONDS;
             expire = next;
             j++;
+        } else if (!strcasecmp(a, "keepttl")) {
+            flags |= REDIS_SET_KEEPTTL;
         } else {
             addReply(c, shared.syntaxerr);
             return;
         }
     }
 
+    // KEEPTTL与EX/PX不能同时使用
+    if ((flags & REDIS_SET_KEEPTTL) && expire) {
+        addReply(c, shared.syntaxerr);
+        return;
+    }
+
     c->argv[2] = tryObjectEncoding(c->argv[2]);
 
     setGenericCommand(c, flags, c->argv[1], c->argv[2], expire, unit, NULL, NULL);
@@ -166,6 +174,116 @@ void getCommand(redisClient* c) {
     getGenericCommand(c);
 }
 
+/*
+ * GETEX命令
+ *
+ * GETEX key [EX seconds | PX milliseconds | EXAT timestamp | PXAT timestamp | PERSIST]
+ *
+ * 获取指定键的字符串类型值，同时设置或移除它的过期时间，
+ * 以PEXPIREAT/PERSIST/DEL的形式传播
+ */
+void getexCommand(redisClient* c) {
+
+    robj* o;
+    robj* expire = NULL;
+    int unit = UNIT_SECONDS;
+    long long basetime = 0;
+    long long when;
+    int persist = 0;
+    int j;
+
+    for (j = 2; j < c->argc; j++) {
+
+        char* a = c->argv[j]->ptr;
+        robj* next = (j == c->argc - 1) ? NULL : c->argv[j + 1];
+
+        if (expire || persist) {
+            addReply(c, shared.syntaxerr);
+            return;
+        }
+
+        if (!strcasecmp(a, "ex") && next) {
+            unit = UNIT_SECONDS;
+            basetime = mstime();
+            expire = next;
+            j++;
+        } else if (!strcasecmp(a, "px") && next) {
+            unit = UNIT_MILLISECONDS;
+            basetime = mstime();
+            expire = next;
+            j++;
+        } else if (!strcasecmp(a, "exat") && next) {
+            unit = UNIT_SECONDS;
+            expire = next;
+            j++;
+        } else if (!strcasecmp(a, "pxat") && next) {
+            unit = UNIT_MILLISECONDS;
+            expire = next;
+            j++;
+        } else if (!strcasecmp(a, "persist")) {
+            persist = 1;
+        } else {
+            addReply(c, shared.syntaxerr);
+            return;
+        }
+    }
+
+    if (expire) {
+        if (getLongLongFromObjectOrReply(c, expire, &when, NULL) != REDIS_OK)
+            return;
+
+        if (when <= 0) {
+            addReplyError(c, "invalid expire time in GETEX");
+            return;
+        }
+
+        if (unit == UNIT_SECONDS) when *= 1000;
+        when += basetime;
+    }
+
+    if ((o = lookupKeyReadOrReply(c, c->argv[1], shared.nullbulk)) == NULL)
+        return;
+
+    if (o->type != REDIS_STRING) {
+        addReply(c, shared.wrongtypeerr);
+        return;
+    }
+
+    // 先回复值，之后键可能会被删除
+    addReplyBulk(c, o);
+
+    if (expire) {
+        robj* aux;
+
+        // 设置的时间已经过期，删除键并传播DEL
+        if (when <= mstime() && !server.loading /* && !server.masterhost */) {
+            assert(dbDelete(c->db, c->argv[1]));
+            aux = createStringObject("DEL", 3);
+            rewriteClientCommandVector(c, 2, aux, c->argv[1]);
+            decrRefCount(aux);
+        // 否则以绝对时间PEXPIREAT传播
+        } else {
+            robj* whenobj = createStringObjectFromLongLong(when);
+
+            setExpire(c->db, c->argv[1], when);
+            aux = createStringObject("PEXPIREAT", 9);
+            rewriteClientCommandVector(c, 3, aux, c->argv[1], whenobj);
+            decrRefCount(aux);
+            decrRefCount(whenobj);
+        }
+        signalModifiedKey(c->db, c->argv[1]);
+        server.dirty++;
+    } else if (persist) {
+        if (removeExpire(c->db, c->argv[1])) {
+            robj* aux = createStringObject("PERSIST", 7);
+            rewriteClientCommandVector(c, 2, aux, c->argv[1]);
+            decrRefCount(aux);
+            signalModifiedKey(c->db, c->argv[1]);
+            server.dirty++;
+        }
+    }
+}
+
 /*
  * INCR，DECR，INCRBY，DECRBY命令的底层实现
  */
@@ -196,6 +314,7 @@ void incrDecrCommand(redisClient* c, long long incr) {
     else
         dbAdd(c->db, c->argv[1], new);
 
+    signalModifiedKey(c->db, c->argv[1]);
     server.dirty++;
 
     addReply(c, shared.colon);
@@ -267,7 +386,7 @@ void incrbyfloatCommand(redisClient* c) {
     else
         dbAdd(c->db, c->argv[1], new);
 
-
+    signalModifiedKey(c->db, c->argv[1]);
     server.dirty++;
 
     addReplyBulk(c, new);
@@ -316,7 +435,198 @@ void appendCommand(redisClient* c) {
         totlen = sdslen(o->ptr);
     }
 
+    signalModifiedKey(c->db, c->argv[1]);
     server.dirty++;
 
     addReplyLongLong(c, totlen);
 }
+
+/*
+ * SETRANGE命令
+ *
+ * SETRANGE key offset value
+ *
+ * 从偏移量offset开始用value覆盖字符串，字符串不够长时用0字节补齐，回复修改后字符串的长度
+ */
+void setrangeCommand(redisClient* c) {
+    robj* o;
+    long offset;
+    sds value = c->argv[3]->ptr;
+
+    if (getLongFromObjectOrReply(c, c->argv[2], &offset, NULL) != REDIS_OK)
+        return;
+
+    if (offset < 0) {
+        addReplyError(c, "offset is out of range");
+        return;
+    }
+
+    o = lookupKeyWrite(c->db, c->argv[1]);
+    if (o == NULL) {
+        /* Return 0 when setting nothing on a non-existing string */
+        if (sdslen(value) == 0) {
+            addReply(c, shared.czero);
+            return;
+        }
+
+        /* Return when the resulting string exceeds allowed size */
+        if (checkStringLength(c, offset + sdslen(value)) != REDIS_OK)
+            return;
+
+        o = createObject(REDIS_STRING, sdsnewlen(NULL, offset + sdslen(value)));
+        dbAdd(c->db, c->argv[1], o);
+    } else {
+        size_t olen;
+
+        /* Key exists, check type */
+        if (checkType(c, o, REDIS_STRING))
+            return;
+
+        /* Return existing string length when setting nothing */
+        olen = stringObjectLen(o);
+        if (sdslen(value) == 0) {
+            addReplyLongLong(c, olen);
+            return;
+        }
+
+        /* Return when the resulting string exceeds allowed size */
+        if (checkStringLength(c, offset + sdslen(value)) != REDIS_OK)
+            return;
+
+        // 原地修改，共享的或者不是RAW编码的对象先复制一份
+        /* Create a copy when the object is shared or encoded. */
+        o = dbUnshareStringValue(c->db, c->argv[1], o);
+    }
+
+    if (sdslen(value) > 0) {
+        o->ptr = sdsgrowzero(o->ptr, offset + sdslen(value));
+        memcpy((char*) o->ptr + offset, value, sdslen(value));
+        signalModifiedKey(c->db, c->argv[1]);
+        server.dirty++;
+    }
+    addReplyLongLong(c, sdslen(o->ptr));
+}
+
+/*
+ * GETRANGE命令
+ *
+ * GETRANGE key start end
+ *
+ * 返回字符串在[start, end]之间的部分，负数下标从末尾开始计算
+ */
+void getrangeCommand(redisClient* c) {
+    robj* o;
+    long long start, end;
+    char* str;
+    char llbuf[32];
+    size_t strlen;
+
+    if (getLongLongFromObjectOrReply(c, c->argv[2], &start, NULL) != REDIS_OK)
+        return;
+    if (getLongLongFromObjectOrReply(c, c->argv[3], &end, NULL) != REDIS_OK)
+        return;
+    if ((o = lookupKeyReadOrReply(c, c->argv[1], shared.emptybulk)) == NULL ||
+        checkType(c, o, REDIS_STRING))
+        return;
+
+    // 整数编码的字符串转换到栈上的缓冲区，不创建新对象
+    if (o->encoding == REDIS_ENCODING_INT) {
+        str = llbuf;
+        strlen = ll2string(llbuf, sizeof(llbuf), (long) o->ptr);
+    } else {
+        str = o->ptr;
+        strlen = sdslen(str);
+    }
+
+    /* Convert negative indexes */
+    if (start < 0 && end < 0 && start > end) {
+        addReply(c, shared.emptybulk);
+        return;
+    }
+    if (start < 0) start = strlen + start;
+    if (end < 0) end = strlen + end;
+    if (start < 0) start = 0;
+    if (end < 0) end = 0;
+    if ((unsigned long long) end >= strlen) end = strlen - 1;
+
+    /* Precondition: end >= 0 && end < strlen, so the only condition where
+     * nothing can be returned is: start > end. */
+    if (start > end || strlen == 0) {
+        addReply(c, shared.emptybulk);
+    } else {
+        addReplyBulkCBuffer(c, (char*) str + start, end - start + 1);
+    }
+}
+
+/*
+ * MGET命令
+ *
+ * MGET key [key ...]
+ *
+ * 一次获取多个键的字符串值，不存在的键和非字符串类型的键返回空值，
+ * 所有结果放在同一个多条批量回复中
+ */
+void mgetCommand(redisClient* c) {
+
+    int j;
+
+    addReplyMultiBulkLen(c, c->argc - 1);
+    for (j = 1; j < c->argc; j++) {
+        robj* o = lookupKeyRead(c->db, c->argv[j]);
+        if (o == NULL || o->type != REDIS_STRING) {
+            addReply(c, shared.nullbulk);
+        } else {
+            addReplyBulk(c, o);
+        }
+    }
+}
+
+/*
+ * MSET和MSETNX命令的底层实现，nx为1时只有所有键都不存在才执行设置
+ */
+void msetGenericCommand(redisClient* c, int nx) {
+
+    int j;
+
+    if ((c->argc % 2) == 0) {
+        addReplyError(c, "wrong number of arguments for MSET");
+        return;
+    }
+
+    // MSETNX: 只要有一个键存在就不执行任何设置
+    if (nx) {
+        for (j = 1; j < c->argc; j += 2) {
+            if (lookupKeyWrite(c->db, c->argv[j]) != NULL) {
+                addReply(c, shared.czero);
+                return;
+            }
+        }
+    }
+
+    // 设置所有键值对，同时移除原有的过期时间
+    for (j = 1; j < c->argc; j += 2) {
+        c->argv[j + 1] = tryObjectEncoding(c->argv[j + 1]);
+        setKey(c->db, c->argv[j], c->argv[j + 1], 0);
+    }
+    server.dirty += (c->argc - 1) / 2;
+
+    addReply(c, nx ? shared.cone : shared.ok);
+}
+
+/*
+ * MSET命令
+ *
+ * MSET key value [key value ...]
+ */
+void msetCommand(redisClient* c) {
+    msetGenericCommand(c, 0);
+}
+
+/*
+ * MSETNX命令
+ *
+ * MSETNX key value [key value ...]
+ */
+void msetnxCommand(redisClient* c) {
+    msetGenericCommand(c, 1);
+}
@@ -21,7 +21,7 @@ double zzlGetScore(unsigned char* sptr) {
     double score;
 
     assert(sptr != NULL);
-    assert(ziplistGet(sptr, &vstr, &vlen, &vlong));
+    assert(lpGet(sptr, &vstr, &vlen, &vlong));
 
     if (vstr) {
         memcpy(buf, vstr, vlen);
@@ -37,13 +37,13 @@ double zzlGetScore(unsigned char* sptr) {
 /*
  * 取出sptr指向节点所保存的有序集合元素，返回一个新创建的对象
  */
-robj* ziplistGetObject(unsigned char* sptr) {
+robj* lpGetObject(unsigned char* sptr) {
     unsigned char* vstr;
     unsigned int vlen;
     long long vlong;
 
     assert(sptr != NULL);
-    assert(ziplistGet(sptr, &vstr, &vlen, &vlong));
+    assert(lpGet(sptr, &vstr, &vlen, &vlong));
 
     if (vstr) {
         return createStringObject((char*)vstr, vlen);
@@ -62,7 +62,7 @@ int zzlCompareElements(unsigned char* eptr, unsigned char* cstr, unsigned int cl
     unsigned char vbuf[32];
     int minlen, cmp;
 
-    assert(ziplistGet(eptr, &vstr, &vlen, &vlong));
+    assert(lpGet(eptr, &vstr, &vlen, &vlong));
     if (vstr == NULL) {
         /* Store string representation of long long in buf. */
         vlen = ll2string((char*)vbuf, sizeof(vbuf), vlong);
@@ -79,7 +79,7 @@ int zzlCompareElements(unsigned char* eptr, unsigned char* cstr, unsigned int cl
  * 返回有序集合保存的元素-分值对数目
  */
 unsigned int zzlLength(unsigned char* zl) {
-    return ziplistLen(zl) / 2;
+    return lpLength(zl) / 2;
 }
 
 /*
@@ -92,9 +92,9 @@ void zzlNext(unsigned char* zl, unsigned char** eptr, unsigned char** sptr) {
 
     assert(*eptr != NULL && *sptr != NULL);
 
-    _eptr = ziplistNext(zl, *sptr);
+    _eptr = lpNext(zl, *sptr);
     if (_eptr != NULL) {
-        _sptr = ziplistNext(zl, _eptr);
+        _sptr = lpNext(zl, _eptr);
         assert(_sptr != NULL);
     } else {
         _sptr = NULL;
@@ -114,9 +114,9 @@ void zzlPrev(unsigned char* zl, unsigned char** eptr, unsigned char** sptr) {
 
     assert(*eptr != NULL && *sptr != NULL);
 
-    _sptr = ziplistPrev(zl, *eptr);
+    _sptr = lpPrev(zl, *eptr);
     if (_sptr != NULL) {
-        _eptr = ziplistPrev(zl, _sptr);
+        _eptr = lpPrev(zl, _sptr);
         assert(_eptr != NULL);
     } else {
         _eptr = NULL;
@@ -141,7 +141,7 @@ static int zzlValueLteMax(double value, zrangespec* spec) {
 }
 
 /*
- * 判断压缩列表编码的有序集合分值范围是否与range有交集
+ * 判断listpack编码的有序集合分值范围是否与range有交集
  */
 int zzlIsInRange(unsigned char* zl, zrangespec* range) {
     unsigned char* p;
@@ -152,7 +152,7 @@ int zzlIsInRange(unsigned char* zl, zrangespec* range) {
         return 0;
 
     /* Last score */
-    p = ziplistIndex(zl, -1);
+    p = lpIndex(zl, -1);
     /* Empty sorted set */
     if (p == NULL) return 0;
     score = zzlGetScore(p);
@@ -160,7 +160,7 @@ int zzlIsInRange(unsigned char* zl, zrangespec* range) {
         return 0;
 
     /* First score */
-    p = ziplistIndex(zl, 1);
+    p = lpIndex(zl, 1);
     assert(p != NULL);
     score = zzlGetScore(p);
     if (!zzlValueLteMax(score, range))
@@ -170,17 +170,17 @@ int zzlIsInRange(unsigned char* zl, zrangespec* range) {
 }
 
 /*
- * 从前往后遍历压缩列表，找到满足分值在range范围内的第一个元素
+ * 从前往后遍历listpack，找到满足分值在range范围内的第一个元素
  */
 unsigned char* zzlFirstInRange(unsigned char* zl, zrangespec* range) {
-    unsigned char* eptr = ziplistIndex(zl, 0);
+    unsigned char* eptr = lpIndex(zl, 0);
     unsigned char* sptr;
     double score;
 
     if (!zzlIsInRange(zl, range)) return NULL;
 
     while (eptr != NULL) {
-        sptr = ziplistNext(zl, eptr);
+        sptr = lpNext(zl, eptr);
         assert(sptr != NULL);
 
         score = zzlGetScore(sptr);
@@ -190,24 +190,24 @@ unsigned char* zzlFirstInRange(unsigned char* zl, zrangespec* range) {
             return NULL;
         }
 
-        eptr = ziplistNext(zl, sptr);
+        eptr = lpNext(zl, sptr);
     }
 
     return NULL;
 }
 
 /*
- * 从后往前遍历压缩列表，找到满足分值在range范围内的最后一个元素
+ * 从后往前遍历listpack，找到满足分值在range范围内的最后一个元素
  */
 unsigned char* zzlLastInRange(unsigned char* zl, zrangespec* range) {
-    unsigned char* eptr = ziplistIndex(zl, -2);
+    unsigned char* eptr = lpIndex(zl, -2);
     unsigned char* sptr;
     double score;
 
     if (!zzlIsInRange(zl, range)) return NULL;
 
     while (eptr != NULL) {
-        sptr = ziplistNext(zl, eptr);
+        sptr = lpNext(zl, eptr);
         assert(sptr != NULL);
 
         score = zzlGetScore(sptr);
@@ -219,9 +219,9 @@ unsigned char* zzlLastInRange(unsigned char* zl, zrangespec* range) {
 
         /* Move to previous element by moving to the score of previous element.
          * When this returns NULL, we know there also is no element. */
-        sptr = ziplistPrev(zl, eptr);
+        sptr = lpPrev(zl, eptr);
         if (sptr != NULL)
-            assert((eptr = ziplistPrev(zl, sptr)) != NULL);
+            assert((eptr = lpPrev(zl, sptr)) != NULL);
         else
             eptr = NULL;
     }
@@ -230,25 +230,126 @@ unsigned char* zzlLastInRange(unsigned char* zl, zrangespec* range) {
 }
 
 /*
- * 从ziplist编码的有序集合中查找ele元素，并将它的分值保存在score中
+ * 将eptr指向的元素与字典序范围的一端bound比较
+ */
+static int zzlLexCompare(unsigned char* eptr, robj* bound) {
+    if (bound == shared.minstring) return 1;
+    if (bound == shared.maxstring) return -1;
+    return zzlCompareElements(eptr, bound->ptr, sdslen(bound->ptr));
+}
+
+/*
+ * 检查eptr指向的元素是否大于字典序范围内的最小值
+ */
+static int zzlLexValueGteMin(unsigned char* eptr, zlexrangespec* spec) {
+    int cmp = zzlLexCompare(eptr, spec->min);
+    return spec->minex ? (cmp > 0) : (cmp >= 0);
+}
+
+/*
+ * 检查eptr指向的元素是否小于字典序范围内的最大值
+ */
+static int zzlLexValueLteMax(unsigned char* eptr, zlexrangespec* spec) {
+    int cmp = zzlLexCompare(eptr, spec->max);
+    return spec->maxex ? (cmp < 0) : (cmp <= 0);
+}
+
+/*
+ * 判断listpack编码的有序集合成员范围是否与字典序范围range有交集
+ */
+int zzlIsInLexRange(unsigned char* zl, zlexrangespec* range) {
+    unsigned char* p;
+    int cmp = compareStringObjectsForLexRange(range->min, range->max);
+
+    // 空区间
+    if (cmp > 0 || (cmp == 0 && (range->minex || range->maxex)))
+        return 0;
+
+    // 最后一个元素
+    p = lpIndex(zl, -2);
+    if (p == NULL) return 0;
+    if (!zzlLexValueGteMin(p, range))
+        return 0;
+
+    // 第一个元素
+    p = lpIndex(zl, 0);
+    assert(p != NULL);
+    if (!zzlLexValueLteMax(p, range))
+        return 0;
+
+    return 1;
+}
+
+/*
+ * 从前往后遍历listpack，找到成员在字典序范围range内的第一个元素
+ */
+unsigned char* zzlFirstInLexRange(unsigned char* zl, zlexrangespec* range) {
+    unsigned char* eptr = lpIndex(zl, 0);
+    unsigned char* sptr;
+
+    if (!zzlIsInLexRange(zl, range)) return NULL;
+
+    while (eptr != NULL) {
+        if (zzlLexValueGteMin(eptr, range)) {
+            if (zzlLexValueLteMax(eptr, range))
+                return eptr;
+            return NULL;
+        }
+
+        sptr = lpNext(zl, eptr);
+        assert(sptr != NULL);
+        eptr = lpNext(zl, sptr);
+    }
+
+    return NULL;
+}
+
+/*
+ * 从后往前遍历listpack，找到成员在字典序范围range内的最后一个元素
+ */
+unsigned char* zzlLastInLexRange(unsigned char* zl, zlexrangespec* range) {
+    unsigned char* eptr = lpIndex(zl, -2);
+    unsigned char* sptr;
+
+    if (!zzlIsInLexRange(zl, range)) return NULL;
+
+    while (eptr != NULL) {
+        if (zzlLexValueLteMax(eptr, range)) {
+            if (zzlLexValueGteMin(eptr, range))
+                return eptr;
+            return NULL;
+        }
+
+        sptr = lpPrev(zl, eptr);
+        if (sptr != NULL)
+            assert((eptr = lpPrev(zl, sptr)) != NULL);
+        else
+            eptr = NULL;
+    }
+
+    return NULL;
+}
+
+/*
+ * 从listpack编码的有序集合中查找ele元素，并将它的分值保存在score中
  */
 unsigned char* zzlFind(unsigned char* zl, robj* ele, double* score) {
-    unsigned char* eptr = ziplistIndex(zl, 0);
+    unsigned char* eptr = lpIndex(zl, 0);
     unsigned char* sptr;
 
     ele = getDecodedObject(ele);
 
     while (eptr != NULL) {
-        sptr = ziplistNext(zl, eptr);
+        sptr = lpNext(zl, eptr);
         assert(sptr != NULL);
 
-        if (ziplistCompare(eptr, ele->ptr, sdslen(ele->ptr))) {
+        if (lpCompare(eptr, ele->ptr, sdslen(ele->ptr))) {
             if (score != NULL) *score = zzlGetScore(sptr);
             decrRefCount(ele);
             return eptr;
         }
 
-        eptr = ziplistNext(zl, sptr);
+        eptr = lpNext(zl, sptr);
     }
 
     decrRefCount(ele);
@@ -257,13 +358,13 @@ unsigned char* zzlFind(unsigned char* zl, robj* ele, double* score) {
 }
 
 /*
- * 从ziplist编码的有序集合中删除eptr指向的有序集合元素-分值对
+ * 从listpack编码的有序集合中删除eptr指向的有序集合元素-分值对
  */
 unsigned char* zzlDelete(unsigned char* zl, unsigned char* eptr) {
     unsigned char* p = eptr;
 
-    zl = ziplistDelete(zl, &p);
-    zl = ziplistDelete(zl, &p);
+    zl = lpDelete(zl, &p);
+    zl = lpDelete(zl, &p);
     return zl;
 }
 
@@ -280,27 +381,27 @@ unsigned char* zzlInsertAt(unsigned char* zl, unsigned char* eptr, robj* ele, do
     scorelen = d2string(scorebuf, sizeof(scorebuf), score);
 
     if (eptr == NULL) {
-        zl = ziplistPush(zl, ele->ptr, sdslen(ele->ptr), ZIPLIST_TAIL);
-        zl = ziplistPush(zl, (unsigned char*)scorebuf, scorelen, ZIPLIST_TAIL);
+        zl = lpPush(zl, ele->ptr, sdslen(ele->ptr), LP_TAIL);
+        zl = lpPush(zl, (unsigned char*)scorebuf, scorelen, LP_TAIL);
     } else {
         offset = eptr - zl;
-        zl = ziplistInsert(zl, eptr, ele->ptr, sdslen(ele->ptr));
+        zl = lpInsert(zl, eptr, ele->ptr, sdslen(ele->ptr));
         eptr = zl + offset;
 
-        assert((sptr = ziplistNext(zl, eptr)) != NULL);
-        zl = ziplistInsert(zl, sptr, (unsigned char*)scorebuf, scorelen);
+        assert((sptr = lpNext(zl, eptr)) != NULL);
+        zl = lpInsert(zl, sptr, (unsigned char*)scorebuf, scorelen);
     }
 
     return zl;
 }
 
 /*
- * 将元素-分值对按照分值从小到大顺序插入到ziplist编码的有序集合
+ * 将元素-分值对按照分值从小到大顺序插入到listpack编码的有序集合
  * 注意: 这个函数假设ele之前并未在有序集合中存在
  */
 unsigned char* zzlInsert(unsigned char* zl, robj* ele, double score) {
 
-    unsigned char* eptr = ziplistIndex(zl, 0);
+    unsigned char* eptr = lpIndex(zl, 0);
     unsigned char* sptr;
     double s;
 
@@ -308,7 +409,7 @@ unsigned char* zzlInsert(unsigned char* zl, robj* ele, double score) {
 
     while (eptr != NULL) {
 
-        sptr = ziplistNext(zl, eptr);
+        sptr = lpNext(zl, eptr);
         assert(sptr != NULL);
         s = zzlGetScore(sptr);
 
@@ -323,7 +424,7 @@ unsigned char* zzlInsert(unsigned char* zl, robj* ele, double score) {
         }
 
         // 新添加的元素分值比当前遍历到的元素分值大，移动到下一个节点
-        eptr = ziplistNext(zl, sptr);
+        eptr = lpNext(zl, sptr);
     }
 
     if (eptr == NULL)
@@ -334,7 +435,7 @@ unsigned char* zzlInsert(unsigned char* zl, robj* ele, double score) {
 }
 
 /*
- * 删除ziplist中分值在指定范围内的元素-分值对
+ * 删除listpack中分值在指定范围内的元素-分值对
  */
 unsigned char* zzlDeleteRangeByScore(unsigned char* zl, zrangespec* range, unsigned long* deleted) {
     unsigned char* eptr;
@@ -347,12 +448,12 @@ unsigned char* zzlDeleteRangeByScore(unsigned char* zl, zrangespec* range, unsig
     eptr = zzlFirstInRange(zl, range);
     if (eptr == NULL) return zl;
 
-    while ((sptr = ziplistNext(zl, eptr)) != NULL) {
+    while ((sptr = lpNext(zl, eptr)) != NULL) {
         score = zzlGetScore(sptr);
         if (zzlValueLteMax(score, range)) {
             /* Delete both the element and the score. */
-            zl = ziplistDelete(zl, &eptr);
-            zl = ziplistDelete(zl, &eptr);
+            zl = lpDelete(zl, &eptr);
+            zl = lpDelete(zl, &eptr);
             num++;
         } else {
             /* No longer in range. */
@@ -365,14 +466,14 @@ unsigned char* zzlDeleteRangeByScore(unsigned char* zl, zrangespec* range, unsig
 }
 
 /*
- * 删除ziplist中分值在指定排位范围内的元素-分值对
+ * 删除listpack中分值在指定排位范围内的元素-分值对
  */
 unsigned char* zzlDeleteRangeByRank(unsigned char* zl, unsigned int start, unsigned int end, unsigned long* deleted) {
     unsigned int num = (end - start) + 1;
 
     if (deleted != NULL) *deleted = num;
 
-    zl = ziplistDeleteRange(zl, 2 * (start - 1), 2 * num);
+    zl = lpDeleteRange(zl, 2 * (start - 1), 2 * num);
 
     return zl;
 }
@@ -388,10 +489,12 @@ unsigned int zsetLength(robj* zobj) {
 
     int length = -1;
 
-    if (zobj->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (zobj->encoding == REDIS_ENCODING_LISTPACK) {
         length = zzlLength(zobj->ptr);
     } else if (zobj->encoding == REDIS_ENCODING_SKIPLIST) {
         length = ((zset*)zobj->ptr)->zsl->length;
+    } else if (zobj->encoding == REDIS_ENCODING_BTREE) {
+        length = ((zset*)zobj->ptr)->zbt->length;
     } else {
         exit(1);
     }
@@ -411,8 +514,8 @@ void zsetConvert(robj* zobj, int encoding) {
 
     if (zobj->encoding == encoding) return;
 
-    // zobj原来编码是REDIS_ENCODING_ZIPLIST，转为REDIS_ENCODING_SKIPLIST
-    if (zobj->encoding == REDIS_ENCODING_ZIPLIST) {
+    // zobj原来编码是REDIS_ENCODING_LISTPACK，转为REDIS_ENCODING_SKIPLIST
+    if (zobj->encoding == REDIS_ENCODING_LISTPACK) {
         unsigned char* zl = zobj->ptr;
         unsigned char* eptr;
         unsigned char* sptr;
@@ -420,23 +523,31 @@ void zsetConvert(robj* zobj, int encoding) {
         unsigned int vlen;
         long long vlong;
 
+        // 转为B+树时先转为跳跃表
+        if (encoding == REDIS_ENCODING_BTREE) {
+            zsetConvert(zobj, REDIS_ENCODING_SKIPLIST);
+            zsetConvert(zobj, REDIS_ENCODING_BTREE);
+            return;
+        }
+
         if (encoding != REDIS_ENCODING_SKIPLIST)
             exit(1);
 
         zs = zmalloc(sizeof(zset));
         zs->dict = dictCreate(&zsetDictType, NULL);
         zs->zsl = zslCreate();
+        zs->zbt = NULL;
 
-        eptr = ziplistIndex(zl, 0);
+        eptr = lpIndex(zl, 0);
         assert(eptr != NULL);
-        sptr = ziplistNext(zl, eptr);
+        sptr = lpNext(zl, eptr);
         assert(sptr != NULL);
 
         while (eptr != NULL) {
 
             score = zzlGetScore(sptr);
 
-            assert(ziplistGet(eptr, &vstr, &vlen, &vlong));
+            assert(lpGet(eptr, &vstr, &vlen, &vlong));
 
             if (vstr == NULL)
                 ele = createStringObjectFromLongLong(vlong);
@@ -456,12 +567,39 @@ void zsetConvert(robj* zobj, int encoding) {
         zobj->ptr = zs;
         zobj->encoding = REDIS_ENCODING_SKIPLIST;
 
-    // zobj原来编码是REDIS_ENCODING_SKIPLIST，转为REDIS_ENCODING_ZIPLIST
+    // zobj原来编码是REDIS_ENCODING_SKIPLIST，转为REDIS_ENCODING_BTREE，
+    // 跳跃表持有的成员引用转交给B+树，字典中的值改为保存分值本身
+    } else if (zobj->encoding == REDIS_ENCODING_SKIPLIST && encoding == REDIS_ENCODING_BTREE) {
+
+        zs = zobj->ptr;
+        zs->zbt = zbtCreate();
+
+        node = zs->zsl->header->level[0].forward;
+
+        zfree(zs->zsl->header);
+        zfree(zs->zsl);
+        zs->zsl = NULL;
+
+        while (node) {
+            dictEntry* de = dictFind(zs->dict, node->obj);
+
+            assert(de != NULL);
+            zbtInsert(zs->zbt, node->score, node->obj);
+            dictSetDoubleVal(de, node->score);
+
+            next = node->level[0].forward;
+            zfree(node);
+            node = next;
+        }
+
+        zobj->encoding = REDIS_ENCODING_BTREE;
+
+    // zobj原来编码是REDIS_ENCODING_SKIPLIST，转为REDIS_ENCODING_LISTPACK
     } else if (zobj->encoding == REDIS_ENCODING_SKIPLIST) {
 
-        unsigned char* zl = ziplistNew();
+        unsigned char* zl = lpNew();
 
-        if (encoding != REDIS_ENCODING_ZIPLIST)
+        if (encoding != REDIS_ENCODING_LISTPACK)
             exit(1);
 
         zs = zobj->ptr;
@@ -487,7 +625,7 @@ void zsetConvert(robj* zobj, int encoding) {
         zfree(zs);
 
         zobj->ptr = zl;
-        zobj->encoding = REDIS_ENCODING_ZIPLIST;
+        zobj->encoding = REDIS_ENCODING_LISTPACK;
     } else {
         exit(1);
     }
@@ -495,7 +633,6 @@ void zsetConvert(robj* zobj, int encoding) {
 
 /*
  * 注意: 
- * signalModifiedKey函数与独立功能事务相关，在本代码中删除；
  * notifyKeyspaceEvent函数与独立功能发布/订阅相关，在本代码中删除；
  */
 
@@ -545,7 +682,7 @@ void zaddGenericCommand(redisClient* c, int incr) {
             server.zset_max_ziplist_value < sdslen(c->argv[3]->ptr)) {
             zobj = createZsetObject();
         } else {
-            zobj = createZsetZiplistObject();
+            zobj = createZsetListpackObject();
         }
         dbAdd(c->db, key, zobj);
     } else {
@@ -559,11 +696,11 @@ void zaddGenericCommand(redisClient* c, int incr) {
     for (j = 0; j < elements; j++) {
         score = scores[j];
 
-        // ZIPLIST
-        if (zobj->encoding == REDIS_ENCODING_ZIPLIST) {
+        // LISTPACK
+        if (zobj->encoding == REDIS_ENCODING_LISTPACK) {
             unsigned char* eptr;
 
-            /* Prefer non-encoded element when dealing with ziplists. */
+            /* Prefer non-encoded element when dealing with listpacks. */
             ele = c->argv[3 + j * 2];
             if ((eptr = zzlFind(zobj->ptr, ele, &curscore)) != NULL) {
 
@@ -596,6 +733,10 @@ void zaddGenericCommand(redisClient* c, int incr) {
                 if (sdslen(ele->ptr) > server.zset_max_ziplist_value)
                     zsetConvert(zobj, REDIS_ENCODING_SKIPLIST);
 
+                if (zobj->encoding == REDIS_ENCODING_SKIPLIST &&
+                    zsetLength(zobj) > server.zset_max_skiplist_entries)
+                    zsetConvert(zobj, REDIS_ENCODING_BTREE);
+
                 server.dirty++;
                 added++;
             }
@@ -640,12 +781,63 @@ void zaddGenericCommand(redisClient* c, int incr) {
                 }
             } else {
 
+                // 有序集合保存成员的副本，不和参数数组共享
+                ele = dupStringObject(ele);
                 znode = zslInsert(zs->zsl, score, ele);
-                incrRefCount(ele);
 
                 assert(dictAdd(zs->dict, ele, &znode->score) == DICT_OK);
                 incrRefCount(ele);
 
+                if (zs->zsl->length > server.zset_max_skiplist_entries)
+                    zsetConvert(zobj, REDIS_ENCODING_BTREE);
+
+                server.dirty++;
+                added++;
+            }
+
+        // BTREE
+        } else if (zobj->encoding == REDIS_ENCODING_BTREE) {
+            zset* zs = zobj->ptr;
+            dictEntry* de;
+
+            ele = c->argv[3 + j * 2] = tryObjectEncoding(c->argv[3 + j * 2]);
+
+            de = dictFind(zs->dict, ele);
+            if (de != NULL) {
+
+                curobj = dictGetKey(de);
+                curscore = dictGetDoubleVal(de);
+
+                if (incr) {
+                    score += curscore;
+                    if (isnan(score)) {
+                        addReplyError(c, nanerr);
+                        goto cleanup;
+                    }
+                }
+
+                // 分值改变时从B+树中删除再重新插入，字典仍然持有成员的引用
+                if (score != curscore) {
+                    assert(zbtDelete(zs->zbt, curscore, curobj));
+
+                    zbtInsert(zs->zbt, score, curobj);
+                    incrRefCount(curobj);
+
+                    dictSetDoubleVal(de, score);
+
+                    server.dirty++;
+                    updated++;
+                }
+            } else {
+
+                ele = dupStringObject(ele);
+                zbtInsert(zs->zbt, score, ele);
+
+                de = dictAddRaw(zs->dict, ele);
+                assert(de != NULL);
+                dictSetDoubleVal(de, score);
+                incrRefCount(ele);
+
                 server.dirty++;
                 added++;
             }
@@ -654,6 +846,8 @@ void zaddGenericCommand(redisClient* c, int incr) {
         }
     }
 
+    if (added || updated) signalModifiedKey(c->db, key);
+
     if (incr)    /* ZINCRBY */
         addReplyDouble(c, score);
     else         /* ZADD */
@@ -702,7 +896,7 @@ void zcountCommand(redisClient* c) {
     if ((zobj = lookupKeyReadOrReply(c, key, shared.czero)) == NULL || checkType(c, zobj, REDIS_ZSET))
         return;
 
-    if (zobj->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (zobj->encoding == REDIS_ENCODING_LISTPACK) {
         unsigned char* zl = zobj->ptr;
         unsigned char* eptr;
         unsigned char* sptr;
@@ -716,7 +910,7 @@ void zcountCommand(redisClient* c) {
             return;
         }
 
-        sptr = ziplistNext(zl, eptr);
+        sptr = lpNext(zl, eptr);
         score = zzlGetScore(sptr);
         assert(zslValueLteMax(score, &range));
 
@@ -755,6 +949,12 @@ void zcountCommand(redisClient* c) {
             }
         }
 
+    } else if (zobj->encoding == REDIS_ENCODING_BTREE) {
+        zset* zs = zobj->ptr;
+
+        // 两次查找得到范围两端之前的元素数量，不需要遍历范围内的元素
+        count = zbtCountInRange(zs->zbt, &range);
+
     } else {
         exit(1);
     }
@@ -806,7 +1006,7 @@ void zrangeGenericCommand(redisClient* c, int reverse) {
     /* Return the result in form of a multi-bulk reply */
     addReplyMultiBulkLen(c, withscores ? (rangelen * 2) : rangelen);
 
-    if (zobj->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (zobj->encoding == REDIS_ENCODING_LISTPACK) {
         unsigned char* zl = zobj->ptr;
         unsigned char* eptr;
         unsigned char* sptr;
@@ -815,16 +1015,16 @@ void zrangeGenericCommand(redisClient* c, int reverse) {
         long long vlong;
 
         if (reverse)
-            eptr = ziplistIndex(zl,-2 - (2 * start));
+            eptr = lpIndex(zl,-2 - (2 * start));
         else
-            eptr = ziplistIndex(zl,2 * start);
+            eptr = lpIndex(zl,2 * start);
 
         assert(eptr != NULL);
-        sptr = ziplistNext(zl, eptr);
+        sptr = lpNext(zl, eptr);
 
         while (rangelen--) {
             assert(eptr != NULL && sptr != NULL);
-            assert(ziplistGet(eptr, &vstr, &vlen, &vlong));
+            assert(lpGet(eptr, &vstr, &vlen, &vlong));
             if (vstr == NULL)
                 addReplyBulkLongLong(c, vlong);
             else
@@ -859,11 +1059,23 @@ void zrangeGenericCommand(redisClient* c, int reverse) {
         while(rangelen--) {
             assert(ln != NULL);
             ele = ln->obj;
-            addReplyBulk(c, ele);
+            addReplyBulkCopy(c, ele);
             if (withscores)
                 addReplyDouble(c, ln->score);
             ln = reverse ? ln->backward : ln->level[0].forward;
         }
+    } else if (zobj->encoding == REDIS_ENCODING_BTREE) {
+        zset* zs = zobj->ptr;
+        zbtreePos pos;
+
+        assert(zbtGetElementByRank(zs->zbt, reverse ? llen - start : start + 1, &pos));
+
+        while (rangelen--) {
+            addReplyBulkCopy(c, zbtPosObj(&pos));
+            if (withscores)
+                addReplyDouble(c, zbtPosScore(&pos));
+            if (rangelen) assert(reverse ? zbtPrev(&pos) : zbtNext(&pos));
+        }
     } else {
         exit(1);
     }
@@ -900,19 +1112,19 @@ void zrankGenericCommand(redisClient* c, int reverse) {
 
     assert(sdsEncodedObject(ele));
 
-    if (zobj->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (zobj->encoding == REDIS_ENCODING_LISTPACK) {
         unsigned char* zl = zobj->ptr;
         unsigned char* eptr;
         unsigned char* sptr;
 
-        eptr = ziplistIndex(zl, 0);
+        eptr = lpIndex(zl, 0);
         assert(eptr != NULL);
-        sptr = ziplistNext(zl, eptr);
+        sptr = lpNext(zl, eptr);
         assert(sptr != NULL);
 
         rank = 1;
         while(eptr != NULL) {
-            if (ziplistCompare(eptr, ele->ptr, sdslen(ele->ptr)))
+            if (lpCompare(eptr, ele->ptr, sdslen(ele->ptr)))
                 break;
             rank++;
             zzlNext(zl, &eptr, &sptr);
@@ -950,6 +1162,24 @@ void zrankGenericCommand(redisClient* c, int reverse) {
             addReply(c, shared.nullbulk);
         }
 
+    } else if (zobj->encoding == REDIS_ENCODING_BTREE) {
+        zset* zs = zobj->ptr;
+        dictEntry* de;
+
+        ele = c->argv[2] = tryObjectEncoding(c->argv[2]);
+        de = dictFind(zs->dict, ele);
+        if (de != NULL) {
+            rank = zbtGetRank(zs->zbt, dictGetDoubleVal(de), ele);
+            assert(rank);
+
+            if (reverse)
+                addReplyLongLong(c, llen - rank);
+            else
+                addReplyLongLong(c, rank - 1);
+        } else {
+            addReply(c, shared.nullbulk);
+        }
+
     } else {
         exit(1);
     }
@@ -981,7 +1211,7 @@ void zremCommand(redisClient* c) {
     if ((zobj = lookupKeyWriteOrReply(c, key, shared.czero)) == NULL || checkType(c, zobj, REDIS_ZSET))
         return;
 
-    if (zobj->encoding == REDIS_ENCODING_ZIPLIST) {
+    if (zobj->encoding == REDIS_ENCODING_LISTPACK) {
         unsigned char* eptr;
 
         for (j = 2; j < c->argc; j++) {
@@ -1018,6 +1248,30 @@ void zremCommand(redisClient* c) {
 
                 if (htNeedsResize(zs->dict)) dictResize(zs->dict);
 
+                if (dictSize(zs->dict) == 0) {
+                    dbDelete(c->db, key);
+                    break;
+                }
+            }
+        }
+    } else if (zobj->encoding == REDIS_ENCODING_BTREE) {
+        zset* zs = zobj->ptr;
+        dictEntry* de;
+
+        for (j = 2; j < c->argc; j++) {
+
+            de = dictFind(zs->dict, c->argv[j]);
+
+            if (de != NULL) {
+
+                deleted++;
+
+                assert(zbtDelete(zs->zbt, dictGetDoubleVal(de), c->argv[j]));
+
+                dictDelete(zs->dict, c->argv[j]);
+
+                if (htNeedsResize(zs->dict)) dictResize(zs->dict);
+
                 if (dictSize(zs->dict) == 0) {
                     dbDelete(c->db, key);
                     break;
@@ -1030,6 +1284,7 @@ void zremCommand(redisClient* c) {
 
     if (deleted) {
 
+        signalModifiedKey(c->db, c->argv[1]);
         server.dirty += deleted;
     }
 
@@ -1047,8 +1302,8 @@ void zscoreCommand(redisClient* c) {
     if ((zobj = lookupKeyReadOrReply(c, key, shared.nullbulk)) == NULL || checkType(c, zobj, REDIS_ZSET))
         return;
 
-    // ziplist
-    if (zobj->encoding == REDIS_ENCODING_ZIPLIST) {
+    // listpack
+    if (zobj->encoding == REDIS_ENCODING_LISTPACK) {
         if (zzlFind(zobj->ptr, c->argv[2], &score) != NULL)
             addReplyDouble(c, score);
         else
@@ -1067,7 +1322,1039 @@ void zscoreCommand(redisClient* c) {
         } else {
             addReply(c, shared.nullbulk);
         }
+    // btree
+    } else if (zobj->encoding == REDIS_ENCODING_BTREE) {
+        zset* zs = zobj->ptr;
+        dictEntry* de;
+
+        c->argv[2] = tryObjectEncoding(c->argv[2]);
+        // 字典中直接保存分值
+        de = dictFind(zs->dict, c->argv[2]);
+        if (de != NULL)
+            addReplyDouble(c, dictGetDoubleVal(de));
+        else
+            addReply(c, shared.nullbulk);
+    } else {
+        exit(1);
+    }
+}
+
+/*
+ * ZINCRBY命令
+ */
+void zincrbyCommand(redisClient* c) {
+    zaddGenericCommand(c, 1);
+}
+
+#define ZRANGE_RANK 0
+#define ZRANGE_SCORE 1
+
+/*
+ * ZREMRANGEBYRANK，ZREMRANGEBYSCORE命令底层实现
+ */
+void zremrangeGenericCommand(redisClient* c, int rangetype) {
+    robj* key = c->argv[1];
+    robj* zobj;
+    zrangespec range;
+    long start;
+    long end;
+    long llen;
+    unsigned long deleted = 0;
+
+    if (rangetype == ZRANGE_RANK) {
+        if ((getLongFromObjectOrReply(c, c->argv[2], &start, NULL) != REDIS_OK) ||
+            (getLongFromObjectOrReply(c, c->argv[3], &end, NULL) != REDIS_OK))
+            return;
+    } else {
+        if (zslParseRange(c->argv[2], c->argv[3], &range) != REDIS_OK) {
+            addReplyError(c, "min or max is not a float");
+            return;
+        }
+    }
+
+    if ((zobj = lookupKeyWriteOrReply(c, key, shared.czero)) == NULL || checkType(c, zobj, REDIS_ZSET))
+        return;
+
+    if (rangetype == ZRANGE_RANK) {
+        /* Sanitize indexes. */
+        llen = zsetLength(zobj);
+        if (start < 0) start = llen + start;
+        if (end < 0) end = llen + end;
+        if (start < 0) start = 0;
+
+        if (start > end || start >= llen) {
+            addReply(c, shared.czero);
+            return;
+        }
+        if (end >= llen) end = llen - 1;
+    }
+
+    if (zobj->encoding == REDIS_ENCODING_LISTPACK) {
+        if (rangetype == ZRANGE_RANK)
+            zobj->ptr = zzlDeleteRangeByRank(zobj->ptr, start + 1, end + 1, &deleted);
+        else
+            zobj->ptr = zzlDeleteRangeByScore(zobj->ptr, &range, &deleted);
+
+    } else if (zobj->encoding == REDIS_ENCODING_SKIPLIST) {
+        zset* zs = zobj->ptr;
+
+        if (rangetype == ZRANGE_RANK)
+            deleted = zslDeleteRangeByRank(zs->zsl, start + 1, end + 1, zs->dict);
+        else
+            deleted = zslDeleteRangeByScore(zs->zsl, &range, zs->dict);
+
+        if (htNeedsResize(zs->dict)) dictResize(zs->dict);
+
+    } else if (zobj->encoding == REDIS_ENCODING_BTREE) {
+        zset* zs = zobj->ptr;
+
+        if (rangetype == ZRANGE_RANK)
+            deleted = zbtDeleteRangeByRank(zs->zbt, start + 1, end + 1, zs->dict);
+        else
+            deleted = zbtDeleteRangeByScore(zs->zbt, &range, zs->dict);
+
+        if (htNeedsResize(zs->dict)) dictResize(zs->dict);
+
     } else {
         exit(1);
     }
+
+    if (zsetLength(zobj) == 0) dbDelete(c->db, key);
+
+    if (deleted) {
+        signalModifiedKey(c->db, key);
+        server.dirty += deleted;
+    }
+
+    addReplyLongLong(c, deleted);
+}
+
+/*
+ * ZREMRANGEBYRANK命令
+ */
+void zremrangebyrankCommand(redisClient* c) {
+    zremrangeGenericCommand(c, ZRANGE_RANK);
+}
+
+/*
+ * ZREMRANGEBYSCORE命令
+ */
+void zremrangebyscoreCommand(redisClient* c) {
+    zremrangeGenericCommand(c, ZRANGE_SCORE);
+}
+
+/*
+ * 解析ZRANGEBYSCORE，ZRANGEBYLEX等命令从argv[start]开始的可选参数，
+ * withscores为NULL时不接受WITHSCORES选项
+ */
+static int zrangeParseOptions(redisClient* c, int start, int* withscores, long* offset, long* limit) {
+    int pos = start;
+    int remaining = c->argc - start;
+
+    while (remaining) {
+        if (withscores && remaining >= 1 && !strcasecmp(c->argv[pos]->ptr, "withscores")) {
+            pos++; remaining--;
+            *withscores = 1;
+        } else if (remaining >= 3 && !strcasecmp(c->argv[pos]->ptr, "limit")) {
+            if ((getLongFromObjectOrReply(c, c->argv[pos + 1], offset, NULL) != REDIS_OK) ||
+                (getLongFromObjectOrReply(c, c->argv[pos + 2], limit, NULL) != REDIS_OK))
+                return REDIS_ERR;
+            pos += 3; remaining -= 3;
+        } else {
+            addReply(c, shared.syntaxerr);
+            return REDIS_ERR;
+        }
+    }
+
+    return REDIS_OK;
+}
+
+/*
+ * ZRANGEBYSCORE，ZREVRANGEBYSCORE命令底层实现
+ *
+ * LIMIT的偏移量在跳跃表和B+树中通过排名直接定位，不需要逐个跳过offset个元素
+ */
+void genericZrangebyscoreCommand(redisClient* c, int reverse) {
+    zrangespec range;
+    robj* key = c->argv[1];
+    robj* zobj;
+    long offset = 0;
+    long limit = -1;
+    int withscores = 0;
+    unsigned long rangelen = 0;
+    void* replylen = NULL;
+    int minidx, maxidx;
+
+    /* Parse the range arguments. */
+    if (reverse) {
+        /* Range is given as [max,min] */
+        maxidx = 2; minidx = 3;
+    } else {
+        /* Range is given as [min,max] */
+        minidx = 2; maxidx = 3;
+    }
+
+    if (zslParseRange(c->argv[minidx], c->argv[maxidx], &range) != REDIS_OK) {
+        addReplyError(c, "min or max is not a float");
+        return;
+    }
+
+    if (zrangeParseOptions(c, 4, &withscores, &offset, &limit) != REDIS_OK) return;
+
+    if ((zobj = lookupKeyReadOrReply(c, key, shared.emptymultibulk)) == NULL || checkType(c, zobj, REDIS_ZSET))
+        return;
+
+    // 偏移量为负数时结果为空
+    if (offset < 0) {
+        addReply(c, shared.emptymultibulk);
+        return;
+    }
+
+    if (zobj->encoding == REDIS_ENCODING_LISTPACK) {
+        unsigned char* zl = zobj->ptr;
+        unsigned char* eptr;
+        unsigned char* sptr;
+        unsigned char* vstr;
+        unsigned int vlen;
+        long long vlong;
+        double score;
+
+        /* If reversed, get the last node in range as starting point. */
+        if (reverse)
+            eptr = zzlLastInRange(zl, &range);
+        else
+            eptr = zzlFirstInRange(zl, &range);
+
+        /* No "first" element in the specified interval. */
+        if (eptr == NULL) {
+            addReply(c, shared.emptymultibulk);
+            return;
+        }
+
+        /* Get score pointer for the first element. */
+        sptr = lpNext(zl, eptr);
+        assert(sptr != NULL);
+
+        /* We don't know in advance how many matching elements there are in the
+         * list, so we push this object that will represent the multi-bulk
+         * length in the output buffer, and will "fix" it later */
+        replylen = addDeferredMultiBulkLength(c);
+
+        /* If there is an offset, just element skipping is fine in listpack. */
+        while (eptr && offset--) {
+            if (reverse)
+                zzlPrev(zl, &eptr, &sptr);
+            else
+                zzlNext(zl, &eptr, &sptr);
+        }
+
+        while (eptr && limit--) {
+            score = zzlGetScore(sptr);
+
+            /* Abort when the node is no longer in range. */
+            if (reverse) {
+                if (!zslValueGteMin(score, &range)) break;
+            } else {
+                if (!zslValueLteMax(score, &range)) break;
+            }
+
+            assert(lpGet(eptr, &vstr, &vlen, &vlong));
+
+            rangelen++;
+            if (vstr == NULL)
+                addReplyBulkLongLong(c, vlong);
+            else
+                addReplyBulkCBuffer(c, vstr, vlen);
+
+            if (withscores)
+                addReplyDouble(c, score);
+
+            if (reverse)
+                zzlPrev(zl, &eptr, &sptr);
+            else
+                zzlNext(zl, &eptr, &sptr);
+        }
+
+    } else if (zobj->encoding == REDIS_ENCODING_SKIPLIST) {
+        zset* zs = zobj->ptr;
+        zskiplist* zsl = zs->zsl;
+        zskiplistNode* ln;
+
+        if (reverse)
+            ln = zslLastInRange(zsl, &range);
+        else
+            ln = zslFirstInRange(zsl, &range);
+
+        if (ln == NULL) {
+            addReply(c, shared.emptymultibulk);
+            return;
+        }
+
+        replylen = addDeferredMultiBulkLength(c);
+
+        // 通过节点的排名直接定位到跳过offset个元素之后的节点
+        if (offset > 0) {
+            unsigned long rank = zslGetRank(zsl, ln->score, ln->obj);
+
+            if (reverse)
+                ln = ((unsigned long) offset < rank) ? zslGetElementByRank(zsl, rank - offset) : NULL;
+            else
+                ln = (rank + offset <= zsl->length) ? zslGetElementByRank(zsl, rank + offset) : NULL;
+        }
+
+        while (ln && limit--) {
+            /* Abort when the node is no longer in range. */
+            if (reverse) {
+                if (!zslValueGteMin(ln->score, &range)) break;
+            } else {
+                if (!zslValueLteMax(ln->score, &range)) break;
+            }
+
+            rangelen++;
+            addReplyBulkCopy(c, ln->obj);
+
+            if (withscores)
+                addReplyDouble(c, ln->score);
+
+            /* Move to next node */
+            ln = reverse ? ln->backward : ln->level[0].forward;
+        }
+
+    } else if (zobj->encoding == REDIS_ENCODING_BTREE) {
+        zset* zs = zobj->ptr;
+        zbtreePos pos;
+        unsigned long rank;
+        int found;
+
+        if (reverse)
+            rank = zbtLastInRange(zs->zbt, &range, &pos);
+        else
+            rank = zbtFirstInRange(zs->zbt, &range, &pos);
+
+        if (rank == 0) {
+            addReply(c, shared.emptymultibulk);
+            return;
+        }
+
+        replylen = addDeferredMultiBulkLength(c);
+
+        // 查找范围时已经得到排名，按排名直接定位
+        found = 1;
+        if (offset > 0) {
+            if (reverse)
+                found = (unsigned long) offset < rank && zbtGetElementByRank(zs->zbt, rank - offset, &pos);
+            else
+                found = zbtGetElementByRank(zs->zbt, rank + offset, &pos);
+        }
+
+        while (found && limit--) {
+            if (reverse) {
+                if (!zslValueGteMin(zbtPosScore(&pos), &range)) break;
+            } else {
+                if (!zslValueLteMax(zbtPosScore(&pos), &range)) break;
+            }
+
+            rangelen++;
+            addReplyBulkCopy(c, zbtPosObj(&pos));
+
+            if (withscores)
+                addReplyDouble(c, zbtPosScore(&pos));
+
+            found = reverse ? zbtPrev(&pos) : zbtNext(&pos);
+        }
+
+    } else {
+        exit(1);
+    }
+
+    if (withscores) rangelen *= 2;
+
+    setDeferredMultiBulkLength(c, replylen, rangelen);
+}
+
+/*
+ * ZRANGEBYSCORE命令
+ *
+ * ZRANGEBYSCORE key min max [WITHSCORES] [LIMIT offset count]
+ */
+void zrangebyscoreCommand(redisClient* c) {
+    genericZrangebyscoreCommand(c, 0);
+}
+
+/*
+ * ZREVRANGEBYSCORE命令
+ *
+ * ZREVRANGEBYSCORE key max min [WITHSCORES] [LIMIT offset count]
+ */
+void zrevrangebyscoreCommand(redisClient* c) {
+    genericZrangebyscoreCommand(c, 1);
+}
+
+/*
+ * ZLEXCOUNT命令
+ *
+ * ZLEXCOUNT key min max
+ *
+ * 返回成员在字典序范围内的元素数量，只有所有元素分值相同时结果才有意义
+ */
+void zlexcountCommand(redisClient* c) {
+    robj* key = c->argv[1];
+    robj* zobj;
+    zlexrangespec range;
+    unsigned long count = 0;
+
+    if (zslParseLexRange(c->argv[2], c->argv[3], &range) != REDIS_OK) {
+        addReplyError(c, "min or max not valid string range item");
+        return;
+    }
+
+    if ((zobj = lookupKeyReadOrReply(c, key, shared.czero)) == NULL || checkType(c, zobj, REDIS_ZSET)) {
+        zslFreeLexRange(&range);
+        return;
+    }
+
+    if (zobj->encoding == REDIS_ENCODING_LISTPACK) {
+        unsigned char* zl = zobj->ptr;
+        unsigned char* eptr;
+        unsigned char* sptr;
+
+        eptr = zzlFirstInLexRange(zl, &range);
+        if (eptr != NULL) {
+            sptr = lpNext(zl, eptr);
+
+            while (eptr && zzlLexValueLteMax(eptr, &range)) {
+                count++;
+                zzlNext(zl, &eptr, &sptr);
+            }
+        }
+
+    } else if (zobj->encoding == REDIS_ENCODING_SKIPLIST) {
+        zset* zs = zobj->ptr;
+        zskiplist* zsl = zs->zsl;
+        zskiplistNode* zn;
+        unsigned long rank;
+
+        // 通过范围两端元素的排名计算数量
+        zn = zslFirstInLexRange(zsl, &range);
+        if (zn != NULL) {
+            rank = zslGetRank(zsl, zn->score, zn->obj);
+            count = zsl->length - (rank - 1);
+
+            zn = zslLastInLexRange(zsl, &range);
+            if (zn != NULL) {
+                rank = zslGetRank(zsl, zn->score, zn->obj);
+                count -= (zsl->length - rank);
+            }
+        }
+
+    } else if (zobj->encoding == REDIS_ENCODING_BTREE) {
+        zset* zs = zobj->ptr;
+
+        count = zbtCountInLexRange(zs->zbt, &range);
+
+    } else {
+        exit(1);
+    }
+
+    zslFreeLexRange(&range);
+
+    addReplyLongLong(c, count);
+}
+
+/*
+ * ZRANGEBYLEX，ZREVRANGEBYLEX命令底层实现
+ */
+void genericZrangebylexCommand(redisClient* c, int reverse) {
+    zlexrangespec range;
+    robj* key = c->argv[1];
+    robj* zobj;
+    long offset = 0;
+    long limit = -1;
+    unsigned long rangelen = 0;
+    void* replylen = NULL;
+    int minidx, maxidx;
+
+    if (reverse) {
+        maxidx = 2; minidx = 3;
+    } else {
+        minidx = 2; maxidx = 3;
+    }
+
+    if (zslParseLexRange(c->argv[minidx], c->argv[maxidx], &range) != REDIS_OK) {
+        addReplyError(c, "min or max not valid string range item");
+        return;
+    }
+
+    if (zrangeParseOptions(c, 4, NULL, &offset, &limit) != REDIS_OK ||
+        (zobj = lookupKeyReadOrReply(c, key, shared.emptymultibulk)) == NULL || checkType(c, zobj, REDIS_ZSET)) {
+        zslFreeLexRange(&range);
+        return;
+    }
+
+    if (offset < 0) {
+        zslFreeLexRange(&range);
+        addReply(c, shared.emptymultibulk);
+        return;
+    }
+
+    if (zobj->encoding == REDIS_ENCODING_LISTPACK) {
+        unsigned char* zl = zobj->ptr;
+        unsigned char* eptr;
+        unsigned char* sptr;
+        unsigned char* vstr;
+        unsigned int vlen;
+        long long vlong;
+
+        if (reverse)
+            eptr = zzlLastInLexRange(zl, &range);
+        else
+            eptr = zzlFirstInLexRange(zl, &range);
+
+        if (eptr == NULL) {
+            addReply(c, shared.emptymultibulk);
+            zslFreeLexRange(&range);
+            return;
+        }
+
+        sptr = lpNext(zl, eptr);
+        assert(sptr != NULL);
+
+        replylen = addDeferredMultiBulkLength(c);
+
+        while (eptr && offset--) {
+            if (reverse)
+                zzlPrev(zl, &eptr, &sptr);
+            else
+                zzlNext(zl, &eptr, &sptr);
+        }
+
+        while (eptr && limit--) {
+            if (reverse) {
+                if (!zzlLexValueGteMin(eptr, &range)) break;
+            } else {
+                if (!zzlLexValueLteMax(eptr, &range)) break;
+            }
+
+            assert(lpGet(eptr, &vstr, &vlen, &vlong));
+
+            rangelen++;
+            if (vstr == NULL)
+                addReplyBulkLongLong(c, vlong);
+            else
+                addReplyBulkCBuffer(c, vstr, vlen);
+
+            if (reverse)
+                zzlPrev(zl, &eptr, &sptr);
+            else
+                zzlNext(zl, &eptr, &sptr);
+        }
+
+    } else if (zobj->encoding == REDIS_ENCODING_SKIPLIST) {
+        zset* zs = zobj->ptr;
+        zskiplist* zsl = zs->zsl;
+        zskiplistNode* ln;
+
+        if (reverse)
+            ln = zslLastInLexRange(zsl, &range);
+        else
+            ln = zslFirstInLexRange(zsl, &range);
+
+        if (ln == NULL) {
+            addReply(c, shared.emptymultibulk);
+            zslFreeLexRange(&range);
+            return;
+        }
+
+        replylen = addDeferredMultiBulkLength(c);
+
+        if (offset > 0) {
+            unsigned long rank = zslGetRank(zsl, ln->score, ln->obj);
+
+            if (reverse)
+                ln = ((unsigned long) offset < rank) ? zslGetElementByRank(zsl, rank - offset) : NULL;
+            else
+                ln = (rank + offset <= zsl->length) ? zslGetElementByRank(zsl, rank + offset) : NULL;
+        }
+
+        while (ln && limit--) {
+            if (reverse) {
+                if (!zslLexValueGteMin(ln->obj, &range)) break;
+            } else {
+                if (!zslLexValueLteMax(ln->obj, &range)) break;
+            }
+
+            rangelen++;
+            addReplyBulkCopy(c, ln->obj);
+
+            ln = reverse ? ln->backward : ln->level[0].forward;
+        }
+
+    } else if (zobj->encoding == REDIS_ENCODING_BTREE) {
+        zset* zs = zobj->ptr;
+        zbtreePos pos;
+        unsigned long rank;
+        int found;
+
+        if (reverse)
+            rank = zbtLastInLexRange(zs->zbt, &range, &pos);
+        else
+            rank = zbtFirstInLexRange(zs->zbt, &range, &pos);
+
+        if (rank == 0) {
+            addReply(c, shared.emptymultibulk);
+            zslFreeLexRange(&range);
+            return;
+        }
+
+        replylen = addDeferredMultiBulkLength(c);
+
+        found = 1;
+        if (offset > 0) {
+            if (reverse)
+                found = (unsigned long) offset < rank && zbtGetElementByRank(zs->zbt, rank - offset, &pos);
+            else
+                found = zbtGetElementByRank(zs->zbt, rank + offset, &pos);
+        }
+
+        while (found && limit--) {
+            if (reverse) {
+                if (!zslLexValueGteMin(zbtPosObj(&pos), &range)) break;
+            } else {
+                if (!zslLexValueLteMax(zbtPosObj(&pos), &range)) break;
+            }
+
+            rangelen++;
+            addReplyBulkCopy(c, zbtPosObj(&pos));
+
+            found = reverse ? zbtPrev(&pos) : zbtNext(&pos);
+        }
+
+    } else {
+        exit(1);
+    }
+
+    zslFreeLexRange(&range);
+    setDeferredMultiBulkLength(c, replylen, rangelen);
+}
+
+/*
+ * ZRANGEBYLEX命令
+ *
+ * ZRANGEBYLEX key min max [LIMIT offset count]
+ */
+void zrangebylexCommand(redisClient* c) {
+    genericZrangebylexCommand(c, 0);
+}
+
+/*
+ * ZREVRANGEBYLEX命令
+ *
+ * ZREVRANGEBYLEX key max min [LIMIT offset count]
+ */
+void zrevrangebylexCommand(redisClient* c) {
+    genericZrangebylexCommand(c, 1);
+}
+
+#define REDIS_AGGR_SUM 1
+#define REDIS_AGGR_MIN 2
+#define REDIS_AGGR_MAX 3
+
+/*
+ * 初始化输入迭代器
+ */
+void zuiInitIterator(zsetopsrc* op) {
+    robj* o = op->subject;
+
+    if (o == NULL) return;
+
+    if (o->type == REDIS_SET) {
+        op->si = setTypeInitIterator(o);
+    } else if (o->encoding == REDIS_ENCODING_LISTPACK) {
+        op->eptr = lpIndex(o->ptr, 0);
+        op->sptr = op->eptr ? lpNext(o->ptr, op->eptr) : NULL;
+    } else if (o->encoding == REDIS_ENCODING_SKIPLIST) {
+        op->node = ((zset*) o->ptr)->zsl->header->level[0].forward;
+    } else if (o->encoding == REDIS_ENCODING_BTREE) {
+        op->valid = zbtGetElementByRank(((zset*) o->ptr)->zbt, 1, &op->pos);
+    } else {
+        exit(1);
+    }
+}
+
+/*
+ * 释放输入迭代器
+ */
+void zuiClearIterator(zsetopsrc* op) {
+    if (op->subject != NULL && op->subject->type == REDIS_SET) setTypeReleaseIterator(op->si);
+}
+
+/*
+ * 返回输入中的元素数量，不存在的键视为空集合
+ */
+unsigned long zuiLength(zsetopsrc* op) {
+    if (op->subject == NULL) return 0;
+    if (op->subject->type == REDIS_SET) return setTypeSize(op->subject);
+    return zsetLength(op->subject);
+}
+
+/*
+ * 取出下一个元素和分值，*ele保存一个新的引用，调用者使用完后需要decrRefCount，
+ * 没有更多元素时返回0
+ */
+int zuiNext(zsetopsrc* op, robj** ele, double* score) {
+    robj* o = op->subject;
+
+    if (o == NULL) return 0;
+
+    if (o->type == REDIS_SET) {
+        if ((*ele = setTypeNextObject(op->si)) == NULL) return 0;
+        *score = 1.0;
+    } else if (o->encoding == REDIS_ENCODING_LISTPACK) {
+        if (op->eptr == NULL) return 0;
+        *ele = lpGetObject(op->eptr);
+        *score = zzlGetScore(op->sptr);
+        zzlNext(o->ptr, &op->eptr, &op->sptr);
+    } else if (o->encoding == REDIS_ENCODING_SKIPLIST) {
+        if (op->node == NULL) return 0;
+        *ele = op->node->obj;
+        incrRefCount(*ele);
+        *score = op->node->score;
+        op->node = op->node->level[0].forward;
+    } else if (o->encoding == REDIS_ENCODING_BTREE) {
+        if (!op->valid) return 0;
+        *ele = zbtPosObj(&op->pos);
+        incrRefCount(*ele);
+        *score = zbtPosScore(&op->pos);
+        op->valid = zbtNext(&op->pos);
+    } else {
+        exit(1);
+    }
+
+    return 1;
+}
+
+/*
+ * 在输入中查找元素ele，找到时将分值保存在*score中并返回1
+ */
+int zuiFind(zsetopsrc* op, robj* ele, double* score) {
+    robj* o = op->subject;
+
+    if (o == NULL) return 0;
+
+    if (o->type == REDIS_SET) {
+        if (!setTypeIsMember(o, ele)) return 0;
+        *score = 1.0;
+        return 1;
+    } else if (o->encoding == REDIS_ENCODING_LISTPACK) {
+        return zzlFind(o->ptr, ele, score) != NULL;
+    } else if (o->encoding == REDIS_ENCODING_SKIPLIST) {
+        dictEntry* de = dictFind(((zset*) o->ptr)->dict, ele);
+
+        if (de == NULL) return 0;
+        *score = *(double*) dictGetVal(de);
+        return 1;
+    } else if (o->encoding == REDIS_ENCODING_BTREE) {
+        dictEntry* de = dictFind(((zset*) o->ptr)->dict, ele);
+
+        if (de == NULL) return 0;
+        *score = dictGetDoubleVal(de);
+        return 1;
+    } else {
+        exit(1);
+    }
+}
+
+/*
+ * 按照aggregate指定的方式将分值val合并到*target
+ */
+static void zunionInterAggregate(double* target, double val, int aggregate) {
+    if (aggregate == REDIS_AGGR_SUM) {
+        *target = *target + val;
+        /* The result of adding two doubles is NaN when one variable
+         * is +inf and the other is -inf. When these numbers are added,
+         * we maintain the convention of the result being 0.0. */
+        if (isnan(*target)) *target = 0.0;
+    } else if (aggregate == REDIS_AGGR_MIN) {
+        *target = val < *target ? val : *target;
+    } else if (aggregate == REDIS_AGGR_MAX) {
+        *target = val > *target ? val : *target;
+    } else {
+        exit(1);
+    }
+}
+
+/*
+ * 计算结果中的一个元素
+ */
+typedef struct {
+
+    robj* ele;
+
+    double score;
+
+} zsetopval;
+
+static int zsetopvalCompare(const void* a, const void* b) {
+    const zsetopval* va = a;
+    const zsetopval* vb = b;
+
+    if (va->score < vb->score) return -1;
+    if (va->score > vb->score) return 1;
+    return compareStringObjects(va->ele, vb->ele);
+}
+
+/*
+ * 用排好序的结果创建有序集合对象，
+ * 结果较小时直接按顺序追加到listpack中，不需要先创建跳跃表和字典再转换
+ */
+static robj* zsetCreateFromSorted(zsetopval* vals, unsigned long count, size_t maxelelen) {
+    robj* zobj;
+    unsigned long j;
+
+    if (count <= server.zset_max_ziplist_entries && maxelelen <= server.zset_max_ziplist_value) {
+        unsigned char* zl;
+
+        zobj = createZsetListpackObject();
+        zl = zobj->ptr;
+        for (j = 0; j < count; j++) {
+            robj* ele = getDecodedObject(vals[j].ele);
+
+            zl = zzlInsertAt(zl, NULL, ele, vals[j].score);
+            decrRefCount(ele);
+        }
+        zobj->ptr = zl;
+    } else {
+        zset* zs;
+
+        zobj = createZsetObject();
+        zs = zobj->ptr;
+        for (j = 0; j < count; j++) {
+            // 成员可能来自源集合或者源有序集合，保存副本，结果独占自己的元素
+            robj* ele = dupStringObject(vals[j].ele);
+            zskiplistNode* node = zslInsert(zs->zsl, vals[j].score, ele);
+
+            assert(dictAdd(zs->dict, ele, &node->score) == DICT_OK);
+            incrRefCount(ele);
+        }
+
+        if (count > server.zset_max_skiplist_entries)
+            zsetConvert(zobj, REDIS_ENCODING_BTREE);
+    }
+
+    return zobj;
+}
+
+/*
+ * ZUNIONSTORE，ZINTERSTORE命令底层实现
+ *
+ * 交集以最小的输入为基础，逐个在其他输入中查找；
+ * 并集使用一个临时字典合并相同的元素，结果排序后一次性创建目标有序集合
+ */
+void zunionInterGenericCommand(redisClient* c, robj* dstkey, int op) {
+    int i, j;
+    long setnum;
+    int aggregate = REDIS_AGGR_SUM;
+    zsetopsrc* src;
+    zsetopval* vals = NULL;
+    unsigned long count = 0;
+    unsigned long capacity = 0;
+    size_t maxelelen = 0;
+    dict* accumulator = NULL;
+    robj* ele;
+    double score;
+
+    /* expect setnum input keys to be given */
+    if ((getLongFromObjectOrReply(c, c->argv[2], &setnum, NULL) != REDIS_OK))
+        return;
+
+    if (setnum < 1) {
+        addReplyError(c, "at least 1 input key is needed for ZUNIONSTORE/ZINTERSTORE");
+        return;
+    }
+
+    /* test if the expected number of keys would overflow */
+    if (setnum > c->argc - 3) {
+        addReply(c, shared.syntaxerr);
+        return;
+    }
+
+    /* read keys to be used for input */
+    src = zcalloc(sizeof(zsetopsrc) * setnum);
+    for (i = 0, j = 3; i < setnum; i++, j++) {
+        robj* obj = lookupKeyWrite(c->db, c->argv[j]);
+
+        if (obj != NULL && obj->type != REDIS_ZSET && obj->type != REDIS_SET) {
+            zfree(src);
+            addReply(c, shared.wrongtypeerr);
+            return;
+        }
+
+        src[i].subject = obj;
+        /* Default all weights to 1. */
+        src[i].weight = 1.0;
+    }
+
+    /* parse optional extra arguments */
+    if (j < c->argc) {
+        int remaining = c->argc - j;
+
+        while (remaining) {
+            if (remaining >= (setnum + 1) && !strcasecmp(c->argv[j]->ptr, "weights")) {
+                j++; remaining--;
+                for (i = 0; i < setnum; i++, j++, remaining--) {
+                    if (getDoubleFromObjectOrReply(c, c->argv[j], &src[i].weight,
+                            "weight value is not a float") != REDIS_OK) {
+                        zfree(src);
+                        return;
+                    }
+                }
+            } else if (remaining >= 2 && !strcasecmp(c->argv[j]->ptr, "aggregate")) {
+                j++; remaining--;
+                if (!strcasecmp(c->argv[j]->ptr, "sum")) {
+                    aggregate = REDIS_AGGR_SUM;
+                } else if (!strcasecmp(c->argv[j]->ptr, "min")) {
+                    aggregate = REDIS_AGGR_MIN;
+                } else if (!strcasecmp(c->argv[j]->ptr, "max")) {
+                    aggregate = REDIS_AGGR_MAX;
+                } else {
+                    zfree(src);
+                    addReply(c, shared.syntaxerr);
+                    return;
+                }
+                j++; remaining--;
+            } else {
+                zfree(src);
+                addReply(c, shared.syntaxerr);
+                return;
+            }
+        }
+    }
+
+    if (op == REDIS_OP_INTER) {
+        zsetopsrc tmp;
+        int smallest = 0;
+
+        // 交集从最小的输入开始，只需要遍历这一个输入
+        for (i = 1; i < setnum; i++)
+            if (zuiLength(&src[i]) < zuiLength(&src[smallest])) smallest = i;
+        tmp = src[0];
+        src[0] = src[smallest];
+        src[smallest] = tmp;
+
+        if (zuiLength(&src[0]) > 0) {
+            capacity = zuiLength(&src[0]);
+            vals = zmalloc(sizeof(zsetopval) * capacity);
+
+            zuiInitIterator(&src[0]);
+            while (zuiNext(&src[0], &ele, &score)) {
+                double orig = score;
+                double value;
+
+                score = src[0].weight * score;
+                if (isnan(score)) score = 0;
+
+                for (i = 1; i < setnum; i++) {
+                    // 同一个键出现多次时直接使用当前分值，
+                    // 迭代集合时在同一个字典中查找可能触发rehash，使迭代器失效
+                    if (src[i].subject == src[0].subject) {
+                        value = orig;
+                    } else if (!zuiFind(&src[i], ele, &value)) {
+                        break;
+                    }
+
+                    value = src[i].weight * value;
+                    if (isnan(value)) value = 0;
+                    zunionInterAggregate(&score, value, aggregate);
+                }
+
+                // 只有所有输入中都存在的元素才添加到结果中
+                if (i == setnum) {
+                    vals[count].ele = ele;
+                    vals[count].score = score;
+                    count++;
+                    if (stringObjectLen(ele) > maxelelen) maxelelen = stringObjectLen(ele);
+                } else {
+                    decrRefCount(ele);
+                }
+            }
+            zuiClearIterator(&src[0]);
+        }
+
+    } else if (op == REDIS_OP_UNION) {
+        // 临时字典中保存元素在vals数组中的下标
+        accumulator = dictCreate(&zsetDictType, NULL);
+
+        for (i = 0; i < setnum; i++) {
+            if (zuiLength(&src[i]) == 0) continue;
+
+            zuiInitIterator(&src[i]);
+            while (zuiNext(&src[i], &ele, &score)) {
+                dictEntry* de;
+
+                score = src[i].weight * score;
+                if (isnan(score)) score = 0;
+
+                if ((de = dictFind(accumulator, ele)) != NULL) {
+                    zunionInterAggregate(&vals[dictGetSignedIntegerVal(de)].score, score, aggregate);
+                    decrRefCount(ele);
+                    continue;
+                }
+
+                if (count == capacity) {
+                    capacity = capacity ? capacity * 2 : 16;
+                    vals = zrealloc(vals, sizeof(zsetopval) * capacity);
+                }
+
+                // 字典中的键持有元素对象的另一个引用，释放字典时一起释放
+                incrRefCount(ele);
+                de = dictAddRaw(accumulator, ele);
+                dictSetSignedIntegerVal(de, count);
+                vals[count].ele = ele;
+                vals[count].score = score;
+                count++;
+                if (stringObjectLen(ele) > maxelelen) maxelelen = stringObjectLen(ele);
+            }
+            zuiClearIterator(&src[i]);
+        }
+
+    } else {
+        exit(1);
+    }
+
+    if (dbDelete(c->db, dstkey)) server.dirty++;
+
+    if (count) {
+        robj* dstobj;
+
+        qsort(vals, count, sizeof(zsetopval), zsetopvalCompare);
+        dstobj = zsetCreateFromSorted(vals, count, maxelelen);
+        dbAdd(c->db, dstkey, dstobj);
+        server.dirty++;
+    }
+
+    signalModifiedKey(c->db, dstkey);
+    addReplyLongLong(c, count);
+
+    if (accumulator) dictRelease(accumulator);
+    for (i = 0; (unsigned long) i < count; i++) decrRefCount(vals[i].ele);
+    zfree(vals);
+    zfree(src);
+}
+
+/*
+ * ZUNIONSTORE命令
+ *
+ * ZUNIONSTORE destination numkeys key [key ...] [WEIGHTS weight [weight ...]] [AGGREGATE SUM|MIN|MAX]
+ */
+void zunionstoreCommand(redisClient* c) {
+    zunionInterGenericCommand(c, c->argv[1], REDIS_OP_UNION);
+}
+
+/*
+ * ZINTERSTORE命令
+ *
+ * ZINTERSTORE destination numkeys key [key ...] [WEIGHTS weight [weight ...]] [AGGREGATE SUM|MIN|MAX]
+ */
+void zinterstoreCommand(redisClient* c) {
+    zunionInterGenericCommand(c, c->argv[1], REDIS_OP_INTER);
 }
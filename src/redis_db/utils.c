@@ -2,6 +2,8 @@
 // Created by zouyi on 2021/9/1.
 //
 
+#define _GNU_SOURCE
+
 #include <limits.h>
 #include <string.h>
 #include <stdio.h>
@@ -11,8 +13,11 @@
 #include <ctype.h>
 #include <unistd.h>
 #include <float.h>
+#include <errno.h>
+#include <strings.h>
 
 #include "utils.h"
+#include "zmalloc.h"
 
 /*
  * 通配符模式匹配，nocase为1则忽略大小写
@@ -150,6 +155,409 @@ int stringmatch(const char *pattern, const char *string, int nocase) {
     return stringmatchlen(pattern,strlen(pattern),string,strlen(string),nocase);
 }
 
+/*
+ * 编译后的通配符模式
+ *
+ * stringmatchlen每匹配一个字符串都要重新解析一次模式，并且'*'会递归回溯，
+ * 对大量字符串使用同一个模式时(KEYS，SCAN MATCH)，先将模式编译为stringmatcher：
+ * 1) 只由字面量和'*'组成的常见模式，直接比较前缀/后缀，或者使用memmem查找；
+ * 2) 其他模式去掉首尾的字面量后，将剩余部分编译为位并行的NFA，
+ *    每个字符只需要几次位运算，没有回溯；
+ * 3) 模式单元超过64个时，使用不递归的迭代回溯算法
+ */
+
+#define STRINGMATCH_TOKEN_STAR 0
+#define STRINGMATCH_TOKEN_CHARSET 1
+
+/*
+ * 模式单元: '*'，或者可以匹配单个字符的字符集合('?'，'[...]'，字面量)
+ */
+typedef struct stringmatchToken {
+
+    int type;
+
+    // 字面量字符，不是字面量时为-1
+    int literal;
+
+    // 可以匹配的字符集合，位图
+    uint64_t set[4];
+
+} stringmatchToken;
+
+#define stringmatchSetAdd(t, c) ((t)->set[(unsigned char)(c) >> 6] |= (uint64_t)1 << ((unsigned char)(c) & 63))
+#define stringmatchSetHas(t, c) (((t)->set[(unsigned char)(c) >> 6] >> ((unsigned char)(c) & 63)) & 1)
+
+/*
+ * 将字面量字符c加入到模式单元t的字符集合中
+ */
+static void stringmatchAddLiteral(stringmatchToken* t, int c, int nocase) {
+
+    int x;
+
+    if (!nocase) {
+        stringmatchSetAdd(t, c);
+        return;
+    }
+
+    for (x = 0; x < 256; x++)
+        if (tolower(x) == tolower((unsigned char)c)) stringmatchSetAdd(t, x);
+}
+
+/*
+ * 将模式p解析为模式单元数组，连续的'*'合并为一个，返回模式单元数量，
+ * 解析规则与stringmatchlen保持一致
+ */
+static int stringmatchParse(const char* p, int plen, int nocase, stringmatchToken** tokens) {
+
+    stringmatchToken* toks = zmalloc(sizeof(stringmatchToken) * (plen + 1));
+    int n = 0;
+    int i = 0;
+
+    while (i < plen) {
+        stringmatchToken* t = toks + n;
+
+        memset(t, 0, sizeof(*t));
+        t->type = STRINGMATCH_TOKEN_CHARSET;
+        t->literal = -1;
+
+        if (p[i] == '*') {
+            i++;
+            if (n > 0 && toks[n - 1].type == STRINGMATCH_TOKEN_STAR) continue;
+            t->type = STRINGMATCH_TOKEN_STAR;
+        } else if (p[i] == '?') {
+            i++;
+            memset(t->set, 0xff, sizeof(t->set));
+        } else if (p[i] == '[') {
+            int not, x;
+
+            i++;
+            not = (i < plen && p[i] == '^');
+            if (not) i++;
+
+            while (1) {
+                if (i < plen && p[i] == '\\') {
+                    // 字符集合中的转义字符总是区分大小写
+                    i++;
+                    if (i >= plen) break;
+                    stringmatchSetAdd(t, p[i]);
+                    i++;
+                } else if (i < plen && p[i] == ']') {
+                    i++;
+                    break;
+                } else if (i >= plen) {
+                    // 没有闭合的']'，字符集合一直延续到模式末尾
+                    break;
+                } else if (plen - i >= 3 && p[i + 1] == '-') {
+                    int start = p[i];
+                    int end = p[i + 2];
+
+                    if (start > end) {
+                        int tmp = start;
+                        start = end;
+                        end = tmp;
+                    }
+                    if (nocase) {
+                        start = tolower(start);
+                        end = tolower(end);
+                    }
+                    for (x = 0; x < 256; x++) {
+                        int c = (char)x;
+                        if (nocase) c = tolower(c);
+                        if (c >= start && c <= end) stringmatchSetAdd(t, x);
+                    }
+                    i += 3;
+                } else {
+                    stringmatchAddLiteral(t, p[i], nocase);
+                    i++;
+                }
+            }
+
+            if (not) {
+                for (x = 0; x < 4; x++) t->set[x] = ~t->set[x];
+            }
+        } else {
+            if (p[i] == '\\' && plen - i >= 2) i++;
+            t->literal = (unsigned char)p[i];
+            stringmatchAddLiteral(t, p[i], nocase);
+            i++;
+        }
+
+        n++;
+    }
+
+    *tokens = toks;
+
+    return n;
+}
+
+/*
+ * 将模式单元数组中[start, end)范围的字面量拼接成sds
+ */
+static sds stringmatchLiterals(stringmatchToken* toks, int start, int end) {
+
+    sds s = sdsempty();
+    int j;
+
+    for (j = start; j < end; j++) {
+        char c = toks[j].literal;
+        s = sdscatlen(s, &c, 1);
+    }
+
+    return s;
+}
+
+/*
+ * 编译模式p，返回匹配器，nocase为1则忽略大小写
+ */
+stringmatcher* stringmatcherNew(const char* p, int plen, int nocase) {
+
+    stringmatcher* m = zmalloc(sizeof(*m));
+    stringmatchToken* toks;
+    int n, j, first, last;
+    int stars = 0;
+
+    m->pattern = sdsnewlen(p, plen);
+    m->nocase = nocase;
+    m->prefix = NULL;
+    m->suffix = NULL;
+    m->middle = NULL;
+    m->ntokens = 0;
+    m->tokens = NULL;
+    m->masks = NULL;
+    m->starmask = 0;
+
+    n = stringmatchParse(p, plen, nocase, &toks);
+
+    // 首尾的字面量，忽略大小写时不提取
+    first = 0;
+    last = n;
+    if (!nocase) {
+        while (first < n && toks[first].literal != -1) first++;
+        while (last > first && toks[last - 1].literal != -1) last--;
+    }
+    m->prefix = stringmatchLiterals(toks, 0, first);
+    m->suffix = stringmatchLiterals(toks, last, n);
+
+    for (j = first; j < last; j++)
+        if (toks[j].type == STRINGMATCH_TOKEN_STAR) stars++;
+
+    m->type = -1;
+    if (!nocase && first == n) {
+        // 整个模式都是字面量
+        m->type = STRINGMATCH_EXACT;
+    } else if (!nocase && last - first == 1 && stars == 1) {
+        // prefix*suffix，前缀和后缀都可能为空
+        if (first == 0 && last == n)
+            m->type = STRINGMATCH_ALL;
+        else if (last == n)
+            m->type = STRINGMATCH_PREFIX;
+        else if (first == 0)
+            m->type = STRINGMATCH_SUFFIX;
+        else
+            m->type = STRINGMATCH_PREFIX_SUFFIX;
+    } else if (!nocase && first == 0 && last == n && stars == 2 &&
+               toks[0].type == STRINGMATCH_TOKEN_STAR && toks[n - 1].type == STRINGMATCH_TOKEN_STAR) {
+        // *middle*，中间只有字面量时使用memmem
+        for (j = 1; j < n - 1; j++)
+            if (toks[j].literal == -1) break;
+        if (j == n - 1) {
+            m->type = STRINGMATCH_CONTAINS;
+            m->middle = stringmatchLiterals(toks, 1, n - 1);
+        }
+    }
+
+    if (m->type == -1) {
+        m->ntokens = last - first;
+
+        if (m->ntokens <= STRINGMATCH_NFA_MAX_TOKENS) {
+            // 构造位并行NFA，状态j表示已经匹配了前j个模式单元
+            int c;
+
+            m->type = STRINGMATCH_NFA;
+            m->masks = zcalloc(sizeof(uint64_t) * 256);
+            for (j = 0; j < m->ntokens; j++) {
+                stringmatchToken* t = toks + first + j;
+
+                if (t->type == STRINGMATCH_TOKEN_STAR) {
+                    m->starmask |= (uint64_t)1 << j;
+                } else {
+                    for (c = 0; c < 256; c++)
+                        if (stringmatchSetHas(t, c)) m->masks[c] |= (uint64_t)1 << (j + 1);
+                }
+            }
+        } else {
+            m->type = STRINGMATCH_BACKTRACK;
+            m->tokens = zmalloc(sizeof(stringmatchToken) * m->ntokens);
+            memcpy(m->tokens, toks + first, sizeof(stringmatchToken) * m->ntokens);
+        }
+    }
+
+    zfree(toks);
+
+    return m;
+}
+
+/*
+ * 使用位并行NFA匹配字符串s
+ */
+static int stringmatchNFA(stringmatcher* m, const unsigned char* s, int slen) {
+
+    uint64_t star = m->starmask;
+    uint64_t d = 1;
+    int j;
+
+    // '*'可以匹配空串，连续的'*'已经合并，闭包只需要传播一步
+    d |= (d & star) << 1;
+
+    for (j = 0; j < slen; j++) {
+        // 前进一个模式单元，或者停留在'*'上
+        d = ((d << 1) & m->masks[s[j]]) | (d & star);
+        d |= (d & star) << 1;
+        if (d == 0) return 0;
+    }
+
+    return (d >> m->ntokens) & 1;
+}
+
+/*
+ * 使用迭代回溯匹配字符串s，只需要回溯到最近的一个'*'，不会递归
+ */
+static int stringmatchBacktrack(stringmatcher* m, const unsigned char* s, int slen) {
+
+    stringmatchToken* toks = m->tokens;
+    int n = m->ntokens;
+    int si = 0, ti = 0;
+    int star_ti = -1, star_si = 0;
+
+    while (si < slen) {
+        if (ti < n && toks[ti].type == STRINGMATCH_TOKEN_STAR) {
+            star_ti = ti++;
+            star_si = si;
+        } else if (ti < n && stringmatchSetHas(toks + ti, s[si])) {
+            ti++;
+            si++;
+        } else if (star_ti != -1) {
+            ti = star_ti + 1;
+            si = ++star_si;
+        } else {
+            return 0;
+        }
+    }
+
+    while (ti < n && toks[ti].type == STRINGMATCH_TOKEN_STAR) ti++;
+
+    return ti == n;
+}
+
+/*
+ * 检查字符串s是否与编译后的模式匹配，匹配返回1，否则返回0
+ */
+int stringmatcherMatch(stringmatcher* m, const char* s, int slen) {
+
+    size_t plen = sdslen(m->prefix);
+    size_t suflen = sdslen(m->suffix);
+
+    switch (m->type) {
+        case STRINGMATCH_ALL:
+            return 1;
+        case STRINGMATCH_EXACT:
+            return (size_t)slen == plen && memcmp(s, m->prefix, plen) == 0;
+        case STRINGMATCH_CONTAINS:
+            return memmem(s, slen, m->middle, sdslen(m->middle)) != NULL;
+    }
+
+    // 先比较首尾的字面量
+    if ((size_t)slen < plen + suflen) return 0;
+    if (plen && memcmp(s, m->prefix, plen) != 0) return 0;
+    if (suflen && memcmp(s + slen - suflen, m->suffix, suflen) != 0) return 0;
+
+    switch (m->type) {
+        case STRINGMATCH_PREFIX:
+        case STRINGMATCH_SUFFIX:
+        case STRINGMATCH_PREFIX_SUFFIX:
+            return 1;
+        case STRINGMATCH_NFA:
+            return stringmatchNFA(m, (const unsigned char*)s + plen, slen - plen - suflen);
+        default:
+            return stringmatchBacktrack(m, (const unsigned char*)s + plen, slen - plen - suflen);
+    }
+}
+
+/*
+ * 释放编译后的模式
+ */
+void stringmatcherFree(stringmatcher* m) {
+
+    if (m == NULL) return;
+
+    sdsfree(m->pattern);
+    sdsfree(m->prefix);
+    sdsfree(m->suffix);
+    sdsfree(m->middle);
+    zfree(m->tokens);
+    zfree(m->masks);
+    zfree(m);
+}
+
+/*
+ * 将带单位的内存大小字符串(如"1gb"、"100mb"、"512k")转为字节数，
+ * 出错时*err被设置为1(如果err不为NULL)
+ */
+/* Convert a string representing an amount of memory into the number of
+ * bytes, so for instance memtoll("1Gb") will return 1073741824 that is
+ * (1024*1024*1024). */
+long long memtoll(const char *p, int *err) {
+    const char *u;
+    char buf[128];
+    long mul; /* unit multiplier */
+    long long val;
+    unsigned int digits;
+
+    if (err) *err = 0;
+
+    /* Search the first non digit character. */
+    u = p;
+    if (*u == '-') u++;
+    while(*u && isdigit(*u)) u++;
+    if (*u == '\0' || !strcasecmp(u,"b")) {
+        mul = 1;
+    } else if (!strcasecmp(u,"k")) {
+        mul = 1000;
+    } else if (!strcasecmp(u,"kb")) {
+        mul = 1024;
+    } else if (!strcasecmp(u,"m")) {
+        mul = 1000*1000;
+    } else if (!strcasecmp(u,"mb")) {
+        mul = 1024*1024;
+    } else if (!strcasecmp(u,"g")) {
+        mul = 1000L*1000*1000;
+    } else if (!strcasecmp(u,"gb")) {
+        mul = 1024L*1024*1024;
+    } else {
+        if (err) *err = 1;
+        return 0;
+    }
+
+    /* Copy the digits into a buffer, we'll use strtoll() to convert
+     * the digit (without the unit) into a number. */
+    digits = u-p;
+    if (digits == 0 || digits >= sizeof(buf)) {
+        if (err) *err = 1;
+        return 0;
+    }
+    memcpy(buf,p,digits);
+    buf[digits] = '\0';
+
+    char *endptr;
+    errno = 0;
+    val = strtoll(buf,&endptr,10);
+    if ((val == 0 && errno == EINVAL) || *endptr != '\0') {
+        if (err) *err = 1;
+        return 0;
+    }
+    return val*mul;
+}
+
 /*
  * 将long long转为string，返回字符串表示该long long数值需要的字符数，
  * 结果存放在缓冲区s中，len指示了缓冲区大小
@@ -269,6 +677,35 @@ int string2l(const char *s, size_t slen, long *lval) {
     return 1;
 }
 
+/*
+ * 将string转为long double，
+ * 字符串必须整体是一个合法的数值(不允许前导空格，不允许NaN)，成功返回1；否则返回0；
+ */
+/* Convert a string into a long double. Returns 1 if the string could be parsed
+ * into a (non-overflowing) long double, 0 otherwise. The value will be set to
+ * the parsed value when appropriate. */
+int string2ld(const char *s, size_t slen, long double *dp) {
+    char buf[MAX_LONG_DOUBLE_CHARS];
+    long double value;
+    char *eptr;
+
+    if (slen == 0 || slen >= sizeof(buf)) return 0;
+    memcpy(buf,s,slen);
+    buf[slen] = '\0';
+
+    errno = 0;
+    value = strtold(buf, &eptr);
+    if (isspace(buf[0]) || eptr[0] != '\0' ||
+        (errno == ERANGE &&
+            (value == HUGE_VAL || value == -HUGE_VAL || value == 0)) ||
+        errno == EINVAL ||
+        isnan(value))
+        return 0;
+
+    if (dp) *dp = value;
+    return 1;
+}
+
 /*
  * 将double转为string，返回字符串表示该double数值需要的字符数
  */
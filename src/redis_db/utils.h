@@ -5,13 +5,77 @@
 #ifndef TINYREDIS_UTILS_H
 #define TINYREDIS_UTILS_H
 
+#include <stdint.h>
 #include "sds.h"
 
+/* string2ld能够解析的long double字符串的最大长度 */
+#define MAX_LONG_DOUBLE_CHARS 5*1024
+
+/*
+ * 编译后的通配符模式的匹配方式
+ */
+#define STRINGMATCH_ALL 0           /* "*"，匹配任意字符串 */
+#define STRINGMATCH_EXACT 1         /* 不含通配符，整体比较 */
+#define STRINGMATCH_PREFIX 2        /* "prefix*" */
+#define STRINGMATCH_SUFFIX 3        /* "*suffix" */
+#define STRINGMATCH_PREFIX_SUFFIX 4 /* "prefix*suffix" */
+#define STRINGMATCH_CONTAINS 5      /* "*middle*"，使用memmem查找 */
+#define STRINGMATCH_NFA 6           /* 一般情况，位并行的NFA模拟 */
+#define STRINGMATCH_BACKTRACK 7     /* 模式过长，迭代回溯 */
+
+/* 位并行NFA最多能表示的模式单元数量 */
+#define STRINGMATCH_NFA_MAX_TOKENS 63
+
+struct stringmatchToken;
+
+/*
+ * 编译后的通配符模式，编译一次，可以对任意多个字符串进行匹配，
+ * 语义与stringmatchlen一致
+ */
+typedef struct stringmatcher {
+
+    // 原始模式，用于判断缓存的匹配器能否复用
+    sds pattern;
+
+    // 匹配方式
+    int type;
+
+    // 是否忽略大小写
+    int nocase;
+
+    // 模式开头的字面量前缀(不忽略大小写时才会提取)
+    sds prefix;
+
+    // 模式末尾的字面量后缀
+    sds suffix;
+
+    // STRINGMATCH_CONTAINS时在中间查找的字面量
+    sds middle;
+
+    // 去掉前缀和后缀之后剩余的模式单元数量
+    int ntokens;
+
+    // 剩余的模式单元，仅STRINGMATCH_BACKTRACK使用
+    struct stringmatchToken* tokens;
+
+    // 位并行NFA: masks[c]的第j+1位表示第j个模式单元可以匹配字符c，
+    // starmask的第j位表示第j个模式单元是'*'
+    uint64_t* masks;
+    uint64_t starmask;
+
+} stringmatcher;
+
+stringmatcher* stringmatcherNew(const char* p, int plen, int nocase);
+int stringmatcherMatch(stringmatcher* m, const char* s, int slen);
+void stringmatcherFree(stringmatcher* m);
+
 int stringmatchlen(const char* p, int plen, const char* s, int slen, int nocase);
 int stringmatch(const char* p, const char* s, int nocase);
+long long memtoll(const char* p, int* err);
 int ll2string(char* s, size_t len, long long value);
 int string2ll(const char* s, size_t slen, long long* value);
 int string2l(const char *s, size_t slen, long *lval);
+int string2ld(const char *s, size_t slen, long double *dp);
 int d2string(char* buf, size_t len, double value);
 
 #endif //TINYREDIS_UTILS_H
@@ -0,0 +1,677 @@
+//
+// Created by zouyi on 2021/11/11.
+//
+
+#include <string.h>
+#include "zbtree.h"
+#include "zmalloc.h"
+#include "redis.h"
+
+/*
+ * 节点元素数量少于这个值时，尝试与相邻节点合并
+ */
+#define ZBTREE_LEAF_MIN (ZBTREE_LEAF_MAX / 4)
+#define ZBTREE_INNER_MIN (ZBTREE_INNER_MAX / 4)
+
+/*
+ * 按照分值、成员的顺序比较两个元素
+ */
+static int zbtCompare(double s1, robj* o1, double s2, robj* o2) {
+    if (s1 < s2) return -1;
+    if (s1 > s2) return 1;
+    return compareStringObjects(o1, o2);
+}
+
+static zbtreeLeaf* zbtCreateLeaf(void) {
+    zbtreeLeaf* leaf = zmalloc(sizeof(zbtreeLeaf));
+
+    leaf->hdr.leaf = 1;
+    leaf->hdr.num = 0;
+    leaf->prev = leaf->next = NULL;
+    return leaf;
+}
+
+static zbtreeInner* zbtCreateInner(void) {
+    zbtreeInner* in = zmalloc(sizeof(zbtreeInner));
+
+    in->hdr.leaf = 0;
+    in->hdr.num = 0;
+    return in;
+}
+
+/*
+ * 创建空的B+树
+ */
+zbtree* zbtCreate(void) {
+    zbtree* zbt = zmalloc(sizeof(zbtree));
+    zbtreeLeaf* leaf = zbtCreateLeaf();
+
+    zbt->root = (zbtreeNode*) leaf;
+    zbt->head = zbt->tail = leaf;
+    zbt->length = 0;
+    return zbt;
+}
+
+/*
+ * 释放子树，减少其中所有成员和下界对象的引用计数
+ */
+static void zbtFreeNode(zbtreeNode* n) {
+    int i;
+
+    if (n->leaf) {
+        zbtreeLeaf* leaf = (zbtreeLeaf*) n;
+
+        for (i = 0; i < n->num; i++) decrRefCount(leaf->eles[i]);
+    } else {
+        zbtreeInner* in = (zbtreeInner*) n;
+
+        for (i = 0; i < n->num; i++) {
+            zbtFreeNode(in->children[i]);
+            if (i > 0) decrRefCount(in->eles[i]);
+        }
+    }
+    zfree(n);
+}
+
+/*
+ * 释放B+树
+ */
+void zbtFree(zbtree* zbt) {
+    zbtFreeNode(zbt->root);
+    zfree(zbt);
+}
+
+/*
+ * 返回子树中的元素数量
+ */
+static unsigned long zbtNodeCount(zbtreeNode* n) {
+    unsigned long count = 0;
+    int i;
+
+    if (n->leaf) return n->num;
+    for (i = 0; i < n->num; i++) count += ((zbtreeInner*) n)->counts[i];
+    return count;
+}
+
+/*
+ * 返回内部节点中(score, obj)所在的子树下标，即下界不大于(score, obj)的最后一个子树
+ */
+static int zbtInnerFind(zbtreeInner* in, double score, robj* obj) {
+    int lo = 1, hi = in->hdr.num - 1, i = 0;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+
+        if (zbtCompare(in->scores[mid], in->eles[mid], score, obj) <= 0) {
+            i = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return i;
+}
+
+/*
+ * 返回叶子节点中第一个不小于(score, obj)的元素下标
+ */
+static int zbtLeafFind(zbtreeLeaf* leaf, double score, robj* obj) {
+    int lo = 0, hi = leaf->hdr.num;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+
+        if (zbtCompare(leaf->scores[mid], leaf->eles[mid], score, obj) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static void zbtLeafInsertAt(zbtreeLeaf* leaf, int pos, double score, robj* obj) {
+    int move = leaf->hdr.num - pos;
+
+    memmove(leaf->scores + pos + 1, leaf->scores + pos, move * sizeof(double));
+    memmove(leaf->eles + pos + 1, leaf->eles + pos, move * sizeof(robj*));
+    leaf->scores[pos] = score;
+    leaf->eles[pos] = obj;
+    leaf->hdr.num++;
+}
+
+/*
+ * 在内部节点的pos处插入子节点child，它的下界是(score, obj)，pos必须大于0
+ */
+static void zbtInnerInsertAt(zbtreeInner* in, int pos, zbtreeNode* child, unsigned long count, double score, robj* obj) {
+    int move = in->hdr.num - pos;
+
+    memmove(in->scores + pos + 1, in->scores + pos, move * sizeof(double));
+    memmove(in->eles + pos + 1, in->eles + pos, move * sizeof(robj*));
+    memmove(in->counts + pos + 1, in->counts + pos, move * sizeof(unsigned long));
+    memmove(in->children + pos + 1, in->children + pos, move * sizeof(zbtreeNode*));
+    in->scores[pos] = score;
+    in->eles[pos] = obj;
+    in->counts[pos] = count;
+    in->children[pos] = child;
+    in->hdr.num++;
+}
+
+/*
+ * 将元素插入以n为根的子树，子树分裂时返回新的右侧节点，并通过sepscore, sepobj返回右侧节点的下界
+ */
+static zbtreeNode* zbtInsertNode(zbtree* zbt, zbtreeNode* n, double score, robj* obj, double* sepscore, robj** sepobj) {
+
+    if (n->leaf) {
+        zbtreeLeaf* leaf = (zbtreeLeaf*) n;
+        zbtreeLeaf* right;
+        int pos = zbtLeafFind(leaf, score, obj);
+        int half;
+
+        if (n->num < ZBTREE_LEAF_MAX) {
+            zbtLeafInsertAt(leaf, pos, score, obj);
+            return NULL;
+        }
+
+        // 叶子节点已满，后一半元素移动到新的叶子节点，
+        // 新元素在表尾时(例如分值递增的插入)原节点保持全满，新节点只保存新元素
+        half = (pos == ZBTREE_LEAF_MAX) ? ZBTREE_LEAF_MAX : ZBTREE_LEAF_MAX / 2;
+        right = zbtCreateLeaf();
+        memcpy(right->scores, leaf->scores + half, (ZBTREE_LEAF_MAX - half) * sizeof(double));
+        memcpy(right->eles, leaf->eles + half, (ZBTREE_LEAF_MAX - half) * sizeof(robj*));
+        right->hdr.num = ZBTREE_LEAF_MAX - half;
+        leaf->hdr.num = half;
+
+        right->prev = leaf;
+        right->next = leaf->next;
+        if (leaf->next)
+            leaf->next->prev = right;
+        else
+            zbt->tail = right;
+        leaf->next = right;
+
+        if (pos < half)
+            zbtLeafInsertAt(leaf, pos, score, obj);
+        else
+            zbtLeafInsertAt(right, pos - half, score, obj);
+
+        *sepscore = right->scores[0];
+        *sepobj = right->eles[0];
+        incrRefCount(*sepobj);
+        return (zbtreeNode*) right;
+    } else {
+        zbtreeInner* in = (zbtreeInner*) n;
+        zbtreeInner* right;
+        zbtreeNode* split;
+        double childscore;
+        robj* childobj;
+        unsigned long childcount;
+        int i = zbtInnerFind(in, score, obj);
+        int half = ZBTREE_INNER_MAX / 2;
+
+        in->counts[i]++;
+        split = zbtInsertNode(zbt, in->children[i], score, obj, &childscore, &childobj);
+        if (split == NULL) return NULL;
+
+        childcount = zbtNodeCount(split);
+        in->counts[i] -= childcount;
+
+        if (n->num < ZBTREE_INNER_MAX) {
+            zbtInnerInsertAt(in, i + 1, split, childcount, childscore, childobj);
+            return NULL;
+        }
+
+        // 内部节点已满并且新子节点在最后，原节点保持全满，新节点只保存新子节点
+        if (i + 1 == ZBTREE_INNER_MAX) {
+            right = zbtCreateInner();
+            right->children[0] = split;
+            right->counts[0] = childcount;
+            right->hdr.num = 1;
+            *sepscore = childscore;
+            *sepobj = childobj;
+            return (zbtreeNode*) right;
+        }
+
+        // 内部节点已满，后一半子节点移动到新的内部节点，第half个子树的下界成为新节点的下界
+        right = zbtCreateInner();
+        memcpy(right->scores, in->scores + half, (ZBTREE_INNER_MAX - half) * sizeof(double));
+        memcpy(right->eles, in->eles + half, (ZBTREE_INNER_MAX - half) * sizeof(robj*));
+        memcpy(right->counts, in->counts + half, (ZBTREE_INNER_MAX - half) * sizeof(unsigned long));
+        memcpy(right->children, in->children + half, (ZBTREE_INNER_MAX - half) * sizeof(zbtreeNode*));
+        right->hdr.num = ZBTREE_INNER_MAX - half;
+        in->hdr.num = half;
+
+        *sepscore = right->scores[0];
+        *sepobj = right->eles[0];
+
+        if (i + 1 <= half)
+            zbtInnerInsertAt(in, i + 1, split, childcount, childscore, childobj);
+        else
+            zbtInnerInsertAt(right, i + 1 - half, split, childcount, childscore, childobj);
+
+        return (zbtreeNode*) right;
+    }
+}
+
+/*
+ * 插入新元素，调用者保证元素不在树中，obj的一个引用交给B+树
+ */
+void zbtInsert(zbtree* zbt, double score, robj* obj) {
+    double sepscore;
+    robj* sepobj;
+    zbtreeNode* split = zbtInsertNode(zbt, zbt->root, score, obj, &sepscore, &sepobj);
+
+    // 根节点分裂，树高度加1
+    if (split) {
+        zbtreeInner* root = zbtCreateInner();
+        zbtreeNode* old = zbt->root;
+
+        root->children[0] = old;
+        root->counts[0] = zbtNodeCount(old);
+        root->hdr.num = 1;
+        zbtInnerInsertAt(root, 1, split, zbtNodeCount(split), sepscore, sepobj);
+        zbt->root = (zbtreeNode*) root;
+    }
+    zbt->length++;
+}
+
+/*
+ * 从内部节点中删除第i个子节点和对应的下界，不释放子节点
+ */
+static void zbtInnerRemoveAt(zbtreeInner* in, int i) {
+    int num = in->hdr.num;
+    // 删除第0个子节点时，第1个子节点的下界不再使用
+    int sep = (i > 0) ? i : 1;
+
+    memmove(in->counts + i, in->counts + i + 1, (num - i - 1) * sizeof(unsigned long));
+    memmove(in->children + i, in->children + i + 1, (num - i - 1) * sizeof(zbtreeNode*));
+    if (sep < num) {
+        memmove(in->scores + sep, in->scores + sep + 1, (num - sep - 1) * sizeof(double));
+        memmove(in->eles + sep, in->eles + sep + 1, (num - sep - 1) * sizeof(robj*));
+    }
+    in->hdr.num--;
+}
+
+/*
+ * 从叶子链表中移除叶子节点
+ */
+static void zbtUnlinkLeaf(zbtree* zbt, zbtreeLeaf* leaf) {
+    if (leaf->prev) leaf->prev->next = leaf->next; else zbt->head = leaf->next;
+    if (leaf->next) leaf->next->prev = leaf->prev; else zbt->tail = leaf->prev;
+}
+
+/*
+ * 第i个子节点已经为空，从内部节点中删除并释放
+ */
+static void zbtInnerDropChild(zbtree* zbt, zbtreeInner* in, int i) {
+    zbtreeNode* child = in->children[i];
+    int sep = (i > 0) ? i : 1;
+
+    if (child->leaf) zbtUnlinkLeaf(zbt, (zbtreeLeaf*) child);
+    if (sep < in->hdr.num) decrRefCount(in->eles[sep]);
+    zbtInnerRemoveAt(in, i);
+    zfree(child);
+}
+
+/*
+ * 第i个子节点元素过少时，如果能放入一个节点，与相邻子节点合并
+ */
+static void zbtInnerTryMerge(zbtree* zbt, zbtreeInner* in, int i) {
+    zbtreeNode* left;
+    zbtreeNode* right;
+    int l, ln, rn;
+
+    if (i + 1 < in->hdr.num)
+        l = i;
+    else if (i > 0)
+        l = i - 1;
+    else
+        return;
+
+    left = in->children[l];
+    right = in->children[l + 1];
+    ln = left->num;
+    rn = right->num;
+
+    if (left->leaf) {
+        zbtreeLeaf* ll = (zbtreeLeaf*) left;
+        zbtreeLeaf* rl = (zbtreeLeaf*) right;
+
+        if (ln + rn > ZBTREE_LEAF_MAX) return;
+
+        memcpy(ll->scores + ln, rl->scores, rn * sizeof(double));
+        memcpy(ll->eles + ln, rl->eles, rn * sizeof(robj*));
+        ll->hdr.num = ln + rn;
+        zbtUnlinkLeaf(zbt, rl);
+        // 右侧节点的下界不再使用
+        decrRefCount(in->eles[l + 1]);
+    } else {
+        zbtreeInner* li = (zbtreeInner*) left;
+        zbtreeInner* ri = (zbtreeInner*) right;
+
+        if (ln + rn > ZBTREE_INNER_MAX) return;
+
+        // 父节点中右侧节点的下界成为右侧第0个子树在合并后节点中的下界
+        li->scores[ln] = in->scores[l + 1];
+        li->eles[ln] = in->eles[l + 1];
+        memcpy(li->scores + ln + 1, ri->scores + 1, (rn - 1) * sizeof(double));
+        memcpy(li->eles + ln + 1, ri->eles + 1, (rn - 1) * sizeof(robj*));
+        memcpy(li->counts + ln, ri->counts, rn * sizeof(unsigned long));
+        memcpy(li->children + ln, ri->children, rn * sizeof(zbtreeNode*));
+        li->hdr.num = ln + rn;
+    }
+
+    in->counts[l] += in->counts[l + 1];
+    zbtInnerRemoveAt(in, l + 1);
+    zfree(right);
+}
+
+/*
+ * 从以n为根的子树中删除元素，删除成功返回1
+ */
+static int zbtDeleteNode(zbtree* zbt, zbtreeNode* n, double score, robj* obj) {
+
+    if (n->leaf) {
+        zbtreeLeaf* leaf = (zbtreeLeaf*) n;
+        int pos = zbtLeafFind(leaf, score, obj);
+        int move;
+
+        if (pos == n->num || leaf->scores[pos] != score || !equalStringObjects(leaf->eles[pos], obj))
+            return 0;
+
+        decrRefCount(leaf->eles[pos]);
+        move = n->num - pos - 1;
+        memmove(leaf->scores + pos, leaf->scores + pos + 1, move * sizeof(double));
+        memmove(leaf->eles + pos, leaf->eles + pos + 1, move * sizeof(robj*));
+        n->num--;
+        return 1;
+    } else {
+        zbtreeInner* in = (zbtreeInner*) n;
+        int i = zbtInnerFind(in, score, obj);
+        zbtreeNode* child = in->children[i];
+
+        if (!zbtDeleteNode(zbt, child, score, obj)) return 0;
+
+        in->counts[i]--;
+        if (child->num == 0)
+            zbtInnerDropChild(zbt, in, i);
+        else if (child->num < (child->leaf ? ZBTREE_LEAF_MIN : ZBTREE_INNER_MIN))
+            zbtInnerTryMerge(zbt, in, i);
+        return 1;
+    }
+}
+
+/*
+ * 删除元素，删除成功返回1，被删除的成员对象引用计数减1
+ */
+int zbtDelete(zbtree* zbt, double score, robj* obj) {
+
+    if (!zbtDeleteNode(zbt, zbt->root, score, obj)) return 0;
+    zbt->length--;
+
+    // 根节点只剩一个子节点时，树高度减1
+    while (!zbt->root->leaf && zbt->root->num == 1) {
+        zbtreeNode* old = zbt->root;
+
+        zbt->root = ((zbtreeInner*) old)->children[0];
+        zfree(old);
+    }
+
+    // 所有叶子节点都被删除
+    if (!zbt->root->leaf && zbt->root->num == 0) {
+        zfree(zbt->root);
+        zbt->head = zbt->tail = zbtCreateLeaf();
+        zbt->root = (zbtreeNode*) zbt->head;
+    }
+    return 1;
+}
+
+/*
+ * 查找第一个不满足before的元素，before对有序排列的元素必须是先真后假的，
+ * pos->leaf为NULL表示所有元素都满足before，返回在它之前的元素数量
+ */
+static unsigned long zbtSeek(zbtree* zbt, int (*before)(double, robj*, void*), void* arg, zbtreePos* pos) {
+    zbtreeNode* n = zbt->root;
+    zbtreeLeaf* leaf;
+    unsigned long rank = 0;
+    int lo, hi, i, j;
+
+    while (!n->leaf) {
+        zbtreeInner* in = (zbtreeInner*) n;
+
+        // 最后一个下界满足before的子树，它之前的子树中所有元素都满足before
+        lo = 1;
+        hi = n->num - 1;
+        i = 0;
+        while (lo <= hi) {
+            int mid = (lo + hi) / 2;
+
+            if (before(in->scores[mid], in->eles[mid], arg)) {
+                i = mid;
+                lo = mid + 1;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        for (j = 0; j < i; j++) rank += in->counts[j];
+        n = in->children[i];
+    }
+
+    leaf = (zbtreeLeaf*) n;
+    lo = 0;
+    hi = n->num;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+
+        if (before(leaf->scores[mid], leaf->eles[mid], arg))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    rank += lo;
+
+    // 叶子节点中的元素都满足before时，结果是下一个叶子节点的第一个元素
+    if (lo == n->num) {
+        leaf = leaf->next;
+        lo = 0;
+    }
+
+    pos->leaf = leaf;
+    pos->idx = lo;
+    return rank;
+}
+
+typedef struct zbtKey {
+    double score;
+    robj* obj;
+} zbtKey;
+
+static int zbtBeforeKey(double score, robj* obj, void* arg) {
+    zbtKey* key = arg;
+    return zbtCompare(score, obj, key->score, key->obj) < 0;
+}
+
+static int zbtBeforeMin(double score, robj* obj, void* arg) {
+    return !zslValueGteMin(score, arg);
+}
+
+static int zbtNotAfterMax(double score, robj* obj, void* arg) {
+    return zslValueLteMax(score, arg);
+}
+
+/*
+ * 移动到下一个元素，没有下一个元素时返回0
+ */
+int zbtNext(zbtreePos* pos) {
+    if (++pos->idx < pos->leaf->hdr.num) return 1;
+    pos->leaf = pos->leaf->next;
+    pos->idx = 0;
+    return pos->leaf != NULL;
+}
+
+/*
+ * 移动到前一个元素，没有前一个元素时返回0
+ */
+int zbtPrev(zbtreePos* pos) {
+    if (pos->idx > 0) {
+        pos->idx--;
+        return 1;
+    }
+    pos->leaf = pos->leaf->prev;
+    if (pos->leaf == NULL) return 0;
+    pos->idx = pos->leaf->hdr.num - 1;
+    return 1;
+}
+
+/*
+ * zbtSeek得到第一个超出范围上界的位置后，移动到它的前一个元素，即范围内的最后一个元素
+ */
+static int zbtSeekPrev(zbtree* zbt, zbtreePos* pos) {
+    if (pos->leaf == NULL) {
+        if (zbt->length == 0) return 0;
+        pos->leaf = zbt->tail;
+        pos->idx = zbt->tail->hdr.num - 1;
+        return 1;
+    }
+    return zbtPrev(pos);
+}
+
+/*
+ * 查找分值在range范围内的第一个元素，找到时返回它的排名(从1开始)，否则返回0
+ */
+unsigned long zbtFirstInRange(zbtree* zbt, zrangespec* range, zbtreePos* pos) {
+    unsigned long rank = zbtSeek(zbt, zbtBeforeMin, range, pos);
+
+    if (pos->leaf == NULL || !zslValueLteMax(zbtPosScore(pos), range)) return 0;
+    return rank + 1;
+}
+
+/*
+ * 查找分值在range范围内的最后一个元素，找到时返回它的排名(从1开始)，否则返回0
+ */
+unsigned long zbtLastInRange(zbtree* zbt, zrangespec* range, zbtreePos* pos) {
+    // 不超过max的元素数量就是最后一个不超过max的元素的排名
+    unsigned long rank = zbtSeek(zbt, zbtNotAfterMax, range, pos);
+
+    if (!zbtSeekPrev(zbt, pos) || !zslValueGteMin(zbtPosScore(pos), range)) return 0;
+    return rank;
+}
+
+/*
+ * 返回分值在range范围内的元素数量
+ */
+unsigned long zbtCountInRange(zbtree* zbt, zrangespec* range) {
+    zbtreePos pos;
+    unsigned long first = zbtSeek(zbt, zbtBeforeMin, range, &pos);
+    unsigned long last = zbtSeek(zbt, zbtNotAfterMax, range, &pos);
+
+    return (last > first) ? last - first : 0;
+}
+
+static int zbtBeforeLexMin(double score, robj* obj, void* arg) {
+    return !zslLexValueGteMin(obj, arg);
+}
+
+static int zbtNotAfterLexMax(double score, robj* obj, void* arg) {
+    return zslLexValueLteMax(obj, arg);
+}
+
+/*
+ * 查找成员在字典序范围range内的第一个元素，找到时返回它的排名(从1开始)，否则返回0，
+ * 和跳跃表一样，只有所有元素分值相同时结果才有意义
+ */
+unsigned long zbtFirstInLexRange(zbtree* zbt, zlexrangespec* range, zbtreePos* pos) {
+    unsigned long rank = zbtSeek(zbt, zbtBeforeLexMin, range, pos);
+
+    if (pos->leaf == NULL || !zslLexValueLteMax(zbtPosObj(pos), range)) return 0;
+    return rank + 1;
+}
+
+/*
+ * 查找成员在字典序范围range内的最后一个元素，找到时返回它的排名(从1开始)，否则返回0
+ */
+unsigned long zbtLastInLexRange(zbtree* zbt, zlexrangespec* range, zbtreePos* pos) {
+    unsigned long rank = zbtSeek(zbt, zbtNotAfterLexMax, range, pos);
+
+    if (!zbtSeekPrev(zbt, pos) || !zslLexValueGteMin(zbtPosObj(pos), range)) return 0;
+    return rank;
+}
+
+/*
+ * 返回成员在字典序范围range内的元素数量
+ */
+unsigned long zbtCountInLexRange(zbtree* zbt, zlexrangespec* range) {
+    zbtreePos pos;
+    unsigned long first = zbtSeek(zbt, zbtBeforeLexMin, range, &pos);
+    unsigned long last = zbtSeek(zbt, zbtNotAfterLexMax, range, &pos);
+
+    return (last > first) ? last - first : 0;
+}
+
+/*
+ * 删除排名在[start, end]范围内的元素(排名从1开始)，同时从字典dict中删除成员，返回删除的元素数量；
+ * 每次删除后重新按排名定位，每个元素的代价是O(logN)
+ */
+unsigned long zbtDeleteRangeByRank(zbtree* zbt, unsigned long start, unsigned long end, dict* dict) {
+    unsigned long removed = 0;
+    zbtreePos pos;
+
+    while (start + removed <= end && zbtGetElementByRank(zbt, start, &pos)) {
+        robj* obj = zbtPosObj(&pos);
+
+        // 字典仍然持有成员的引用，先从B+树中删除
+        assert(zbtDelete(zbt, zbtPosScore(&pos), obj));
+        dictDelete(dict, obj);
+        removed++;
+    }
+
+    return removed;
+}
+
+/*
+ * 删除分值在range范围内的元素，同时从字典dict中删除成员，返回删除的元素数量
+ */
+unsigned long zbtDeleteRangeByScore(zbtree* zbt, zrangespec* range, dict* dict) {
+    zbtreePos pos;
+    unsigned long first = zbtFirstInRange(zbt, range, &pos);
+
+    if (first == 0) return 0;
+    return zbtDeleteRangeByRank(zbt, first, first + zbtCountInRange(zbt, range) - 1, dict);
+}
+
+/*
+ * 返回元素的排名，排名从1开始，元素不存在时返回0
+ */
+unsigned long zbtGetRank(zbtree* zbt, double score, robj* obj) {
+    zbtKey key = {score, obj};
+    zbtreePos pos;
+    unsigned long rank = zbtSeek(zbt, zbtBeforeKey, &key, &pos);
+
+    if (pos.leaf == NULL || zbtPosScore(&pos) != score || !equalStringObjects(zbtPosObj(&pos), obj))
+        return 0;
+    return rank + 1;
+}
+
+/*
+ * 查找排名为rank的元素，排名从1开始，找到返回1
+ */
+int zbtGetElementByRank(zbtree* zbt, unsigned long rank, zbtreePos* pos) {
+    zbtreeNode* n = zbt->root;
+
+    if (rank < 1 || rank > zbt->length) return 0;
+
+    rank--;
+    while (!n->leaf) {
+        zbtreeInner* in = (zbtreeInner*) n;
+        int i = 0;
+
+        while (rank >= in->counts[i]) {
+            rank -= in->counts[i];
+            i++;
+        }
+        n = in->children[i];
+    }
+
+    pos->leaf = (zbtreeLeaf*) n;
+    pos->idx = rank;
+    return 1;
+}
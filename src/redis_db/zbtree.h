@@ -0,0 +1,99 @@
+//
+// Created by zouyi on 2021/11/11.
+//
+
+#ifndef TINYREDIS_ZBTREE_H
+#define TINYREDIS_ZBTREE_H
+
+#include "redis_obj.h"
+
+/*
+ * 有序集合使用的B+树，按照(分值, 成员)排序，用于元素很多的有序集合
+ *
+ * 叶子节点连续保存分值数组和成员数组，叶子节点之间双向链接，范围遍历按顺序访问连续内存；
+ * 内部节点保存每个子节点的下界和子树中的元素数量，按排名查找和计算排名都是O(logN)，
+ * 与跳跃表相比，每个元素不需要单独分配节点和层指针
+ */
+#define ZBTREE_LEAF_MAX 64
+#define ZBTREE_INNER_MAX 64
+
+/*
+ * B+树节点的公共头部
+ */
+typedef struct zbtreeNode {
+
+    // 1表示叶子节点，0表示内部节点
+    int leaf;
+
+    // 叶子节点中的元素数量，或者内部节点中的子节点数量
+    int num;
+
+} zbtreeNode;
+
+/*
+ * 叶子节点
+ */
+typedef struct zbtreeLeaf {
+
+    zbtreeNode hdr;
+
+    // 前一个和后一个叶子节点
+    struct zbtreeLeaf* prev;
+    struct zbtreeLeaf* next;
+
+    // 有序排列的分值和成员
+    double scores[ZBTREE_LEAF_MAX];
+    robj* eles[ZBTREE_LEAF_MAX];
+
+} zbtreeLeaf;
+
+/*
+ * 内部节点
+ */
+typedef struct zbtreeInner {
+
+    zbtreeNode hdr;
+
+    // scores[i], eles[i]是第i个子树中元素的下界，同时大于第i-1个子树中的所有元素，下标0不使用，
+    // 删除元素不会修改下界，所以下界对象持有自己的引用
+    double scores[ZBTREE_INNER_MAX];
+    robj* eles[ZBTREE_INNER_MAX];
+
+    // 每个子树中的元素数量
+    unsigned long counts[ZBTREE_INNER_MAX];
+
+    zbtreeNode* children[ZBTREE_INNER_MAX];
+
+} zbtreeInner;
+
+/*
+ * B+树
+ */
+typedef struct zbtree {
+
+    zbtreeNode* root;
+
+    // 第一个和最后一个叶子节点
+    zbtreeLeaf* head;
+    zbtreeLeaf* tail;
+
+    // 元素数量
+    unsigned long length;
+
+} zbtree;
+
+/*
+ * 指向B+树中一个元素的位置
+ */
+typedef struct zbtreePos {
+
+    zbtreeLeaf* leaf;
+
+    int idx;
+
+} zbtreePos;
+
+#define zbtPosScore(p) ((p)->leaf->scores[(p)->idx])
+#define zbtPosObj(p) ((p)->leaf->eles[(p)->idx])
+
+#endif //TINYREDIS_ZBTREE_H
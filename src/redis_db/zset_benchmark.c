@@ -0,0 +1,243 @@
+//
+// Created by zouyi on 2021/11/11.
+//
+
+/*
+ * 有序集合跳跃表编码与B+树编码的性能对比
+ *
+ * 连接到运行中的服务器，通过CONFIG SET zset-max-skiplist-entries分别让有序集合使用跳跃表和B+树，
+ * 对同样的数据测试ZADD，ZRANGE(随机位置的10个元素)，ZRANK(随机成员)的吞吐量，
+ * 命令以流水线方式发送，减少网络往返对结果的影响
+ *
+ * 编译: make zset-benchmark
+ * 运行: ./zset_benchmark [端口] [元素数量] [查询次数]
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define PIPELINE 256
+#define ZADD_BATCH 64
+
+// 一个ZADD命令最多ZADD_BATCH个分值和成员，每个参数不超过32字节
+#define CMD_MAX_LEN (ZADD_BATCH * 2 * 48 + 64)
+
+static char rbuf[1 << 16];
+static size_t rpos = 0, rlen = 0;
+
+static long long ustime(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (long long) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static int readByte(int fd) {
+    if (rpos == rlen) {
+        ssize_t n = read(fd, rbuf, sizeof(rbuf));
+        if (n <= 0) {
+            fprintf(stderr, "connection lost\n");
+            exit(1);
+        }
+        rpos = 0;
+        rlen = n;
+    }
+    return (unsigned char) rbuf[rpos++];
+}
+
+static void readLine(int fd, char* line, size_t size) {
+    size_t i = 0;
+    int ch;
+
+    while ((ch = readByte(fd)) != '\n') {
+        if (ch != '\r' && i + 1 < size) line[i++] = ch;
+    }
+    line[i] = '\0';
+}
+
+/*
+ * 读取并丢弃一个回复，遇到错误回复时退出
+ */
+static void skipReply(int fd) {
+    char line[256];
+    long n;
+
+    readLine(fd, line, sizeof(line));
+    switch (line[0]) {
+        case '-':
+            fprintf(stderr, "server error: %s\n", line + 1);
+            exit(1);
+        case '$':
+            n = strtol(line + 1, NULL, 10);
+            if (n >= 0) {
+                n += 2;
+                while (n--) readByte(fd);
+            }
+            break;
+        case '*':
+            n = strtol(line + 1, NULL, 10);
+            while (n-- > 0) skipReply(fd);
+            break;
+        default:
+            break;
+    }
+}
+
+static void writeAll(int fd, const char* buf, size_t len) {
+    while (len) {
+        ssize_t n = write(fd, buf, len);
+        if (n <= 0) {
+            perror("write");
+            exit(1);
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+/*
+ * 追加一个多条批量格式的命令，argv中的参数都是C字符串
+ */
+static size_t appendCommand(char* buf, int argc, char** argv) {
+    size_t len = sprintf(buf, "*%d\r\n", argc);
+    int i;
+
+    for (i = 0; i < argc; i++)
+        len += sprintf(buf + len, "$%zu\r\n%s\r\n", strlen(argv[i]), argv[i]);
+    return len;
+}
+
+static void command(int fd, int argc, char** argv) {
+    char buf[1024];
+
+    writeAll(fd, buf, appendCommand(buf, argc, argv));
+    skipReply(fd);
+}
+
+static int connectServer(int port) {
+    struct sockaddr_in sa;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &sa.sin_addr);
+    if (fd < 0 || connect(fd, (struct sockaddr*) &sa, sizeof(sa)) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+static void report(const char* name, long ops, long long us) {
+    printf("  %-6s: %9.0f ops/sec (%ld ops, %.2f s)\n", name, ops * 1000000.0 / us, ops, us / 1000000.0);
+}
+
+/*
+ * 以指定的跳跃表元素数量上限运行一轮测试，members个元素，分值随机
+ */
+static void bench(int fd, const char* encoding, const char* maxskiplist, long members, long queries) {
+    char* cmdbuf = malloc(PIPELINE * CMD_MAX_LEN);
+    char* argv[2 + ZADD_BATCH * 2];
+    char args[ZADD_BATCH * 2][32];
+    char* cfg[] = {"config", "set", "zset-max-skiplist-entries", (char*) maxskiplist};
+    char* del[] = {"del", "zbench"};
+    long i, j, sent, pending;
+    long long start;
+    size_t len;
+
+    command(fd, 4, cfg);
+    command(fd, 2, del);
+    printf("%s (%ld members)\n", encoding, members);
+
+    // ZADD: 每个命令添加ZADD_BATCH个元素
+    srand(1);
+    start = ustime();
+    for (i = 0; i < members;) {
+        len = 0;
+        for (pending = 0; pending < PIPELINE && i < members; pending++) {
+            int argc = 2;
+
+            argv[0] = "zadd";
+            argv[1] = "zbench";
+            for (j = 0; j < ZADD_BATCH && i < members; j++, i++) {
+                sprintf(args[j * 2], "%d", rand() % 1000000000);
+                sprintf(args[j * 2 + 1], "member:%ld", i);
+                argv[argc++] = args[j * 2];
+                argv[argc++] = args[j * 2 + 1];
+            }
+            len += appendCommand(cmdbuf + len, argc, argv);
+        }
+        writeAll(fd, cmdbuf, len);
+        while (pending--) skipReply(fd);
+    }
+    report("ZADD", members, ustime() - start);
+
+    // ZRANGE: 随机起始位置的10个元素
+    start = ustime();
+    for (sent = 0; sent < queries;) {
+        len = 0;
+        for (pending = 0; pending < PIPELINE && sent < queries; pending++, sent++) {
+            long offset = ((long) rand() * RAND_MAX + rand()) % members;
+
+            sprintf(args[0], "%ld", offset);
+            sprintf(args[1], "%ld", offset + 9);
+            argv[0] = "zrange";
+            argv[1] = "zbench";
+            argv[2] = args[0];
+            argv[3] = args[1];
+            len += appendCommand(cmdbuf + len, 4, argv);
+        }
+        writeAll(fd, cmdbuf, len);
+        while (pending--) skipReply(fd);
+    }
+    report("ZRANGE", queries, ustime() - start);
+
+    // ZRANK: 随机成员
+    start = ustime();
+    for (sent = 0; sent < queries;) {
+        len = 0;
+        for (pending = 0; pending < PIPELINE && sent < queries; pending++, sent++) {
+            sprintf(args[0], "member:%ld", ((long) rand() * RAND_MAX + rand()) % members);
+            argv[0] = "zrank";
+            argv[1] = "zbench";
+            argv[2] = args[0];
+            len += appendCommand(cmdbuf + len, 3, argv);
+        }
+        writeAll(fd, cmdbuf, len);
+        while (pending--) skipReply(fd);
+    }
+    report("ZRANK", queries, ustime() - start);
+
+    command(fd, 2, del);
+    free(cmdbuf);
+}
+
+int main(int argc, char** argv) {
+    int port = argc > 1 ? atoi(argv[1]) : 6379;
+    long members = argc > 2 ? atol(argv[2]) : 10000000;
+    long queries = argc > 3 ? atol(argv[3]) : 1000000;
+    char maxskiplist[32];
+    int fd;
+
+    if (port <= 0 || members <= 0 || queries <= 0) {
+        fprintf(stderr, "usage: %s [port] [members] [queries]\n", argv[0]);
+        return 1;
+    }
+
+    fd = connectServer(port);
+    sprintf(maxskiplist, "%ld", members);
+
+    bench(fd, "skiplist", maxskiplist, members, queries);
+    bench(fd, "btree", "0", members, queries);
+
+    close(fd);
+    return 0;
+}
@@ -516,4 +516,158 @@ int zslParseRange(robj* min, robj* max, zrangespec* spec) {
     }
 
     return REDIS_OK;
-}
\ No newline at end of file
+}
+/*
+ * 解析字典序范围的一端，'['表示闭区间，'('表示开区间，'-'和'+'分别表示负无穷和正无穷
+ */
+static int zslParseLexRangeItem(robj* item, robj** dest, int* ex) {
+    char* c = item->ptr;
+
+    switch (c[0]) {
+        case '+':
+            if (c[1] != '\0') return REDIS_ERR;
+            *ex = 0;
+            *dest = shared.maxstring;
+            incrRefCount(shared.maxstring);
+            return REDIS_OK;
+        case '-':
+            if (c[1] != '\0') return REDIS_ERR;
+            *ex = 0;
+            *dest = shared.minstring;
+            incrRefCount(shared.minstring);
+            return REDIS_OK;
+        case '(':
+            *ex = 1;
+            *dest = createStringObject(c + 1, sdslen(c) - 1);
+            return REDIS_OK;
+        case '[':
+            *ex = 0;
+            *dest = createStringObject(c + 1, sdslen(c) - 1);
+            return REDIS_OK;
+        default:
+            return REDIS_ERR;
+    }
+}
+
+/*
+ * 解析ZRANGEBYLEX等命令的字典序范围，成功时调用者需要使用zslFreeLexRange释放spec
+ */
+int zslParseLexRange(robj* min, robj* max, zlexrangespec* spec) {
+
+    // 整数编码的对象不可能以'(' '['开头
+    if (min->encoding == REDIS_ENCODING_INT || max->encoding == REDIS_ENCODING_INT) return REDIS_ERR;
+
+    spec->min = spec->max = NULL;
+    if (zslParseLexRangeItem(min, &spec->min, &spec->minex) == REDIS_ERR ||
+        zslParseLexRangeItem(max, &spec->max, &spec->maxex) == REDIS_ERR) {
+        if (spec->min) decrRefCount(spec->min);
+        if (spec->max) decrRefCount(spec->max);
+        return REDIS_ERR;
+    }
+
+    return REDIS_OK;
+}
+
+/*
+ * 释放字典序范围中的对象
+ */
+void zslFreeLexRange(zlexrangespec* spec) {
+    decrRefCount(spec->min);
+    decrRefCount(spec->max);
+}
+
+/*
+ * 按字典序比较两个字符串对象，shared.minstring和shared.maxstring分别小于和大于任何字符串
+ */
+int compareStringObjectsForLexRange(robj* a, robj* b) {
+    if (a == b) return 0;
+    if (a == shared.minstring || b == shared.maxstring) return -1;
+    if (a == shared.maxstring || b == shared.minstring) return 1;
+    return compareStringObjects(a, b);
+}
+
+/*
+ * 检查value是否大于字典序范围内的最小值
+ */
+int zslLexValueGteMin(robj* value, zlexrangespec* spec) {
+    return spec->minex ?
+        (compareStringObjectsForLexRange(value, spec->min) > 0) :
+        (compareStringObjectsForLexRange(value, spec->min) >= 0);
+}
+
+/*
+ * 检查value是否小于字典序范围内的最大值
+ */
+int zslLexValueLteMax(robj* value, zlexrangespec* spec) {
+    return spec->maxex ?
+        (compareStringObjectsForLexRange(value, spec->max) < 0) :
+        (compareStringObjectsForLexRange(value, spec->max) <= 0);
+}
+
+/*
+ * 检查跳跃表所含成员范围与给定字典序范围是否有交集，有返回1，否则返回0
+ */
+int zslIsInLexRange(zskiplist* zsl, zlexrangespec* range) {
+    zskiplistNode* x;
+    int cmp = compareStringObjectsForLexRange(range->min, range->max);
+
+    // 空的范围值，直接返回0
+    if (cmp > 0 || (cmp == 0 && (range->minex || range->maxex)))
+        return 0;
+
+    x = zsl->tail;
+    if (x == NULL || !zslLexValueGteMin(x->obj, range))
+        return 0;
+
+    x = zsl->header->level[0].forward;
+    if (x == NULL || !zslLexValueLteMax(x->obj, range))
+        return 0;
+
+    return 1;
+}
+
+/*
+ * 返回跳跃表zsl中第一个处于字典序范围range内的节点，
+ * 只有所有元素分值相同时，字典序范围才有意义
+ */
+zskiplistNode* zslFirstInLexRange(zskiplist* zsl, zlexrangespec* range) {
+    zskiplistNode* x;
+    int i;
+
+    if (!zslIsInLexRange(zsl, range)) return NULL;
+
+    x = zsl->header;
+    for (i = zsl->level - 1; i >= 0; i--) {
+        while (x->level[i].forward && !zslLexValueGteMin(x->level[i].forward->obj, range))
+            x = x->level[i].forward;
+    }
+
+    x = x->level[0].forward;
+    assert(x != NULL);
+
+    if (!zslLexValueLteMax(x->obj, range)) return NULL;
+
+    return x;
+}
+
+/*
+ * 返回跳跃表zsl中最后一个处于字典序范围range内的节点
+ */
+zskiplistNode* zslLastInLexRange(zskiplist* zsl, zlexrangespec* range) {
+    zskiplistNode* x;
+    int i;
+
+    if (!zslIsInLexRange(zsl, range)) return NULL;
+
+    x = zsl->header;
+    for (i = zsl->level - 1; i >= 0; i--) {
+        while (x->level[i].forward && zslLexValueLteMax(x->level[i].forward->obj, range))
+            x = x->level[i].forward;
+    }
+
+    assert(x != NULL);
+
+    if (!zslLexValueGteMin(x->obj, range)) return NULL;
+
+    return x;
+}